@@ -0,0 +1,769 @@
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include <fstream>
+
+#include "BattleLog.h"
+#include "CombatantPolicies.h"
+#include "EventQueue.h"
+#include "TrialSampler.h"
+
+#include "BattleEngine.h"
+
+
+inline int Min(int number1, int number2)
+{
+    return (number1 < number2) ? number1 : number2;
+}
+
+
+inline int Max(int number1, int number2)
+{
+    return (number1 > number2) ? number1 : number2;
+}
+
+
+/* bin of a value from 0 to range in a histogram, values at or past the ends go in the end bins */
+inline int HistogramBin(long long value, long long range, int numBins)
+{
+    if (value <= 0 || range <= 0) return 0;
+    if (value >= range) return numBins - 1;
+    return (int) (value * numBins / range);
+}
+
+
+/* number of whole fast attacks the attacker can make ahead of the one it is starting without anything else happening */
+/* they all finish before the defender lands damage or starts an attack, with the battle timer running and the defender standing, */
+/* and leave the attacker's energy below its special attack, where every policy chooses a fast attack */
+inline int NumSkippedFastAttacks(EventQueue &defenderEventQueue, int minDefensiveInterval, int battleTimer, int defenderBattleHP, int energy,
+                                 int specialAttackEnergy, int maxEnergy, int fastAttackDamage, int fastAttackEnergy, int fastAttackDuration)
+{
+    int quietTime;
+    int numFastAttacks;
+
+    /* rule out the common cases before looking through the defender's events and dividing */
+    if (battleTimer <= fastAttackDuration || defenderBattleHP <= fastAttackDamage) return 0;
+    if (maxEnergy >= specialAttackEnergy && energy + fastAttackEnergy >= specialAttackEnergy) return 0;
+    if (fastAttackDamage <= 0 || fastAttackDuration <= 0) return 0;
+    quietTime = defenderEventQueue.QuietTime(minDefensiveInterval);
+    if (quietTime <= fastAttackDuration) return 0;
+
+    numFastAttacks = Min((quietTime - 1) / fastAttackDuration, (battleTimer - 1) / fastAttackDuration);
+    numFastAttacks = Min(numFastAttacks, (defenderBattleHP - 1) / fastAttackDamage);
+    if (maxEnergy >= specialAttackEnergy && fastAttackEnergy > 0) {
+        numFastAttacks = Min(numFastAttacks, (specialAttackEnergy - 1 - energy) / fastAttackEnergy);
+    }
+    return numFastAttacks;
+}
+
+
+/* limits on how fast each combatant can land damage, for deciding battles before they end */
+/* the attacker starts attacks back to back, and the defender chains its attacks with intervals, */
+/* so the cycles are the least and most time from one attack starting to the next, and the landings the time from start to damage */
+struct DamageBounds {
+    int minAttackerDamage, maxAttackerDamage;
+    int minAttackerCycle, maxAttackerCycle;
+    int minAttackerLanding, maxAttackerLanding;
+    int minDefenderDamage, maxDefenderDamage;
+    int minDefenderCycle, maxDefenderCycle;
+    int maxDefenderLanding;
+    int maxDefensiveInterval;
+};
+
+
+/* set the bounds of a battle, or return false if its attacks are too short to bound */
+/* special attacks only count if the combatant can ever have the energy for them */
+bool SetDamageBounds(const BattleParameters &parameters, int minDefensiveInterval, int maxDefensiveInterval, DamageBounds &bounds)
+{
+    int specialAttackCycle, specialAttackLanding;
+
+    bounds.minAttackerDamage = parameters.attackerFastAttackDamage;
+    bounds.maxAttackerDamage = parameters.attackerFastAttackDamage;
+    bounds.minAttackerCycle = parameters.attackerFastAttackDuration;
+    bounds.maxAttackerCycle = parameters.attackerFastAttackDuration;
+    bounds.minAttackerLanding = parameters.attackerFastAttackDamageStart;
+    bounds.maxAttackerLanding = parameters.attackerFastAttackDamageStart;
+    if (parameters.maxAttackerEnergy >= -parameters.attackerSpecialAttackEnergy) {
+        specialAttackCycle = parameters.longPressDuration + parameters.attackerSpecialAttackDuration;
+        specialAttackLanding = parameters.longPressDuration + parameters.attackerSpecialAttackDamageStart;
+        bounds.minAttackerDamage = Min(bounds.minAttackerDamage, parameters.attackerSpecialAttackDamage);
+        bounds.maxAttackerDamage = Max(bounds.maxAttackerDamage, parameters.attackerSpecialAttackDamage);
+        bounds.minAttackerCycle = Min(bounds.minAttackerCycle, specialAttackCycle);
+        bounds.maxAttackerCycle = Max(bounds.maxAttackerCycle, specialAttackCycle);
+        bounds.minAttackerLanding = Min(bounds.minAttackerLanding, specialAttackLanding);
+        bounds.maxAttackerLanding = Max(bounds.maxAttackerLanding, specialAttackLanding);
+    }
+
+    bounds.minDefenderDamage = parameters.defenderFastAttackDamage;
+    bounds.maxDefenderDamage = parameters.defenderFastAttackDamage;
+    bounds.minDefenderCycle = parameters.defenderFastAttackDuration;
+    bounds.maxDefenderCycle = parameters.defenderFastAttackDuration;
+    bounds.maxDefenderLanding = parameters.defenderFastAttackDamageStart;
+    if (parameters.maxDefenderEnergy >= -parameters.defenderSpecialAttackEnergy) {
+        bounds.minDefenderDamage = Min(bounds.minDefenderDamage, parameters.defenderSpecialAttackDamage);
+        bounds.maxDefenderDamage = Max(bounds.maxDefenderDamage, parameters.defenderSpecialAttackDamage);
+        bounds.minDefenderCycle = Min(bounds.minDefenderCycle, parameters.defenderSpecialAttackDuration);
+        bounds.maxDefenderCycle = Max(bounds.maxDefenderCycle, parameters.defenderSpecialAttackDuration);
+        bounds.maxDefenderLanding = Max(bounds.maxDefenderLanding, parameters.defenderSpecialAttackDamageStart);
+    }
+    if (parameters.defenderTransforms) {
+        bounds.minDefenderDamage = Min(bounds.minDefenderDamage, parameters.transformDamage);
+        bounds.maxDefenderDamage = Max(bounds.maxDefenderDamage, parameters.transformDamage);
+        bounds.maxDefenderLanding = Max(bounds.maxDefenderLanding, parameters.transformDamageStart);
+    }
+    bounds.minDefenderCycle += Max(minDefensiveInterval, 0);
+    bounds.maxDefenderCycle += maxDefensiveInterval;
+    bounds.maxDefensiveInterval = maxDefensiveInterval;
+    return bounds.minAttackerDamage > 0 && bounds.minAttackerCycle > 0 && bounds.minDefenderCycle > 0 && bounds.maxDefenderCycle > 0;
+}
+
+
+/* whether the winner is certain when the attacker starts an attack, and if so whether it is the attacker */
+/* the attacker loses if it cannot deal the defender's HP in the time left or the defender must defeat it before it can win, */
+/* and it wins if it must defeat the defender before the battle ends while the defender cannot defeat it by then */
+inline bool OutcomeDecided(const DamageBounds &bounds, EventQueue &defenderEventQueue, int battleTimer, int attackerBattleHP, int defenderBattleHP,
+                           bool &attackerWins)
+{
+    int numAttacks;
+    int winTime;
+
+    attackerWins = false;
+    if ((battleTimer / bounds.minAttackerCycle + 1) * (long long) bounds.maxAttackerDamage < defenderBattleHP) return true;
+    numAttacks = (defenderBattleHP + bounds.maxAttackerDamage - 1) / bounds.maxAttackerDamage;
+    winTime = Min((numAttacks - 1) * bounds.minAttackerCycle + bounds.minAttackerLanding, battleTimer);
+    if (defenderEventQueue.NumLandings(winTime, bounds.maxDefenderLanding, bounds.maxDefensiveInterval, bounds.maxDefenderCycle) *
+        (long long) bounds.minDefenderDamage >= attackerBattleHP) return true;
+
+    attackerWins = true;
+    numAttacks = (defenderBattleHP + bounds.minAttackerDamage - 1) / bounds.minAttackerDamage;
+    winTime = (numAttacks - 1) * bounds.maxAttackerCycle + bounds.maxAttackerLanding;
+    if (winTime >= battleTimer) return false;
+    return (defenderEventQueue.NumAttacks(winTime) + winTime / bounds.minDefenderCycle + 1) * (long long) bounds.maxDefenderDamage < attackerBattleHP;
+}
+
+
+/* antithetic pairs and randomized point sets are the independent samples for the variance estimate */
+long TrialsPerGroup(const BattleParameters &parameters)
+{
+    if (parameters.quasiMonteCarlo) {
+        return parameters.numTrials / parameters.numRandomizations;
+    } else if (parameters.antitheticTrials) {
+        return 2;
+    } else {
+        return 1;
+    }
+}
+
+
+/* every trial can be simulated on its own except with the single rand() stream */
+bool TrialsAreSeparable(const BattleParameters &parameters)
+{
+    return !parameters.randomness || parameters.commonRandomNumbers || parameters.antitheticTrials || parameters.quasiMonteCarlo;
+}
+
+
+/* simulate trials with the given attacker and defender policies */
+template <class AttackerPolicy, class DefenderPolicy>
+void SimulateTrialsWith(const BattleParameters &parameters, std::ofstream &logFile, long firstTrial, long numTrials, BattleTally &tally,
+                        TrialStatistics *statistics, AttackerPolicy attacker, DefenderPolicy defender)
+{
+    bool         randomness;
+    int          attackerHP, defenderHP, scaledDefenderHP;
+    bool         attackerTransforms, defenderTransforms;
+    int          attackerFastAttackDamage, attackerSpecialAttackDamage, defenderFastAttackDamage, defenderSpecialAttackDamage;
+    int          attackerFastAttackEnergy, attackerSpecialAttackEnergy, defenderFastAttackEnergy, defenderSpecialAttackEnergy;
+    int          attackerFastAttackDamageStart, attackerSpecialAttackDamageStart, defenderFastAttackDamageStart, defenderSpecialAttackDamageStart;
+    int          attackerFastAttackDuration, attackerSpecialAttackDuration, defenderFastAttackDuration, defenderSpecialAttackDuration;
+    int          transformDamage, transformEnergy, transformDamageStart, transformDuration;
+    double       defensiveHPMultiplier;
+    int          maxAttackerEnergy, maxDefenderEnergy;
+    double       energyPerDamage;
+    int          battleDuration, longPressDuration;
+    int          offensiveInitialInterval;
+    int          numDefensiveInitialIntervals;
+    const int    *defensiveInitialIntervals;
+    int          defensiveInterval, defensiveIntervalRandomness;
+    TrialSampler sampler(parameters);
+    EventQueue   attackerEventQueue, defenderEventQueue;
+    long         trialsPerGroup, groupWins;
+    int          defenderTime;
+    int          battleTimer, nextTime;
+    int          attackerBattleHP, defenderBattleHP;
+    int          attackerEnergy, defenderEnergy;
+    int          numAttackerSpecialAttacks, numDefenderSpecialAttacks;
+    long long    duration;
+    PlayerEvents playerEvent;
+    bool         specialAttack;
+    int          interval;
+    int          fastAttackDefenderEnergy, minDefensiveInterval, maxDefensiveInterval;
+    int          numSkippedFastAttacks, skippedTime;
+    DamageBounds bounds;
+    bool         earlyOutcomes, outcomeDecided, attackerWins;
+    int          nextOutcomeCheck;
+    long         i;
+
+#if !LOG
+    /* battles are only logged by log builds */
+    (void) logFile;
+#endif
+
+    /* copy parameters into locals for the inner loop */
+    randomness = parameters.randomness;
+    attackerHP = parameters.attackerHP;
+    defenderHP = parameters.defenderHP;
+    attackerTransforms = parameters.attackerTransforms;
+    defenderTransforms = parameters.defenderTransforms;
+    attackerFastAttackDamage = parameters.attackerFastAttackDamage;
+    attackerFastAttackEnergy = parameters.attackerFastAttackEnergy;
+    attackerFastAttackDamageStart = parameters.attackerFastAttackDamageStart;
+    attackerFastAttackDuration = parameters.attackerFastAttackDuration;
+    attackerSpecialAttackDamage = parameters.attackerSpecialAttackDamage;
+    attackerSpecialAttackEnergy = parameters.attackerSpecialAttackEnergy;
+    attackerSpecialAttackDamageStart = parameters.attackerSpecialAttackDamageStart;
+    attackerSpecialAttackDuration = parameters.attackerSpecialAttackDuration;
+    defenderFastAttackDamage = parameters.defenderFastAttackDamage;
+    defenderFastAttackEnergy = parameters.defenderFastAttackEnergy;
+    defenderFastAttackDamageStart = parameters.defenderFastAttackDamageStart;
+    defenderFastAttackDuration = parameters.defenderFastAttackDuration;
+    defenderSpecialAttackDamage = parameters.defenderSpecialAttackDamage;
+    defenderSpecialAttackEnergy = parameters.defenderSpecialAttackEnergy;
+    defenderSpecialAttackDamageStart = parameters.defenderSpecialAttackDamageStart;
+    defenderSpecialAttackDuration = parameters.defenderSpecialAttackDuration;
+    transformDamage = parameters.transformDamage;
+    transformEnergy = parameters.transformEnergy;
+    transformDamageStart = parameters.transformDamageStart;
+    transformDuration = parameters.transformDuration;
+    defensiveHPMultiplier = parameters.defensiveHPMultiplier;
+    maxAttackerEnergy = parameters.maxAttackerEnergy;
+    maxDefenderEnergy = parameters.maxDefenderEnergy;
+    energyPerDamage = parameters.energyPerDamage;
+    battleDuration = parameters.battleDuration;
+    longPressDuration = parameters.longPressDuration;
+    offensiveInitialInterval = parameters.offensiveInitialInterval;
+    numDefensiveInitialIntervals = parameters.numDefensiveInitialIntervals;
+    defensiveInitialIntervals = parameters.defensiveInitialIntervals;
+    defensiveInterval = parameters.defensiveInterval;
+    defensiveIntervalRandomness = parameters.defensiveIntervalRandomness;
+    scaledDefenderHP = (int) (defenderHP * defensiveHPMultiplier);
+    fastAttackDefenderEnergy = (int) round(attackerFastAttackDamage * energyPerDamage + tolerance);
+    if (randomness) {
+        minDefensiveInterval = defensiveInterval - defensiveIntervalRandomness / 2;
+        maxDefensiveInterval = minDefensiveInterval + defensiveIntervalRandomness;
+    } else {
+        minDefensiveInterval = defensiveInterval;
+        maxDefensiveInterval = defensiveInterval;
+    }
+    /* stopping a trial early leaves its statistics unfinished and the rand() stream where the next trial would not find it */
+#if LOG
+    earlyOutcomes = false;
+#else
+    earlyOutcomes = !statistics && TrialsAreSeparable(parameters) && SetDamageBounds(parameters, minDefensiveInterval, maxDefensiveInterval, bounds);
+#endif
+
+    trialsPerGroup = TrialsPerGroup(parameters);
+    assert(firstTrial % trialsPerGroup == 0 && numTrials % trialsPerGroup == 0);
+    assert(firstTrial == 0 || TrialsAreSeparable(parameters));
+
+    /* perform Monte Carlo trials */
+    groupWins = 0;
+    for (i = firstTrial; i < firstTrial + numTrials; ++i) {
+        sampler.StartTrial(i);
+
+        /* set up event queues */
+        attackerEventQueue.Initialize(1);
+        if (attackerTransforms) {
+            attackerEventQueue.Add(offensiveInitialInterval, PlayerStartsTransform);
+        } else {
+            attackerEventQueue.Add(offensiveInitialInterval, PlayerStartsAttack);
+        }
+        defenderEventQueue.Initialize(numDefensiveInitialIntervals);
+        defenderTime = defensiveInitialIntervals[0];
+        if (defenderTransforms) {
+            defenderEventQueue.Add(defenderTime, PlayerStartsTransform);
+        } else {
+            defenderEventQueue.Add(defenderTime, PlayerStartsInitialAttack);
+        }
+        defenderTime += defensiveInitialIntervals[1];
+        defenderEventQueue.Add(defenderTime, PlayerStartsInitialAttack);
+        if (randomness) {
+            defenderTime += sampler.Interval(defensiveInitialIntervals[2], defensiveIntervalRandomness);
+        } else {
+            defenderTime += defensiveInitialIntervals[2];
+        }
+        defenderEventQueue.Add(defenderTime, PlayerStartsAttack);
+
+        /* simulate battle */
+        battleTimer = battleDuration;
+        attackerBattleHP = attackerHP;
+        defenderBattleHP = scaledDefenderHP;
+        attackerEnergy = 0;
+        defenderEnergy = 0;
+        attacker.StartBattle(parameters);
+        defender.StartBattle(parameters);
+        numAttackerSpecialAttacks = 0;
+        numDefenderSpecialAttacks = 0;
+        outcomeDecided = false;
+        nextOutcomeCheck = battleDuration;
+        LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "battle starts");
+        while (battleTimer > 0 && attackerBattleHP > 0 && defenderBattleHP > 0 && !outcomeDecided) {
+
+            /* count down timers to next event */
+            nextTime = Min(attackerEventQueue.Timer(), defenderEventQueue.Timer());
+            attackerEventQueue.CountDown(nextTime);
+            defenderEventQueue.CountDown(nextTime);
+            battleTimer -= nextTime;
+
+            /* check if time for next attacker event */
+            if (attackerEventQueue.Timer() == 0) {
+                playerEvent = attackerEventQueue.Pop();
+
+                /* attacker finishes action */
+                switch (playerEvent) {
+                case PlayerFinishesLongPress:
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker finishes long press");
+                    break;
+                case PlayerLandsFastAttack:
+                    /* attacker lands fast attack damage */
+                    defenderBattleHP -= attackerFastAttackDamage;
+                    defenderEnergy = Min(defenderEnergy + (int) round(attackerFastAttackDamage * energyPerDamage + tolerance), maxDefenderEnergy);
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker lands fast attack");
+                    break;
+                case PlayerLandsSpecialAttack:
+                    /* attacker lands special attack damage */
+                    defenderBattleHP -= attackerSpecialAttackDamage;
+                    defenderEnergy = Min(defenderEnergy + (int) round(attackerSpecialAttackDamage * energyPerDamage + tolerance), maxDefenderEnergy);
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker lands special attack");
+                    break;
+                case PlayerLandsTransform:
+                    /* attacker lands transform damage */
+                    defenderBattleHP -= transformDamage;
+                    defenderEnergy = Min(defenderEnergy + (int) round(transformDamage * energyPerDamage + tolerance), maxDefenderEnergy);
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker lands transform");
+                    break;
+                case PlayerFinishesFastAttack:
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker finishes fast attack");
+                    break;
+                case PlayerFinishesSpecialAttack:
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker finishes special attack");
+                    break;
+                case PlayerFinishesTransform:
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker finishes transform");
+                    break;
+                case PlayerFinishesInitialFastAttack:
+                case PlayerFinishesInitialSpecialAttack:
+                    assert(false);
+                    break;
+                }
+
+                /* attacker performs next action */
+                switch (playerEvent) {
+                case PlayerStartsInitialAttack:
+                    assert(false);
+                    break;
+                case PlayerStartsTransform:
+                    /* attacker starts transform */
+                    attackerEnergy = Min(attackerEnergy + transformEnergy, maxAttackerEnergy);
+                    attackerEventQueue.Add(transformDamageStart, PlayerLandsTransform);
+                    attackerEventQueue.Add(transformDuration, PlayerFinishesTransform);
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker starts transform");
+                    break;
+                case PlayerStartsAttack:
+                case PlayerFinishesFastAttack:
+                case PlayerFinishesSpecialAttack:
+                case PlayerFinishesTransform:
+                    /* attacker starts next attack, unless the winner is already certain */
+                    /* the bounds change little from one attack to the next, so they are checked once per longest attack */
+                    if (earlyOutcomes && battleTimer <= nextOutcomeCheck) {
+                        nextOutcomeCheck = battleTimer - bounds.maxAttackerCycle;
+                        if (OutcomeDecided(bounds, defenderEventQueue, battleTimer, attackerBattleHP, defenderBattleHP, attackerWins)) {
+                            outcomeDecided = true;
+                            break;
+                        }
+                    }
+                    if (attacker.StartsSpecialAttack(attackerEnergy)) {
+                        /* special attack */
+                        attackerEventQueue.Add(longPressDuration, PlayerFinishesLongPress);
+                        LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker starts long press");
+                    } else {
+                        /* fast attack, after the whole fast attacks that nothing can interrupt */
+                        /* energy caps are monotone, so adding the skipped gains at once gives the same energies */
+#if LOG
+                        numSkippedFastAttacks = 0;
+#else
+                        numSkippedFastAttacks = NumSkippedFastAttacks(defenderEventQueue, minDefensiveInterval, battleTimer, defenderBattleHP,
+                                                                      attackerEnergy, -attackerSpecialAttackEnergy, maxAttackerEnergy,
+                                                                      attackerFastAttackDamage, attackerFastAttackEnergy, attackerFastAttackDuration);
+#endif
+                        skippedTime = numSkippedFastAttacks * attackerFastAttackDuration;
+                        if (numSkippedFastAttacks > 0) {
+                            defenderBattleHP -= numSkippedFastAttacks * attackerFastAttackDamage;
+                            defenderEnergy = Min(defenderEnergy + numSkippedFastAttacks * fastAttackDefenderEnergy, maxDefenderEnergy);
+                            attackerEnergy = Min(attackerEnergy + numSkippedFastAttacks * attackerFastAttackEnergy, maxAttackerEnergy);
+                        }
+                        attackerEnergy = Min(attackerEnergy + attackerFastAttackEnergy, maxAttackerEnergy);
+                        attackerEventQueue.Add(skippedTime + attackerFastAttackDamageStart, PlayerLandsFastAttack);
+                        attackerEventQueue.Add(skippedTime + attackerFastAttackDuration, PlayerFinishesFastAttack);
+                        LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker starts fast attack");
+                    }
+                    break;
+                case PlayerFinishesLongPress:
+                    /* attacker continues special attack */
+                    attackerEnergy = attackerEnergy + attackerSpecialAttackEnergy;
+                    ++numAttackerSpecialAttacks;
+                    attackerEventQueue.Add(attackerSpecialAttackDamageStart, PlayerLandsSpecialAttack);
+                    attackerEventQueue.Add(attackerSpecialAttackDuration, PlayerFinishesSpecialAttack);
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker starts special attack");
+                    break;
+                }
+            }
+
+            /* check if time for next defender event */
+            if (defenderEventQueue.Timer() == 0) {
+                playerEvent = defenderEventQueue.Pop();
+
+                /* defender finishes action */
+                switch (playerEvent) {
+                case PlayerFinishesLongPress:
+                    assert(false);
+                    break;
+                case PlayerLandsFastAttack:
+                    /* defender lands fast attack damage */
+                    attackerBattleHP -= defenderFastAttackDamage;
+                    attackerEnergy = Min(attackerEnergy + (int) round(defenderFastAttackDamage * energyPerDamage + tolerance), maxAttackerEnergy);
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender lands fast attack");
+                    break;
+                case PlayerLandsSpecialAttack:
+                    /* defender lands special attack damage */
+                    attackerBattleHP -= defenderSpecialAttackDamage;
+                    attackerEnergy = Min(attackerEnergy + (int) round(defenderSpecialAttackDamage * energyPerDamage + tolerance), maxAttackerEnergy);
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender lands special attack");
+                    break;
+                case PlayerLandsTransform:
+                    /* defender lands transform damage */
+                    attackerBattleHP -= transformDamage;
+                    attackerEnergy = Min(attackerEnergy + (int) round(transformDamage * energyPerDamage + tolerance), maxAttackerEnergy);
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender lands transform");
+                    break;
+                case PlayerFinishesFastAttack:
+                case PlayerFinishesInitialFastAttack:
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender finishes fast attack");
+                    break;
+                case PlayerFinishesSpecialAttack:
+                case PlayerFinishesInitialSpecialAttack:
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender finishes special attack");
+                    break;
+                case PlayerFinishesTransform:
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender finishes transform");
+                    break;
+                }
+
+                /* defender performs next action */
+                switch (playerEvent) {
+                case PlayerStartsTransform:
+                    /* defender starts transform */
+                    defenderEnergy = Min(defenderEnergy + transformEnergy, maxDefenderEnergy);
+                    defenderEventQueue.Add(transformDamageStart, PlayerLandsTransform);
+                    defenderEventQueue.Add(transformDuration, PlayerFinishesTransform);
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender starts transform");
+                    break;
+                case PlayerStartsAttack:
+                case PlayerStartsInitialAttack:
+                    /* defender starts next attack */
+                    specialAttack = defender.StartsSpecialAttack(defenderEnergy, sampler);
+                    if (!specialAttack && defenderEnergy >= -defenderSpecialAttackEnergy) {
+                        LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender defers special attack");
+                    }
+                    if (specialAttack) {
+                        /* special attack */
+                        defenderEnergy = defenderEnergy + defenderSpecialAttackEnergy;
+                        ++numDefenderSpecialAttacks;
+                        defenderEventQueue.Add(defenderSpecialAttackDamageStart, PlayerLandsSpecialAttack);
+                        if (playerEvent == PlayerStartsInitialAttack) {
+                            defenderEventQueue.Add(defenderSpecialAttackDuration, PlayerFinishesInitialSpecialAttack);
+                        } else {
+                            defenderEventQueue.Add(defenderSpecialAttackDuration, PlayerFinishesSpecialAttack);
+                        }
+                        LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender starts special attack");
+                    } else {
+                        /* fast attack */
+                        defenderEnergy = Min(defenderEnergy + defenderFastAttackEnergy, maxDefenderEnergy);
+                        defenderEventQueue.Add(defenderFastAttackDamageStart, PlayerLandsFastAttack);
+                        if (playerEvent == PlayerStartsInitialAttack) {
+                            defenderEventQueue.Add(defenderFastAttackDuration, PlayerFinishesInitialFastAttack);
+                        } else {
+                            defenderEventQueue.Add(defenderFastAttackDuration, PlayerFinishesFastAttack);
+                        }
+                        LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender starts fast attack");
+                    }
+                    break;
+                case PlayerFinishesFastAttack:
+                case PlayerFinishesSpecialAttack:
+                    /* defender does nothing for a while and then starts next attack */
+                    if (randomness) {
+                        interval = sampler.Interval(defensiveInterval, defensiveIntervalRandomness);
+                    } else {
+                        interval = defensiveInterval;
+                    }
+                    defenderEventQueue.Add(interval, PlayerStartsAttack);
+                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender idles");
+                    break;
+                case PlayerFinishesInitialFastAttack:
+                case PlayerFinishesInitialSpecialAttack:
+                case PlayerFinishesTransform:
+                    /* initial attacks do not start new attacks */
+                    break;
+                }
+            }
+        }
+        LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "battle ends");
+        LOGNEWLINE(logFile);
+
+        if (!outcomeDecided) {
+            attackerWins = defenderBattleHP <= 0;
+        }
+        if (attackerWins) {
+            /* attacker won */
+            ++tally.numWins;
+            ++groupWins;
+        } else {
+            /* defender won */
+        }
+
+        /* accumulate group wins for the variance estimate */
+        if ((i + 1) % trialsPerGroup == 0) {
+            tally.sumOfSquaredGroupWins += (long long) groupWins * groupWins;
+            groupWins = 0;
+        }
+
+        /* overkill damage does not count, the battle timer can run past the end of the battle */
+        if (statistics) {
+            duration = battleDuration - ((battleTimer > 0) ? battleTimer : 0);
+            statistics->sumOfDurations += duration;
+            statistics->sumOfSquaredDurations += duration * duration;
+            if (defenderBattleHP <= 0) statistics->sumOfWinDurations += duration;
+            statistics->sumOfDamageDealt += scaledDefenderHP - ((defenderBattleHP > 0) ? defenderBattleHP : 0);
+            statistics->sumOfDamageTaken += attackerHP - ((attackerBattleHP > 0) ? attackerBattleHP : 0);
+            statistics->numAttackerSpecialAttacks += numAttackerSpecialAttacks;
+            statistics->numDefenderSpecialAttacks += numDefenderSpecialAttacks;
+            ++statistics->durationCounts[HistogramBin(duration, battleDuration, numDurationBins)];
+            ++statistics->attackerHPCounts[HistogramBin(attackerBattleHP, attackerHP, numHPBins)];
+            ++statistics->defenderHPCounts[HistogramBin(defenderBattleHP, scaledDefenderHP, numHPBins)];
+        }
+    }
+}
+
+
+/* simulate trials firstTrial to firstTrial + numTrials - 1, which must be whole groups, and add them to the tally */
+/* if statistics is not null the duration, damage, and remaining HP of every trial are added to it too */
+void SimulateTrials(const BattleParameters &parameters, std::ofstream &logFile, long firstTrial, long numTrials, BattleTally &tally,
+                    TrialStatistics *statistics)
+{
+    DispatchPolicies(parameters.attackerPolicy, parameters.defenderPolicy, [&] (auto attacker, auto defender) {
+        SimulateTrialsWith(parameters, logFile, firstTrial, numTrials, tally, statistics, attacker, defender);
+    });
+}
+
+
+/* probability of the attacker winning and its standard error from the tally of all trials */
+void FinishBattles(const BattleParameters &parameters, const BattleTally &tally, BattleResult &result)
+{
+    long   trialsPerGroup, numGroups;
+    double groupMean, groupSumOfSquares;
+
+    result.numWins = tally.numWins;
+    result.numTrials = parameters.numTrials;
+    result.winProbability = (double) tally.numWins / parameters.numTrials;
+    result.engine = MonteCarloEngine;
+    trialsPerGroup = TrialsPerGroup(parameters);
+    numGroups = parameters.numTrials / trialsPerGroup;
+    if (numGroups > 1) {
+        /* unbiased sample variance of the group means divided by the number of groups */
+        groupMean = result.winProbability;
+        groupSumOfSquares = (double) tally.sumOfSquaredGroupWins / ((double) trialsPerGroup * trialsPerGroup);
+        result.standardError = sqrt(fmax(groupSumOfSquares - numGroups * groupMean * groupMean, 0.0) / (numGroups - 1) / numGroups);
+    } else {
+        result.standardError = 0.0;
+    }
+}
+
+
+void SimulateBattles(const BattleParameters &parameters, std::ofstream &logFile, BattleResult &result)
+{
+    BattleTally tally;
+
+    tally.numWins = 0;
+    tally.sumOfSquaredGroupWins = 0;
+    SimulateTrials(parameters, logFile, 0, parameters.numTrials, tally, nullptr);
+    FinishBattles(parameters, tally, result);
+}
+
+
+void ClearTrialStatistics(TrialStatistics &statistics)
+{
+    memset(&statistics, 0, sizeof statistics);
+}
+
+
+/* add the statistics of another range of trials */
+void AddTrialStatistics(TrialStatistics &statistics, const TrialStatistics &moreStatistics)
+{
+    int i;
+
+    statistics.sumOfDurations += moreStatistics.sumOfDurations;
+    statistics.sumOfSquaredDurations += moreStatistics.sumOfSquaredDurations;
+    statistics.sumOfWinDurations += moreStatistics.sumOfWinDurations;
+    statistics.sumOfDamageDealt += moreStatistics.sumOfDamageDealt;
+    statistics.sumOfDamageTaken += moreStatistics.sumOfDamageTaken;
+    statistics.numAttackerSpecialAttacks += moreStatistics.numAttackerSpecialAttacks;
+    statistics.numDefenderSpecialAttacks += moreStatistics.numDefenderSpecialAttacks;
+    for (i = 0; i < numDurationBins; ++i) {
+        statistics.durationCounts[i] += moreStatistics.durationCounts[i];
+    }
+    for (i = 0; i < numHPBins; ++i) {
+        statistics.attackerHPCounts[i] += moreStatistics.attackerHPCounts[i];
+        statistics.defenderHPCounts[i] += moreStatistics.defenderHPCounts[i];
+    }
+}
+
+
+/* battle duration in milliseconds that the given fraction of the trials end within */
+/* interpolated within the histogram bin, so it is accurate to a bin width of battleDuration / numDurationBins */
+double DurationPercentile(const BattleParameters &parameters, const TrialStatistics &statistics, long numTrials, double fraction)
+{
+    double binWidth, target, cumulativeCount;
+    int    i;
+
+    binWidth = (double) parameters.battleDuration / numDurationBins;
+    target = fraction * numTrials;
+    cumulativeCount = 0.0;
+    for (i = 0; i < numDurationBins; ++i) {
+        if (statistics.durationCounts[i] > 0 && cumulativeCount + statistics.durationCounts[i] >= target) {
+            return (i + fmax(target - cumulativeCount, 0.0) / statistics.durationCounts[i]) * binWidth;
+        }
+        cumulativeCount += statistics.durationCounts[i];
+    }
+    return parameters.battleDuration;
+}
+
+
+/* simulate the trials of a matchup collecting the outcome measures with the wins */
+void SimulateBattleStatistics(const BattleParameters &parameters, std::ofstream &logFile, BattleResult &result, TrialStatistics &statistics)
+{
+    BattleTally tally;
+
+    tally.numWins = 0;
+    tally.sumOfSquaredGroupWins = 0;
+    ClearTrialStatistics(statistics);
+    SimulateTrials(parameters, logFile, 0, parameters.numTrials, tally, &statistics);
+    FinishBattles(parameters, tally, result);
+}
+
+
+/* append an integer to a battle key */
+inline void AddKeyWord(BattleKey &key, int &numWords, long long value)
+{
+    assert(numWords < numBattleKeyWords);
+    key.words[numWords++] = (unsigned long long) value;
+}
+
+
+/* append a floating point number to a battle key */
+inline void AddKeyWord(BattleKey &key, int &numWords, double value)
+{
+    assert(numWords < numBattleKeyWords);
+    /* negative zero equals zero */
+    if (value == 0.0) value = 0.0;
+    memcpy(&key.words[numWords++], &value, sizeof value);
+}
+
+
+void MakeBattleKey(const BattleParameters &parameters, BattleKey &key)
+{
+    int  numWords;
+    bool attackerSpecialAttacks, defenderSpecialAttacks;
+    bool transforms;
+    int  i;
+
+    numWords = 0;
+
+    /* random number settings only matter with random behavior, deferral settings only with the standard defender */
+    /* planned matchups may be solved exactly instead of simulated */
+    AddKeyWord(key, numWords, (long long) parameters.enginePlanning);
+    AddKeyWord(key, numWords, (long long) parameters.randomness);
+    AddKeyWord(key, numWords, (long long) parameters.attackerPolicy);
+    AddKeyWord(key, numWords, (long long) parameters.defenderPolicy);
+    if (parameters.randomness) {
+        AddKeyWord(key, numWords, (long long) parameters.rngSeed);
+        AddKeyWord(key, numWords, (long long) parameters.numTrials);
+        AddKeyWord(key, numWords, (long long) parameters.commonRandomNumbers);
+        AddKeyWord(key, numWords, (long long) parameters.antitheticTrials);
+        AddKeyWord(key, numWords, (long long) parameters.quasiMonteCarlo);
+        AddKeyWord(key, numWords, (long long) (parameters.quasiMonteCarlo ? parameters.numRandomizations : 1));
+        AddKeyWord(key, numWords, (long long) parameters.defensiveIntervalRandomness);
+        if (parameters.defenderPolicy == StandardDefenderPolicy) {
+            AddKeyWord(key, numWords, parameters.defensiveSpecialAttackProbability);
+        }
+    } else if (parameters.defenderPolicy == StandardDefenderPolicy) {
+        AddKeyWord(key, numWords, (long long) parameters.numDefensiveSpecialAttackDeferrals);
+    }
+
+    /* the defender's HP is only used after scaling */
+    AddKeyWord(key, numWords, (long long) parameters.attackerHP);
+    AddKeyWord(key, numWords, (long long) (int) (parameters.defenderHP * parameters.defensiveHPMultiplier));
+
+    /* special attacks beyond the maximum energy are never used */
+    AddKeyWord(key, numWords, (long long) parameters.attackerFastAttackDamage);
+    AddKeyWord(key, numWords, (long long) parameters.attackerFastAttackEnergy);
+    AddKeyWord(key, numWords, (long long) parameters.attackerFastAttackDamageStart);
+    AddKeyWord(key, numWords, (long long) parameters.attackerFastAttackDuration);
+    attackerSpecialAttacks = -parameters.attackerSpecialAttackEnergy <= parameters.maxAttackerEnergy;
+    AddKeyWord(key, numWords, (long long) attackerSpecialAttacks);
+    if (attackerSpecialAttacks) {
+        AddKeyWord(key, numWords, (long long) parameters.attackerSpecialAttackDamage);
+        AddKeyWord(key, numWords, (long long) parameters.attackerSpecialAttackEnergy);
+        AddKeyWord(key, numWords, (long long) parameters.attackerSpecialAttackDamageStart);
+        AddKeyWord(key, numWords, (long long) parameters.attackerSpecialAttackDuration);
+        AddKeyWord(key, numWords, (long long) parameters.longPressDuration);
+    }
+    AddKeyWord(key, numWords, (long long) parameters.defenderFastAttackDamage);
+    AddKeyWord(key, numWords, (long long) parameters.defenderFastAttackEnergy);
+    AddKeyWord(key, numWords, (long long) parameters.defenderFastAttackDamageStart);
+    AddKeyWord(key, numWords, (long long) parameters.defenderFastAttackDuration);
+    defenderSpecialAttacks = -parameters.defenderSpecialAttackEnergy <= parameters.maxDefenderEnergy;
+    AddKeyWord(key, numWords, (long long) defenderSpecialAttacks);
+    if (defenderSpecialAttacks) {
+        AddKeyWord(key, numWords, (long long) parameters.defenderSpecialAttackDamage);
+        AddKeyWord(key, numWords, (long long) parameters.defenderSpecialAttackEnergy);
+        AddKeyWord(key, numWords, (long long) parameters.defenderSpecialAttackDamageStart);
+        AddKeyWord(key, numWords, (long long) parameters.defenderSpecialAttackDuration);
+    }
+
+    /* transform data only matters for Ditto */
+    AddKeyWord(key, numWords, (long long) parameters.attackerTransforms);
+    AddKeyWord(key, numWords, (long long) parameters.defenderTransforms);
+    transforms = parameters.attackerTransforms || parameters.defenderTransforms;
+    if (transforms) {
+        AddKeyWord(key, numWords, (long long) parameters.transformDamage);
+        AddKeyWord(key, numWords, (long long) parameters.transformEnergy);
+        AddKeyWord(key, numWords, (long long) parameters.transformDamageStart);
+        AddKeyWord(key, numWords, (long long) parameters.transformDuration);
+    }
+
+    /* battle parameters */
+    AddKeyWord(key, numWords, (long long) parameters.maxAttackerEnergy);
+    AddKeyWord(key, numWords, (long long) parameters.maxDefenderEnergy);
+    AddKeyWord(key, numWords, parameters.energyPerDamage);
+    AddKeyWord(key, numWords, (long long) parameters.battleDuration);
+    AddKeyWord(key, numWords, (long long) parameters.offensiveInitialInterval);
+    AddKeyWord(key, numWords, (long long) parameters.numDefensiveInitialIntervals);
+    for (i = 0; i < numDefensiveInitialIntervalInputs; ++i) {
+        AddKeyWord(key, numWords, (long long) parameters.defensiveInitialIntervals[i]);
+    }
+    AddKeyWord(key, numWords, (long long) parameters.defensiveInterval);
+
+    /* zero unused words so keys compare equal */
+    while (numWords < numBattleKeyWords) {
+        key.words[numWords++] = 0;
+    }
+}
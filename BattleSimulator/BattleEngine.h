@@ -0,0 +1,143 @@
+#pragma once
+
+
+#include <fstream>
+
+#include "BattleSimulator.h"
+
+
+/* number of defensive initial interval inputs */
+const int numDefensiveInitialIntervalInputs = 3;
+
+
+/* how the attacker decides to use its special attack */
+enum AttackerPolicies {
+    GreedyAttackerPolicy,
+    EnergyBankingAttackerPolicy,
+    numAttackerPolicies
+};
+
+
+/* how the defender decides to use its special attack */
+enum DefenderPolicies {
+    StandardDefenderPolicy,
+    GreedyDefenderPolicy,
+    EnergyBankingDefenderPolicy,
+    numDefenderPolicies
+};
+
+
+/* ways of evaluating a matchup */
+enum BattleEngines {
+    MonteCarloEngine,
+    ExactEngine,
+    numBattleEngines
+};
+
+
+/* simulation inputs of one matchup after all workbook lookups are resolved */
+struct BattleParameters {
+    /* simulation settings */
+    bool   randomness;
+    int    rngSeed;
+    long   numTrials;
+    bool   commonRandomNumbers;
+    bool   antitheticTrials;
+    bool   quasiMonteCarlo;
+    long   numRandomizations;
+    bool   enginePlanning;
+
+    /* combatants */
+    int    attackerHP, defenderHP;
+    bool   attackerTransforms, defenderTransforms;
+
+    /* attacks */
+    int    attackerFastAttackDamage, attackerFastAttackEnergy, attackerFastAttackDamageStart, attackerFastAttackDuration;
+    int    attackerSpecialAttackDamage, attackerSpecialAttackEnergy, attackerSpecialAttackDamageStart, attackerSpecialAttackDuration;
+    int    defenderFastAttackDamage, defenderFastAttackEnergy, defenderFastAttackDamageStart, defenderFastAttackDuration;
+    int    defenderSpecialAttackDamage, defenderSpecialAttackEnergy, defenderSpecialAttackDamageStart, defenderSpecialAttackDuration;
+    int    transformDamage, transformEnergy, transformDamageStart, transformDuration;
+
+    /* battle parameters */
+    double defensiveHPMultiplier;
+    int    maxAttackerEnergy, maxDefenderEnergy;
+    double energyPerDamage;
+    int    battleDuration, longPressDuration;
+    int    offensiveInitialInterval;
+    int    numDefensiveInitialIntervals;
+    int    defensiveInitialIntervals[numDefensiveInitialIntervalInputs];
+    int    defensiveInterval, defensiveIntervalRandomness;
+    int    numDefensiveSpecialAttackDeferrals;
+    double defensiveSpecialAttackProbability;
+
+    /* combatant policies */
+    int    attackerPolicy, defenderPolicy;
+};
+
+
+/* outcome of the Monte Carlo trials of one matchup, or of the exact solver counted as the same number of trials */
+struct BattleResult {
+    long   numWins;
+    long   numTrials;
+    double winProbability;
+    double standardError;
+    int    engine;
+};
+
+
+/* wins of a range of trials, exact integers so ranges can be added up in any order */
+struct BattleTally {
+    long      numWins;
+    long long sumOfSquaredGroupWins;
+};
+
+
+/* number of bins of the battle duration and remaining HP histograms */
+const int numDurationBins = 1000;
+const int numHPBins = 10;
+
+
+/* outcome measures of a range of trials collected in the same pass as the wins */
+/* exact integers so ranges can be added up in any order like the tally */
+/* durations are in milliseconds, damage is in HP, remaining HP is binned by its fraction of the starting HP */
+struct TrialStatistics {
+    long long sumOfDurations, sumOfSquaredDurations;
+    long long sumOfWinDurations;
+    long long sumOfDamageDealt, sumOfDamageTaken;
+    long long numAttackerSpecialAttacks, numDefenderSpecialAttacks;
+    long      durationCounts[numDurationBins];
+    long      attackerHPCounts[numHPBins], defenderHPCounts[numHPBins];
+};
+
+
+/* number of 64-bit words in a canonical battle key */
+const int numBattleKeyWords = 49;
+
+
+/* canonical form of the battle parameters that determine the result of a matchup */
+/* matchups with equal keys have identical results, whatever move sets they came from */
+struct BattleKey {
+    unsigned long long words[numBattleKeyWords];
+};
+
+
+long   TrialsPerGroup           (const BattleParameters &parameters);
+
+bool   TrialsAreSeparable       (const BattleParameters &parameters);
+
+void   SimulateTrials           (const BattleParameters &parameters, std::ofstream &logFile, long firstTrial, long numTrials, BattleTally &tally,
+                                 TrialStatistics *statistics);
+
+void   FinishBattles            (const BattleParameters &parameters, const BattleTally &tally, BattleResult &result);
+
+void   SimulateBattles          (const BattleParameters &parameters, std::ofstream &logFile, BattleResult &result);
+
+void   ClearTrialStatistics     (TrialStatistics &statistics);
+
+void   AddTrialStatistics       (TrialStatistics &statistics, const TrialStatistics &moreStatistics);
+
+double DurationPercentile       (const BattleParameters &parameters, const TrialStatistics &statistics, long numTrials, double fraction);
+
+void   SimulateBattleStatistics (const BattleParameters &parameters, std::ofstream &logFile, BattleResult &result, TrialStatistics &statistics);
+
+void   MakeBattleKey            (const BattleParameters &parameters, BattleKey &key);
@@ -0,0 +1,70 @@
+#include <fstream>
+#include <string>
+
+#include "BattleLog.h"
+
+
+#if LOG
+void LogSimulationInfo(std::ofstream &logFile, bool randomness, int rngSeed, bool skipWeakerSpecialAttacks, bool commonRandomNumbers, bool antitheticTrials,
+                       bool quasiMonteCarlo)
+{
+    if (logFile.is_open()) {
+        if (randomness) {
+            logFile << "simulation uses random behavior\n";
+            logFile << SHOWSPACE(rngSeed) << " random number generator seed\n";
+            if (commonRandomNumbers) {
+                logFile << "simulation uses common random numbers\n";
+            }
+            if (antitheticTrials) {
+                logFile << "simulation uses antithetic trials\n";
+            }
+            if (quasiMonteCarlo) {
+                logFile << "simulation uses quasi-Monte Carlo trials\n";
+            }
+        }
+        else {
+            logFile << "simulation uses expected behavior\n";
+        }
+        if (skipWeakerSpecialAttacks) {
+            logFile << "simulation skips weaker special attacks\n";
+        }
+        else {
+            logFile << "simulation always uses special attacks\n";
+        }
+    }
+}
+#endif
+
+
+#if LOG
+void LogEvent(std::ofstream &logFile, int battleTimer, int attackerBattleHP, int attackerEnergy, int defenderBattleHP, int defenderEnergy,
+              const std::string &playerEvent)
+{
+    if (logFile.is_open()) {
+        logFile << SHOWSPACE(battleTimer) << " "
+                << SHOWSPACE(attackerBattleHP) << " " << SHOWSPACE(attackerEnergy) << " "
+                << SHOWSPACE(defenderBattleHP) << " " << SHOWSPACE(defenderEnergy) << " "
+                << playerEvent << "\n";
+    }
+}
+#endif
+
+
+#if LOG
+void LogNewline(std::ofstream &logFile)
+{
+    if (logFile.is_open()) {
+        logFile << std::endl;
+    }
+}
+#endif
+
+
+#if LOG
+void CloseLog(std::ofstream &logFile)
+{
+    if (logFile.is_open()) {
+        logFile.close();
+    }
+}
+#endif
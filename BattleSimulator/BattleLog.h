@@ -0,0 +1,41 @@
+#pragma once
+
+
+#include <fstream>
+#include <string>
+
+#include "BattleSimulator.h"
+
+
+/* prefix non-negative numbers with a space to match VBA formatting */
+#define SHOWSPACE(n) (((n) < 0) ? "" : " ") << (n)
+
+
+#if LOG
+#define LOGSIMULATIONINFO(logFile, randomness, rngSeed, skipWeakerSpecialAttacks, commonRandomNumbers, antitheticTrials, quasiMonteCarlo) \
+        LogSimulationInfo(logFile, randomness, rngSeed, skipWeakerSpecialAttacks, commonRandomNumbers, antitheticTrials, quasiMonteCarlo)
+#define LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, playerEvent) \
+        LogEvent(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, playerEvent)
+#define LOGNEWLINE(logFile) \
+        LogNewline(logFile)
+#define CLOSELOG(logFile) \
+        CloseLog(logFile)
+#else
+#define LOGSIMULATIONINFO(logFile, randomness, rngSeed, skipWeakerSpecialAttacks, commonRandomNumbers, antitheticTrials, quasiMonteCarlo)
+#define LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, playerEvent)
+#define LOGNEWLINE(logFile)
+#define CLOSELOG(logFile)
+#endif
+
+
+#if LOG
+void LogSimulationInfo (std::ofstream &logFile, bool randomness, int rngSeed, bool skipWeakerSpecialAttacks, bool commonRandomNumbers, bool antitheticTrials,
+                        bool quasiMonteCarlo);
+
+void LogEvent          (std::ofstream &logFile, int battleTimer, int attackerBattleHP, int attackerEnergy, int defenderBattleHP, int defenderEnergy,
+                        const std::string &playerEvent);
+
+void LogNewline        (std::ofstream &logFile);
+
+void CloseLog          (std::ofstream &logFile);
+#endif
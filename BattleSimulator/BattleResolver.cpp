@@ -0,0 +1,418 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "BattleResolver.h"
+
+
+const BattleInputInfo battleInputInfo[numBattleInputs] = {
+    {"SkipWeakerSpecialAttacks",           true},
+    {"Randomness",                         true},
+    {"RNGSeed",                            false},
+    {"NumMonteCarloTrials",                false},
+    {"CommonRandomNumbers",                true},
+    {"AntitheticTrials",                   true},
+    {"QuasiMonteCarlo",                    true},
+    {"NumQMCRandomizations",               false},
+    {"LogBattles",                         true},
+    {"AttackerLevel",                      false},
+    {"AttackerStaminaIV",                  false},
+    {"AttackerAttackIV",                   false},
+    {"AttackerDefenseIV",                  false},
+    {"DefenderLevel",                      false},
+    {"DefenderStaminaIV",                  false},
+    {"DefenderAttackIV",                   false},
+    {"DefenderDefenseIV",                  false},
+    {"DefensiveHPMultiplier",              false},
+    {"MaxOffensiveEnergy",                 false},
+    {"MaxDefensiveEnergy",                 false},
+    {"EnergyPerHPLost",                    false},
+    {"BattleDuration",                     false},
+    {"LongPressDuration",                  false},
+    {"OffensiveInitialInterval",           false},
+    {"NumDefensiveInitialIntervals",       false},
+    {"DefensiveFirstInitialInterval",      false},
+    {"DefensiveSecondInitialInterval",     false},
+    {"DefensiveThirdInitialInterval",      false},
+    {"DefensiveInterval",                  false},
+    {"DefensiveIntervalRandomness",        false},
+    {"NumDefensiveSpecialAttackDeferrals", false},
+    {"DefensiveSpecialAttackProbability",  false},
+    {"AttackerPolicy",                     false},
+    {"DefenderPolicy",                     false},
+    {"EnginePlanning",                     true}
+};
+
+
+void DefaultBattleInputs(BattleInputs &inputs)
+{
+    int i;
+
+    for (i = 0; i < numBattleInputs; ++i) {
+        inputs.values[i] = 0.0;
+    }
+    inputs.values[RNGSeedInput] = 1.0;
+    inputs.values[NumMonteCarloTrialsInput] = 1.0;
+    inputs.values[NumQMCRandomizationsInput] = 1.0;
+    inputs.values[NumDefensiveInitialIntervalsInput] = numDefensiveInitialIntervalInputs;
+}
+
+
+/* parse input values by name, keeping the current value of inputs that are not given */
+bool ParseBattleInputs(const std::map<std::string, std::string> &inputStrs, BattleInputs &inputs)
+{
+    int  i;
+    char *end;
+
+    for (i = 0; i < numBattleInputs; ++i) {
+        auto inputStr = inputStrs.find(battleInputInfo[i].name);
+        if (inputStr == inputStrs.end()) continue;
+        if (battleInputInfo[i].boolean && (inputStr->second == "TRUE" || inputStr->second == "FALSE")) {
+            inputs.values[i] = (inputStr->second == "TRUE") ? 1.0 : 0.0;
+        } else {
+            inputs.values[i] = strtod(inputStr->second.c_str(), &end);
+            if (end == inputStr->second.c_str() || *end != '\0') return false;
+        }
+    }
+    return true;
+}
+
+
+void FormatBattleInputs(const BattleInputs &inputs, std::map<std::string, std::string> &inputStrs)
+{
+    char valueStr[32];
+    int  i;
+
+    for (i = 0; i < numBattleInputs; ++i) {
+        if (battleInputInfo[i].boolean) {
+            inputStrs[battleInputInfo[i].name] = (inputs.values[i] != 0.0) ? "TRUE" : "FALSE";
+        } else {
+            /* enough digits to read back the same double */
+            snprintf(valueStr, sizeof valueStr, "%.17g", inputs.values[i]);
+            inputStrs[battleInputInfo[i].name] = valueStr;
+        }
+    }
+}
+
+
+BattleInputErrors CheckBattleInputs(const BattleInputs &inputs)
+{
+    bool   randomness;
+    long   numTrials;
+    long   numRandomizations;
+    double attackerPolicy, defenderPolicy;
+
+    randomness = inputs.values[RandomnessInput] != 0.0;
+    numTrials = (long) inputs.values[NumMonteCarloTrialsInput];
+    attackerPolicy = inputs.values[AttackerPolicyInput];
+    defenderPolicy = inputs.values[DefenderPolicyInput];
+    assert(inputs.values[RNGSeedInput] > 0);
+    assert(numTrials > 0);
+    if (numTrials > 1 && !randomness) {
+        return RandomnessRequiredError;
+    }
+    if (randomness && inputs.values[AntitheticTrialsInput] != 0.0) {
+        if (numTrials % 2 != 0) {
+            return OddAntitheticTrialsError;
+        }
+        if (inputs.values[QuasiMonteCarloInput] != 0.0) {
+            return AntitheticQuasiMonteCarloError;
+        }
+    }
+    if (randomness && inputs.values[QuasiMonteCarloInput] != 0.0) {
+        numRandomizations = (long) inputs.values[NumQMCRandomizationsInput];
+        assert(numRandomizations > 0);
+        if (numTrials % numRandomizations != 0) {
+            return UnevenRandomizationsError;
+        }
+    }
+    if (attackerPolicy != (int) attackerPolicy || attackerPolicy < 0 || attackerPolicy >= numAttackerPolicies ||
+        defenderPolicy != (int) defenderPolicy || defenderPolicy < 0 || defenderPolicy >= numDefenderPolicies) {
+        return UnknownPolicyError;
+    }
+    assert((int) inputs.values[NumDefensiveInitialIntervalsInput] == numDefensiveInitialIntervalInputs);
+    return NoInputError;
+}
+
+
+void ResolveMatchupAttack(const GameData &gameData, const AttackRecord &attack, const SpeciesRecord &defenderSpecies, MatchupAttack &matchupAttack)
+{
+    matchupAttack.power = attack.power;
+    matchupAttack.energy = attack.energy;
+    matchupAttack.damageStart = attack.damageStart;
+    matchupAttack.duration = attack.duration;
+    matchupAttack.stab = attack.stab;
+    matchupAttack.effectiveness = gameData.TypeEffectiveness(attack.type, defenderSpecies.type1, defenderSpecies.type2);
+}
+
+
+/* look up the species and move data of a matchup, performing any Ditto transformation */
+/* returns false if a move set or species is not in the game data */
+bool ResolveMatchupData(const GameData &gameData, long attackerMoveSetNum, long defenderMoveSetNum, MatchupData &matchupData)
+{
+    int                    attackerPokedexNum, defenderPokedexNum;
+    const SpeciesRecord    *attackerOwnSpecies, *defenderOwnSpecies;
+    const SpeciesRecord    *attackerSpecies, *defenderSpecies;
+    const MoveSetRecord    *attackerMoveSet, *defenderMoveSet;
+    long                   transformMoveNum;
+    const FastAttackRecord *transform;
+
+    attackerPokedexNum = attackerMoveSetNum / 1000000;
+    defenderPokedexNum = defenderMoveSetNum / 1000000;
+    attackerOwnSpecies = gameData.FindSpecies(attackerPokedexNum);
+    defenderOwnSpecies = gameData.FindSpecies(defenderPokedexNum);
+    if (!attackerOwnSpecies || !defenderOwnSpecies) return false;
+
+    /* HP comes from the combatant's own species even after transforming */
+    matchupData.attacker.baseStamina = attackerOwnSpecies->baseStamina;
+    matchupData.defender.baseStamina = defenderOwnSpecies->baseStamina;
+
+    matchupData.attacker.transforms = false;
+    matchupData.defender.transforms = false;
+    matchupData.transformPower = 0;
+    matchupData.transformEnergy = 0;
+    matchupData.transformDamageStart = 0;
+    matchupData.transformDuration = 0;
+    if ((attackerPokedexNum == dittoPokedexNum) != (defenderPokedexNum == dittoPokedexNum)) {
+        /* perform Ditto transformations */
+        if (attackerPokedexNum == dittoPokedexNum) {
+            transformMoveNum = (attackerMoveSetNum % 1000000) / 1000;
+            attackerMoveSetNum = defenderMoveSetNum;
+            attackerPokedexNum = defenderPokedexNum;
+            matchupData.attacker.transforms = true;
+        } else {
+            transformMoveNum = (defenderMoveSetNum % 1000000) / 1000;
+            defenderMoveSetNum = attackerMoveSetNum;
+            defenderPokedexNum = attackerPokedexNum;
+            matchupData.defender.transforms = true;
+        }
+        transform = gameData.FindFastAttack(transformMoveNum);
+        if (!transform) return false;
+        assert(transform->power == 0);
+        matchupData.transformPower = transform->power;
+        matchupData.transformEnergy = transform->energy;
+        matchupData.transformDamageStart = transform->damageStart;
+        matchupData.transformDuration = transform->duration;
+    }
+
+    attackerSpecies = gameData.FindSpecies(attackerPokedexNum);
+    defenderSpecies = gameData.FindSpecies(defenderPokedexNum);
+    attackerMoveSet = gameData.FindMoveSet(attackerMoveSetNum);
+    defenderMoveSet = gameData.FindMoveSet(defenderMoveSetNum);
+    if (!attackerSpecies || !defenderSpecies || !attackerMoveSet || !defenderMoveSet) return false;
+
+    matchupData.attacker.moveSetNum = attackerMoveSetNum;
+    matchupData.attacker.pokedexNum = attackerPokedexNum;
+    matchupData.attacker.baseAttack = attackerSpecies->baseAttack;
+    matchupData.attacker.baseDefense = attackerSpecies->baseDefense;
+    ResolveMatchupAttack(gameData, attackerMoveSet->fastAttack, *defenderSpecies, matchupData.attacker.fastAttack);
+    ResolveMatchupAttack(gameData, attackerMoveSet->specialAttack, *defenderSpecies, matchupData.attacker.specialAttack);
+
+    matchupData.defender.moveSetNum = defenderMoveSetNum;
+    matchupData.defender.pokedexNum = defenderPokedexNum;
+    matchupData.defender.baseAttack = defenderSpecies->baseAttack;
+    matchupData.defender.baseDefense = defenderSpecies->baseDefense;
+    ResolveMatchupAttack(gameData, defenderMoveSet->fastAttack, *attackerSpecies, matchupData.defender.fastAttack);
+    ResolveMatchupAttack(gameData, defenderMoveSet->specialAttack, *attackerSpecies, matchupData.defender.specialAttack);
+    return true;
+}
+
+
+/* calculate the level and IV dependent battle parameters of a matchup */
+void ResolveBattleParameters(const MatchupData &matchupData, const BattleInputs &inputs, double attackerCPMultiplier, double defenderCPMultiplier,
+                             BattleParameters &parameters)
+{
+    const double *values;
+    double       attackerAttack, attackerDefense;
+    double       defenderAttack, defenderDefense;
+    double       attackerFastAttackDPS, attackerSpecialAttackDPS;
+    int          i;
+
+    values = inputs.values;
+
+    /* get simulation settings, variance reduction only applies to random behavior */
+    parameters.randomness = values[RandomnessInput] != 0.0;
+    parameters.rngSeed = (int) values[RNGSeedInput];
+    parameters.numTrials = (long) values[NumMonteCarloTrialsInput];
+    parameters.commonRandomNumbers = parameters.randomness && values[CommonRandomNumbersInput] != 0.0;
+    parameters.antitheticTrials = parameters.randomness && values[AntitheticTrialsInput] != 0.0;
+    parameters.quasiMonteCarlo = parameters.randomness && values[QuasiMonteCarloInput] != 0.0;
+    parameters.numRandomizations = parameters.quasiMonteCarlo ? (long) values[NumQMCRandomizationsInput] : 1;
+    parameters.enginePlanning = values[EnginePlanningInput] != 0.0;
+
+    /* calculate stats */
+    parameters.attackerHP = CombatantHP(matchupData.attacker.baseStamina, (int) values[AttackerStaminaIVInput], attackerCPMultiplier);
+    parameters.defenderHP = CombatantHP(matchupData.defender.baseStamina, (int) values[DefenderStaminaIVInput], defenderCPMultiplier);
+    parameters.attackerTransforms = matchupData.attacker.transforms;
+    parameters.defenderTransforms = matchupData.defender.transforms;
+
+    attackerAttack = (matchupData.attacker.baseAttack + (int) values[AttackerAttackIVInput]) * attackerCPMultiplier;
+    attackerDefense = (matchupData.attacker.baseDefense + (int) values[AttackerDefenseIVInput]) * attackerCPMultiplier;
+
+    defenderAttack = (matchupData.defender.baseAttack + (int) values[DefenderAttackIVInput]) * defenderCPMultiplier;
+    defenderDefense = (matchupData.defender.baseDefense + (int) values[DefenderDefenseIVInput]) * defenderCPMultiplier;
+
+    /* calculate damage against opponent */
+    parameters.attackerFastAttackDamage = AttackDamage(attackerAttack, defenderDefense, matchupData.attacker.fastAttack.power,
+                                                       matchupData.attacker.fastAttack.stab, matchupData.attacker.fastAttack.effectiveness);
+    parameters.attackerFastAttackEnergy = matchupData.attacker.fastAttack.energy;
+    parameters.attackerFastAttackDamageStart = matchupData.attacker.fastAttack.damageStart;
+    parameters.attackerFastAttackDuration = matchupData.attacker.fastAttack.duration;
+    parameters.attackerSpecialAttackDamage = AttackDamage(attackerAttack, defenderDefense, matchupData.attacker.specialAttack.power,
+                                                          matchupData.attacker.specialAttack.stab, matchupData.attacker.specialAttack.effectiveness);
+    parameters.attackerSpecialAttackEnergy = matchupData.attacker.specialAttack.energy;
+    parameters.attackerSpecialAttackDamageStart = matchupData.attacker.specialAttack.damageStart;
+    parameters.attackerSpecialAttackDuration = matchupData.attacker.specialAttack.duration;
+
+    parameters.defenderFastAttackDamage = AttackDamage(defenderAttack, attackerDefense, matchupData.defender.fastAttack.power,
+                                                       matchupData.defender.fastAttack.stab, matchupData.defender.fastAttack.effectiveness);
+    parameters.defenderFastAttackEnergy = matchupData.defender.fastAttack.energy;
+    parameters.defenderFastAttackDamageStart = matchupData.defender.fastAttack.damageStart;
+    parameters.defenderFastAttackDuration = matchupData.defender.fastAttack.duration;
+    parameters.defenderSpecialAttackDamage = AttackDamage(defenderAttack, attackerDefense, matchupData.defender.specialAttack.power,
+                                                          matchupData.defender.specialAttack.stab, matchupData.defender.specialAttack.effectiveness);
+    parameters.defenderSpecialAttackEnergy = matchupData.defender.specialAttack.energy;
+    parameters.defenderSpecialAttackDamageStart = matchupData.defender.specialAttack.damageStart;
+    parameters.defenderSpecialAttackDuration = matchupData.defender.specialAttack.duration;
+
+    if (parameters.attackerTransforms || parameters.defenderTransforms) {
+        /* transform always does 1 damage */
+        parameters.transformDamage = 1;
+        parameters.transformEnergy = matchupData.transformEnergy;
+        parameters.transformDamageStart = matchupData.transformDamageStart;
+        parameters.transformDuration = matchupData.transformDuration;
+    } else {
+        parameters.transformDamage = 0;
+        parameters.transformEnergy = 0;
+        parameters.transformDamageStart = 0;
+        parameters.transformDuration = 0;
+    }
+
+    /* get battle parameters */
+    parameters.defensiveHPMultiplier = values[DefensiveHPMultiplierInput];
+    parameters.maxAttackerEnergy = (int) values[MaxOffensiveEnergyInput];
+    parameters.maxDefenderEnergy = (int) values[MaxDefensiveEnergyInput];
+    parameters.energyPerDamage = values[EnergyPerHPLostInput];
+    parameters.battleDuration = (int) values[BattleDurationInput];
+    parameters.longPressDuration = (int) values[LongPressDurationInput];
+    parameters.offensiveInitialInterval = (int) values[OffensiveInitialIntervalInput];
+    parameters.numDefensiveInitialIntervals = (int) values[NumDefensiveInitialIntervalsInput];
+    for (i = 0; i < numDefensiveInitialIntervalInputs; ++i) {
+        parameters.defensiveInitialIntervals[i] = (int) values[DefensiveFirstInitialIntervalInput + i];
+    }
+    parameters.defensiveInterval = (int) values[DefensiveIntervalInput];
+    parameters.defensiveIntervalRandomness = (int) values[DefensiveIntervalRandomnessInput];
+    parameters.numDefensiveSpecialAttackDeferrals = (int) values[NumDefensiveSpecialAttackDeferralsInput];
+    parameters.defensiveSpecialAttackProbability = values[DefensiveSpecialAttackProbabilityInput];
+    parameters.attackerPolicy = (int) values[AttackerPolicyInput];
+    parameters.defenderPolicy = (int) values[DefenderPolicyInput];
+
+    /* calculate damage per second */
+    attackerFastAttackDPS = parameters.attackerFastAttackDamage / (parameters.attackerFastAttackDuration / 1000.0);
+    attackerSpecialAttackDPS = parameters.attackerSpecialAttackDamage / ((parameters.longPressDuration + parameters.attackerSpecialAttackDuration) / 1000.0);
+
+    /* if enabled, skip weaker special attacks */
+    if (values[SkipWeakerSpecialAttacksInput] != 0.0 && attackerSpecialAttackDPS <= attackerFastAttackDPS) {
+        /* disable special attacks by making energy requirement unreachable */
+        parameters.attackerSpecialAttackEnergy = -(parameters.maxAttackerEnergy + 1);
+    }
+}
+
+
+/* find the inputs the result of a resolved matchup depends on */
+/* the result is the same for any inputs that agree with these inputs on every input in the set */
+BattleInputMask BattleInputDependencies(const BattleInputs &inputs, const BattleParameters &parameters)
+{
+    BattleInputMask mask;
+    int             i;
+
+    /* settings that are checked or decide which other inputs matter */
+    mask = InputBit(SkipWeakerSpecialAttacksInput) | InputBit(RandomnessInput) | InputBit(NumMonteCarloTrialsInput) | InputBit(LogBattlesInput) |
+           InputBit(AttackerPolicyInput) | InputBit(DefenderPolicyInput) | InputBit(EnginePlanningInput);
+
+    /* random number settings only matter with random behavior, deferral counts only without it */
+    /* only the standard defender defers special attacks */
+    if (parameters.randomness) {
+        mask |= InputBit(RNGSeedInput) | InputBit(CommonRandomNumbersInput) | InputBit(AntitheticTrialsInput) | InputBit(QuasiMonteCarloInput);
+        if (inputs.values[QuasiMonteCarloInput] != 0.0) {
+            mask |= InputBit(NumQMCRandomizationsInput);
+        }
+        mask |= InputBit(DefensiveIntervalRandomnessInput);
+        if (parameters.defenderPolicy == StandardDefenderPolicy) {
+            mask |= InputBit(DefensiveSpecialAttackProbabilityInput);
+        }
+    } else if (parameters.defenderPolicy == StandardDefenderPolicy) {
+        mask |= InputBit(NumDefensiveSpecialAttackDeferralsInput);
+    }
+
+    /* levels and IVs determine HP and damage */
+    for (i = AttackerLevelInput; i <= DefenderDefenseIVInput; ++i) {
+        mask |= InputBit(i);
+    }
+
+    /* long press only delays special attacks, but also decides whether weaker ones are skipped */
+    if (-parameters.attackerSpecialAttackEnergy <= parameters.maxAttackerEnergy || inputs.values[SkipWeakerSpecialAttacksInput] != 0.0) {
+        mask |= InputBit(LongPressDurationInput);
+    }
+
+    /* battle parameters */
+    mask |= InputBit(DefensiveHPMultiplierInput) | InputBit(MaxOffensiveEnergyInput) | InputBit(MaxDefensiveEnergyInput) | InputBit(EnergyPerHPLostInput) |
+            InputBit(BattleDurationInput) | InputBit(OffensiveInitialIntervalInput) | InputBit(NumDefensiveInitialIntervalsInput) |
+            InputBit(DefensiveFirstInitialIntervalInput) | InputBit(DefensiveSecondInitialIntervalInput) | InputBit(DefensiveThirdInitialIntervalInput) |
+            InputBit(DefensiveIntervalInput);
+    return mask;
+}
+
+
+/* resolve the matchup of every party member against the boss, the delays and relobbies are left to the caller */
+/* returns false if a move set or level is not in the game data */
+bool ResolveRaidParameters(const GameData &gameData, const BattleInputs &inputs, const std::vector<std::vector<long>> &partyMoveSetNums,
+                           long bossMoveSetNum, RaidParameters &raid)
+{
+    MatchupData matchupData;
+    double      attackerCPMultiplier, defenderCPMultiplier;
+
+    attackerCPMultiplier = gameData.CPMultiplier(inputs.values[AttackerLevelInput]);
+    defenderCPMultiplier = gameData.CPMultiplier(inputs.values[DefenderLevelInput]);
+    if (attackerCPMultiplier == 0.0 || defenderCPMultiplier == 0.0) return false;
+    raid.parties.clear();
+    for (auto &moveSetNums : partyMoveSetNums) {
+        raid.parties.emplace_back();
+        for (auto moveSetNum : moveSetNums) {
+            if (!ResolveMatchupData(gameData, moveSetNum, bossMoveSetNum, matchupData)) return false;
+            raid.parties.back().emplace_back();
+            ResolveBattleParameters(matchupData, inputs, attackerCPMultiplier, defenderCPMultiplier, raid.parties.back().back());
+        }
+    }
+    return true;
+}
+
+
+/* resolve the matchup of every attacker of the team against every defender of the lineup */
+/* returns false if the team or lineup is too large, or a move set or level is not in the game data */
+bool ResolveTeamParameters(const GameData &gameData, const BattleInputs &inputs, const std::vector<long> &attackerMoveSetNums,
+                           const std::vector<long> &defenderMoveSetNums, TeamParameters &team)
+{
+    MatchupData matchupData;
+    double      attackerCPMultiplier, defenderCPMultiplier;
+    int         attackerNum, defenderNum;
+
+    if (attackerMoveSetNums.size() > (size_t) maxTeamSize || defenderMoveSetNums.size() > (size_t) maxTeamSize) return false;
+    attackerCPMultiplier = gameData.CPMultiplier(inputs.values[AttackerLevelInput]);
+    defenderCPMultiplier = gameData.CPMultiplier(inputs.values[DefenderLevelInput]);
+    if (attackerCPMultiplier == 0.0 || defenderCPMultiplier == 0.0) return false;
+    team.numAttackers = (int) attackerMoveSetNums.size();
+    team.numDefenders = (int) defenderMoveSetNums.size();
+    for (attackerNum = 0; attackerNum < team.numAttackers; ++attackerNum) {
+        for (defenderNum = 0; defenderNum < team.numDefenders; ++defenderNum) {
+            if (!ResolveMatchupData(gameData, attackerMoveSetNums[attackerNum], defenderMoveSetNums[defenderNum], matchupData)) return false;
+            ResolveBattleParameters(matchupData, inputs, attackerCPMultiplier, defenderCPMultiplier, team.matchups[attackerNum][defenderNum]);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "BattleEngine.h"
+#include "GameData.h"
+#include "RaidEngine.h"
+#include "TeamEngine.h"
+
+
+/* named inputs on the Inputs sheet */
+enum BattleInputIds {
+    SkipWeakerSpecialAttacksInput,
+    RandomnessInput,
+    RNGSeedInput,
+    NumMonteCarloTrialsInput,
+    CommonRandomNumbersInput,
+    AntitheticTrialsInput,
+    QuasiMonteCarloInput,
+    NumQMCRandomizationsInput,
+    LogBattlesInput,
+    AttackerLevelInput,
+    AttackerStaminaIVInput,
+    AttackerAttackIVInput,
+    AttackerDefenseIVInput,
+    DefenderLevelInput,
+    DefenderStaminaIVInput,
+    DefenderAttackIVInput,
+    DefenderDefenseIVInput,
+    DefensiveHPMultiplierInput,
+    MaxOffensiveEnergyInput,
+    MaxDefensiveEnergyInput,
+    EnergyPerHPLostInput,
+    BattleDurationInput,
+    LongPressDurationInput,
+    OffensiveInitialIntervalInput,
+    NumDefensiveInitialIntervalsInput,
+    DefensiveFirstInitialIntervalInput,
+    DefensiveSecondInitialIntervalInput,
+    DefensiveThirdInitialIntervalInput,
+    DefensiveIntervalInput,
+    DefensiveIntervalRandomnessInput,
+    NumDefensiveSpecialAttackDeferralsInput,
+    DefensiveSpecialAttackProbabilityInput,
+    AttackerPolicyInput,
+    DefenderPolicyInput,
+    EnginePlanningInput,
+    numBattleInputs
+};
+
+
+struct BattleInputInfo {
+    const char *name;
+    bool       boolean;
+};
+
+
+extern const BattleInputInfo battleInputInfo[numBattleInputs];
+
+
+/* values of the named inputs, booleans as 0 or 1 */
+struct BattleInputs {
+    double values[numBattleInputs];
+};
+
+
+/* set of named inputs, one bit per input id */
+typedef unsigned long long BattleInputMask;
+
+
+inline BattleInputMask InputBit(int inputId)
+{
+    return 1ULL << inputId;
+}
+
+
+/* reasons the simulation settings can be invalid */
+enum BattleInputErrors {
+    NoInputError,
+    RandomnessRequiredError,
+    OddAntitheticTrialsError,
+    AntitheticQuasiMonteCarloError,
+    UnevenRandomizationsError,
+    UnknownPolicyError
+};
+
+
+/* attack data that does not depend on level or IVs */
+struct MatchupAttack {
+    int    power, energy, damageStart, duration;
+    double stab;
+    double effectiveness;
+};
+
+
+/* combatant data that does not depend on level or IVs, after any Ditto transformation */
+struct MatchupCombatant {
+    long          moveSetNum;
+    int           pokedexNum;
+    double        baseStamina, baseAttack, baseDefense;
+    bool          transforms;
+    MatchupAttack fastAttack, specialAttack;
+};
+
+
+/* matchup data that does not depend on level or IVs */
+struct MatchupData {
+    MatchupCombatant attacker, defender;
+    int              transformPower, transformEnergy, transformDamageStart, transformDuration;
+};
+
+
+/* attacker and defender move set numbers */
+struct Matchup {
+    long attackerMoveSetNum;
+    long defenderMoveSetNum;
+};
+
+
+inline int CombatantHP(double baseStamina, int staminaIV, double cpMultiplier)
+{
+    int hp;
+
+    hp = (int) ((baseStamina + staminaIV) * cpMultiplier);
+    return (hp > 10) ? hp : 10;
+}
+
+
+inline int AttackDamage(double attack, double defense, int power, double stab, double effectiveness)
+{
+    return (int) (0.5 * attack / defense * power * stab * effectiveness) + 1;
+}
+
+
+void              DefaultBattleInputs     (BattleInputs &inputs);
+
+bool              ParseBattleInputs       (const std::map<std::string, std::string> &inputStrs, BattleInputs &inputs);
+
+void              FormatBattleInputs      (const BattleInputs &inputs, std::map<std::string, std::string> &inputStrs);
+
+BattleInputErrors CheckBattleInputs       (const BattleInputs &inputs);
+
+bool              ResolveMatchupData      (const GameData &gameData, long attackerMoveSetNum, long defenderMoveSetNum, MatchupData &matchupData);
+
+void              ResolveBattleParameters (const MatchupData &matchupData, const BattleInputs &inputs, double attackerCPMultiplier, double defenderCPMultiplier,
+                                           BattleParameters &parameters);
+
+BattleInputMask   BattleInputDependencies (const BattleInputs &inputs, const BattleParameters &parameters);
+
+bool              ResolveRaidParameters   (const GameData &gameData, const BattleInputs &inputs, const std::vector<std::vector<long>> &partyMoveSetNums,
+                                           long bossMoveSetNum, RaidParameters &raid);
+
+bool              ResolveTeamParameters   (const GameData &gameData, const BattleInputs &inputs, const std::vector<long> &attackerMoveSetNums,
+                                           const std::vector<long> &defenderMoveSetNums, TeamParameters &team);
@@ -0,0 +1,449 @@
+#include <math.h>
+#include <string.h>
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BattleEngine.h"
+#include "BattleResolver.h"
+#include "GameData.h"
+#include "MatchupCache.h"
+#include "ParameterSweep.h"
+
+#include "BattleSimAPI.h"
+
+
+/* game tables with the inputs of the file they came from */
+struct LoadedGameData {
+    GameData     gameData;
+    BattleInputs inputs;
+};
+
+
+struct BattleSimGameData {
+    std::shared_ptr<const LoadedGameData> loaded;
+};
+
+
+struct BattleSimContext {
+    std::shared_ptr<const LoadedGameData> loaded;
+    BattleInputs                          inputs;
+    std::mutex                            inputsLock;
+    MatchupCache                          matchupCache;
+};
+
+
+const char *statusMessages[BattleSimNumStatuses] = {
+    "OK",
+    "Invalid argument.",
+    "Opening the game data file failed.",
+    "Not a valid game data file.",
+    "Unknown input name.",
+    "The simulation settings are invalid.",
+    "A move set is not in the game data.",
+    "A level is not in the game data.",
+    "Out of memory.",
+    "Internal error."
+};
+
+
+/* rand() has one state per process, so battles drawing from it are evaluated one batch at a time across all contexts */
+std::mutex randStreamLock;
+
+
+int ReadGameDataStream(std::istream &stream, BattleSimGameData **gameData)
+{
+    std::map<std::string, std::string> inputStrs;
+
+    auto loaded = std::make_shared<LoadedGameData>();
+    if (!ReadGameData(stream, loaded->gameData, inputStrs)) return BattleSimInvalidGameData;
+    DefaultBattleInputs(loaded->inputs);
+    if (!ParseBattleInputs(inputStrs, loaded->inputs)) return BattleSimInvalidGameData;
+    *gameData = new BattleSimGameData;
+    (*gameData)->loaded = loaded;
+    return BattleSimOK;
+}
+
+
+int InputId(const char *name)
+{
+    int i;
+
+    for (i = 0; i < numBattleInputs; ++i) {
+        if (!strcmp(battleInputInfo[i].name, name)) return i;
+    }
+    return -1;
+}
+
+
+/* a copy of the context's inputs taken once per call, so other threads can change them meanwhile */
+void ContextInputs(BattleSimContext *context, BattleInputs &inputs)
+{
+    std::lock_guard<std::mutex> guard(context->inputsLock);
+
+    inputs = context->inputs;
+}
+
+
+/* the asserts of CheckBattleInputs() are errors here, since the inputs come from the caller */
+bool InputsAreValid(const BattleInputs &inputs)
+{
+    if (inputs.values[RNGSeedInput] <= 0 || (long) inputs.values[NumMonteCarloTrialsInput] <= 0) return false;
+    if ((long) inputs.values[NumQMCRandomizationsInput] <= 0) return false;
+    if ((int) inputs.values[NumDefensiveInitialIntervalsInput] != numDefensiveInitialIntervalInputs) return false;
+    return CheckBattleInputs(inputs) == NoInputError;
+}
+
+
+/* resolve one matchup with its levels and IVs in place of the inputs' */
+int ResolveMatchup(const GameData &gameData, const BattleInputs &inputs, const BattleSimMatchup &matchup, BattleParameters &parameters)
+{
+    BattleInputs matchupInputs;
+    MatchupData  matchupData;
+    double       values[numSweepInputs];
+    double       attackerCPMultiplier, defenderCPMultiplier;
+    int          i;
+
+    values[AttackerLevelSweep] = matchup.attackerLevel;
+    values[AttackerStaminaIVSweep] = matchup.attackerStaminaIV;
+    values[AttackerAttackIVSweep] = matchup.attackerAttackIV;
+    values[AttackerDefenseIVSweep] = matchup.attackerDefenseIV;
+    values[DefenderLevelSweep] = matchup.defenderLevel;
+    values[DefenderStaminaIVSweep] = matchup.defenderStaminaIV;
+    values[DefenderAttackIVSweep] = matchup.defenderAttackIV;
+    values[DefenderDefenseIVSweep] = matchup.defenderDefenseIV;
+    matchupInputs = inputs;
+    for (i = 0; i < numSweepInputs; ++i) {
+        if (values[i] >= 0.0) matchupInputs.values[sweepInputIds[i]] = values[i];
+    }
+
+    if (!ResolveMatchupData(gameData, (long) matchup.attackerMoveSetNum, (long) matchup.defenderMoveSetNum, matchupData)) return BattleSimUnknownMatchup;
+    attackerCPMultiplier = gameData.CPMultiplier(matchupInputs.values[AttackerLevelInput]);
+    defenderCPMultiplier = gameData.CPMultiplier(matchupInputs.values[DefenderLevelInput]);
+    if (attackerCPMultiplier == 0.0 || defenderCPMultiplier == 0.0) return BattleSimUnknownLevel;
+    ResolveBattleParameters(matchupData, matchupInputs, attackerCPMultiplier, defenderCPMultiplier, parameters);
+    return BattleSimOK;
+}
+
+
+/* copy an engine result into a library result */
+inline void LibraryResult(const BattleResult &result, BattleSimResult &libraryResult)
+{
+    libraryResult.numWins = result.numWins;
+    libraryResult.numTrials = result.numTrials;
+    libraryResult.winProbability = result.winProbability;
+    libraryResult.standardError = result.standardError;
+    libraryResult.engine = result.engine;
+    libraryResult.status = BattleSimOK;
+}
+
+
+/* evaluate the matchups not found in the context's cache, each distinct one once */
+/* the inputs are the copy the caller checked, since another thread may change the context's meanwhile */
+/* getMatchup(i, matchup) reads the ith matchup and putResult(i, result) writes its result, wherever the caller keeps them */
+template <class GetMatchup, class PutResult>
+void EvaluateMatchups(BattleSimContext *context, const BattleInputs &inputs, size_t numMatchups, GetMatchup getMatchup, PutResult putResult,
+                      int numThreads)
+{
+    BattleSimMatchup              matchup;
+    BattleSimResult               libraryResult;
+    BattleParameters              matchupParameters;
+    BattleKey                     key;
+    BattleResult                  result;
+    std::vector<BattleParameters> parameters;
+    std::vector<BattleKey>        keys;
+    std::vector<BattleResult>     simulatedResults;
+    std::vector<size_t>           resultNums;
+    std::unique_lock<std::mutex>  randStreamGuard(randStreamLock, std::defer_lock);
+    size_t                        i;
+
+    const GameData &gameData = context->loaded->gameData;
+    for (i = 0; i < numMatchups; ++i) {
+        getMatchup(i, matchup);
+        memset(&libraryResult, 0, sizeof libraryResult);
+        libraryResult.status = ResolveMatchup(gameData, inputs, matchup, matchupParameters);
+        if (libraryResult.status != BattleSimOK) {
+            putResult(i, libraryResult);
+            continue;
+        }
+        MakeBattleKey(matchupParameters, key);
+        if (context->matchupCache.Find(key, result)) {
+            LibraryResult(result, libraryResult);
+            putResult(i, libraryResult);
+            continue;
+        }
+        if (!TrialsAreSeparable(matchupParameters) && !randStreamGuard.owns_lock()) randStreamGuard.lock();
+        parameters.push_back(matchupParameters);
+        keys.push_back(key);
+        resultNums.push_back(i);
+    }
+
+    simulatedResults.resize(parameters.size());
+    SimulateUniqueBattles(parameters.data(), (long) parameters.size(), simulatedResults.data(), numThreads);
+    for (i = 0; i < parameters.size(); ++i) {
+        context->matchupCache.Insert(keys[i], simulatedResults[i]);
+        LibraryResult(simulatedResults[i], libraryResult);
+        putResult(resultNums[i], libraryResult);
+    }
+}
+
+
+/* ith number of a column, or the default of a missing column */
+template <class Number>
+inline Number ColumnNumber(const BattleSimColumn &column, size_t i, Number defaultNumber)
+{
+    Number number;
+
+    if (!column.data) return defaultNumber;
+    memcpy(&number, (const char *) column.data + (ptrdiff_t) i * column.stride, sizeof number);
+    return number;
+}
+
+
+template <class Number>
+inline void PutColumnNumber(const BattleSimOutputColumn &column, size_t i, Number number)
+{
+    if (!column.data) return;
+    memcpy((char *) column.data + (ptrdiff_t) i * column.stride, &number, sizeof number);
+}
+
+
+/* collect the outcome measures of one matchup as BattleStatistics() does */
+void MatchupStatistics(const BattleParameters &parameters, BattleSimStatistics *matchupStatistics)
+{
+    std::unique_lock<std::mutex> randStreamGuard(randStreamLock, std::defer_lock);
+    std::ofstream                logFile;
+    BattleResult                 result;
+    double                       numTrials, meanDuration;
+    int                          i;
+
+    auto statistics = std::unique_ptr<TrialStatistics>(new TrialStatistics);
+    if (!TrialsAreSeparable(parameters)) randStreamGuard.lock();
+    SimulateBattleStatistics(parameters, logFile, result, *statistics);
+    if (randStreamGuard.owns_lock()) randStreamGuard.unlock();
+
+    numTrials = (double) parameters.numTrials;
+    meanDuration = statistics->sumOfDurations / numTrials;
+    matchupStatistics->winProbability = result.winProbability;
+    matchupStatistics->standardError = result.standardError;
+    matchupStatistics->meanDuration = meanDuration / 1000.0;
+    matchupStatistics->durationStandardDeviation = sqrt(fmax(statistics->sumOfSquaredDurations / numTrials - meanDuration * meanDuration, 0.0)) / 1000.0;
+    matchupStatistics->duration10thPercentile = DurationPercentile(parameters, *statistics, parameters.numTrials, 0.1) / 1000.0;
+    matchupStatistics->durationMedian = DurationPercentile(parameters, *statistics, parameters.numTrials, 0.5) / 1000.0;
+    matchupStatistics->duration90thPercentile = DurationPercentile(parameters, *statistics, parameters.numTrials, 0.9) / 1000.0;
+    matchupStatistics->timeToWin = (result.numWins > 0) ? statistics->sumOfWinDurations / (double) result.numWins / 1000.0 : NAN;
+    matchupStatistics->damageDealt = statistics->sumOfDamageDealt / numTrials;
+    matchupStatistics->damageTaken = statistics->sumOfDamageTaken / numTrials;
+    matchupStatistics->attackerSpecialAttacks = statistics->numAttackerSpecialAttacks / numTrials;
+    matchupStatistics->defenderSpecialAttacks = statistics->numDefenderSpecialAttacks / numTrials;
+    for (i = 0; i < BATTLESIM_HP_BINS; ++i) {
+        matchupStatistics->attackerHPFractions[i] = statistics->attackerHPCounts[i] / numTrials;
+        matchupStatistics->defenderHPFractions[i] = statistics->defenderHPCounts[i] / numTrials;
+    }
+}
+
+
+static_assert(BATTLESIM_HP_BINS == numHPBins, "The library's HP bins must match the engine's.");
+static_assert((int) BattleSimMonteCarloEngine == MonteCarloEngine && (int) BattleSimExactEngine == ExactEngine, "The library's engines must match.");
+
+
+/* exceptions do not cross the C interface */
+
+int BattleSimApiVersion(void)
+{
+    return BATTLESIM_API_VERSION;
+}
+
+
+const char *BattleSimStatusMessage(int status)
+{
+    return (status >= 0 && status < BattleSimNumStatuses) ? statusMessages[status] : "Unknown status.";
+}
+
+
+int BattleSimLoadGameDataFile(const char *fileName, BattleSimGameData **gameData)
+{
+    std::ifstream dataFile;
+
+    if (!fileName || !gameData) return BattleSimInvalidArgument;
+    *gameData = nullptr;
+    try {
+        dataFile.open(fileName);
+        if (dataFile.fail()) return BattleSimOpenFailed;
+        return ReadGameDataStream(dataFile, gameData);
+    } catch (const std::bad_alloc &) {
+        return BattleSimOutOfMemory;
+    } catch (...) {
+        return BattleSimInternalError;
+    }
+}
+
+
+int BattleSimLoadGameDataBuffer(const char *buffer, size_t numBytes, BattleSimGameData **gameData)
+{
+    if (!buffer || !gameData) return BattleSimInvalidArgument;
+    *gameData = nullptr;
+    try {
+        std::istringstream stream(std::string(buffer, numBytes));
+
+        return ReadGameDataStream(stream, gameData);
+    } catch (const std::bad_alloc &) {
+        return BattleSimOutOfMemory;
+    } catch (...) {
+        return BattleSimInternalError;
+    }
+}
+
+
+void BattleSimFreeGameData(BattleSimGameData *gameData)
+{
+    delete gameData;
+}
+
+
+int BattleSimCreateContext(const BattleSimGameData *gameData, BattleSimContext **context)
+{
+    if (!gameData || !context) return BattleSimInvalidArgument;
+    *context = new (std::nothrow) BattleSimContext;
+    if (!*context) return BattleSimOutOfMemory;
+    (*context)->loaded = gameData->loaded;
+    (*context)->inputs = gameData->loaded->inputs;
+    return BattleSimOK;
+}
+
+
+void BattleSimFreeContext(BattleSimContext *context)
+{
+    delete context;
+}
+
+
+int BattleSimSetInput(BattleSimContext *context, const char *name, double value)
+{
+    int inputId;
+
+    if (!context || !name) return BattleSimInvalidArgument;
+    inputId = InputId(name);
+    if (inputId < 0) return BattleSimUnknownInput;
+    std::lock_guard<std::mutex> guard(context->inputsLock);
+
+    context->inputs.values[inputId] = value;
+    return BattleSimOK;
+}
+
+
+int BattleSimGetInput(BattleSimContext *context, const char *name, double *value)
+{
+    int inputId;
+
+    if (!context || !name || !value) return BattleSimInvalidArgument;
+    inputId = InputId(name);
+    if (inputId < 0) return BattleSimUnknownInput;
+    std::lock_guard<std::mutex> guard(context->inputsLock);
+
+    *value = context->inputs.values[inputId];
+    return BattleSimOK;
+}
+
+
+int BattleSimEvaluate(BattleSimContext *context, const BattleSimMatchup *matchups, size_t numMatchups, BattleSimResult *results, int numThreads)
+{
+    BattleInputs inputs;
+
+    if (!context || (numMatchups > 0 && (!matchups || !results))) return BattleSimInvalidArgument;
+    ContextInputs(context, inputs);
+    if (!InputsAreValid(inputs)) return BattleSimInvalidInputs;
+    try {
+        EvaluateMatchups(context, inputs, numMatchups, [matchups] (size_t i, BattleSimMatchup &matchup) {
+            matchup = matchups[i];
+        }, [results] (size_t i, const BattleSimResult &result) {
+            results[i] = result;
+        }, numThreads);
+        return BattleSimOK;
+    } catch (const std::bad_alloc &) {
+        return BattleSimOutOfMemory;
+    } catch (...) {
+        return BattleSimInternalError;
+    }
+}
+
+
+int BattleSimEvaluateColumns(BattleSimContext *context, const BattleSimMatchupColumns *matchups, size_t numMatchups,
+                             const BattleSimResultColumns *results, int numThreads)
+{
+    BattleInputs inputs;
+
+    if (!context || !matchups || !results) return BattleSimInvalidArgument;
+    if (numMatchups > 0 && (!matchups->attackerMoveSetNums.data || !matchups->defenderMoveSetNums.data)) return BattleSimInvalidArgument;
+    ContextInputs(context, inputs);
+    if (!InputsAreValid(inputs)) return BattleSimInvalidInputs;
+    try {
+        EvaluateMatchups(context, inputs, numMatchups, [matchups] (size_t i, BattleSimMatchup &matchup) {
+            matchup.attackerMoveSetNum = ColumnNumber(matchups->attackerMoveSetNums, i, (int64_t) 0);
+            matchup.defenderMoveSetNum = ColumnNumber(matchups->defenderMoveSetNums, i, (int64_t) 0);
+            matchup.attackerLevel = ColumnNumber(matchups->attackerLevels, i, -1.0);
+            matchup.attackerStaminaIV = ColumnNumber(matchups->attackerStaminaIVs, i, -1.0);
+            matchup.attackerAttackIV = ColumnNumber(matchups->attackerAttackIVs, i, -1.0);
+            matchup.attackerDefenseIV = ColumnNumber(matchups->attackerDefenseIVs, i, -1.0);
+            matchup.defenderLevel = ColumnNumber(matchups->defenderLevels, i, -1.0);
+            matchup.defenderStaminaIV = ColumnNumber(matchups->defenderStaminaIVs, i, -1.0);
+            matchup.defenderAttackIV = ColumnNumber(matchups->defenderAttackIVs, i, -1.0);
+            matchup.defenderDefenseIV = ColumnNumber(matchups->defenderDefenseIVs, i, -1.0);
+        }, [results] (size_t i, const BattleSimResult &result) {
+            PutColumnNumber(results->numWins, i, result.numWins);
+            PutColumnNumber(results->numTrials, i, result.numTrials);
+            PutColumnNumber(results->winProbabilities, i, result.winProbability);
+            PutColumnNumber(results->standardErrors, i, result.standardError);
+            PutColumnNumber(results->engines, i, result.engine);
+            PutColumnNumber(results->statuses, i, result.status);
+        }, numThreads);
+        return BattleSimOK;
+    } catch (const std::bad_alloc &) {
+        return BattleSimOutOfMemory;
+    } catch (...) {
+        return BattleSimInternalError;
+    }
+}
+
+
+int BattleSimMatchupStatistics(BattleSimContext *context, const BattleSimMatchup *matchup, BattleSimStatistics *statistics)
+{
+    BattleInputs     inputs;
+    BattleParameters parameters;
+    int              status;
+
+    if (!context || !matchup || !statistics) return BattleSimInvalidArgument;
+    ContextInputs(context, inputs);
+    if (!InputsAreValid(inputs)) return BattleSimInvalidInputs;
+    try {
+        status = ResolveMatchup(context->loaded->gameData, inputs, *matchup, parameters);
+        if (status != BattleSimOK) return status;
+        MatchupStatistics(parameters, statistics);
+        return BattleSimOK;
+    } catch (const std::bad_alloc &) {
+        return BattleSimOutOfMemory;
+    } catch (...) {
+        return BattleSimInternalError;
+    }
+}
+
+
+void BattleSimCacheCounts(BattleSimContext *context, int64_t *numHits, int64_t *numMisses)
+{
+    if (!context) return;
+    if (numHits) *numHits = context->matchupCache.NumHits();
+    if (numMisses) *numMisses = context->matchupCache.NumMisses();
+}
+
+
+void BattleSimClearCache(BattleSimContext *context)
+{
+    if (!context) return;
+    context->matchupCache.Clear();
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+
+/* C interface of libbattlesim, the battle simulator as a shared library for batch pipelines */
+/* built from the portable sources like the headless driver, without XLCALL.H or Windows.h */
+/* every function returns a status, and no function throws or keeps state outside the handles it is given */
+/* contexts may be shared by any number of threads, and batches run on the caller's thread when given one thread */
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#if defined(_WIN32)
+#define BATTLESIM_API __declspec(dllexport)
+#else
+#define BATTLESIM_API __attribute__((visibility("default")))
+#endif
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* changes whenever a structure or function changes incompatibly */
+#define BATTLESIM_API_VERSION 1
+
+
+enum BattleSimStatus {
+    BattleSimOK,
+    BattleSimInvalidArgument,
+    BattleSimOpenFailed,
+    BattleSimInvalidGameData,
+    BattleSimUnknownInput,
+    BattleSimInvalidInputs,
+    BattleSimUnknownMatchup,
+    BattleSimUnknownLevel,
+    BattleSimOutOfMemory,
+    BattleSimInternalError,
+    BattleSimNumStatuses
+};
+
+
+/* engines as in BattleSimResult.engine */
+enum BattleSimEngine {
+    BattleSimMonteCarloEngine,
+    BattleSimExactEngine
+};
+
+
+/* game tables and default inputs read from a game data file exported by the workbook, immutable once loaded */
+typedef struct BattleSimGameData BattleSimGameData;
+
+/* inputs of the Inputs sheet and a cache of results, over one game data */
+typedef struct BattleSimContext BattleSimContext;
+
+
+/* one matchup of a batch, levels and IVs that are negative keep the context's inputs */
+typedef struct BattleSimMatchup {
+    int64_t attackerMoveSetNum, defenderMoveSetNum;
+    double  attackerLevel, attackerStaminaIV, attackerAttackIV, attackerDefenseIV;
+    double  defenderLevel, defenderStaminaIV, defenderAttackIV, defenderDefenseIV;
+} BattleSimMatchup;
+
+
+/* result of one matchup, all zero except the status if the matchup could not be resolved */
+typedef struct BattleSimResult {
+    int64_t numWins, numTrials;
+    double  winProbability, standardError;
+    int32_t engine;
+    int32_t status;
+} BattleSimResult;
+
+
+/* column of a batch, the ith number at data + i * stride bytes, as in a strided array */
+/* a null matchup column keeps the context's input, a null result column is not written */
+typedef struct BattleSimColumn {
+    const void *data;
+    ptrdiff_t  stride;
+} BattleSimColumn;
+
+typedef struct BattleSimOutputColumn {
+    void      *data;
+    ptrdiff_t stride;
+} BattleSimOutputColumn;
+
+
+/* matchups of a batch by column, move set numbers are int64_t and levels and IVs double */
+typedef struct BattleSimMatchupColumns {
+    BattleSimColumn attackerMoveSetNums, defenderMoveSetNums;
+    BattleSimColumn attackerLevels, attackerStaminaIVs, attackerAttackIVs, attackerDefenseIVs;
+    BattleSimColumn defenderLevels, defenderStaminaIVs, defenderAttackIVs, defenderDefenseIVs;
+} BattleSimMatchupColumns;
+
+
+/* results of a batch by column, numbers of wins and trials are int64_t, probabilities and errors double, engines and statuses int32_t */
+typedef struct BattleSimResultColumns {
+    BattleSimOutputColumn numWins, numTrials;
+    BattleSimOutputColumn winProbabilities, standardErrors;
+    BattleSimOutputColumn engines, statuses;
+} BattleSimResultColumns;
+
+
+/* number of bins of the remaining HP fractions */
+#define BATTLESIM_HP_BINS 10
+
+
+/* outcome measures of one matchup as returned by BattleStatistics() in the workbook, times in seconds */
+/* the time to win is NaN if the attacker never wins, remaining HP fractions are of trials ending up to each tenth of the starting HP */
+typedef struct BattleSimStatistics {
+    double winProbability, standardError;
+    double meanDuration, durationStandardDeviation;
+    double duration10thPercentile, durationMedian, duration90thPercentile;
+    double timeToWin;
+    double damageDealt, damageTaken;
+    double attackerSpecialAttacks, defenderSpecialAttacks;
+    double attackerHPFractions[BATTLESIM_HP_BINS], defenderHPFractions[BATTLESIM_HP_BINS];
+} BattleSimStatistics;
+
+
+BATTLESIM_API int         BattleSimApiVersion         (void);
+
+BATTLESIM_API const char *BattleSimStatusMessage      (int status);
+
+BATTLESIM_API int         BattleSimLoadGameDataFile   (const char *fileName, BattleSimGameData **gameData);
+
+BATTLESIM_API int         BattleSimLoadGameDataBuffer (const char *buffer, size_t numBytes, BattleSimGameData **gameData);
+
+/* contexts keep the game data they were created with, so it can be freed before them */
+BATTLESIM_API void        BattleSimFreeGameData       (BattleSimGameData *gameData);
+
+BATTLESIM_API int         BattleSimCreateContext      (const BattleSimGameData *gameData, BattleSimContext **context);
+
+BATTLESIM_API void        BattleSimFreeContext        (BattleSimContext *context);
+
+/* inputs are named as on the Inputs sheet, booleans are 0 or 1, and changing one does not invalidate cached results */
+BATTLESIM_API int         BattleSimSetInput           (BattleSimContext *context, const char *name, double value);
+
+BATTLESIM_API int         BattleSimGetInput           (BattleSimContext *context, const char *name, double *value);
+
+/* evaluate matchups into the caller's results, on up to numThreads threads of the library's own */
+/* returns BattleSimInvalidInputs without evaluating anything if the inputs are inconsistent, */
+/* otherwise BattleSimOK with the status of each matchup in its result */
+BATTLESIM_API int         BattleSimEvaluate           (BattleSimContext *context, const BattleSimMatchup *matchups, size_t numMatchups,
+                                                       BattleSimResult *results, int numThreads);
+
+/* BattleSimEvaluate() over columns, such as the arrays of a data frame, read and written in place */
+/* the move set columns are required */
+BATTLESIM_API int         BattleSimEvaluateColumns    (BattleSimContext *context, const BattleSimMatchupColumns *matchups, size_t numMatchups,
+                                                       const BattleSimResultColumns *results, int numThreads);
+
+BATTLESIM_API int         BattleSimMatchupStatistics  (BattleSimContext *context, const BattleSimMatchup *matchup, BattleSimStatistics *statistics);
+
+BATTLESIM_API void        BattleSimCacheCounts        (BattleSimContext *context, int64_t *numHits, int64_t *numMisses);
+
+BATTLESIM_API void        BattleSimClearCache         (BattleSimContext *context);
+
+
+#ifdef __cplusplus
+}
+#endif
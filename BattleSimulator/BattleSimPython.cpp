@@ -0,0 +1,332 @@
+/* Python extension battlesim over libbattlesim, for evaluating batches of matchups held in NumPy arrays */
+/* arrays are read and written in place through the buffer protocol, and the GIL is released while a batch is evaluated */
+/* built as a module with the sources of the library */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <thread>
+
+#include "BattleSimAPI.h"
+
+
+/* kinds of numbers in a column */
+enum ColumnKinds {
+    Int64Column,
+    Int32Column,
+    DoubleColumn
+};
+
+
+/* matchup columns by keyword, in the order of BattleSimMatchupColumns after the move sets */
+const int numLevelIVColumns = 8;
+
+/* result columns by keyword, in the order of BattleSimResultColumns */
+const int numResultColumns = 6;
+
+const char *resultColumnNames[numResultColumns] = {
+    "num_wins",
+    "num_trials",
+    "win_probability",
+    "standard_error",
+    "engine",
+    "status"
+};
+
+const int resultColumnKinds[numResultColumns] = {
+    Int64Column,
+    Int64Column,
+    DoubleColumn,
+    DoubleColumn,
+    Int32Column,
+    Int32Column
+};
+
+
+struct ContextObject {
+    PyObject_HEAD
+    BattleSimContext *context;
+};
+
+
+PyObject *battleSimError;
+
+
+/* raise battlesim.Error for a library status, returns false if there is an error */
+bool CheckStatus(int status)
+{
+    if (status == BattleSimOK) return true;
+    PyErr_SetString(battleSimError, BattleSimStatusMessage(status));
+    return false;
+}
+
+
+/* whether a buffer format is a native number of the given kind, with or without a byte order that is native */
+bool FormatIsKind(const char *format, Py_ssize_t itemSize, int kind)
+{
+    if (!format) format = "B";
+    if (*format == '@' || *format == '=' || (PY_LITTLE_ENDIAN && *format == '<') || (!PY_LITTLE_ENDIAN && *format == '>')) ++format;
+    if (strlen(format) != 1) return false;
+    switch (kind) {
+    case Int64Column:
+        return itemSize == 8 && (*format == 'q' || *format == 'l');
+    case Int32Column:
+        return itemSize == 4 && (*format == 'i' || *format == 'l');
+    default:
+        return itemSize == 8 && *format == 'd';
+    }
+}
+
+
+/* get a one-dimensional buffer of numbers of the given kind with the given length, or any length if it is negative */
+/* the buffer is released by the caller once the batch is done, returns false with an exception set if it does not fit */
+bool GetColumn(PyObject *object, const char *name, int kind, bool writable, Py_ssize_t length, Py_buffer &buffer)
+{
+    if (PyObject_GetBuffer(object, &buffer, PyBUF_STRIDES | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0)) < 0) return false;
+    if (buffer.ndim != 1 || !FormatIsKind(buffer.format, buffer.itemsize, kind)) {
+        PyErr_Format(PyExc_TypeError, "%s must be a one-dimensional array of %s", name,
+                     (kind == Int64Column) ? "int64" : (kind == Int32Column) ? "int32" : "float64");
+        PyBuffer_Release(&buffer);
+        return false;
+    }
+    if (length >= 0 && buffer.shape[0] != length) {
+        PyErr_Format(PyExc_ValueError, "%s has %zd elements instead of %zd", name, buffer.shape[0], length);
+        PyBuffer_Release(&buffer);
+        return false;
+    }
+    return true;
+}
+
+
+int ContextInit(ContextObject *self, PyObject *args, PyObject *kwargs)
+{
+    const char        *keywords[] = {"game_data_file", nullptr};
+    const char        *fileName;
+    BattleSimGameData *gameData;
+    int               status;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **) keywords, &fileName)) return -1;
+    /* another thread may be evaluating with the context while the GIL is released, so it is never replaced */
+    if (self->context) {
+        PyErr_SetString(battleSimError, "The context already has game data.");
+        return -1;
+    }
+    status = BattleSimLoadGameDataFile(fileName, &gameData);
+    if (!CheckStatus(status)) return -1;
+    status = BattleSimCreateContext(gameData, &self->context);
+    BattleSimFreeGameData(gameData);
+    return CheckStatus(status) ? 0 : -1;
+}
+
+
+/* the type is a heap type, which each of its objects holds a reference to */
+void ContextDealloc(ContextObject *self)
+{
+    PyTypeObject *type;
+
+    type = Py_TYPE(self);
+    BattleSimFreeContext(self->context);
+    type->tp_free((PyObject *) self);
+    Py_DECREF(type);
+}
+
+
+/* contexts are created by __init__, which may fail after __new__ */
+bool ContextIsOpen(ContextObject *self)
+{
+    if (self->context) return true;
+    PyErr_SetString(battleSimError, "The context has no game data.");
+    return false;
+}
+
+
+PyObject *ContextSetInput(ContextObject *self, PyObject *args)
+{
+    const char *name;
+    double     value;
+
+    if (!PyArg_ParseTuple(args, "sd", &name, &value) || !ContextIsOpen(self)) return nullptr;
+    if (!CheckStatus(BattleSimSetInput(self->context, name, value))) return nullptr;
+    Py_RETURN_NONE;
+}
+
+
+PyObject *ContextGetInput(ContextObject *self, PyObject *args)
+{
+    const char *name;
+    double     value;
+
+    if (!PyArg_ParseTuple(args, "s", &name) || !ContextIsOpen(self)) return nullptr;
+    if (!CheckStatus(BattleSimGetInput(self->context, name, &value))) return nullptr;
+    return PyFloat_FromDouble(value);
+}
+
+
+/* evaluate(attacker_move_sets, defender_move_sets, *, level and IV columns, result columns, threads) */
+/* level and IV columns that are not given keep the context's inputs, and result columns that are not given are not written */
+PyObject *ContextEvaluate(ContextObject *self, PyObject *args, PyObject *kwargs)
+{
+    const char              *keywords[] = {"attacker_move_sets", "defender_move_sets",
+                                           "attacker_level", "attacker_stamina_iv", "attacker_attack_iv", "attacker_defense_iv",
+                                           "defender_level", "defender_stamina_iv", "defender_attack_iv", "defender_defense_iv",
+                                           "num_wins", "num_trials", "win_probability", "standard_error", "engine", "status",
+                                           "threads", nullptr};
+    PyObject                *moveSetObjects[2];
+    PyObject                *levelIVObjects[numLevelIVColumns] = {};
+    PyObject                *resultObjects[numResultColumns] = {};
+    int                     numThreads;
+    Py_buffer               buffers[2 + numLevelIVColumns + numResultColumns];
+    int                     numBuffers;
+    BattleSimMatchupColumns matchupColumns;
+    BattleSimResultColumns  resultColumns;
+    BattleSimColumn         *matchupColumn;
+    BattleSimOutputColumn   *resultColumn;
+    Py_ssize_t              numMatchups;
+    bool                    valid;
+    int                     status;
+    int                     i;
+
+    numThreads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|$OOOOOOOOOOOOOOi", (char **) keywords, &moveSetObjects[0], &moveSetObjects[1],
+                                     &levelIVObjects[0], &levelIVObjects[1], &levelIVObjects[2], &levelIVObjects[3],
+                                     &levelIVObjects[4], &levelIVObjects[5], &levelIVObjects[6], &levelIVObjects[7],
+                                     &resultObjects[0], &resultObjects[1], &resultObjects[2], &resultObjects[3], &resultObjects[4], &resultObjects[5],
+                                     &numThreads)) {
+        return nullptr;
+    }
+    if (!ContextIsOpen(self)) return nullptr;
+    if (numThreads <= 0) numThreads = (int) std::thread::hardware_concurrency();
+
+    /* the columns point into the buffers, in the order of the column structures */
+    memset(&matchupColumns, 0, sizeof matchupColumns);
+    memset(&resultColumns, 0, sizeof resultColumns);
+    matchupColumn = &matchupColumns.attackerMoveSetNums;
+    resultColumn = &resultColumns.numWins;
+    numBuffers = 0;
+    numMatchups = -1;
+    valid = true;
+    for (i = 0; i < 2 && valid; ++i) {
+        valid = GetColumn(moveSetObjects[i], keywords[i], Int64Column, false, numMatchups, buffers[numBuffers]);
+        if (!valid) break;
+        numMatchups = buffers[numBuffers].shape[0];
+        matchupColumn[i].data = buffers[numBuffers].buf;
+        matchupColumn[i].stride = buffers[numBuffers].strides[0];
+        ++numBuffers;
+    }
+    for (i = 0; i < numLevelIVColumns && valid; ++i) {
+        if (!levelIVObjects[i] || levelIVObjects[i] == Py_None) continue;
+        valid = GetColumn(levelIVObjects[i], keywords[2 + i], DoubleColumn, false, numMatchups, buffers[numBuffers]);
+        if (!valid) break;
+        matchupColumn[2 + i].data = buffers[numBuffers].buf;
+        matchupColumn[2 + i].stride = buffers[numBuffers].strides[0];
+        ++numBuffers;
+    }
+    for (i = 0; i < numResultColumns && valid; ++i) {
+        if (!resultObjects[i] || resultObjects[i] == Py_None) continue;
+        valid = GetColumn(resultObjects[i], resultColumnNames[i], resultColumnKinds[i], true, numMatchups, buffers[numBuffers]);
+        if (!valid) break;
+        resultColumn[i].data = buffers[numBuffers].buf;
+        resultColumn[i].stride = buffers[numBuffers].strides[0];
+        ++numBuffers;
+    }
+
+    status = BattleSimOK;
+    if (valid) {
+        Py_BEGIN_ALLOW_THREADS
+        status = BattleSimEvaluateColumns(self->context, &matchupColumns, (size_t) numMatchups, &resultColumns, numThreads);
+        Py_END_ALLOW_THREADS
+    }
+    for (i = 0; i < numBuffers; ++i) {
+        PyBuffer_Release(&buffers[i]);
+    }
+    if (!valid || !CheckStatus(status)) return nullptr;
+    Py_RETURN_NONE;
+}
+
+
+PyObject *ContextCacheCounts(ContextObject *self, PyObject *)
+{
+    int64_t numHits, numMisses;
+
+    if (!ContextIsOpen(self)) return nullptr;
+    BattleSimCacheCounts(self->context, &numHits, &numMisses);
+    return Py_BuildValue("(LL)", (long long) numHits, (long long) numMisses);
+}
+
+
+PyObject *ContextClearCache(ContextObject *self, PyObject *)
+{
+    if (!ContextIsOpen(self)) return nullptr;
+    BattleSimClearCache(self->context);
+    Py_RETURN_NONE;
+}
+
+
+PyMethodDef contextMethods[] = {
+    {"set_input", (PyCFunction) ContextSetInput, METH_VARARGS, "set_input(name, value) sets an input of the Inputs sheet by name"},
+    {"get_input", (PyCFunction) ContextGetInput, METH_VARARGS, "get_input(name) returns an input of the Inputs sheet by name"},
+    {"evaluate", (PyCFunction) (void (*) (void)) ContextEvaluate, METH_VARARGS | METH_KEYWORDS,
+     "evaluate(attacker_move_sets, defender_move_sets, **columns, threads=0) evaluates matchups into the given result arrays in place"},
+    {"cache_counts", (PyCFunction) ContextCacheCounts, METH_NOARGS, "cache_counts() returns the numbers of cache hits and misses"},
+    {"clear_cache", (PyCFunction) ContextClearCache, METH_NOARGS, "clear_cache() forgets all cached results"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+
+PyType_Slot contextSlots[] = {
+    {Py_tp_doc, (void *) "Context(game_data_file) holds game data exported by the workbook, its inputs, and a cache of results"},
+    {Py_tp_new, (void *) PyType_GenericNew},
+    {Py_tp_init, (void *) ContextInit},
+    {Py_tp_dealloc, (void *) ContextDealloc},
+    {Py_tp_methods, (void *) contextMethods},
+    {0, nullptr}
+};
+
+
+PyType_Spec contextSpec = {
+    "battlesim.Context",
+    sizeof (ContextObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    contextSlots
+};
+
+
+PyModuleDef battleSimModule = {
+    PyModuleDef_HEAD_INIT,
+    "battlesim",
+    "Battle simulator over arrays of matchups",
+    -1,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr
+};
+
+
+/* the module owns each object once it is added, so a failure only releases the objects not added yet */
+PyMODINIT_FUNC PyInit_battlesim(void)
+{
+    PyObject *module, *contextType;
+
+    module = PyModule_Create(&battleSimModule);
+    if (!module) return nullptr;
+    contextType = PyType_FromSpec(&contextSpec);
+    if (!contextType || PyModule_AddObject(module, "Context", contextType) < 0) {
+        Py_XDECREF(contextType);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    battleSimError = PyErr_NewException("battlesim.Error", nullptr, nullptr);
+    if (!battleSimError || PyModule_AddObject(module, "Error", battleSimError) < 0) {
+        Py_XDECREF(battleSimError);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
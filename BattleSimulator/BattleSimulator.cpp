@@ -2,9 +2,15 @@
 #include <math.h>
 #include <stdlib.h>
 
+#include <chrono>
 #include <fstream>
 #include <locale>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <Windows.h>
 
@@ -13,7 +19,23 @@
 #include "ExcelCallbacks.h"
 #include "VBACallbacks.h"
 
-#include "EventQueue.h"
+#include "BattleEngine.h"
+#include "BattleLog.h"
+#include "BattleResolver.h"
+#include "EnginePlanner.h"
+#include "GameData.h"
+#include "GameDataStore.h"
+#include "GridCoordinator.h"
+#include "MatchupCache.h"
+#include "MatchupMatrix.h"
+#include "MatrixFile.h"
+#include "ParameterSweep.h"
+#include "RaidEngine.h"
+#include "StrategySolver.h"
+#include "TeamEngine.h"
+#include "WorkbookData.h"
+#include "WorkerPool.h"
+#include "WorkloadTrace.h"
 
 #include "BattleSimulator.h"
 
@@ -22,33 +44,20 @@
 #define EXPORT comment(linker, "/EXPORT:" __FUNCTION__ "=" __FUNCDNAME__)
 
 
-/* prefix non-negative numbers with a space to match VBA formatting */
-#define SHOWSPACE(n) (((n) < 0) ? "" : " ") << (n)
-
-
 #if LOG
 #define OPENLOG(logFile, logBattles) \
         OpenLog(logFile, logBattles)
-#define LOGSIMULATIONINFO(logFile, randomness, rngSeed, skipWeakerSpecialAttacks) \
-        LogSimulationInfo(logFile, randomness, rngSeed, skipWeakerSpecialAttacks)
 #define LOGPOKEMONINFO(logFile, role, pokedexNum, level, staminaIV, attackIV, defenseIV, transforms) \
         LogPokemonInfo(logFile, role, pokedexNum, level, staminaIV, attackIV, defenseIV, transforms)
 #define LOGATTACKINFO(logFile, attackName, effectiveness, damage, energy, damageStart, duration) \
         LogAttackInfo(logFile, attackName, effectiveness, damage, energy, damageStart, duration)
-#define LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, playerEvent) \
-        LogEvent(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, playerEvent)
-#define LOGNEWLINE(logFile) \
-        LogNewline(logFile)
-#define CLOSELOG(logFile) \
-        CloseLog(logFile)
+#define LOGCOMBATANTINFO(logFile, role, combatant, level, staminaIV, attackIV, defenseIV, fastAttackDamage, specialAttackDamage) \
+        LogCombatantInfo(logFile, role, combatant, level, staminaIV, attackIV, defenseIV, fastAttackDamage, specialAttackDamage)
 #else
 #define OPENLOG(logFile, logBattles)
-#define LOGSIMULATIONINFO(logFile, randomness, rngSeed, skipWeakerSpecialAttacks)
 #define LOGPOKEMONINFO(logFile, role, pokedexNum, level, staminaIV, attackIV, defenseIV, transforms)
 #define LOGATTACKINFO(logFile, attackName, effectiveness, damage, energy, damageStart, duration)
-#define LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, playerEvent)
-#define LOGNEWLINE(logFile)
-#define CLOSELOG(logFile)
+#define LOGCOMBATANTINFO(logFile, role, combatant, level, staminaIV, attackIV, defenseIV, fastAttackDamage, specialAttackDamage)
 #endif
 
 
@@ -56,25 +65,33 @@
 typedef __int16 ExcelBoolean;
 
 
-inline int Min(int number1, int number2)
-{
-    return (number1 < number2) ? number1 : number2;
-}
+/* game tables of the workbook, loaded when Excel is first idle or by the first function that needs them */
+/* checked for edits when each recalculation ends */
+GameDataStore   gameDataStore(LoadGameTables, GameTablesStamp);
 
+/* results of matchups already simulated in this session */
+MatchupCache    matchupCache;
 
-inline int Max(int number1, int number2)
-{
-    return (number1 > number2) ? number1 : number2;
-}
+/* last result of each matchup cell with the inputs it depended on */
+DependencyCache dependencyCache;
 
+/* out-of-process simulation workers, BattleAsync() simulates in process if there are none */
+WorkerPool      workerPool;
 
-int RandomInterval(int expectedInterval, int intervalRandomness)
-{
-    int intervalStart;
+/* Move Set Matchups sheet loaded by LoadMatchupMatrix() for the aggregate functions */
+/* a load publishes a new matrix, aggregates keep the one they got and read it without holding the lock */
+std::shared_ptr<const MatchupMatrix> matchupMatrix;
+std::mutex                           matchupMatrixLock;
 
-    intervalStart = expectedInterval - intervalRandomness / 2;
-    return intervalStart + (int) ((intervalRandomness + 1) * (double) rand() / (RAND_MAX + 1));
-}
+/* number of loads, the value of the MatchupMatrixGeneration name the aggregate functions take */
+double          matchupMatrixGeneration;
+
+/* matrix files opened by MatrixSpeciesAverage(), by file name */
+std::map<std::string, std::unique_ptr<MatrixFileReader>> matrixFiles;
+std::mutex                                               matrixFilesLock;
+
+/* function calls recorded between StartWorkloadTrace() and StopWorkloadTrace() for the headless driver to replay */
+TraceWriter     workloadTrace;
 
 
 #if 0
@@ -137,28 +154,6 @@ void OpenLog(std::ofstream &logFile, bool logBattles)
 #endif
 
 
-#if LOG
-void LogSimulationInfo(std::ofstream &logFile, bool randomness, int rngSeed, bool skipWeakerSpecialAttacks)
-{
-    if (logFile.is_open()) {
-        if (randomness) {
-            logFile << "simulation uses random behavior\n";
-            logFile << SHOWSPACE(rngSeed) << " random number generator seed\n";
-        }
-        else {
-            logFile << "simulation uses expected behavior\n";
-        }
-        if (skipWeakerSpecialAttacks) {
-            logFile << "simulation skips weaker special attacks\n";
-        }
-        else {
-            logFile << "simulation always uses special attacks\n";
-        }
-    }
-}
-#endif
-
-
 #if LOG
 void LogPokemonInfo(std::ofstream &logFile, const std::string &role, int pokedexNum, double level, int staminaIV, int attackIV, int defenseIV, bool transforms)
 {
@@ -201,40 +196,6 @@ void LogAttackInfo(std::ofstream &logFile, const XLOPER12 &attackName, double ef
 #endif
 
 
-#if LOG
-void LogEvent(std::ofstream &logFile, int battleTimer, int attackerBattleHP, int attackerEnergy, int defenderBattleHP, int defenderEnergy,
-              const std::string &playerEvent)
-{
-    if (logFile.is_open()) {
-        logFile << SHOWSPACE(battleTimer) << " "
-                << SHOWSPACE(attackerBattleHP) << " " << SHOWSPACE(attackerEnergy) << " "
-                << SHOWSPACE(defenderBattleHP) << " " << SHOWSPACE(defenderEnergy) << " "
-                << playerEvent << "\n";
-    }
-}
-#endif
-
-
-#if LOG
-void LogNewline(std::ofstream &logFile)
-{
-    if (logFile.is_open()) {
-        logFile << std::endl;
-    }
-}
-#endif
-
-
-#if LOG
-void CloseLog(std::ofstream &logFile)
-{
-    if (logFile.is_open()) {
-        logFile.close();
-    }
-}
-#endif
-
-
 BOOL CALLBACK EnumWindowsProc(HWND hWnd, bool &calledFromExcelDialog)
 {
     WCHAR classNameStr[sizeof "bosa_sdm_XL"];
@@ -286,13 +247,19 @@ int WINAPI xlAutoOpen(void)
 {
 #pragma EXPORT
     XLOPER12 xllName;
-    XLOPER12 functionName, typeText, argumentText, macroType, category, functionHelp, argumentHelp1, argumentHelp2, result;
+    XLOPER12 functionName, typeText, argumentText, macroType, category, functionHelp, argumentHelp1, argumentHelp2, argumentHelp3, argumentHelp4;
+    XLOPER12 argumentHelp5;
+    XLOPER12 result;
+    XLOPER12 missing, now, event;
     int      returnValue;
+    char     *workerEndpoints;
 
     /* get XLL path and name */
     returnValue = Excel12(xlGetName, &xllName, 0);
     if (returnValue != xlretSuccess) return 0;
 
+    missing.xltype = xltypeMissing;
+
     /* register functions with Excel */
     functionName.xltype = xltypeStr;
     functionName.val.str = L"\025SpecialAttackIsWeaker";
@@ -343,7 +310,31 @@ int WINAPI xlAutoOpen(void)
     if (returnValue != xlretSuccess) return 0;
 
     functionName.xltype = xltypeStr;
-    functionName.val.str = L"\026DefenderSpeciesAverage";
+    functionName.val.str = L"\013BattleAsync";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\005>JJX$";
+#else
+    typeText.val.str = L"\004>JJX";
+#endif
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\053attacker_move_set_num,defender_move_set_num";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\150Returns the probability of the attacker winning versus the defender, simulated by the simulation workers";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\042is the attacker's move set number.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\042is the defender's move set number.";
+    returnValue = Excel12(xlfRegister, &result, 12, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2);
+    if (returnValue != xlretSuccess) return 0;
+
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\023BattleStandardError";
     typeText.xltype = xltypeStr;
 #if THREADSAFE
     typeText.val.str = L"\004BJJ$";
@@ -357,7 +348,7 @@ int WINAPI xlAutoOpen(void)
     category.xltype = xltypeStr;
     category.val.str = L"\020Battle Simulator";
     functionHelp.xltype = xltypeStr;
-    functionHelp.val.str = L"\144Returns the average of the matchups between the attacker and all move sets of the defender's species";
+    functionHelp.val.str = L"\141Returns the standard error of the attacker's estimated probability of winning versus the defender";
     argumentHelp1.xltype = xltypeStr;
     argumentHelp1.val.str = L"\042is the attacker's move set number.";
     argumentHelp2.xltype = xltypeStr;
@@ -366,599 +357,1529 @@ int WINAPI xlAutoOpen(void)
                           &functionHelp, &argumentHelp1, &argumentHelp2);
     if (returnValue != xlretSuccess) return 0;
 
-    return 1;
-}
-
-
-double TypeEffectiveness(const XLOPER12 &attackerMoveType, const XLOPER12 &defenderType1, const XLOPER12 &defenderType2)
-{
-    XLOPER12 typeMatchupsRange;
-    XLOPER12 attackingTypesRange, defendingTypesRange;
-    int      rowNum, colNum;
-    double   effectiveness;
-
-    typeMatchupsRange = GetNamedRange(L"\034'Type Matchups'!TypeMatchups");
-    attackingTypesRange = GetNamedRange(L"\036'Type Matchups'!AttackingTypes");
-    defendingTypesRange = GetNamedRange(L"\036'Type Matchups'!DefendingTypes");
-    rowNum = Match(attackerMoveType, attackingTypesRange, 0);
-    colNum = Match(defenderType1, defendingTypesRange, 0);
-    effectiveness = IndexNumber(typeMatchupsRange, rowNum, colNum);
-    /* defenderType2.xltype can be xltypeNil */
-    if (defenderType2.xltype == xltypeStr) {
-        colNum = Match(defenderType2, defendingTypesRange, 0);
-        effectiveness *= IndexNumber(typeMatchupsRange, rowNum, colNum);
-    }
-    FREE(3, &typeMatchupsRange, &attackingTypesRange, &defendingTypesRange);
-    return effectiveness;
-}
-
-
-ExcelBoolean WINAPI SpecialAttackIsWeaker(long attackerMoveSetNum, long defenderMoveSetNum)
-{
-#pragma EXPORT
-    double   attackerLevel, defenderLevel;
-    int      attackerAttackIV, defenderDefenseIV;
-    XLOPER12 levelsRange, speciesRange;
-    int      attackerPokedexNum, defenderPokedexNum;
-    double   attackerCPMultiplier, defenderCPMultiplier;
-    double   attackerAttack, defenderDefense;
-    XLOPER12 moveSetsRange;
-    XLOPER12 attackerFastAttackType, attackerSpecialAttackType;
-    int      attackerFastAttackPower, attackerSpecialAttackPower;
-    int      attackerFastAttackDuration, attackerSpecialAttackDuration;
-    double   attackerFastAttackSTAB, attackerSpecialAttackSTAB;
-    XLOPER12 defenderType1, defenderType2;
-    double   effectiveness;
-    int      attackerFastAttackDamage, attackerSpecialAttackDamage;
-    int      longPressDuration;
-    double   attackerFastAttackDPS, attackerSpecialAttackDPS;
-
-    /* do not execute from dialog box */
-    if (CalledFromExcelDialog()) return FALSE;
-
-    /* get global inputs */
-    attackerLevel = GetNamedNumber(L"\024Inputs!AttackerLevel");
-    attackerAttackIV = (int) GetNamedNumber(L"\027Inputs!AttackerAttackIV");
-
-    defenderLevel = GetNamedNumber(L"\024Inputs!DefenderLevel");
-    defenderDefenseIV = (int) GetNamedNumber(L"\030Inputs!DefenderDefenseIV");
-
-    /* calculate stats */
-    levelsRange = GetNamedRange(L"\015Levels!Levels");
-    speciesRange = GetNamedRange(L"\017Species!Species");
-    attackerPokedexNum = attackerMoveSetNum / 1000000;
-    attackerCPMultiplier = VLookupNumber(attackerLevel, levelsRange, 2, false);
-    attackerAttack = (VLookupNumber(attackerPokedexNum, speciesRange, 6, false) + attackerAttackIV) * attackerCPMultiplier;
-
-    defenderPokedexNum = defenderMoveSetNum / 1000000;
-    defenderCPMultiplier = VLookupNumber(defenderLevel, levelsRange, 2, false);
-    defenderDefense = (VLookupNumber(defenderPokedexNum, speciesRange, 7, false) + defenderDefenseIV) * defenderCPMultiplier;
-
-    /* get move data */
-    moveSetsRange = GetNamedRange(L"\024'Move Sets'!MoveSets");
-    attackerFastAttackType = VLookupString(attackerMoveSetNum, moveSetsRange, 8, false);
-    attackerFastAttackPower = (int) VLookupNumber(attackerMoveSetNum, moveSetsRange, 9, false);
-    attackerFastAttackDuration = (int) VLookupNumber(attackerMoveSetNum, moveSetsRange, 12, false);
-    attackerFastAttackSTAB = VLookupNumber(attackerMoveSetNum, moveSetsRange, 13, false);
-    attackerSpecialAttackType = VLookupString(attackerMoveSetNum, moveSetsRange, 16, false);
-    attackerSpecialAttackPower = (int) VLookupNumber(attackerMoveSetNum, moveSetsRange, 17, false);
-    attackerSpecialAttackDuration = (int) VLookupNumber(attackerMoveSetNum, moveSetsRange, 20, false);
-    attackerSpecialAttackSTAB = VLookupNumber(attackerMoveSetNum, moveSetsRange, 21, false);
-
-    /* calculate damage against opponent */
-    defenderType1 = VLookupString(defenderPokedexNum, speciesRange, 3, false);
-    defenderType2 = VLookupString(defenderPokedexNum, speciesRange, 4, false);
-
-    effectiveness = TypeEffectiveness(attackerFastAttackType, defenderType1, defenderType2);
-    attackerFastAttackDamage = (int) (0.5 * attackerAttack / defenderDefense * attackerFastAttackPower * attackerFastAttackSTAB * effectiveness) + 1;
-
-    effectiveness = TypeEffectiveness(attackerSpecialAttackType, defenderType1, defenderType2);
-    attackerSpecialAttackDamage = (int) (0.5 * attackerAttack / defenderDefense * attackerSpecialAttackPower * attackerSpecialAttackSTAB * effectiveness) + 1;
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\015MatchupEngine";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\004BJJ$";
+#else
+    typeText.val.str = L"\003BJJ";
+#endif
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\053attacker_move_set_num,defender_move_set_num";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\142Returns the engine that evaluated the matchup, 0 for Monte Carlo trials and 1 for the exact solver";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\042is the attacker's move set number.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\042is the defender's move set number.";
+    returnValue = Excel12(xlfRegister, &result, 12, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2);
+    if (returnValue != xlretSuccess) return 0;
 
-    /* get battle parameters */
-    longPressDuration = (int) GetNamedNumber(L"\030Inputs!LongPressDuration");
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\023SamplingConvergence";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\004QJJ$";
+#else
+    typeText.val.str = L"\003QJJ";
+#endif
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\053attacker_move_set_num,defender_move_set_num";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\167Compares the standard error of plain Monte Carlo and quasi-Monte Carlo trials of the matchup at increasing trial counts";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\042is the attacker's move set number.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\042is the defender's move set number.";
+    returnValue = Excel12(xlfRegister, &result, 12, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2);
+    if (returnValue != xlretSuccess) return 0;
 
-    /* calculate damage per second */
-    attackerFastAttackDPS = attackerFastAttackDamage / (attackerFastAttackDuration / 1000.0);
-    attackerSpecialAttackDPS = attackerSpecialAttackDamage / ((longPressDuration + attackerSpecialAttackDuration) / 1000.0);
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\020BattleStatistics";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\004QJJ$";
+#else
+    typeText.val.str = L"\003QJJ";
+#endif
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\053attacker_move_set_num,defender_move_set_num";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\202Returns the win probability, battle duration, damage, special attacks, and remaining HP of the matchup from one pass of its trials";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\042is the attacker's move set number.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\042is the defender's move set number.";
+    returnValue = Excel12(xlfRegister, &result, 12, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2);
+    if (returnValue != xlretSuccess) return 0;
 
-    FREE(7, &levelsRange, &speciesRange, &moveSetsRange, &attackerFastAttackType, &attackerSpecialAttackType, &defenderType1, &defenderType2);
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\017OptimalStrategy";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\005QJJJ$";
+#else
+    typeText.val.str = L"\004QJJJ";
+#endif
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\065attacker_move_set_num,defender_move_set_num,objective";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\220Returns the value of the best attacker strategy against the defender, the value of always using special attacks, the states solved, and the plan";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\042is the attacker's move set number.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\042is the defender's move set number.";
+    argumentHelp3.xltype = xltypeStr;
+    argumentHelp3.val.str = L"\121is 0 to maximize the win probability or 1 to minimize the time to win in seconds.";
+    returnValue = Excel12(xlfRegister, &result, 13, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2, &argumentHelp3);
+    if (returnValue != xlretSuccess) return 0;
 
-    /* return whether special attack DPS is less than fast attack DPS */
-    return attackerSpecialAttackDPS <= attackerFastAttackDPS;
-}
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\012RaidBattle";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\007QQJJJJ$";
+#else
+    typeText.val.str = L"\006QQJJJJ";
+#endif
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\122party_move_set_nums,boss_move_set_num,party_swap_delay,relobby_delay,num_relobbies";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\130Returns the probability of a group of players defeating a raid boss before time runs out";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\104are the move set numbers of each player's party, one row per player.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\036is the boss's move set number.";
+    argumentHelp3.xltype = xltypeStr;
+    argumentHelp3.val.str = L"\105is the time in milliseconds for the next Pokemon of a party to enter.";
+    argumentHelp4.xltype = xltypeStr;
+    argumentHelp4.val.str = L"\125is the time in milliseconds for a player to rejoin after the whole party has fainted.";
+    argumentHelp5.xltype = xltypeStr;
+    argumentHelp5.val.str = L"\056is the number of times each player may rejoin.";
+    returnValue = Excel12(xlfRegister, &result, 15, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2, &argumentHelp3, &argumentHelp4, &argumentHelp5);
+    if (returnValue != xlretSuccess) return 0;
 
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\012TeamBattle";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\004QQQ$";
+#else
+    typeText.val.str = L"\003QQQ";
+#endif
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\055attacker_move_set_nums,defender_move_set_nums";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\226Returns the probability of a team defeating a gym lineup in order, its standard error, the expected number of attackers needed, and its standard error";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\070are the move set numbers of the attacking team in order.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\064are the move set numbers of the gym lineup in order.";
+    returnValue = Excel12(xlfRegister, &result, 12, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2);
+    if (returnValue != xlretSuccess) return 0;
 
-double WINAPI Battle(long attackerMoveSetNum, long defenderMoveSetNum)
-{
-#pragma EXPORT
-    bool          skipWeakerSpecialAttacks;
-    bool          randomness;
-    int           rngSeed;
-    long          numTrials;
-    bool          logBattles;
-    std::ofstream logFile;
-    double        attackerLevel, defenderLevel;
-    int           attackerStaminaIV, attackerAttackIV, attackerDefenseIV;
-    int           defenderStaminaIV, defenderAttackIV, defenderDefenseIV;
-    XLOPER12      levelsRange, speciesRange;
-    int           attackerPokedexNum, defenderPokedexNum;
-    double        attackerCPMultiplier, defenderCPMultiplier;
-    int           attackerHP, defenderHP;
-    bool          attackerTransforms, defenderTransforms;
-    long          transformMoveNum;
-    XLOPER12      fastAttacksRange;
-    int           transformPower, transformEnergy, transformDamageStart, transformDuration, transformDamage;
-    double        attackerAttack, attackerDefense;
-    double        defenderAttack, defenderDefense;
-    XLOPER12      moveSetsRange;
-    XLOPER12      attackerFastAttackName, attackerSpecialAttackName, defenderFastAttackName, defenderSpecialAttackName;
-    XLOPER12      attackerFastAttackType, attackerSpecialAttackType, defenderFastAttackType, defenderSpecialAttackType;
-    int           attackerFastAttackPower, attackerSpecialAttackPower, defenderFastAttackPower, defenderSpecialAttackPower;
-    int           attackerFastAttackEnergy, attackerSpecialAttackEnergy, defenderFastAttackEnergy, defenderSpecialAttackEnergy;
-    int           attackerFastAttackDamageStart, attackerSpecialAttackDamageStart, defenderFastAttackDamageStart, defenderSpecialAttackDamageStart;
-    int           attackerFastAttackDuration, attackerSpecialAttackDuration, defenderFastAttackDuration, defenderSpecialAttackDuration;
-    double        attackerFastAttackSTAB, attackerSpecialAttackSTAB, defenderFastAttackSTAB, defenderSpecialAttackSTAB;
-    XLOPER12      attackerType1, attackerType2, defenderType1, defenderType2;
-    double        effectiveness;
-    int           attackerFastAttackDamage, attackerSpecialAttackDamage, defenderFastAttackDamage, defenderSpecialAttackDamage;
-    double        defensiveHPMultiplier;
-    int           maxAttackerEnergy, maxDefenderEnergy;
-    double        energyPerDamage;
-    int           battleDuration, longPressDuration;
-    int           offensiveInitialInterval;
-    int           numDefensiveInitialIntervals;
-    int           *defensiveInitialIntervals;
-    int           defensiveInterval, defensiveIntervalRandomness;
-    int           numDefensiveSpecialAttackDeferrals;
-    double        defensiveSpecialAttackProbability;
-    double        attackerFastAttackDPS, attackerSpecialAttackDPS;
-    EventQueue    attackerEventQueue, defenderEventQueue;
-    long          numWins;
-    int           defenderTime;
-    int           battleTimer, nextTime;
-    int           attackerBattleHP, defenderBattleHP;
-    int           attackerEnergy, defenderEnergy;
-    int           numDefensiveSpecialAttackOpportunities;
-    PlayerEvents  playerEvent;
-    bool          specialAttack;
-    int           interval;
-    long          i;
- 
-    /* do not execute from dialog box */
-    if (CalledFromExcelDialog()) return 0.0;
-   
-    /* get simulation settings */
-    skipWeakerSpecialAttacks = GetNamedBoolean(L"\037Inputs!SkipWeakerSpecialAttacks");
-    randomness = GetNamedBoolean(L"\021Inputs!Randomness");
-    rngSeed = (int) GetNamedNumber(L"\016Inputs!RNGSeed");
-    assert(rngSeed > 0);
-    numTrials = (long) GetNamedNumber(L"\032Inputs!NumMonteCarloTrials");
-    assert(numTrials > 0);
-    if (numTrials > 1 && !randomness) {
-#if !THREADSAFE
-        MsgBox(L"\053Monte Carlo simulations require randomness.");
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\013BattleSweep";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\005QQQQ$";
+#else
+    typeText.val.str = L"\004QQQQ";
 #endif
-        return -1.0;
-    }
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\072attacker_move_set_nums,defender_move_set_nums,sweep_ranges";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\165Returns the probability of each attacker winning versus its defender at every combination of the swept levels and IVs";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\056are the attackers' move set numbers, in pairs.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\056are the defenders' move set numbers, in pairs.";
+    argumentHelp3.xltype = xltypeStr;
+    argumentHelp3.val.str = L"\162are first, last, and step values of the attacker and defender levels, stamina, attack, and defense IVs, in 8 rows.";
+    returnValue = Excel12(xlfRegister, &result, 13, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2, &argumentHelp3);
+    if (returnValue != xlretSuccess) return 0;
 
-    /* if enabled, print log to file */
-    logBattles = GetNamedBoolean(L"\021Inputs!LogBattles");
-    OPENLOG(logFile, logBattles);
-    
-    /* seed random number generator */
-    srand(rngSeed);
-    LOGSIMULATIONINFO(logFile, randomness, rngSeed, skipWeakerSpecialAttacks);
-    LOGNEWLINE(logFile);
-    
-    /* get global inputs */
-    attackerLevel = GetNamedNumber(L"\024Inputs!AttackerLevel");
-    attackerStaminaIV = (int) GetNamedNumber(L"\030Inputs!AttackerStaminaIV");
-    attackerAttackIV = (int) GetNamedNumber(L"\027Inputs!AttackerAttackIV");
-    attackerDefenseIV = (int) GetNamedNumber(L"\030Inputs!AttackerDefenseIV");
-
-    defenderLevel = GetNamedNumber(L"\024Inputs!DefenderLevel");
-    defenderStaminaIV = (int) GetNamedNumber(L"\030Inputs!DefenderStaminaIV");
-    defenderAttackIV = (int) GetNamedNumber(L"\027Inputs!DefenderAttackIV");
-    defenderDefenseIV = (int) GetNamedNumber(L"\030Inputs!DefenderDefenseIV");
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\016ExportGameData";
+    typeText.xltype = xltypeStr;
+    typeText.val.str = L"\001J";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 2;
+    returnValue = Excel12(xlfRegister, &result, 7, &xllName, &functionName, &typeText, &functionName, &missing, &macroType, &category);
+    if (returnValue != xlretSuccess) return 0;
 
-    /* calculate stats */
-    levelsRange = GetNamedRange(L"\015Levels!Levels");
-    speciesRange = GetNamedRange(L"\017Species!Species");
-    attackerPokedexNum = attackerMoveSetNum / 1000000;
-    attackerCPMultiplier = VLookupNumber(attackerLevel, levelsRange, 2, false);
-    attackerHP = Max((int) ((VLookupNumber(attackerPokedexNum, speciesRange, 5, false) + attackerStaminaIV) * attackerCPMultiplier), 10);
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\020ResetBattleCache";
+    typeText.xltype = xltypeStr;
+    typeText.val.str = L"\001J";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 2;
+    returnValue = Excel12(xlfRegister, &result, 7, &xllName, &functionName, &typeText, &functionName, &missing, &macroType, &category);
+    if (returnValue != xlretSuccess) return 0;
 
-    defenderPokedexNum = defenderMoveSetNum / 1000000;
-    defenderCPMultiplier = VLookupNumber(defenderLevel, levelsRange, 2, false);
-    defenderHP = Max((int) ((VLookupNumber(defenderPokedexNum, speciesRange, 5, false) + defenderStaminaIV) * defenderCPMultiplier), 10);
-
-    attackerTransforms = false;
-    defenderTransforms = false;
-    if ((attackerPokedexNum == dittoPokedexNum) != (defenderPokedexNum == dittoPokedexNum)) {
-        /* perform Ditto transformations */
-        if (attackerPokedexNum == dittoPokedexNum) {
-            transformMoveNum = (attackerMoveSetNum % 1000000) / 1000;
-            attackerMoveSetNum = defenderMoveSetNum;
-            attackerPokedexNum = defenderPokedexNum;
-            attackerTransforms = true;
-        }
-        if (defenderPokedexNum == dittoPokedexNum) {
-            transformMoveNum = (defenderMoveSetNum % 1000000) / 1000;
-            defenderMoveSetNum = attackerMoveSetNum;
-            defenderPokedexNum = attackerPokedexNum;
-            defenderTransforms = true;
-        }
-        fastAttacksRange = GetNamedRange(L"\032'Fast Attacks'!FastAttacks");
-        transformPower = (int) VLookupNumber(transformMoveNum, fastAttacksRange, 4, false);
-        transformEnergy = (int) VLookupNumber(transformMoveNum, fastAttacksRange, 5, false);
-        transformDamageStart = (int) VLookupNumber(transformMoveNum, fastAttacksRange, 6, false);
-        transformDuration = (int) VLookupNumber(transformMoveNum, fastAttacksRange, 7, false);
-        assert(transformPower == 0);
-        transformDamage = 1;
-        FREE(1, &fastAttacksRange);
-    }
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\020CalculationEnded";
+    typeText.xltype = xltypeStr;
+    typeText.val.str = L"\001J";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 2;
+    returnValue = Excel12(xlfRegister, &result, 7, &xllName, &functionName, &typeText, &functionName, &missing, &macroType, &category);
+    if (returnValue != xlretSuccess) return 0;
 
-    attackerAttack = (VLookupNumber(attackerPokedexNum, speciesRange, 6, false) + attackerAttackIV) * attackerCPMultiplier;
-    attackerDefense = (VLookupNumber(attackerPokedexNum, speciesRange, 7, false) + attackerDefenseIV) * attackerCPMultiplier;
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\017PrewarmGameData";
+    typeText.xltype = xltypeStr;
+    typeText.val.str = L"\001J";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 2;
+    returnValue = Excel12(xlfRegister, &result, 7, &xllName, &functionName, &typeText, &functionName, &missing, &macroType, &category);
+    if (returnValue != xlretSuccess) return 0;
 
-    defenderAttack = (VLookupNumber(defenderPokedexNum, speciesRange, 6, false) + defenderAttackIV) * defenderCPMultiplier;
-    defenderDefense = (VLookupNumber(defenderPokedexNum, speciesRange, 7, false) + defenderDefenseIV) * defenderCPMultiplier;
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\021LoadMatchupMatrix";
+    typeText.xltype = xltypeStr;
+    typeText.val.str = L"\001J";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 2;
+    returnValue = Excel12(xlfRegister, &result, 7, &xllName, &functionName, &typeText, &functionName, &missing, &macroType, &category);
+    if (returnValue != xlretSuccess) return 0;
 
-    /* get move data */
-    moveSetsRange = GetNamedRange(L"\024'Move Sets'!MoveSets");
-    attackerFastAttackName = VLookupString(attackerMoveSetNum, moveSetsRange, 7, false);
-    attackerFastAttackType = VLookupString(attackerMoveSetNum, moveSetsRange, 8, false);
-    attackerFastAttackPower = (int) VLookupNumber(attackerMoveSetNum, moveSetsRange, 9, false);
-    attackerFastAttackEnergy = (int) VLookupNumber(attackerMoveSetNum, moveSetsRange, 10, false);
-    attackerFastAttackDamageStart = (int) VLookupNumber(attackerMoveSetNum, moveSetsRange, 11, false);
-    attackerFastAttackDuration = (int) VLookupNumber(attackerMoveSetNum, moveSetsRange, 12, false);
-    attackerFastAttackSTAB = VLookupNumber(attackerMoveSetNum, moveSetsRange, 13, false);
-    attackerSpecialAttackName = VLookupString(attackerMoveSetNum, moveSetsRange, 15, false);
-    attackerSpecialAttackType = VLookupString(attackerMoveSetNum, moveSetsRange, 16, false);
-    attackerSpecialAttackPower = (int) VLookupNumber(attackerMoveSetNum, moveSetsRange, 17, false);
-    attackerSpecialAttackEnergy = (int) VLookupNumber(attackerMoveSetNum, moveSetsRange, 18, false);
-    attackerSpecialAttackDamageStart = (int) VLookupNumber(attackerMoveSetNum, moveSetsRange, 19, false);
-    attackerSpecialAttackDuration = (int) VLookupNumber(attackerMoveSetNum, moveSetsRange, 20, false);
-    attackerSpecialAttackSTAB = VLookupNumber(attackerMoveSetNum, moveSetsRange, 21, false);
-
-    defenderFastAttackName = VLookupString(defenderMoveSetNum, moveSetsRange, 7, false);
-    defenderFastAttackType = VLookupString(defenderMoveSetNum, moveSetsRange, 8, false);
-    defenderFastAttackPower = (int) VLookupNumber(defenderMoveSetNum, moveSetsRange, 9, false);
-    defenderFastAttackEnergy = (int) VLookupNumber(defenderMoveSetNum, moveSetsRange, 10, false);
-    defenderFastAttackDamageStart = (int) VLookupNumber(defenderMoveSetNum, moveSetsRange, 11, false);
-    defenderFastAttackDuration = (int) VLookupNumber(defenderMoveSetNum, moveSetsRange, 12, false);
-    defenderFastAttackSTAB = VLookupNumber(defenderMoveSetNum, moveSetsRange, 13, false);
-    defenderSpecialAttackName = VLookupString(defenderMoveSetNum, moveSetsRange, 15, false);
-    defenderSpecialAttackType = VLookupString(defenderMoveSetNum, moveSetsRange, 16, false);
-    defenderSpecialAttackPower = (int) VLookupNumber(defenderMoveSetNum, moveSetsRange, 17, false);
-    defenderSpecialAttackEnergy = (int) VLookupNumber(defenderMoveSetNum, moveSetsRange, 18, false);
-    defenderSpecialAttackDamageStart = (int) VLookupNumber(defenderMoveSetNum, moveSetsRange, 19, false);
-    defenderSpecialAttackDuration = (int) VLookupNumber(defenderMoveSetNum, moveSetsRange, 20, false);
-    defenderSpecialAttackSTAB = VLookupNumber(defenderMoveSetNum, moveSetsRange, 21, false);
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\026DefenderSpeciesAverage";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\004BJJ$";
+#else
+    typeText.val.str = L"\003BJJ";
+#endif
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\053attacker_move_set_num,defender_move_set_num";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\144Returns the average of the matchups between the attacker and all move sets of the defender's species";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\042is the attacker's move set number.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\042is the defender's move set number.";
+    returnValue = Excel12(xlfRegister, &result, 12, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2);
+    if (returnValue != xlretSuccess) return 0;
+
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\020BattleMatrixFile";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\006QQQQQ$";
+#else
+    typeText.val.str = L"\005QQQQQ";
+#endif
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\104attacker_move_set_nums,defender_move_set_nums,sweep_ranges,file_name";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\174Writes every attacker versus every defender at every swept level and IV to a matrix file, and returns the number of matchups";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\044are the attackers' move set numbers.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\044are the defenders' move set numbers.";
+    argumentHelp3.xltype = xltypeStr;
+    argumentHelp3.val.str = L"\162are first, last, and step values of the attacker and defender levels, stamina, attack, and defense IVs, in 8 rows.";
+    argumentHelp4.xltype = xltypeStr;
+    argumentHelp4.val.str = L"\050is the name of the matrix file to write.";
+    returnValue = Excel12(xlfRegister, &result, 14, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2, &argumentHelp3, &argumentHelp4);
+    if (returnValue != xlretSuccess) return 0;
+
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\024MatrixSpeciesAverage";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\006QQJJJ$";
+#else
+    typeText.val.str = L"\005QQJJJ";
+#endif
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\077file_name,point_num,attacker_move_set_num,defender_move_set_num";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\167Returns the average of the matchups between the attacker and all move sets of the defender's species from a matrix file";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\037is the name of the matrix file.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\060is the number of the sweep point, starting at 1.";
+    argumentHelp3.xltype = xltypeStr;
+    argumentHelp3.val.str = L"\042is the attacker's move set number.";
+    argumentHelp4.xltype = xltypeStr;
+    argumentHelp4.val.str = L"\042is the defender's move set number.";
+    returnValue = Excel12(xlfRegister, &result, 14, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2, &argumentHelp3, &argumentHelp4);
+    if (returnValue != xlretSuccess) return 0;
+
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\020SpeciesAggregate";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\006QJJJQ$";
+#else
+    typeText.val.str = L"\005QJJJQ";
+#endif
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\112attacker_move_set_num,defender_move_set_num,function_num,matrix_generation";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\231Returns the average, maximum, or minimum of the matchups between the attacker and all move sets of the defender's species, from the loaded matchup matrix";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\042is the attacker's move set number.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\042is the defender's move set number.";
+    argumentHelp3.xltype = xltypeStr;
+    argumentHelp3.val.str = L"\120is 1 for the average, 4 for the maximum, or 5 for the minimum, as in SUBTOTAL().";
+    argumentHelp4.xltype = xltypeStr;
+    argumentHelp4.val.str = L"\126is MatchupMatrixGeneration, to recalculate the result when the matrix is loaded again.";
+    returnValue = Excel12(xlfRegister, &result, 14, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2, &argumentHelp3, &argumentHelp4);
+    if (returnValue != xlretSuccess) return 0;
+
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\021AttackerAggregate";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\005QJJQ$";
+#else
+    typeText.val.str = L"\004QJJQ";
+#endif
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\064attacker_move_set_num,function_num,matrix_generation";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\177Returns the average, maximum, or minimum of the matchups between the attacker and all defenders, from the loaded matchup matrix";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\042is the attacker's move set number.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\120is 1 for the average, 4 for the maximum, or 5 for the minimum, as in SUBTOTAL().";
+    argumentHelp3.xltype = xltypeStr;
+    argumentHelp3.val.str = L"\126is MatchupMatrixGeneration, to recalculate the result when the matrix is loaded again.";
+    returnValue = Excel12(xlfRegister, &result, 13, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2, &argumentHelp3);
+    if (returnValue != xlretSuccess) return 0;
+
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\021DefenderAggregate";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\005QJJQ$";
+#else
+    typeText.val.str = L"\004QJJQ";
+#endif
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\064defender_move_set_num,function_num,matrix_generation";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\177Returns the average, maximum, or minimum of the matchups between all attackers and the defender, from the loaded matchup matrix";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\042is the defender's move set number.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\120is 1 for the average, 4 for the maximum, or 5 for the minimum, as in SUBTOTAL().";
+    argumentHelp3.xltype = xltypeStr;
+    argumentHelp3.val.str = L"\126is MatchupMatrixGeneration, to recalculate the result when the matrix is loaded again.";
+    returnValue = Excel12(xlfRegister, &result, 13, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2, &argumentHelp3);
+    if (returnValue != xlretSuccess) return 0;
+
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\027WeightedAttackerAverage";
+    typeText.xltype = xltypeStr;
+#if THREADSAFE
+    typeText.val.str = L"\005QJQQ$";
+#else
+    typeText.val.str = L"\004QJQQ";
+#endif
+    argumentText.xltype = xltypeStr;
+    argumentText.val.str = L"\057attacker_move_set_num,weights,matrix_generation";
+    macroType.xltype = xltypeInt;
+    macroType.val.w = 1;
+    category.xltype = xltypeStr;
+    category.val.str = L"\020Battle Simulator";
+    functionHelp.xltype = xltypeStr;
+    functionHelp.val.str = L"\163Returns the weighted average of the matchups between the attacker and all defenders, from the loaded matchup matrix";
+    argumentHelp1.xltype = xltypeStr;
+    argumentHelp1.val.str = L"\042is the attacker's move set number.";
+    argumentHelp2.xltype = xltypeStr;
+    argumentHelp2.val.str = L"\116are the weights of the defenders, in the order of the Move Set Matchups sheet.";
+    argumentHelp3.xltype = xltypeStr;
+    argumentHelp3.val.str = L"\126is MatchupMatrixGeneration, to recalculate the result when the matrix is loaded again.";
+    returnValue = Excel12(xlfRegister, &result, 13, &xllName, &functionName, &typeText, &functionName, &argumentText, &macroType, &category, nullptr, nullptr,
+                          &functionHelp, &argumentHelp1, &argumentHelp2, &argumentHelp3);
+    if (returnValue != xlretSuccess) return 0;
+
+    /* check the game tables for edits after every recalculation, including one cancelled partway */
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\020CalculationEnded";
+    event.xltype = xltypeInt;
+    event.val.w = xleventCalculationEnded;
+    (void) Excel12(xlEventRegister, &result, 2, &functionName, &event);
+    event.val.w = xleventCalculationCanceled;
+    (void) Excel12(xlEventRegister, &result, 2, &functionName, &event);
+
+    /* load the game tables as soon as Excel is idle, only the main thread may read them */
+    functionName.xltype = xltypeStr;
+    functionName.val.str = L"\017PrewarmGameData";
+    returnValue = Excel12(xlfNow, &now, 0);
+    if (returnValue == xlretSuccess) {
+        (void) Excel12(xlcOnTime, &result, 2, &now, &functionName);
+    }
+
+    /* connect to the simulation workers listed in the environment, if any */
+    workerEndpoints = getenv("BATTLE_SIMULATOR_WORKERS");
+    if (workerEndpoints) {
+        (void) workerPool.Connect(workerEndpoints);
+    }
+
+    return 1;
+}
+
+
+int WINAPI xlAutoClose(void)
+{
+#pragma EXPORT
+    /* unanswered matchups are simulated in process before the connections close */
+    workerPool.Disconnect();
+    workloadTrace.Close();
+    return 1;
+}
+
+
+/* whether the attacker's special attack does no more damage per second than its fast attack, as SkipWeakerSpecialAttacks decides */
+/* reads the game tables in memory, whose types are indices, instead of looking up and freeing a string for each type */
+ExcelBoolean WINAPI SpecialAttackIsWeaker(long attackerMoveSetNum, long defenderMoveSetNum)
+{
+#pragma EXPORT
+    const SpeciesRecord *attackerSpecies, *defenderSpecies;
+    const MoveSetRecord *attackerMoveSet;
+    const AttackRecord  *fastAttack, *specialAttack;
+    double              attackerCPMultiplier, defenderCPMultiplier;
+    double              attackerAttack, defenderDefense;
+    double              effectiveness;
+    int                 attackerFastAttackDamage, attackerSpecialAttackDamage;
+    int                 longPressDuration;
+    double              attackerFastAttackDPS, attackerSpecialAttackDPS;
+    unsigned long       gameDataGeneration;
+
+    /* do not execute from dialog box */
+    if (CalledFromExcelDialog()) return FALSE;
+
+    auto gameData = gameDataStore.Get(TypeMatchupsTable | LevelsTable | SpeciesTable | MoveSetsTable, gameDataGeneration);
+    attackerSpecies = gameData->FindSpecies(attackerMoveSetNum / 1000000);
+    defenderSpecies = gameData->FindSpecies(defenderMoveSetNum / 1000000);
+    attackerMoveSet = gameData->FindMoveSet(attackerMoveSetNum);
+    if (!attackerSpecies || !defenderSpecies || !attackerMoveSet) return FALSE;
+
+    /* calculate stats */
+    attackerCPMultiplier = gameData->CPMultiplier(ReadBattleInput(AttackerLevelInput));
+    defenderCPMultiplier = gameData->CPMultiplier(ReadBattleInput(DefenderLevelInput));
+    if (attackerCPMultiplier == 0.0 || defenderCPMultiplier == 0.0) return FALSE;
+    attackerAttack = (attackerSpecies->baseAttack + (int) ReadBattleInput(AttackerAttackIVInput)) * attackerCPMultiplier;
+    defenderDefense = (defenderSpecies->baseDefense + (int) ReadBattleInput(DefenderDefenseIVInput)) * defenderCPMultiplier;
 
     /* calculate damage against opponent */
-    attackerType1 = VLookupString(attackerPokedexNum, speciesRange, 3, false);
-    attackerType2 = VLookupString(attackerPokedexNum, speciesRange, 4, false);
-
-    defenderType1 = VLookupString(defenderPokedexNum, speciesRange, 3, false);
-    defenderType2 = VLookupString(defenderPokedexNum, speciesRange, 4, false);
-
-    LOGPOKEMONINFO(logFile, "attacker", attackerPokedexNum, attackerLevel, attackerStaminaIV, attackerAttackIV, attackerDefenseIV, attackerTransforms);
-    effectiveness = TypeEffectiveness(attackerFastAttackType, defenderType1, defenderType2);
-    attackerFastAttackDamage = (int) (0.5 * attackerAttack / defenderDefense * attackerFastAttackPower * attackerFastAttackSTAB * effectiveness) + 1;
-    LOGATTACKINFO(logFile, attackerFastAttackName, effectiveness, attackerFastAttackDamage, attackerFastAttackEnergy, attackerFastAttackDamageStart,
-                  attackerFastAttackDuration);
-
-    effectiveness = TypeEffectiveness(attackerSpecialAttackType, defenderType1, defenderType2);
-    attackerSpecialAttackDamage = (int) (0.5 * attackerAttack / defenderDefense * attackerSpecialAttackPower * attackerSpecialAttackSTAB * effectiveness) + 1;
-    LOGATTACKINFO(logFile, attackerSpecialAttackName, effectiveness, attackerSpecialAttackDamage, attackerSpecialAttackEnergy, attackerSpecialAttackDamageStart,
-                  attackerSpecialAttackDuration);
+    fastAttack = &attackerMoveSet->fastAttack;
+    specialAttack = &attackerMoveSet->specialAttack;
+    effectiveness = gameData->TypeEffectiveness(fastAttack->type, defenderSpecies->type1, defenderSpecies->type2);
+    attackerFastAttackDamage = AttackDamage(attackerAttack, defenderDefense, fastAttack->power, fastAttack->stab, effectiveness);
+    effectiveness = gameData->TypeEffectiveness(specialAttack->type, defenderSpecies->type1, defenderSpecies->type2);
+    attackerSpecialAttackDamage = AttackDamage(attackerAttack, defenderDefense, specialAttack->power, specialAttack->stab, effectiveness);
+
+    /* calculate damage per second */
+    longPressDuration = (int) ReadBattleInput(LongPressDurationInput);
+    attackerFastAttackDPS = attackerFastAttackDamage / (fastAttack->duration / 1000.0);
+    attackerSpecialAttackDPS = attackerSpecialAttackDamage / ((longPressDuration + specialAttack->duration) / 1000.0);
+
+    /* return whether special attack DPS is less than fast attack DPS */
+    return attackerSpecialAttackDPS <= attackerFastAttackDPS;
+}
+
+
+/* show why the simulation settings are invalid */
+/* returns false if the simulation settings are invalid */
+bool CheckSimulationSettings(const BattleInputs &inputs)
+{
+    switch (CheckBattleInputs(inputs)) {
+    case NoInputError:
+        break;
+    case RandomnessRequiredError:
+#if !THREADSAFE
+        MsgBox(L"\053Monte Carlo simulations require randomness.");
+#endif
+        return false;
+    case OddAntitheticTrialsError:
+#if !THREADSAFE
+        MsgBox(L"\063Antithetic trials require an even number of trials.");
+#endif
+        return false;
+    case AntitheticQuasiMonteCarloError:
+#if !THREADSAFE
+        MsgBox(L"\056Quasi-Monte Carlo trials cannot be antithetic.");
+#endif
+        return false;
+    case UnevenRandomizationsError:
+#if !THREADSAFE
+        MsgBox(L"\100Quasi-Monte Carlo trials must divide evenly into randomizations.");
+#endif
+        return false;
+    case UnknownPolicyError:
+#if !THREADSAFE
+        MsgBox(L"\044Unknown attacker or defender policy.");
+#endif
+        return false;
+    }
+    return true;
+}
+
+
+#if LOG
+void LogCombatantInfo(std::ofstream &logFile, const std::string &role, const MatchupCombatant &combatant, double level, int staminaIV, int attackIV,
+                      int defenseIV, int fastAttackDamage, int specialAttackDamage)
+{
+    XLOPER12 moveSetsRange;
+    XLOPER12 fastAttackName, specialAttackName;
+
+    moveSetsRange = GetNamedRange(L"\024'Move Sets'!MoveSets");
+    fastAttackName = VLookupString(combatant.moveSetNum, moveSetsRange, 7, false);
+    specialAttackName = VLookupString(combatant.moveSetNum, moveSetsRange, 15, false);
+
+    LOGPOKEMONINFO(logFile, role, combatant.pokedexNum, level, staminaIV, attackIV, defenseIV, combatant.transforms);
+    LOGATTACKINFO(logFile, fastAttackName, combatant.fastAttack.effectiveness, fastAttackDamage, combatant.fastAttack.energy, combatant.fastAttack.damageStart,
+                  combatant.fastAttack.duration);
+    LOGATTACKINFO(logFile, specialAttackName, combatant.specialAttack.effectiveness, specialAttackDamage, combatant.specialAttack.energy,
+                  combatant.specialAttack.damageStart, combatant.specialAttack.duration);
     LOGNEWLINE(logFile);
 
-    LOGPOKEMONINFO(logFile, "defender", defenderPokedexNum, defenderLevel, defenderStaminaIV, defenderAttackIV, defenderDefenseIV, defenderTransforms);
-    effectiveness = TypeEffectiveness(defenderFastAttackType, attackerType1, attackerType2);
-    defenderFastAttackDamage = (int) (0.5 * defenderAttack / attackerDefense * defenderFastAttackPower * defenderFastAttackSTAB * effectiveness) + 1;
-    LOGATTACKINFO(logFile, defenderFastAttackName, effectiveness, defenderFastAttackDamage, defenderFastAttackEnergy, defenderFastAttackDamageStart,
-                  defenderFastAttackDuration);
+    FREE(3, &moveSetsRange, &fastAttackName, &specialAttackName);
+}
+#endif
 
-    effectiveness = TypeEffectiveness(defenderSpecialAttackType, attackerType1, attackerType2);
-    defenderSpecialAttackDamage = (int) (0.5 * defenderAttack / attackerDefense * defenderSpecialAttackPower * defenderSpecialAttackSTAB * effectiveness) + 1;
-    LOGATTACKINFO(logFile, defenderSpecialAttackName, effectiveness, defenderSpecialAttackDamage, defenderSpecialAttackEnergy, defenderSpecialAttackDamageStart,
-                  defenderSpecialAttackDuration);
+
+/* look up the inputs of one matchup and resolve them into simulation parameters */
+/* returns false if the simulation settings are invalid or a move set or level is not in the game tables */
+bool ResolveBattleParameters(long attackerMoveSetNum, long defenderMoveSetNum, std::ofstream &logFile, BattleInputs &inputs, BattleParameters &parameters,
+                             unsigned long &gameDataGeneration)
+{
+    MatchupData  matchupData;
+    double       attackerCPMultiplier, defenderCPMultiplier;
+
+    /* get simulation settings and global inputs */
+    ReadBattleInputs(inputs);
+    if (!CheckSimulationSettings(inputs)) return false;
+
+    /* calculate stats and damage against opponent */
+    auto gameData = gameDataStore.Get(allGameTables, gameDataGeneration);
+    if (!ResolveMatchupData(*gameData, attackerMoveSetNum, defenderMoveSetNum, matchupData)) return false;
+    attackerCPMultiplier = gameData->CPMultiplier(inputs.values[AttackerLevelInput]);
+    defenderCPMultiplier = gameData->CPMultiplier(inputs.values[DefenderLevelInput]);
+    if (attackerCPMultiplier == 0.0 || defenderCPMultiplier == 0.0) return false;
+    ResolveBattleParameters(matchupData, inputs, attackerCPMultiplier, defenderCPMultiplier, parameters);
+
+    /* if enabled, print log to file */
+    OPENLOG(logFile, inputs.values[LogBattlesInput] != 0.0);
+
+    LOGSIMULATIONINFO(logFile, parameters.randomness, parameters.rngSeed, inputs.values[SkipWeakerSpecialAttacksInput] != 0.0, parameters.commonRandomNumbers,
+                      parameters.antitheticTrials, parameters.quasiMonteCarlo);
     LOGNEWLINE(logFile);
+    LOGCOMBATANTINFO(logFile, "attacker", matchupData.attacker, inputs.values[AttackerLevelInput], (int) inputs.values[AttackerStaminaIVInput],
+                     (int) inputs.values[AttackerAttackIVInput], (int) inputs.values[AttackerDefenseIVInput], parameters.attackerFastAttackDamage,
+                     parameters.attackerSpecialAttackDamage);
+    LOGCOMBATANTINFO(logFile, "defender", matchupData.defender, inputs.values[DefenderLevelInput], (int) inputs.values[DefenderStaminaIVInput],
+                     (int) inputs.values[DefenderAttackIVInput], (int) inputs.values[DefenderDefenseIVInput], parameters.defenderFastAttackDamage,
+                     parameters.defenderSpecialAttackDamage);
+    return true;
+}
 
-    /* get battle parameters */
-    defensiveHPMultiplier = GetNamedNumber(L"\034Inputs!DefensiveHPMultiplier");
-    maxAttackerEnergy = (int) GetNamedNumber(L"\031Inputs!MaxOffensiveEnergy");
-    maxDefenderEnergy = (int) GetNamedNumber(L"\031Inputs!MaxDefensiveEnergy");
-    energyPerDamage = GetNamedNumber(L"\026Inputs!EnergyPerHPLost");
-    battleDuration = (int) GetNamedNumber(L"\025Inputs!BattleDuration");
-    longPressDuration = (int) GetNamedNumber(L"\030Inputs!LongPressDuration");
-    offensiveInitialInterval = (int) GetNamedNumber(L"\037Inputs!OffensiveInitialInterval");
-    numDefensiveInitialIntervals = (int) GetNamedNumber(L"\043Inputs!NumDefensiveInitialIntervals");
-    defensiveInitialIntervals = new int[numDefensiveInitialIntervals];
-    defensiveInitialIntervals[0] = (int) GetNamedNumber(L"\044Inputs!DefensiveFirstInitialInterval");
-    defensiveInitialIntervals[1] = (int) GetNamedNumber(L"\045Inputs!DefensiveSecondInitialInterval");
-    defensiveInitialIntervals[2] = (int) GetNamedNumber(L"\044Inputs!DefensiveThirdInitialInterval");
-    defensiveInterval = (int) GetNamedNumber(L"\030Inputs!DefensiveInterval");
-    defensiveIntervalRandomness = (int) GetNamedNumber(L"\042Inputs!DefensiveIntervalRandomness");
-    numDefensiveSpecialAttackDeferrals = (int) GetNamedNumber(L"\051Inputs!NumDefensiveSpecialAttackDeferrals");
-    defensiveSpecialAttackProbability = GetNamedNumber(L"\050Inputs!DefensiveSpecialAttackProbability");
 
-    /* calculate damage per second */
-    attackerFastAttackDPS = attackerFastAttackDamage / (attackerFastAttackDuration / 1000.0);
-    attackerSpecialAttackDPS = attackerSpecialAttackDamage / ((longPressDuration + attackerSpecialAttackDuration) / 1000.0);
+/* evaluate a matchup unless one with the same canonical battle parameters was already evaluated */
+void SimulateMatchup(const BattleParameters &parameters, std::ofstream &logFile, BattleResult &result)
+{
+    BattleKey key;
+
+    MakeBattleKey(parameters, key);
+    /* logged battles are always simulated */
+    if (!logFile.is_open() && matchupCache.Find(key, result)) return;
+    EvaluateBattles(parameters, logFile, result);
+    matchupCache.Insert(key, result);
+}
+
 
-    /* if enabled, skip weaker special attacks */
-    if (skipWeakerSpecialAttacks && attackerSpecialAttackDPS <= attackerFastAttackDPS) {
-        /* disable special attacks by making energy requirement unreachable */
-        attackerSpecialAttackEnergy = -(maxAttackerEnergy + 1);
+/* find the last result of a matchup if none of the inputs it depended on have changed since */
+/* only those inputs are read from the workbook */
+bool FindDependentResult(long attackerMoveSetNum, long defenderMoveSetNum, BattleResult &result)
+{
+    DependentResult dependentResult;
+    int             i;
+
+    if (!dependencyCache.Find(attackerMoveSetNum, defenderMoveSetNum, dependentResult)) return false;
+    if (dependentResult.gameDataGeneration != gameDataStore.Generation()) return false;
+    for (i = 0; i < numBattleInputs; ++i) {
+        if ((dependentResult.mask & InputBit(i)) && ReadBattleInput(i) != dependentResult.inputs.values[i]) return false;
     }
+    result = dependentResult.result;
+    return true;
+}
 
-    /* perform Monte Carlo trials */
-    numWins = 0;
-    for (i = 0; i < numTrials; ++i) {
 
-        /* set up event queues */
-        attackerEventQueue.Initialize(1);
-        if (attackerTransforms) {
-            attackerEventQueue.Add(offensiveInitialInterval, PlayerStartsTransform);
-        } else {
-            attackerEventQueue.Add(offensiveInitialInterval, PlayerStartsAttack);
+/* remember the result of a matchup cell with the inputs it depended on */
+void RememberDependentResult(long attackerMoveSetNum, long defenderMoveSetNum, const BattleInputs &inputs, const BattleParameters &parameters,
+                             unsigned long gameDataGeneration, const BattleResult &result)
+{
+    DependentResult dependentResult;
+
+    dependentResult.mask = BattleInputDependencies(inputs, parameters);
+    dependentResult.inputs = inputs;
+    dependentResult.gameDataGeneration = gameDataGeneration;
+    dependentResult.result = result;
+    dependencyCache.Insert(attackerMoveSetNum, defenderMoveSetNum, dependentResult);
+}
+
+
+/* log stream of the calling thread, reused by every matchup since constructing a stream allocates its locale */
+std::ofstream &ThreadLogFile(void)
+{
+    static thread_local std::ofstream logFile;
+
+    return logFile;
+}
+
+
+/* get the result of a matchup, recalculating it only if an input it depends on has changed */
+/* returns false if the simulation settings are invalid */
+bool BattleMatchup(long attackerMoveSetNum, long defenderMoveSetNum, BattleResult &result)
+{
+    std::ofstream    &logFile = ThreadLogFile();
+    BattleInputs     inputs;
+    BattleParameters parameters;
+    unsigned long    gameDataGeneration;
+
+    if (FindDependentResult(attackerMoveSetNum, defenderMoveSetNum, result)) return true;
+
+    if (!ResolveBattleParameters(attackerMoveSetNum, defenderMoveSetNum, logFile, inputs, parameters, gameDataGeneration)) return false;
+    SimulateMatchup(parameters, logFile, result);
+    /* logged battles are always simulated */
+    if (!logFile.is_open()) {
+        RememberDependentResult(attackerMoveSetNum, defenderMoveSetNum, inputs, parameters, gameDataGeneration, result);
+    }
+    CLOSELOG(logFile);
+    return true;
+}
+
+
+/* record a matchup function call while a workload trace is being captured */
+void TraceMatchupCall(int function, long attackerMoveSetNum, long defenderMoveSetNum, std::chrono::steady_clock::time_point start, double value,
+                      const BattleInputs &inputs, const GameData &gameData, unsigned long gameDataGeneration)
+{
+    TraceCall call;
+
+    call.function = function;
+    call.attackerMoveSetNum = attackerMoveSetNum;
+    call.defenderMoveSetNum = defenderMoveSetNum;
+    call.inputsHash = HashBattleInputs(inputs);
+    call.result = value;
+    call.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    workloadTrace.Record(call, inputs, gameData, gameDataGeneration);
+}
+
+
+/* record a matchup function call with the current inputs and game tables, only from Excel's threads */
+void TraceMatchupCall(int function, long attackerMoveSetNum, long defenderMoveSetNum, std::chrono::steady_clock::time_point start, double value)
+{
+    BattleInputs  inputs;
+    unsigned long gameDataGeneration;
+
+    if (!workloadTrace.IsOpen()) return;
+    ReadBattleInputs(inputs);
+    auto gameData = gameDataStore.Get(allGameTables, gameDataGeneration);
+    TraceMatchupCall(function, attackerMoveSetNum, defenderMoveSetNum, start, value, inputs, *gameData, gameDataGeneration);
+}
+
+
+double WINAPI Battle(long attackerMoveSetNum, long defenderMoveSetNum)
+{
+#pragma EXPORT
+    std::chrono::steady_clock::time_point start;
+    BattleResult                          result;
+    double                                winProbability;
+
+    /* do not execute from dialog box */
+    if (CalledFromExcelDialog()) return 0.0;
+
+    start = std::chrono::steady_clock::now();
+    /* return probability of attacker winning */
+    winProbability = BattleMatchup(attackerMoveSetNum, defenderMoveSetNum, result) ? result.winProbability : -1.0;
+    TraceMatchupCall(BattleFunction, attackerMoveSetNum, defenderMoveSetNum, start, winProbability);
+    return winProbability;
+}
+
+
+double WINAPI BattleStandardError(long attackerMoveSetNum, long defenderMoveSetNum)
+{
+#pragma EXPORT
+    std::chrono::steady_clock::time_point start;
+    BattleResult                          result;
+    double                                standardError;
+
+    /* do not execute from dialog box */
+    if (CalledFromExcelDialog()) return 0.0;
+
+    start = std::chrono::steady_clock::now();
+    /* return standard error of the probability of attacker winning */
+    standardError = BattleMatchup(attackerMoveSetNum, defenderMoveSetNum, result) ? result.standardError : -1.0;
+    TraceMatchupCall(BattleStandardErrorFunction, attackerMoveSetNum, defenderMoveSetNum, start, standardError);
+    return standardError;
+}
+
+
+/* engine that evaluated the matchup, which EnginePlanning lets the cost model choose */
+double WINAPI MatchupEngine(long attackerMoveSetNum, long defenderMoveSetNum)
+{
+#pragma EXPORT
+    std::chrono::steady_clock::time_point start;
+    BattleResult                          result;
+    double                                engine;
+
+    /* do not execute from dialog box */
+    if (CalledFromExcelDialog()) return 0.0;
+
+    start = std::chrono::steady_clock::now();
+    engine = BattleMatchup(attackerMoveSetNum, defenderMoveSetNum, result) ? result.engine : -1.0;
+    TraceMatchupCall(MatchupEngineFunction, attackerMoveSetNum, defenderMoveSetNum, start, engine);
+    return engine;
+}
+
+
+/* hand the value of an asynchronous call back to Excel, from any thread */
+void ReturnAsync(XLOPER12 asyncHandle, double value)
+{
+    XLOPER12 result;
+
+    result.xltype = xltypeNum;
+    result.val.num = value;
+    (void) Excel12(xlAsyncReturn, nullptr, 2, &asyncHandle, &result);
+}
+
+
+/* asynchronous Battle() that sends uncached matchups to the simulation workers */
+void WINAPI BattleAsync(long attackerMoveSetNum, long defenderMoveSetNum, LPXLOPER12 asyncHandle)
+{
+#pragma EXPORT
+    std::chrono::steady_clock::time_point start;
+    std::ofstream                         &logFile = ThreadLogFile();
+    BattleInputs                          inputs;
+    BattleParameters                      parameters;
+    BattleResult                          result;
+    BattleKey                             key;
+    XLOPER12                              handle;
+    unsigned long                         gameDataGeneration;
+    std::shared_ptr<const GameData>       traceGameData;
+
+    /* do not execute from dialog box */
+    if (CalledFromExcelDialog()) {
+        ReturnAsync(*asyncHandle, 0.0);
+        return;
+    }
+
+    start = std::chrono::steady_clock::now();
+    if (FindDependentResult(attackerMoveSetNum, defenderMoveSetNum, result)) {
+        TraceMatchupCall(BattleAsyncFunction, attackerMoveSetNum, defenderMoveSetNum, start, result.winProbability);
+        ReturnAsync(*asyncHandle, result.winProbability);
+        return;
+    }
+    if (!ResolveBattleParameters(attackerMoveSetNum, defenderMoveSetNum, logFile, inputs, parameters, gameDataGeneration)) {
+        TraceMatchupCall(BattleAsyncFunction, attackerMoveSetNum, defenderMoveSetNum, start, -1.0);
+        ReturnAsync(*asyncHandle, -1.0);
+        return;
+    }
+
+    /* logged battles are always simulated in process */
+    if (logFile.is_open()) {
+        SimulateMatchup(parameters, logFile, result);
+        CLOSELOG(logFile);
+        TraceMatchupCall(BattleAsyncFunction, attackerMoveSetNum, defenderMoveSetNum, start, result.winProbability);
+        ReturnAsync(*asyncHandle, result.winProbability);
+        return;
+    }
+    MakeBattleKey(parameters, key);
+    if (matchupCache.Find(key, result)) {
+        RememberDependentResult(attackerMoveSetNum, defenderMoveSetNum, inputs, parameters, gameDataGeneration, result);
+        TraceMatchupCall(BattleAsyncFunction, attackerMoveSetNum, defenderMoveSetNum, start, result.winProbability);
+        ReturnAsync(*asyncHandle, result.winProbability);
+        return;
+    }
+
+    /* the worker's answer arrives on another thread, which cannot read the workbook */
+    if (workloadTrace.IsOpen()) traceGameData = gameDataStore.Get(allGameTables, gameDataGeneration);
+
+    /* the handle stays valid until the value is returned */
+    handle = *asyncHandle;
+    workerPool.Submit(parameters, [=] (const BattleResult &workerResult) {
+        matchupCache.Insert(key, workerResult);
+        RememberDependentResult(attackerMoveSetNum, defenderMoveSetNum, inputs, parameters, gameDataGeneration, workerResult);
+        if (traceGameData) {
+            TraceMatchupCall(BattleAsyncFunction, attackerMoveSetNum, defenderMoveSetNum, start, workerResult.winProbability, inputs, *traceGameData,
+                             gameDataGeneration);
         }
-        defenderEventQueue.Initialize(numDefensiveInitialIntervals);
-        defenderTime = defensiveInitialIntervals[0];
-        if (defenderTransforms) {
-            defenderEventQueue.Add(defenderTime, PlayerStartsTransform);
+        ReturnAsync(handle, workerResult.winProbability);
+    });
+}
+
+
+/* command to forget all cached results, edits of the species, move, level, or type tables are also found when a recalculation ends */
+int WINAPI ResetBattleCache(void)
+{
+#pragma EXPORT
+    gameDataStore.Invalidate();
+    matchupCache.Clear();
+    dependencyCache.Clear();
+    return 1;
+}
+
+
+/* command run by Excel when a recalculation ends, forgets the game tables if they were edited */
+/* the stamp is taken here rather than by the functions, so no recalculation waits for it */
+int WINAPI CalculationEnded(void)
+{
+#pragma EXPORT
+    gameDataStore.CheckTables();
+    return 1;
+}
+
+
+/* command run by xlAutoOpen() once Excel is idle, so the first recalculation finds the game tables loaded */
+int WINAPI PrewarmGameData(void)
+{
+#pragma EXPORT
+    unsigned long gameDataGeneration;
+
+    /* the add-in can open before the battle workbook */
+    if (!WorkbookHasGameData()) return 1;
+    (void) gameDataStore.Get(allGameTables, gameDataGeneration);
+    return 1;
+}
+
+
+/* number of independent randomizations and maximum number of rows in the convergence table */
+const long numConvergenceRandomizations = 16;
+const int  maxConvergenceRows = 24;
+const int  numConvergenceColumns = 6;
+
+
+LPXLOPER12 WINAPI SamplingConvergence(long attackerMoveSetNum, long defenderMoveSetNum)
+{
+#pragma EXPORT
+    RESULTSTORAGE XLOPER12 table, valueError;
+    RESULTSTORAGE XLOPER12 cells[maxConvergenceRows * numConvergenceColumns];
+    std::ofstream          logFile;
+    BattleInputs           inputs;
+    BattleParameters       parameters, monteCarloParameters, quasiMonteCarloParameters;
+    BattleResult           monteCarloResult, quasiMonteCarloResult;
+    unsigned long          gameDataGeneration;
+    long                   numTrials;
+    int                    numRows;
+    LPXLOPER12             cell;
+
+    valueError.xltype = xltypeErr;
+    valueError.val.err = xlerrValue;
+
+    /* do not execute from dialog box */
+    if (CalledFromExcelDialog()) return &valueError;
+
+    if (!ResolveBattleParameters(attackerMoveSetNum, defenderMoveSetNum, logFile, inputs, parameters, gameDataGeneration)) return &valueError;
+    CLOSELOG(logFile);
+    if (!parameters.randomness) {
+#if !THREADSAFE
+        MsgBox(L"\053Monte Carlo simulations require randomness.");
+#endif
+        return &valueError;
+    }
+
+    /* plain Monte Carlo with independent trials */
+    monteCarloParameters = parameters;
+    monteCarloParameters.commonRandomNumbers = true;
+    monteCarloParameters.antitheticTrials = false;
+    monteCarloParameters.quasiMonteCarlo = false;
+    monteCarloParameters.numRandomizations = 1;
+
+    /* quasi-Monte Carlo with independently randomized point sets */
+    quasiMonteCarloParameters = monteCarloParameters;
+    quasiMonteCarloParameters.quasiMonteCarlo = true;
+    quasiMonteCarloParameters.numRandomizations = numConvergenceRandomizations;
+
+    /* double the number of trials up to the number of Monte Carlo trials */
+    numRows = 0;
+    cell = cells;
+    for (numTrials = 2 * numConvergenceRandomizations; numTrials <= parameters.numTrials && numRows < maxConvergenceRows; numTrials *= 2) {
+        monteCarloParameters.numTrials = numTrials;
+        SimulateBattles(monteCarloParameters, logFile, monteCarloResult);
+        quasiMonteCarloParameters.numTrials = numTrials;
+        SimulateBattles(quasiMonteCarloParameters, logFile, quasiMonteCarloResult);
+
+        /* trials, probabilities and standard errors, and ratio of trials needed for the same precision */
+        cell[0].xltype = xltypeNum;
+        cell[0].val.num = (double) numTrials;
+        cell[1].xltype = xltypeNum;
+        cell[1].val.num = monteCarloResult.winProbability;
+        cell[2].xltype = xltypeNum;
+        cell[2].val.num = monteCarloResult.standardError;
+        cell[3].xltype = xltypeNum;
+        cell[3].val.num = quasiMonteCarloResult.winProbability;
+        cell[4].xltype = xltypeNum;
+        cell[4].val.num = quasiMonteCarloResult.standardError;
+        if (quasiMonteCarloResult.standardError > 0.0) {
+            cell[5].xltype = xltypeNum;
+            cell[5].val.num = (monteCarloResult.standardError * monteCarloResult.standardError) /
+                              (quasiMonteCarloResult.standardError * quasiMonteCarloResult.standardError);
         } else {
-            defenderEventQueue.Add(defenderTime, PlayerStartsInitialAttack);
+            cell[5].xltype = xltypeErr;
+            cell[5].val.err = xlerrDiv0;
         }
-        defenderTime += defensiveInitialIntervals[1];
-        defenderEventQueue.Add(defenderTime, PlayerStartsInitialAttack);
-        if (randomness) {
-            defenderTime += RandomInterval(defensiveInitialIntervals[2], defensiveIntervalRandomness);
+        cell += numConvergenceColumns;
+        ++numRows;
+    }
+    if (numRows == 0) return &valueError;
+
+    table.xltype = xltypeMulti;
+    table.val.array.lparray = cells;
+    table.val.array.rows = numRows;
+    table.val.array.columns = numConvergenceColumns;
+    return &table;
+}
+
+
+/* rows of the statistics table before the remaining HP histogram, and columns of the table */
+const int numStatisticsSummaryRows = 11;
+const int numStatisticsColumns = 3;
+
+
+inline void NumberCell(XLOPER12 &cell, double number)
+{
+    cell.xltype = xltypeNum;
+    cell.val.num = number;
+}
+
+
+/* the string must be a counted string literal, the cell does not own it */
+inline void StringCell(XLOPER12 &cell, const wchar_t *str)
+{
+    cell.xltype = xltypeStr;
+    cell.val.str = (wchar_t *) str;
+}
+
+
+/* outcome measures of the matchup from one pass of its trials, a row per measure and then the remaining HP histograms */
+LPXLOPER12 WINAPI BattleStatistics(long attackerMoveSetNum, long defenderMoveSetNum)
+{
+#pragma EXPORT
+    RESULTSTORAGE XLOPER12 table, valueError;
+    RESULTSTORAGE XLOPER12 cells[(numStatisticsSummaryRows + numHPBins) * numStatisticsColumns];
+    std::ofstream          logFile;
+    BattleInputs           inputs;
+    BattleParameters       parameters;
+    BattleResult           result;
+    TrialStatistics        statistics;
+    unsigned long          gameDataGeneration;
+    double                 numTrials, meanDuration;
+    LPXLOPER12             cell;
+    int                    i;
+
+    valueError.xltype = xltypeErr;
+    valueError.val.err = xlerrValue;
+
+    /* do not execute from dialog box */
+    if (CalledFromExcelDialog()) return &valueError;
+
+    if (!ResolveBattleParameters(attackerMoveSetNum, defenderMoveSetNum, logFile, inputs, parameters, gameDataGeneration)) return &valueError;
+    SimulateBattleStatistics(parameters, logFile, result, statistics);
+    CLOSELOG(logFile);
+
+    /* label, mean, and standard error or standard deviation where there is one, times in seconds */
+    numTrials = (double) parameters.numTrials;
+    meanDuration = statistics.sumOfDurations / numTrials;
+    cell = cells;
+    for (i = 0; i < numStatisticsSummaryRows; ++i) {
+        StringCell(cell[i * numStatisticsColumns + 2], L"\000");
+    }
+    StringCell(cell[0], L"\017Win probability");
+    NumberCell(cell[1], result.winProbability);
+    NumberCell(cell[2], result.standardError);
+    cell += numStatisticsColumns;
+    StringCell(cell[0], L"\017Battle duration");
+    NumberCell(cell[1], meanDuration / 1000.0);
+    NumberCell(cell[2], sqrt(fmax(statistics.sumOfSquaredDurations / numTrials - meanDuration * meanDuration, 0.0)) / 1000.0);
+    cell += numStatisticsColumns;
+    StringCell(cell[0], L"\037Battle duration 10th percentile");
+    NumberCell(cell[1], DurationPercentile(parameters, statistics, parameters.numTrials, 0.1) / 1000.0);
+    cell += numStatisticsColumns;
+    StringCell(cell[0], L"\026Battle duration median");
+    NumberCell(cell[1], DurationPercentile(parameters, statistics, parameters.numTrials, 0.5) / 1000.0);
+    cell += numStatisticsColumns;
+    StringCell(cell[0], L"\037Battle duration 90th percentile");
+    NumberCell(cell[1], DurationPercentile(parameters, statistics, parameters.numTrials, 0.9) / 1000.0);
+    cell += numStatisticsColumns;
+    StringCell(cell[0], L"\013Time to win");
+    if (result.numWins > 0) {
+        NumberCell(cell[1], statistics.sumOfWinDurations / (double) result.numWins / 1000.0);
+    } else {
+        cell[1].xltype = xltypeErr;
+        cell[1].val.err = xlerrNA;
+    }
+    cell += numStatisticsColumns;
+    StringCell(cell[0], L"\014Damage dealt");
+    NumberCell(cell[1], statistics.sumOfDamageDealt / numTrials);
+    cell += numStatisticsColumns;
+    StringCell(cell[0], L"\014Damage taken");
+    NumberCell(cell[1], statistics.sumOfDamageTaken / numTrials);
+    cell += numStatisticsColumns;
+    StringCell(cell[0], L"\030Attacker special attacks");
+    NumberCell(cell[1], statistics.numAttackerSpecialAttacks / numTrials);
+    cell += numStatisticsColumns;
+    StringCell(cell[0], L"\030Defender special attacks");
+    NumberCell(cell[1], statistics.numDefenderSpecialAttacks / numTrials);
+    cell += numStatisticsColumns;
+
+    /* fraction of trials ending with remaining HP up to each fraction of the starting HP */
+    StringCell(cell[0], L"\014Remaining HP");
+    StringCell(cell[1], L"\010Attacker");
+    StringCell(cell[2], L"\010Defender");
+    cell += numStatisticsColumns;
+    for (i = 0; i < numHPBins; ++i) {
+        NumberCell(cell[0], (i + 1.0) / numHPBins);
+        NumberCell(cell[1], statistics.attackerHPCounts[i] / numTrials);
+        NumberCell(cell[2], statistics.defenderHPCounts[i] / numTrials);
+        cell += numStatisticsColumns;
+    }
+
+    table.xltype = xltypeMulti;
+    table.val.array.lparray = cells;
+    table.val.array.rows = numStatisticsSummaryRows + numHPBins;
+    table.val.array.columns = numStatisticsColumns;
+    return &table;
+}
+
+
+const int numStrategyColumns = 4;
+
+
+/* best attacker strategy for the matchup, special attacks are never skipped so the solver can choose them wherever they help */
+/* one row of the optimal value, the greedy attacker's value, the number of states, and the plan of fast and special attacks */
+LPXLOPER12 WINAPI OptimalStrategy(long attackerMoveSetNum, long defenderMoveSetNum, long objective)
+{
+#pragma EXPORT
+    RESULTSTORAGE XLOPER12 table, valueError;
+    RESULTSTORAGE XLOPER12 cells[numStrategyColumns];
+    RESULTSTORAGE wchar_t  planStr[maxPlanLength + 1];
+    BattleInputs           inputs;
+    MatchupData            matchupData;
+    BattleParameters       parameters;
+    StrategyResult         result;
+    unsigned long          gameDataGeneration;
+    double                 attackerCPMultiplier, defenderCPMultiplier;
+    double                 timeScale;
+    size_t                 i;
+
+    valueError.xltype = xltypeErr;
+    valueError.val.err = xlerrValue;
+
+    /* do not execute from dialog box */
+    if (CalledFromExcelDialog()) return &valueError;
+
+    if (objective != WinProbabilityObjective && objective != WinTimeObjective) return &valueError;
+    ReadBattleInputs(inputs);
+    if (!CheckSimulationSettings(inputs)) return &valueError;
+    inputs.values[SkipWeakerSpecialAttacksInput] = 0.0;
+    auto gameData = gameDataStore.Get(allGameTables, gameDataGeneration);
+    if (!ResolveMatchupData(*gameData, attackerMoveSetNum, defenderMoveSetNum, matchupData)) return &valueError;
+    attackerCPMultiplier = gameData->CPMultiplier(inputs.values[AttackerLevelInput]);
+    defenderCPMultiplier = gameData->CPMultiplier(inputs.values[DefenderLevelInput]);
+    if (attackerCPMultiplier == 0.0 || defenderCPMultiplier == 0.0) return &valueError;
+    ResolveBattleParameters(matchupData, inputs, attackerCPMultiplier, defenderCPMultiplier, parameters);
+
+    StrategySolver solver(parameters, (int) objective, defaultIntervalPoints);
+
+    if (!solver.Solve(result)) return &valueError;
+
+    /* times in seconds */
+    timeScale = (objective == WinTimeObjective) ? 0.001 : 1.0;
+    NumberCell(cells[0], result.optimalValue * timeScale);
+    NumberCell(cells[1], result.greedyValue * timeScale);
+    NumberCell(cells[2], (double) result.numStates);
+    planStr[0] = (wchar_t) result.plan.size();
+    for (i = 0; i < result.plan.size(); ++i) {
+        planStr[i + 1] = (wchar_t) result.plan[i];
+    }
+    StringCell(cells[3], planStr);
+    table.xltype = xltypeMulti;
+    table.val.array.lparray = cells;
+    table.val.array.rows = 1;
+    table.val.array.columns = numStrategyColumns;
+    return &table;
+}
+
+
+/* one row of move set numbers per player, blank cells are skipped so parties can be smaller than the table */
+/* returns false if the argument is not a table of numbers or a party is empty or too large */
+bool ArgumentParties(const XLOPER12 &argument, std::vector<std::vector<long>> &partyMoveSetNums)
+{
+    LPXLOPER12 cell;
+    int        rowNum, columnNum;
+
+    partyMoveSetNums.clear();
+    if (argument.xltype == xltypeNum) {
+        partyMoveSetNums.emplace_back(1, (long) argument.val.num);
+        return true;
+    }
+    if (argument.xltype != xltypeMulti || argument.val.array.rows > maxRaidPlayers) return false;
+    for (rowNum = 0, cell = argument.val.array.lparray; rowNum < argument.val.array.rows; ++rowNum) {
+        partyMoveSetNums.emplace_back();
+        for (columnNum = 0; columnNum < argument.val.array.columns; ++columnNum, ++cell) {
+            if (cell->xltype == xltypeNum) {
+                if (partyMoveSetNums.back().size() == (size_t) maxPartySize) return false;
+                partyMoveSetNums.back().push_back((long) cell->val.num);
+            } else if (cell->xltype != xltypeNil) {
+                return false;
+            }
+        }
+        if (partyMoveSetNums.back().empty()) return false;
+    }
+    return true;
+}
+
+
+/* win probability of a raid, its trials split over the processors */
+LPXLOPER12 WINAPI RaidBattle(LPXLOPER12 partyMoveSetNums, long bossMoveSetNum, long partySwapDelay, long relobbyDelay, long numRelobbies)
+{
+#pragma EXPORT
+    RESULTSTORAGE XLOPER12         valueError, probability;
+    BattleInputs                   inputs;
+    std::vector<std::vector<long>> parties;
+    RaidParameters                 raid;
+    BattleResult                   result;
+    unsigned long                  gameDataGeneration;
+
+    valueError.xltype = xltypeErr;
+    valueError.val.err = xlerrValue;
+
+    /* do not execute from dialog box */
+    if (CalledFromExcelDialog()) return &valueError;
+
+    ReadBattleInputs(inputs);
+    if (!CheckSimulationSettings(inputs)) return &valueError;
+    if (!ArgumentParties(*partyMoveSetNums, parties)) return &valueError;
+
+    auto gameData = gameDataStore.Get(allGameTables, gameDataGeneration);
+    if (!ResolveRaidParameters(*gameData, inputs, parties, bossMoveSetNum, raid)) return &valueError;
+    raid.partySwapDelay = (int) partySwapDelay;
+    raid.relobbyDelay = (int) relobbyDelay;
+    raid.numRelobbies = (int) numRelobbies;
+    if (!CheckRaidParameters(raid)) return &valueError;
+    SimulateRaid(raid, (int) std::thread::hardware_concurrency(), result);
+
+    probability.xltype = xltypeNum;
+    probability.val.num = result.winProbability;
+    return &probability;
+}
+
+
+/* number of columns of the sweep ranges argument and of the sweep table */
+const int numSweepRangeColumns = 3;
+const int numSweepColumns = numSweepInputs + 4;
+
+/* number of rows on a worksheet */
+const long maxWorksheetRows = 1048576;
+
+
+/* get the numbers of a single value or an array argument */
+/* returns false if any value is not a number */
+bool ArgumentNumbers(const XLOPER12 &argument, std::vector<double> &numbers)
+{
+    long i;
+
+    numbers.clear();
+    if (argument.xltype == xltypeNum) {
+        numbers.push_back(argument.val.num);
+        return true;
+    }
+    if (argument.xltype != xltypeMulti) return false;
+    for (i = 0; i < (long) argument.val.array.rows * argument.val.array.columns; ++i) {
+        if (argument.val.array.lparray[i].xltype != xltypeNum) return false;
+        numbers.push_back(argument.val.array.lparray[i].val.num);
+    }
+    return true;
+}
+
+
+/* get one row of first, last, and step values per sweep input, a blank row keeps the value on the Inputs sheet */
+/* returns false if the argument has the wrong shape or a partly blank row */
+bool ArgumentSweepRanges(const XLOPER12 &argument, const BattleInputs &inputs, SweepRange ranges[numSweepInputs])
+{
+    LPXLOPER12 cell;
+    int        i;
+
+    if (argument.xltype != xltypeMulti || argument.val.array.rows != numSweepInputs || argument.val.array.columns != numSweepRangeColumns) return false;
+    for (i = 0, cell = argument.val.array.lparray; i < numSweepInputs; ++i, cell += numSweepRangeColumns) {
+        if (cell[0].xltype == xltypeNil && cell[1].xltype == xltypeNil && cell[2].xltype == xltypeNil) {
+            ranges[i].first = inputs.values[sweepInputIds[i]];
+            ranges[i].last = ranges[i].first;
+            ranges[i].step = 0.0;
+        } else if (cell[0].xltype == xltypeNum && cell[1].xltype == xltypeNum && cell[2].xltype == xltypeNum) {
+            ranges[i].first = cell[0].val.num;
+            ranges[i].last = cell[1].val.num;
+            ranges[i].step = cell[2].val.num;
         } else {
-            defenderTime += defensiveInitialIntervals[2];
+            return false;
         }
-        defenderEventQueue.Add(defenderTime, PlayerStartsAttack);
-
-        /* simulate battle */
-        battleTimer = battleDuration;
-        attackerBattleHP = attackerHP;
-        defenderBattleHP = (int) (defenderHP * defensiveHPMultiplier);
-        attackerEnergy = 0;
-        defenderEnergy = 0;
-        numDefensiveSpecialAttackOpportunities = 0;
-        LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "battle starts");
-        while (battleTimer > 0 && attackerBattleHP > 0 && defenderBattleHP > 0) {
-
-            /* count down timers to next event */
-            nextTime = Min(attackerEventQueue.Timer(), defenderEventQueue.Timer());
-            attackerEventQueue.CountDown(nextTime);
-            defenderEventQueue.CountDown(nextTime);
-            battleTimer -= nextTime;
-
-            /* check if time for next attacker event */
-            if (attackerEventQueue.Timer() == 0) {
-                playerEvent = attackerEventQueue.Pop();
-
-                /* attacker finishes action */
-                switch (playerEvent) {
-                case PlayerFinishesLongPress:
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker finishes long press");
-                    break;
-                case PlayerLandsFastAttack:
-                    /* attacker lands fast attack damage */
-                    defenderBattleHP -= attackerFastAttackDamage;
-                    defenderEnergy = Min(defenderEnergy + (int) round(attackerFastAttackDamage * energyPerDamage + tolerance), maxDefenderEnergy);
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker lands fast attack");
-                    break;
-                case PlayerLandsSpecialAttack:
-                    /* attacker lands special attack damage */
-                    defenderBattleHP -= attackerSpecialAttackDamage;
-                    defenderEnergy = Min(defenderEnergy + (int) round(attackerSpecialAttackDamage * energyPerDamage + tolerance), maxDefenderEnergy);
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker lands special attack");
-                    break;
-                case PlayerLandsTransform:
-                    /* attacker lands transform damage */
-                    defenderBattleHP -= transformDamage;
-                    defenderEnergy = Min(defenderEnergy + (int) round(transformDamage * energyPerDamage + tolerance), maxDefenderEnergy);
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker lands transform");
-                    break;
-                case PlayerFinishesFastAttack:
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker finishes fast attack");
-                    break;
-                case PlayerFinishesSpecialAttack:
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker finishes special attack");
-                    break;
-                case PlayerFinishesTransform:
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker finishes transform");
-                    break;
-                case PlayerFinishesInitialFastAttack:
-                case PlayerFinishesInitialSpecialAttack:
-                    assert(false);
-                    break;
-                }
-
-                /* attacker performs next action */
-                switch (playerEvent) {
-                case PlayerStartsInitialAttack:
-                    assert(false);
-                    break;
-                case PlayerStartsTransform:
-                    /* attacker starts transform */
-                    attackerEnergy = Min(attackerEnergy + transformEnergy, maxAttackerEnergy);
-                    attackerEventQueue.Add(transformDamageStart, PlayerLandsTransform);
-                    attackerEventQueue.Add(transformDuration, PlayerFinishesTransform);
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker starts transform");
-                    break;
-                case PlayerStartsAttack:
-                case PlayerFinishesFastAttack:
-                case PlayerFinishesSpecialAttack:
-                case PlayerFinishesTransform:
-                    /* attacker starts next attack */
-                    if (attackerEnergy >= -attackerSpecialAttackEnergy) {
-                        /* special attack */
-                        attackerEventQueue.Add(longPressDuration, PlayerFinishesLongPress);
-                        LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker starts long press");
-                    } else {
-                        /* fast attack */
-                        attackerEnergy = Min(attackerEnergy + attackerFastAttackEnergy, maxAttackerEnergy);
-                        attackerEventQueue.Add(attackerFastAttackDamageStart, PlayerLandsFastAttack);
-                        attackerEventQueue.Add(attackerFastAttackDuration, PlayerFinishesFastAttack);
-                        LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker starts fast attack");
-                    }
-                    break;
-                case PlayerFinishesLongPress:
-                    /* attacker continues special attack */
-                    attackerEnergy = attackerEnergy + attackerSpecialAttackEnergy;
-                    attackerEventQueue.Add(attackerSpecialAttackDamageStart, PlayerLandsSpecialAttack);
-                    attackerEventQueue.Add(attackerSpecialAttackDuration, PlayerFinishesSpecialAttack);
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "attacker starts special attack");
-                    break;
-                }
-            }
+    }
+    return true;
+}
+
+
+LPXLOPER12 WINAPI BattleSweep(LPXLOPER12 attackerMoveSetNums, LPXLOPER12 defenderMoveSetNums, LPXLOPER12 sweepRanges)
+{
+#pragma EXPORT
+    RESULTSTORAGE XLOPER12    valueError, numError;
+    BattleInputs              inputs;
+    SweepRange                ranges[numSweepInputs];
+    std::vector<double>       attackers, defenders;
+    std::vector<Matchup>      matchups;
+    std::vector<SweepPoint>   points;
+    unsigned long             gameDataGeneration;
+    std::vector<BattleResult> results;
+    Matchup                   matchup;
+    LPXLOPER12                table, cell;
+    const BattleResult        *result;
+    std::string               error;
+    size_t                    pointNum, matchupNum;
+    int                       i;
+
+    valueError.xltype = xltypeErr;
+    valueError.val.err = xlerrValue;
+    numError.xltype = xltypeErr;
+    numError.val.err = xlerrNum;
 
-            /* check if time for next defender event */
-            if (defenderEventQueue.Timer() == 0) {
-                playerEvent = defenderEventQueue.Pop();
-
-                /* defender finishes action */
-                switch (playerEvent) {
-                case PlayerFinishesLongPress:
-                    assert(false);
-                    break;
-                case PlayerLandsFastAttack:
-                    /* defender lands fast attack damage */
-                    attackerBattleHP -= defenderFastAttackDamage;
-                    attackerEnergy = Min(attackerEnergy + (int) round(defenderFastAttackDamage * energyPerDamage + tolerance), maxAttackerEnergy);
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender lands fast attack");
-                    break;
-                case PlayerLandsSpecialAttack:
-                    /* defender lands special attack damage */
-                    attackerBattleHP -= defenderSpecialAttackDamage;
-                    attackerEnergy = Min(attackerEnergy + (int) round(defenderSpecialAttackDamage * energyPerDamage + tolerance), maxAttackerEnergy);
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender lands special attack");
-                    break;
-                case PlayerLandsTransform:
-                    /* defender lands transform damage */
-                    attackerBattleHP -= transformDamage;
-                    attackerEnergy = Min(attackerEnergy + (int) round(transformDamage * energyPerDamage + tolerance), maxAttackerEnergy);
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender lands transform");
-                    break;
-                case PlayerFinishesFastAttack:
-                case PlayerFinishesInitialFastAttack:
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender finishes fast attack");
-                    break;
-                case PlayerFinishesSpecialAttack:
-                case PlayerFinishesInitialSpecialAttack:
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender finishes special attack");
-                    break;
-                case PlayerFinishesTransform:
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender finishes transform");
-                    break;
-                }
-
-                /* defender performs next action */
-                switch (playerEvent) {
-                case PlayerStartsTransform:
-                    /* defender starts transform */
-                    defenderEnergy = Min(defenderEnergy + transformEnergy, maxDefenderEnergy);
-                    defenderEventQueue.Add(transformDamageStart, PlayerLandsTransform);
-                    defenderEventQueue.Add(transformDuration, PlayerFinishesTransform);
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender starts transform");
-                    break;
-                case PlayerStartsAttack:
-                case PlayerStartsInitialAttack:
-                    /* defender starts next attack */
-                    if (defenderEnergy >= -defenderSpecialAttackEnergy) {
-                        /* defender often defers special attacks */
-                        if (randomness) {
-                            /* random behavior */
-                            if ((double) rand() / (RAND_MAX + 1) > defensiveSpecialAttackProbability) {
-                                specialAttack = true;
-                            } else {
-                                specialAttack = false;
-                                LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy,
-                                         "defender defers special attack");
-                            }
-                        } else {
-                            /* expected behavior */
-                            numDefensiveSpecialAttackOpportunities = numDefensiveSpecialAttackOpportunities + 1;
-                            if (numDefensiveSpecialAttackOpportunities > numDefensiveSpecialAttackDeferrals) {
-                                numDefensiveSpecialAttackOpportunities = 0;
-                                specialAttack = true;
-                            } else {
-                                specialAttack = false;
-                                LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy,
-                                         "defender defers special attack");
-                            }
-                        }
-                    } else {
-                        specialAttack = false;
-                    }
-                    if (specialAttack) {
-                        /* special attack */
-                        defenderEnergy = defenderEnergy + defenderSpecialAttackEnergy;
-                        defenderEventQueue.Add(defenderSpecialAttackDamageStart, PlayerLandsSpecialAttack);
-                        if (playerEvent == PlayerStartsInitialAttack) {
-                            defenderEventQueue.Add(defenderSpecialAttackDuration, PlayerFinishesInitialSpecialAttack);
-                        } else {
-                            defenderEventQueue.Add(defenderSpecialAttackDuration, PlayerFinishesSpecialAttack);
-                        }
-                        LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender starts special attack");
-                    } else {
-                        /* fast attack */
-                        defenderEnergy = Min(defenderEnergy + defenderFastAttackEnergy, maxDefenderEnergy);
-                        defenderEventQueue.Add(defenderFastAttackDamageStart, PlayerLandsFastAttack);
-                        if (playerEvent == PlayerStartsInitialAttack) {
-                            defenderEventQueue.Add(defenderFastAttackDuration, PlayerFinishesInitialFastAttack);
-                        } else {
-                            defenderEventQueue.Add(defenderFastAttackDuration, PlayerFinishesFastAttack);
-                        }
-                        LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender starts fast attack");
-                    }
-                    break;
-                case PlayerFinishesFastAttack:
-                case PlayerFinishesSpecialAttack:
-                    /* defender does nothing for a while and then starts next attack */
-                    if (randomness) {
-                        interval = RandomInterval(defensiveInterval, defensiveIntervalRandomness);
-                    } else {
-                        interval = defensiveInterval;
-                    }
-                    defenderEventQueue.Add(interval, PlayerStartsAttack);
-                    LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "defender idles");
-                    break;
-                case PlayerFinishesInitialFastAttack:
-                case PlayerFinishesInitialSpecialAttack:
-                case PlayerFinishesTransform:
-                    /* initial attacks do not start new attacks */
-                    break;
-                }
+    /* do not execute from dialog box */
+    if (CalledFromExcelDialog()) return &valueError;
+
+    ReadBattleInputs(inputs);
+    if (!CheckSimulationSettings(inputs)) return &valueError;
+
+    /* matchups are pairs of attackers and defenders */
+    if (!ArgumentNumbers(*attackerMoveSetNums, attackers) || !ArgumentNumbers(*defenderMoveSetNums, defenders) ||
+        attackers.size() != defenders.size()) return &valueError;
+    for (matchupNum = 0; matchupNum < attackers.size(); ++matchupNum) {
+        matchup.attackerMoveSetNum = (long) attackers[matchupNum];
+        matchup.defenderMoveSetNum = (long) defenders[matchupNum];
+        matchups.push_back(matchup);
+    }
+    if (!ArgumentSweepRanges(*sweepRanges, inputs, ranges) || !MakeSweepPoints(ranges, points)) return &valueError;
+    if ((long) points.size() > maxWorksheetRows / (long) matchups.size()) return &numError;
+
+    auto gameData = gameDataStore.Get(allGameTables, gameDataGeneration);
+    /* worksheet sweeps are small enough to recalculate, so they are not checkpointed */
+    if (!RunSweep(*gameData, inputs, points, matchups, (int) std::thread::hardware_concurrency(), nullptr, results, error)) return &numError;
+
+    /* one row per grid point and matchup, freed by xlAutoFree12() */
+    table = new XLOPER12;
+    table->xltype = xltypeMulti | xlbitDLLFree;
+    table->val.array.rows = (int) results.size();
+    table->val.array.columns = numSweepColumns;
+    table->val.array.lparray = new XLOPER12[results.size() * numSweepColumns];
+    cell = table->val.array.lparray;
+    result = results.data();
+    for (pointNum = 0; pointNum < points.size(); ++pointNum) {
+        for (matchupNum = 0; matchupNum < matchups.size(); ++matchupNum, ++result) {
+            for (i = 0; i < numSweepInputs; ++i) {
+                cell[i].xltype = xltypeNum;
+                cell[i].val.num = points[pointNum].values[i];
             }
+            cell[numSweepInputs].xltype = xltypeNum;
+            cell[numSweepInputs].val.num = (double) matchups[matchupNum].attackerMoveSetNum;
+            cell[numSweepInputs + 1].xltype = xltypeNum;
+            cell[numSweepInputs + 1].val.num = (double) matchups[matchupNum].defenderMoveSetNum;
+            cell[numSweepInputs + 2].xltype = xltypeNum;
+            cell[numSweepInputs + 2].val.num = result->winProbability;
+            cell[numSweepInputs + 3].xltype = xltypeNum;
+            cell[numSweepInputs + 3].val.num = result->standardError;
+            cell += numSweepColumns;
         }
-        LOGEVENT(logFile, battleTimer, attackerBattleHP, attackerEnergy, defenderBattleHP, defenderEnergy, "battle ends");
-        LOGNEWLINE(logFile);
+    }
+    return table;
+}
 
-        if (defenderBattleHP <= 0) {
-            /* attacker won */
-            ++numWins;
-        } else {
-            /* defender won */
+
+/* columns of the team table */
+const int numTeamColumns = 4;
+
+
+/* a team fights a gym lineup in order with HP and energy carried over, its trials split over the processors */
+LPXLOPER12 WINAPI TeamBattle(LPXLOPER12 attackerMoveSetNums, LPXLOPER12 defenderMoveSetNums)
+{
+#pragma EXPORT
+    RESULTSTORAGE XLOPER12 table, valueError;
+    RESULTSTORAGE XLOPER12 cells[numTeamColumns];
+    BattleInputs           inputs;
+    std::vector<double>    attackers, defenders;
+    std::vector<long>      attackerNums, defenderNums;
+    TeamParameters         team;
+    TeamResult             result;
+    unsigned long          gameDataGeneration;
+
+    valueError.xltype = xltypeErr;
+    valueError.val.err = xlerrValue;
+
+    /* do not execute from dialog box */
+    if (CalledFromExcelDialog()) return &valueError;
+
+    ReadBattleInputs(inputs);
+    if (!CheckSimulationSettings(inputs)) return &valueError;
+    if (!ArgumentNumbers(*attackerMoveSetNums, attackers) || !ArgumentNumbers(*defenderMoveSetNums, defenders)) return &valueError;
+    attackerNums.assign(attackers.begin(), attackers.end());
+    defenderNums.assign(defenders.begin(), defenders.end());
+
+    auto gameData = gameDataStore.Get(allGameTables, gameDataGeneration);
+    if (!ResolveTeamParameters(*gameData, inputs, attackerNums, defenderNums, team) || !CheckTeamParameters(team)) return &valueError;
+    SimulateTeam(team, (int) std::thread::hardware_concurrency(), result);
+
+    NumberCell(cells[0], result.battleResult.winProbability);
+    NumberCell(cells[1], result.battleResult.standardError);
+    NumberCell(cells[2], result.attackersNeeded);
+    NumberCell(cells[3], result.attackersNeededStandardError);
+    table.xltype = xltypeMulti;
+    table.val.array.lparray = cells;
+    table.val.array.rows = 1;
+    table.val.array.columns = numTeamColumns;
+    return &table;
+}
+
+
+/* matrix files too large for a worksheet are written tile by tile, on the simulation workers if there are any */
+LPXLOPER12 WINAPI BattleMatrixFile(LPXLOPER12 attackerMoveSetNums, LPXLOPER12 defenderMoveSetNums, LPXLOPER12 sweepRanges, LPXLOPER12 fileName)
+{
+#pragma EXPORT
+    RESULTSTORAGE XLOPER12  valueError, numError, numMatchups;
+    BattleInputs            inputs;
+    SweepRange              ranges[numSweepInputs];
+    std::vector<double>     attackers, defenders;
+    std::vector<long>       attackerNums, defenderNums;
+    std::vector<SweepPoint> points;
+    unsigned long           gameDataGeneration;
+    MatrixFileWriter        matrixFile;
+    GridProgress            progress;
+    std::string             fileNameStr, error;
+    const char              *workerEndpoints;
+    size_t                  i;
+
+    valueError.xltype = xltypeErr;
+    valueError.val.err = xlerrValue;
+    numError.xltype = xltypeErr;
+    numError.val.err = xlerrNum;
+
+    /* do not execute from dialog box */
+    if (CalledFromExcelDialog()) return &valueError;
+
+    ReadBattleInputs(inputs);
+    if (!CheckSimulationSettings(inputs)) return &valueError;
+
+    if (!ArgumentNumbers(*attackerMoveSetNums, attackers) || !ArgumentNumbers(*defenderMoveSetNums, defenders) || fileName->xltype != xltypeStr ||
+        fileName->val.str[0] == 0) return &valueError;
+    for (i = 0; i < attackers.size(); ++i) {
+        attackerNums.push_back((long) attackers[i]);
+    }
+    for (i = 0; i < defenders.size(); ++i) {
+        defenderNums.push_back((long) defenders[i]);
+    }
+    if (!ArgumentSweepRanges(*sweepRanges, inputs, ranges) || !MakeSweepPoints(ranges, points)) return &valueError;
+    fileNameStr = XLOPER12StrToUTF8(*fileName);
+
+    /* close the file if MatrixSpeciesAverage() has it open */
+    {
+        std::lock_guard<std::mutex> guard(matrixFilesLock);
+
+        matrixFiles.erase(fileNameStr);
+    }
+
+    auto gameData = gameDataStore.Get(allGameTables, gameDataGeneration);
+    if (!matrixFile.Create(fileNameStr.c_str(), attackerNums, defenderNums, (long) points.size(), defaultGridTileSize, true)) return &numError;
+    auto storeTile = [&] (const GridTile &tile, const std::vector<BattleResult> &tileResults) {
+        (void) matrixFile.WriteTile(tile.pointNum, tile.firstAttacker, tile.numAttackers, tile.firstDefender, tile.numDefenders, tileResults.data());
+    };
+    workerEndpoints = getenv("BATTLE_SIMULATOR_WORKERS");
+    if (!RunGrid(*gameData, inputs, points, attackerNums, defenderNums, workerEndpoints ? workerEndpoints : "", defaultGridTileSize, nullptr, storeTile,
+                 progress, error)) {
+        (void) matrixFile.Close();
+        return &numError;
+    }
+    if (!matrixFile.Close()) return &numError;
+
+    numMatchups.xltype = xltypeNum;
+    numMatchups.val.num = (double) points.size() * attackerNums.size() * defenderNums.size();
+    return &numMatchups;
+}
+
+
+/* DefenderSpeciesAverage() of a matchup in a matrix file, reading only the tiles of the defender's species */
+LPXLOPER12 WINAPI MatrixSpeciesAverage(LPXLOPER12 fileName, long pointNum, long attackerMoveSetNum, long defenderMoveSetNum)
+{
+#pragma EXPORT
+    RESULTSTORAGE XLOPER12 valueError, naError, average;
+    std::string            fileNameStr;
+
+    valueError.xltype = xltypeErr;
+    valueError.val.err = xlerrValue;
+    naError.xltype = xltypeErr;
+    naError.val.err = xlerrNA;
+
+    if (fileName->xltype != xltypeStr || pointNum < 1) return &valueError;
+    fileNameStr = XLOPER12StrToUTF8(*fileName);
+
+    std::lock_guard<std::mutex> guard(matrixFilesLock);
+
+    auto &matrixFile = matrixFiles[fileNameStr];
+    if (!matrixFile) {
+        matrixFile.reset(new MatrixFileReader);
+        if (!matrixFile->Open(fileNameStr.c_str())) {
+            matrixFiles.erase(fileNameStr);
+            return &valueError;
         }
     }
+    average.xltype = xltypeNum;
+    if (!matrixFile->DefenderSpeciesAverage(pointNum - 1, attackerMoveSetNum, defenderMoveSetNum, average.val.num)) return &naError;
+    return &average;
+}
 
-    FREE(15, &levelsRange, &speciesRange, &moveSetsRange,
-             &attackerFastAttackName, &attackerFastAttackType, &attackerSpecialAttackName, &attackerSpecialAttackType,
-             &defenderFastAttackName, &defenderFastAttackType, &defenderSpecialAttackName, &defenderSpecialAttackType,
-             &attackerType1, &attackerType2, &defenderType1, &defenderType2);
-    delete[] defensiveInitialIntervals;
-    CLOSELOG(logFile);
 
-    /* return probability of attacker winning */
-    return (double) numWins / numTrials;
+void WINAPI xlAutoFree12(LPXLOPER12 operand)
+{
+#pragma EXPORT
+    if (operand->xltype & xltypeMulti) {
+        delete[] operand->val.array.lparray;
+    }
+    delete operand;
+}
+
+
+/* command to write the game tables and inputs of the active workbook to a game data file for the headless driver */
+int WINAPI ExportGameData(void)
+{
+#pragma EXPORT
+    XLOPER12                           workbookName, workbookPath, pathSeparator;
+    std::string                        dataFileNameStr;
+    std::ofstream                      dataFile;
+    BattleInputs                       inputs;
+    std::map<std::string, std::string> inputStrs;
+    GameData                           gameData;
+
+    workbookName = ActiveWorkbookName();
+    workbookPath = ActiveWorkbookPath();
+    pathSeparator = PathSeparator();
+    dataFileNameStr = XLOPER12StrToUTF8(workbookPath) + XLOPER12StrToUTF8(pathSeparator) + XLOPER12StrToUTF8(workbookName);
+    FREE(3, &workbookName, &workbookPath, &pathSeparator);
+    dataFileNameStr.replace(dataFileNameStr.rfind(".xlsm"), 5, " data.txt");
+
+    ReadBattleInputs(inputs);
+    FormatBattleInputs(inputs, inputStrs);
+    LoadGameData(gameData);
+
+    dataFile.open(dataFileNameStr, std::ios::out | std::ios::trunc);
+    if (dataFile.fail()) {
+        MsgBox(L"\036Opening game data file failed.");
+        return 0;
+    }
+    WriteGameData(dataFile, gameData, inputStrs);
+    dataFile.close();
+    return 1;
+}
+
+
+/* command to record every matchup function call of the active workbook to a trace file until StopWorkloadTrace() */
+/* the headless driver replays the trace with the game tables and inputs recorded in it */
+int WINAPI StartWorkloadTrace(void)
+{
+#pragma EXPORT
+    XLOPER12    workbookName, workbookPath, pathSeparator;
+    std::string traceFileNameStr;
+
+    workbookName = ActiveWorkbookName();
+    workbookPath = ActiveWorkbookPath();
+    pathSeparator = PathSeparator();
+    traceFileNameStr = XLOPER12StrToUTF8(workbookPath) + XLOPER12StrToUTF8(pathSeparator) + XLOPER12StrToUTF8(workbookName);
+    FREE(3, &workbookName, &workbookPath, &pathSeparator);
+    traceFileNameStr.replace(traceFileNameStr.rfind(".xlsm"), 5, " trace.bin");
+
+    /* starting again begins a new trace */
+    workloadTrace.Close();
+    if (!workloadTrace.Open(traceFileNameStr.c_str())) {
+        MsgBox(L"\032Opening trace file failed.");
+        return 0;
+    }
+    return 1;
+}
+
+
+/* command to finish the trace started by StartWorkloadTrace() */
+int WINAPI StopWorkloadTrace(void)
+{
+#pragma EXPORT
+    workloadTrace.Close();
+    return 1;
 }
 
 
@@ -996,3 +1917,142 @@ double WINAPI DefenderSpeciesAverage(long attackerMoveSetNum, long defenderMoveS
     FREE(3, &moveSetMatchupsRange, &moveSetMatchupAttackersRange, &moveSetMatchupDefendersArray);
     return matchupSum / matchupCount;
 }
+
+
+/* command to copy the Move Set Matchups sheet into the matchup matrix used by the aggregate functions */
+int WINAPI LoadMatchupMatrix(void)
+{
+#pragma EXPORT
+    XLOPER12            moveSetMatchupsArray;
+    XLOPER12            moveSetMatchupAttackersArray;
+    XLOPER12            moveSetMatchupDefendersArray;
+    XLOPER12            generationName, generation, result;
+    std::vector<long>   attackers, defenders;
+    std::vector<double> probabilities;
+    LPXLOPER12          cell;
+    long                i;
+    bool                valid;
+
+    moveSetMatchupsArray = GetNamedArray(L"\043'Move Set Matchups'!MoveSetMatchups");
+    moveSetMatchupAttackersArray = GetNamedArray(L"\053'Move Set Matchups'!MoveSetMatchupAttackers");
+    moveSetMatchupDefendersArray = GetNamedArray(L"\053'Move Set Matchups'!MoveSetMatchupDefenders");
+    valid = moveSetMatchupsArray.val.array.rows == moveSetMatchupAttackersArray.val.array.rows &&
+            moveSetMatchupsArray.val.array.columns == moveSetMatchupDefendersArray.val.array.columns;
+    for (i = 0, cell = moveSetMatchupAttackersArray.val.array.lparray; valid && i < moveSetMatchupAttackersArray.val.array.rows; ++i, ++cell) {
+        valid = cell->xltype == xltypeNum;
+        attackers.push_back((long) cell->val.num);
+    }
+    for (i = 0, cell = moveSetMatchupDefendersArray.val.array.lparray; valid && i < moveSetMatchupDefendersArray.val.array.columns; ++i, ++cell) {
+        valid = cell->xltype == xltypeNum;
+        defenders.push_back((long) cell->val.num);
+    }
+    for (i = 0, cell = moveSetMatchupsArray.val.array.lparray;
+         valid && i < (long) moveSetMatchupsArray.val.array.rows * moveSetMatchupsArray.val.array.columns; ++i, ++cell) {
+        valid = cell->xltype == xltypeNum;
+        probabilities.push_back(cell->val.num);
+    }
+    FREE(3, &moveSetMatchupsArray, &moveSetMatchupAttackersArray, &moveSetMatchupDefendersArray);
+    if (!valid) {
+        MsgBox(L"\057The Move Set Matchups sheet is not all numbers.");
+        return 0;
+    }
+    auto newMatchupMatrix = std::make_shared<MatchupMatrix>();
+    newMatchupMatrix->Build(attackers, defenders, probabilities);
+    {
+        std::lock_guard<std::mutex> guard(matchupMatrixLock);
+
+        matchupMatrix = newMatchupMatrix;
+    }
+
+    /* redefining the name marks the aggregates that take it as dirty, so they are recalculated with the new matrix */
+    matchupMatrixGeneration += 1.0;
+    generationName.xltype = xltypeStr;
+    generationName.val.str = L"\027MatchupMatrixGeneration";
+    generation.xltype = xltypeNum;
+    generation.val.num = matchupMatrixGeneration;
+    (void) Excel12(xlcDefineName, &result, 2, &generationName, &generation);
+    (void) Excel12(xlcCalculateNow, &result, 0);
+    return 1;
+}
+
+
+/* matrix published by the last LoadMatchupMatrix(), empty before the first */
+std::shared_ptr<const MatchupMatrix> LoadedMatchupMatrix(void)
+{
+    std::lock_guard<std::mutex> guard(matchupMatrixLock);
+
+    return matchupMatrix;
+}
+
+
+/* aggregates return #N/A until LoadMatchupMatrix() has loaded the matchup, and #VALUE! for an unknown function number */
+/* the last argument of each aggregate is the MatchupMatrixGeneration name, which only makes a load recalculate it */
+LPXLOPER12 MatrixAggregateResult(bool found, int statistic, double aggregate)
+{
+    RESULTSTORAGE XLOPER12 valueError, naError, result;
+
+    valueError.xltype = xltypeErr;
+    valueError.val.err = xlerrValue;
+    naError.xltype = xltypeErr;
+    naError.val.err = xlerrNA;
+
+    if (statistic != AverageStatistic && statistic != MaxStatistic && statistic != MinStatistic) return &valueError;
+    if (!found) return &naError;
+    result.xltype = xltypeNum;
+    result.val.num = aggregate;
+    return &result;
+}
+
+
+LPXLOPER12 WINAPI SpeciesAggregate(long attackerMoveSetNum, long defenderMoveSetNum, long functionNum, LPXLOPER12)
+{
+#pragma EXPORT
+    double aggregate;
+    bool   found;
+
+    auto matrix = LoadedMatchupMatrix();
+    found = matrix && matrix->SpeciesAggregate(attackerMoveSetNum, defenderMoveSetNum, functionNum, aggregate);
+    return MatrixAggregateResult(found, functionNum, aggregate);
+}
+
+
+LPXLOPER12 WINAPI AttackerAggregate(long attackerMoveSetNum, long functionNum, LPXLOPER12)
+{
+#pragma EXPORT
+    double aggregate;
+    bool   found;
+
+    auto matrix = LoadedMatchupMatrix();
+    found = matrix && matrix->AttackerAggregate(attackerMoveSetNum, functionNum, aggregate);
+    return MatrixAggregateResult(found, functionNum, aggregate);
+}
+
+
+LPXLOPER12 WINAPI DefenderAggregate(long defenderMoveSetNum, long functionNum, LPXLOPER12)
+{
+#pragma EXPORT
+    double aggregate;
+    bool   found;
+
+    auto matrix = LoadedMatchupMatrix();
+    found = matrix && matrix->DefenderAggregate(defenderMoveSetNum, functionNum, aggregate);
+    return MatrixAggregateResult(found, functionNum, aggregate);
+}
+
+
+LPXLOPER12 WINAPI WeightedAttackerAverage(long attackerMoveSetNum, LPXLOPER12 weights, LPXLOPER12)
+{
+#pragma EXPORT
+    RESULTSTORAGE XLOPER12 valueError;
+    std::vector<double>    weightNumbers;
+    double                 average;
+    bool                   found;
+
+    valueError.xltype = xltypeErr;
+    valueError.val.err = xlerrValue;
+
+    if (!ArgumentNumbers(*weights, weightNumbers)) return &valueError;
+    auto matrix = LoadedMatchupMatrix();
+    found = matrix && matrix->WeightedAttackerAverage(attackerMoveSetNum, weightNumbers, average);
+    return MatrixAggregateResult(found, AverageStatistic, average);
+}
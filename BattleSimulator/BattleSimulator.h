@@ -6,6 +6,14 @@
 #define THREADSAFE 0
 
 
+/* storage class of values returned to Excel by pointer */
+#if THREADSAFE
+#define RESULTSTORAGE static thread_local
+#else
+#define RESULTSTORAGE static
+#endif
+
+
 /* include or exclude log code */
 #define LOG 0
 
@@ -0,0 +1,301 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BattleEngine.h"
+#include "BattleResolver.h"
+#include "GameData.h"
+
+#include "Checkpoint.h"
+
+
+/* "BSCHKPT\0" */
+const unsigned long long checkpointMagic = 0x0054504B48435342ULL;
+
+/* the settings in the header are the inputs from Randomness to NumQMCRandomizations */
+const int firstSettingInput = RandomnessInput;
+const int numSettingWords = NumQMCRandomizationsInput - RandomnessInput + 1;
+const int numHeaderWords = 4 + numSettingWords;
+
+/* wins, trials, win probability, standard error, and engine */
+const int numCheckpointResultWords = 5;
+
+
+JobHash::JobHash(void)
+{
+    hash = 14695981039346656037ULL;
+}
+
+
+void JobHash::Add(const void *bytes, size_t numBytes)
+{
+    size_t i;
+
+    for (i = 0; i < numBytes; ++i) {
+        hash = (hash ^ ((const unsigned char *) bytes)[i]) * 1099511628211ULL;
+    }
+}
+
+
+/* game data and inputs are hashed in their exported form, which has every value that affects a result */
+void JobHash::AddGameData(const GameData &gameData, const BattleInputs &inputs)
+{
+    std::ostringstream                 stream;
+    std::map<std::string, std::string> inputStrs;
+    std::string                        text;
+
+    FormatBattleInputs(inputs, inputStrs);
+    WriteGameData(stream, gameData, inputStrs);
+    text = stream.str();
+    Add(text.data(), text.size());
+}
+
+
+unsigned long long JobHash::Value(void) const
+{
+    return hash;
+}
+
+
+inline void PutWord(std::vector<unsigned char> &bytes, unsigned long long word)
+{
+    int i;
+
+    for (i = 0; i < 8; ++i) {
+        bytes.push_back((unsigned char) (word >> (8 * i)));
+    }
+}
+
+
+inline void PutWord(std::vector<unsigned char> &bytes, double number)
+{
+    unsigned long long word;
+
+    memcpy(&word, &number, sizeof word);
+    PutWord(bytes, word);
+}
+
+
+/* returns false at the end of the file */
+inline bool GetWord(FILE *file, unsigned long long &word)
+{
+    unsigned char bytes[8];
+    int           i;
+
+    if (fread(bytes, 1, sizeof bytes, file) != sizeof bytes) return false;
+    word = 0;
+    for (i = 0; i < 8; ++i) {
+        word |= (unsigned long long) bytes[i] << (8 * i);
+    }
+    return true;
+}
+
+
+/* checkpoints of large jobs pass 2 GB, which ftell cannot report on Windows */
+inline unsigned long long FilePosition(FILE *file)
+{
+#ifdef _WIN32
+    return (unsigned long long) _ftelli64(file);
+#else
+    return (unsigned long long) ftello(file);
+#endif
+}
+
+
+inline double WordDouble(unsigned long long word)
+{
+    double number;
+
+    memcpy(&number, &word, sizeof number);
+    return number;
+}
+
+
+unsigned long long RecordChecksum(const unsigned char *bytes, size_t numBytes)
+{
+    JobHash recordHash;
+
+    recordHash.Add(bytes, numBytes);
+    return recordHash.Value();
+}
+
+
+void EncodeTile(const CheckpointTile &tile, std::vector<unsigned char> &bytes)
+{
+    size_t recordStart;
+
+    recordStart = bytes.size();
+    PutWord(bytes, (unsigned long long) tile.tileId);
+    PutWord(bytes, (unsigned long long) tile.results.size());
+    for (auto &result : tile.results) {
+        PutWord(bytes, (unsigned long long) result.numWins);
+        PutWord(bytes, (unsigned long long) result.numTrials);
+        PutWord(bytes, result.winProbability);
+        PutWord(bytes, result.standardError);
+        PutWord(bytes, (unsigned long long) result.engine);
+    }
+    PutWord(bytes, RecordChecksum(bytes.data() + recordStart, bytes.size() - recordStart));
+}
+
+
+/* returns false at the end of the file or at a record cut short by a crash */
+bool ReadTile(FILE *file, long long numTiles, CheckpointTile &tile)
+{
+    std::vector<unsigned char> bytes;
+    unsigned long long         words[numCheckpointResultWords], numResults, checksum;
+    size_t                     i;
+    int                        j;
+
+    if (!GetWord(file, words[0]) || !GetWord(file, numResults)) return false;
+    if (words[0] >= (unsigned long long) numTiles || numResults > (unsigned long long) maxCheckpointTileResults) return false;
+    tile.tileId = (long long) words[0];
+    PutWord(bytes, words[0]);
+    PutWord(bytes, numResults);
+    tile.results.resize(numResults);
+    for (i = 0; i < numResults; ++i) {
+        for (j = 0; j < numCheckpointResultWords; ++j) {
+            if (!GetWord(file, words[j])) return false;
+            PutWord(bytes, words[j]);
+        }
+        tile.results[i].numWins = (long) words[0];
+        tile.results[i].numTrials = (long) words[1];
+        tile.results[i].winProbability = WordDouble(words[2]);
+        tile.results[i].standardError = WordDouble(words[3]);
+        tile.results[i].engine = (int) words[4];
+    }
+    return GetWord(file, checksum) && checksum == RecordChecksum(bytes.data(), bytes.size());
+}
+
+
+CheckpointFile::CheckpointFile(void)
+{
+    file = nullptr;
+    closed = true;
+}
+
+
+CheckpointFile::~CheckpointFile(void)
+{
+    Close();
+}
+
+
+/* restore the tiles of an existing checkpoint of the same job, or start a new one */
+/* returns false if the file cannot be written or is a checkpoint of another job */
+bool CheckpointFile::Open(const char *fileName, unsigned long long jobHash, long long numTiles, const BattleInputs &inputs,
+                          const RestoreTileCallback &restoreTile, std::string &error)
+{
+    std::vector<unsigned char> header;
+    unsigned long long         word;
+    CheckpointTile             tile;
+    unsigned long long         validSize;
+    int                        i;
+
+    PutWord(header, checkpointMagic);
+    PutWord(header, checkpointVersion);
+    PutWord(header, jobHash);
+    PutWord(header, (unsigned long long) numTiles);
+    for (i = 0; i < numSettingWords; ++i) {
+        PutWord(header, inputs.values[firstSettingInput + i]);
+    }
+
+    file = fopen(fileName, "r+b");
+    if (file) {
+        for (i = 0; i < numHeaderWords; ++i) {
+            if (!GetWord(file, word) || memcmp(&word, header.data() + 8 * i, 8) != 0) break;
+        }
+        if (i < numHeaderWords) {
+            /* never overwrite someone else's results */
+            fclose(file);
+            file = nullptr;
+            error = std::string(fileName) + " is a checkpoint of another job or of different game data.";
+            return false;
+        }
+
+        /* keep every whole record and drop a partly written last one */
+        validSize = FilePosition(file);
+        while (ReadTile(file, numTiles, tile)) {
+            if (!restoreTile(tile.tileId, tile.results)) break;
+            validSize = FilePosition(file);
+        }
+        fclose(file);
+        std::filesystem::resize_file(fileName, validSize);
+        file = fopen(fileName, "ab");
+    } else {
+        file = fopen(fileName, "wb");
+        if (file && fwrite(header.data(), 1, header.size(), file) != header.size()) {
+            fclose(file);
+            file = nullptr;
+        }
+    }
+    if (!file) {
+        error = std::string("Writing ") + fileName + " failed.";
+        return false;
+    }
+
+    closed = false;
+    writer = std::thread(&CheckpointFile::WriteTiles, this);
+    return true;
+}
+
+
+/* queue a finished tile, the writer thread saves it within the checkpoint interval */
+void CheckpointFile::Append(long long tileId, const BattleResult *results, long numResults)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    assert(numResults <= maxCheckpointTileResults);
+    if (closed) return;
+    pendingTiles.emplace_back();
+    pendingTiles.back().tileId = tileId;
+    pendingTiles.back().results.assign(results, results + numResults);
+}
+
+
+void CheckpointFile::WriteTiles(void)
+{
+    std::vector<CheckpointTile> tiles;
+    std::vector<unsigned char>  bytes;
+    bool                        done;
+
+    do {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+
+            done = closing.wait_for(guard, std::chrono::seconds(checkpointInterval), [this] { return closed; });
+            tiles.swap(pendingTiles);
+        }
+        bytes.clear();
+        for (auto &tile : tiles) {
+            EncodeTile(tile, bytes);
+        }
+        tiles.clear();
+        if (!bytes.empty()) {
+            (void) fwrite(bytes.data(), 1, bytes.size(), file);
+            (void) fflush(file);
+        }
+    } while (!done);
+}
+
+
+/* write the tiles still queued and close the file */
+void CheckpointFile::Close(void)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        if (closed) return;
+        closed = true;
+    }
+    closing.notify_one();
+    writer.join();
+    fclose(file);
+    file = nullptr;
+}
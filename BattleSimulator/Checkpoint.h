@@ -0,0 +1,81 @@
+#pragma once
+
+
+#include <stdio.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BattleEngine.h"
+#include "BattleResolver.h"
+#include "GameData.h"
+
+
+/* checkpoints are arrays of 64-bit little-endian words: */
+/*     header: magic, version, job hash, number of tiles, simulation settings */
+/*     one record per finished tile: tile id, number of results, 5 words per result, checksum */
+
+/* change whenever the file layout changes */
+const unsigned long long checkpointVersion = 2;
+
+/* seconds between writes of finished tiles */
+const int checkpointInterval = 1;
+
+/* largest tile, a whole sweep block or grid tile */
+const long maxCheckpointTileResults = 1 << 16;
+
+
+/* FNV-1a hash of everything that determines the results of a batch job */
+class JobHash {
+public:
+                       JobHash      (void);
+
+    void               Add          (const void *bytes, size_t numBytes);
+
+    void               AddGameData  (const GameData &gameData, const BattleInputs &inputs);
+
+    unsigned long long Value        (void) const;
+
+private:
+    unsigned long long hash;
+};
+
+
+/* called with each tile read back from a checkpoint, returns false if the tile does not belong to the job */
+typedef std::function<bool (long long tileId, const std::vector<BattleResult> &results)> RestoreTileCallback;
+
+
+struct CheckpointTile {
+    long long                 tileId;
+    std::vector<BattleResult> results;
+};
+
+
+/* file of finished tiles, written by its own thread so compute threads only queue them */
+class CheckpointFile {
+public:
+                  CheckpointFile  (void);
+
+                  ~CheckpointFile (void);
+
+    bool          Open            (const char *fileName, unsigned long long jobHash, long long numTiles, const BattleInputs &inputs,
+                                   const RestoreTileCallback &restoreTile, std::string &error);
+
+    void          Append          (long long tileId, const BattleResult *results, long numResults);
+
+    void          Close           (void);
+
+private:
+    void          WriteTiles      (void);
+
+    FILE                        *file;
+    std::thread                 writer;
+    std::mutex                  lock;
+    std::condition_variable     closing;
+    std::vector<CheckpointTile> pendingTiles;
+    bool                        closed;
+};
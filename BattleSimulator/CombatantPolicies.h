@@ -0,0 +1,182 @@
+#pragma once
+
+
+#include "BattleEngine.h"
+#include "TrialSampler.h"
+
+
+/* a combatant policy decides whether a combatant starting an attack uses its special attack */
+/* engines are instantiated for each pair of policies, so the decision is inlined into the inner loop */
+/* policies are started at the beginning of every battle and may keep state until the next one */
+/* a combatant without the energy for its special attack must make a fast attack, and the engine may skip asking then */
+
+
+/* attacker uses its special attack as soon as it has the energy */
+class GreedyAttacker {
+public:
+    inline void StartBattle(const BattleParameters &parameters)
+    {
+        specialAttackEnergy = -parameters.attackerSpecialAttackEnergy;
+    }
+
+    inline bool StartsSpecialAttack(int energy)
+    {
+        return energy >= specialAttackEnergy;
+    }
+
+private:
+    int specialAttackEnergy;
+};
+
+
+/* spends energy in runs of special attacks once another fast attack would waste energy or the energy for the most special attacks is banked */
+class EnergyBanker {
+public:
+    inline void Start(int specialAttackEnergy, int fastAttackEnergy, int maxEnergy)
+    {
+        this->specialAttackEnergy = specialAttackEnergy;
+        this->fastAttackEnergy = fastAttackEnergy;
+        this->maxEnergy = maxEnergy;
+        bankedEnergy = (specialAttackEnergy > 0) ? maxEnergy / specialAttackEnergy * specialAttackEnergy : 0;
+        spending = false;
+    }
+
+    inline bool StartsSpecialAttack(int energy)
+    {
+        if (energy < specialAttackEnergy) {
+            spending = false;
+            return false;
+        }
+        if (!spending && energy < bankedEnergy && energy + fastAttackEnergy <= maxEnergy) return false;
+        spending = true;
+        return true;
+    }
+
+private:
+    int  specialAttackEnergy, fastAttackEnergy, maxEnergy;
+    int  bankedEnergy;
+    bool spending;
+};
+
+
+/* attacker banks energy and then uses its special attacks back to back */
+class EnergyBankingAttacker {
+public:
+    inline void StartBattle(const BattleParameters &parameters)
+    {
+        banker.Start(-parameters.attackerSpecialAttackEnergy, parameters.attackerFastAttackEnergy, parameters.maxAttackerEnergy);
+    }
+
+    inline bool StartsSpecialAttack(int energy)
+    {
+        return banker.StartsSpecialAttack(energy);
+    }
+
+private:
+    EnergyBanker banker;
+};
+
+
+/* defender AI of gym battles, which defers special attacks a fixed number of times or at random */
+class StandardDefender {
+public:
+    inline void StartBattle(const BattleParameters &parameters)
+    {
+        randomness = parameters.randomness;
+        specialAttackEnergy = -parameters.defenderSpecialAttackEnergy;
+        numSpecialAttackDeferrals = parameters.numDefensiveSpecialAttackDeferrals;
+        specialAttackProbability = parameters.defensiveSpecialAttackProbability;
+        numSpecialAttackOpportunities = 0;
+    }
+
+    inline bool StartsSpecialAttack(int energy, TrialSampler &sampler)
+    {
+        if (energy < specialAttackEnergy) return false;
+        if (randomness) {
+            /* random behavior */
+            return sampler.Deferral() > specialAttackProbability;
+        } else {
+            /* expected behavior */
+            numSpecialAttackOpportunities = numSpecialAttackOpportunities + 1;
+            if (numSpecialAttackOpportunities <= numSpecialAttackDeferrals) return false;
+            numSpecialAttackOpportunities = 0;
+            return true;
+        }
+    }
+
+private:
+    bool   randomness;
+    int    specialAttackEnergy;
+    int    numSpecialAttackDeferrals;
+    double specialAttackProbability;
+    int    numSpecialAttackOpportunities;
+};
+
+
+/* defender that never defers special attacks */
+class GreedyDefender {
+public:
+    inline void StartBattle(const BattleParameters &parameters)
+    {
+        specialAttackEnergy = -parameters.defenderSpecialAttackEnergy;
+    }
+
+    inline bool StartsSpecialAttack(int energy, TrialSampler &)
+    {
+        return energy >= specialAttackEnergy;
+    }
+
+private:
+    int specialAttackEnergy;
+};
+
+
+/* defender that banks energy and then uses its special attacks back to back */
+class EnergyBankingDefender {
+public:
+    inline void StartBattle(const BattleParameters &parameters)
+    {
+        banker.Start(-parameters.defenderSpecialAttackEnergy, parameters.defenderFastAttackEnergy, parameters.maxDefenderEnergy);
+    }
+
+    inline bool StartsSpecialAttack(int energy, TrialSampler &)
+    {
+        return banker.StartsSpecialAttack(energy);
+    }
+
+private:
+    EnergyBanker banker;
+};
+
+
+template <class AttackerPolicy, class Simulate>
+inline void DispatchDefenderPolicy(AttackerPolicy attacker, int defenderPolicy, Simulate &simulate)
+{
+    switch (defenderPolicy) {
+    case GreedyDefenderPolicy:
+        simulate(attacker, GreedyDefender());
+        break;
+    case EnergyBankingDefenderPolicy:
+        simulate(attacker, EnergyBankingDefender());
+        break;
+    default:
+        simulate(attacker, StandardDefender());
+        break;
+    }
+}
+
+
+/* call simulate with an attacker and a defender policy of the selected types */
+/* simulate is a generic lambda that passes the types of its arguments on to an engine template */
+template <class Simulate>
+inline void DispatchPolicies(int attackerPolicy, int defenderPolicy, Simulate simulate)
+{
+    switch (attackerPolicy) {
+    case EnergyBankingAttackerPolicy:
+        DispatchDefenderPolicy(EnergyBankingAttacker(), defenderPolicy, simulate);
+        break;
+    default:
+        DispatchDefenderPolicy(GreedyAttacker(), defenderPolicy, simulate);
+        break;
+    }
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+
+/* cost model of the engine planner, written by "BattleSimulator calibrate" on the build machine */
+/* regenerate after changing either engine or moving to other hardware */
+const double monteCarloSecondsPerEvent = 2.24e-08;
+const double exactSecondsPerState = 6.26e-07;
+const double exactStatesPerPointDraw = 6.28;
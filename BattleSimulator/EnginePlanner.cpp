@@ -0,0 +1,90 @@
+#include <math.h>
+
+#include <algorithm>
+#include <fstream>
+
+#include "BattleEngine.h"
+#include "EngineCalibration.h"
+#include "StrategySolver.h"
+#include "TaskScheduler.h"
+
+#include "EnginePlanner.h"
+
+
+const char *engineNames[numBattleEngines] = {
+    "MonteCarlo",
+    "Exact"
+};
+
+
+/* the solver's states grow with each draw of a defender interval times the points the interval is split into */
+double NumPointDraws(const BattleParameters &parameters)
+{
+    double numIntervalPoints, defenderCycle;
+
+    numIntervalPoints = parameters.randomness ? parameters.defensiveIntervalRandomness + 1.0 : 1.0;
+    defenderCycle = std::max(parameters.defenderFastAttackDuration + parameters.defensiveInterval, 1);
+    return numIntervalPoints * (parameters.numDefensiveInitialIntervals + EstimateBattleTime(parameters) / defenderCycle);
+}
+
+
+double PredictExactStates(const BattleParameters &parameters)
+{
+    return exactStatesPerPointDraw * NumPointDraws(parameters);
+}
+
+
+void PlanBattleEngine(const BattleParameters &parameters, EnginePlan &plan)
+{
+    double numStates;
+
+    plan.engine = MonteCarloEngine;
+    plan.monteCarloSeconds = EstimateBattleCost(parameters) * monteCarloSecondsPerEvent;
+    plan.exactSeconds = HUGE_VAL;
+
+    /* random intervals are only exact with a point for every millisecond of randomness */
+    if (parameters.attackerPolicy != GreedyAttackerPolicy || parameters.defenderPolicy != StandardDefenderPolicy) return;
+    if (parameters.randomness && parameters.defensiveIntervalRandomness + 1 > maxIntervalPoints) return;
+    numStates = PredictExactStates(parameters);
+    if (numStates > maxSolverStates) return;
+
+    plan.exactSeconds = numStates * exactSecondsPerState;
+    if (plan.exactSeconds < plan.monteCarloSeconds) {
+        plan.engine = ExactEngine;
+    }
+}
+
+
+bool SolveExactBattles(const BattleParameters &parameters, BattleResult &result)
+{
+    double winProbability;
+    long   numStates;
+
+    StrategySolver solver(parameters, WinProbabilityObjective, parameters.randomness ? parameters.defensiveIntervalRandomness + 1 : 1);
+
+    if (!solver.SolveGreedy(winProbability, numStates)) return false;
+    result.numWins = lround(winProbability * parameters.numTrials);
+    result.numTrials = parameters.numTrials;
+    result.winProbability = winProbability;
+    result.standardError = 0.0;
+    result.engine = ExactEngine;
+    return true;
+}
+
+
+void EvaluateBattles(const BattleParameters &parameters, std::ofstream &logFile, BattleResult &result)
+{
+    EnginePlan plan;
+
+    if (parameters.enginePlanning && !logFile.is_open()) {
+        PlanBattleEngine(parameters, plan);
+        if (plan.engine == ExactEngine && SolveExactBattles(parameters, result)) return;
+    }
+    SimulateBattles(parameters, logFile, result);
+}
+
+
+const char *EngineName(int engine)
+{
+    return (engine >= 0 && engine < numBattleEngines) ? engineNames[engine] : "";
+}
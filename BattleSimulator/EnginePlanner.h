@@ -0,0 +1,35 @@
+#pragma once
+
+
+#include <fstream>
+
+#include "BattleEngine.h"
+
+
+/* engine chosen for a matchup and the predicted seconds each engine would take */
+/* engines that cannot reach the accuracy of the requested trials are predicted to take forever */
+struct EnginePlan {
+    int    engine;
+    double monteCarloSeconds, exactSeconds;
+};
+
+
+/* number of defender interval draws in a battle times the points each is split into by the exact solver */
+double      NumPointDraws      (const BattleParameters &parameters);
+
+/* rough number of states the exact solver visits for a matchup */
+double      PredictExactStates (const BattleParameters &parameters);
+
+/* pick the cheapest engine for a matchup from the calibrated cost model */
+/* the exact solver is only eligible for the greedy attacker and the standard defender with intervals it splits exactly */
+void        PlanBattleEngine   (const BattleParameters &parameters, EnginePlan &plan);
+
+/* win probability of the greedy attacker from the exact solver, counted as the requested number of trials */
+/* returns false if the solver cannot solve the matchup */
+bool        SolveExactBattles  (const BattleParameters &parameters, BattleResult &result);
+
+/* evaluate a matchup with the planned engine, or simulate it when planning is off or battles are logged */
+/* falls back to simulating if the exact solver runs out of states */
+void        EvaluateBattles    (const BattleParameters &parameters, std::ofstream &logFile, BattleResult &result);
+
+const char *EngineName         (int engine);
@@ -6,27 +6,15 @@
 
 EventQueue::EventQueue(void)
 {
-    queue = nullptr;
     numEntries = 0;
     maxEntries = 0;
 }
 
 
-EventQueue::~EventQueue(void)
-{
-    delete[] queue;
-}
-
-
 void EventQueue::Initialize(int numInitialIntervals)
 {
-    if (maxEntries != numInitialIntervals * 2 + 1) {
-        maxEntries = numInitialIntervals * 2 + 1;
-        if (queue) {
-            delete[] queue;
-        }
-        queue = new EventRecord[maxEntries];
-    }
+    assert(numInitialIntervals <= numDefensiveInitialIntervalInputs);
+    maxEntries = numInitialIntervals * 2 + 1;
     queue[0].time = INT_MAX;
     queue[0].event = NullEvent;
     numEntries = 0;
@@ -87,3 +75,93 @@ PlayerEvents EventQueue::Pop(void)
     assert(numEntries >= 0);
     return event;
 }
+
+
+/* time until the first event that lands damage or starts an attack */
+/* an attack that finishes starts the next one no sooner than the shortest interval later */
+int EventQueue::QuietTime(int minInterval)
+{
+    int quietTime;
+    int i;
+
+    quietTime = INT_MAX;
+    for (i = 0; i < numEntries; ++i) {
+        switch (queue[i].event) {
+        case PlayerFinishesFastAttack:
+        case PlayerFinishesSpecialAttack:
+            if (queue[i].time + minInterval < quietTime) quietTime = queue[i].time + minInterval;
+            break;
+        case PlayerFinishesInitialFastAttack:
+        case PlayerFinishesInitialSpecialAttack:
+        case PlayerFinishesTransform:
+            break;
+        default:
+            return (queue[i].time < quietTime) ? queue[i].time : quietTime;
+        }
+    }
+    return quietTime;
+}
+
+
+/* number of events by the given time that land damage or start an attack that will */
+int EventQueue::NumAttacks(int time)
+{
+    int numAttacks;
+    int i;
+
+    numAttacks = 0;
+    for (i = 0; i < numEntries && queue[i].time <= time; ++i) {
+        switch (queue[i].event) {
+        case PlayerStartsAttack:
+        case PlayerStartsInitialAttack:
+        case PlayerStartsTransform:
+        case PlayerLandsFastAttack:
+        case PlayerLandsSpecialAttack:
+        case PlayerLandsTransform:
+            ++numAttacks;
+            break;
+        default:
+            break;
+        }
+    }
+    return numAttacks;
+}
+
+
+/* number of events that certainly land damage before the given time, if attacks land at most maxLanding after they start */
+/* an attack that finishes starts the next one no later than maxInterval later, and those start at most maxCycle apart */
+int EventQueue::NumLandings(int time, int maxLanding, int maxInterval, int maxCycle)
+{
+    int numLandings;
+    int nextStart;
+    int i;
+
+    numLandings = 0;
+    nextStart = INT_MAX;
+    for (i = 0; i < numEntries; ++i) {
+        switch (queue[i].event) {
+        case PlayerLandsFastAttack:
+        case PlayerLandsSpecialAttack:
+        case PlayerLandsTransform:
+            if (queue[i].time < time) ++numLandings;
+            break;
+        case PlayerStartsInitialAttack:
+        case PlayerStartsTransform:
+            if (queue[i].time < time - maxLanding) ++numLandings;
+            break;
+        case PlayerStartsAttack:
+            nextStart = queue[i].time;
+            break;
+        case PlayerFinishesFastAttack:
+        case PlayerFinishesSpecialAttack:
+            nextStart = queue[i].time + maxInterval;
+            break;
+        default:
+            break;
+        }
+    }
+    if (nextStart < time - maxLanding) {
+        numLandings += (time - 1 - maxLanding - nextStart) / maxCycle + 1;
+    }
+    return numLandings;
+}
@@ -1,15 +1,19 @@
 #pragma once
 
 
+#include "BattleEngine.h"
 #include "BattleSimulator.h"
 
 
+/* most events in a queue, those of the defender's initial intervals and one more */
+const int maxEventQueueEntries = 2 * numDefensiveInitialIntervalInputs + 1;
+
+
+/* events are kept inline in time order and followed by a sentinel, so battles never allocate */
 class EventQueue {
 public:
                  EventQueue  (void);
 
-                 ~EventQueue (void);
-
     void         Initialize  (int numInitialIntervals);
 
     int          Timer       (void);
@@ -20,8 +24,14 @@ public:
 
     PlayerEvents Pop         (void);
 
+    int          QuietTime   (int minInterval);
+
+    int          NumAttacks  (int time);
+
+    int          NumLandings (int time, int maxLanding, int maxInterval, int maxCycle);
+
 private:
-    EventRecord *queue;
+    EventRecord queue[maxEventQueueEntries + 1];
     int         numEntries;
     int         maxEntries;
 };
@@ -0,0 +1,349 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "GameData.h"
+
+
+void GameData::Clear(void)
+{
+    species.clear();
+    moveSets.clear();
+    fastAttacks.clear();
+    cpMultipliers.clear();
+    attackingTypes.clear();
+    defendingTypes.clear();
+    typeMatchups.clear();
+    speciesIndex.clear();
+    moveSetIndex.clear();
+    fastAttackIndex.clear();
+}
+
+
+/* rebuild the lookup indexes after the tables change */
+void GameData::Index(void)
+{
+    size_t i;
+
+    speciesIndex.clear();
+    for (i = 0; i < species.size(); ++i) {
+        speciesIndex[species[i].pokedexNum] = i;
+    }
+    moveSetIndex.clear();
+    for (i = 0; i < moveSets.size(); ++i) {
+        moveSetIndex[moveSets[i].moveSetNum] = i;
+    }
+    fastAttackIndex.clear();
+    for (i = 0; i < fastAttacks.size(); ++i) {
+        fastAttackIndex[fastAttacks[i].moveNum] = i;
+    }
+}
+
+
+const SpeciesRecord *GameData::FindSpecies(int pokedexNum) const
+{
+    auto entry = speciesIndex.find(pokedexNum);
+
+    return (entry == speciesIndex.end()) ? nullptr : &species[entry->second];
+}
+
+
+const MoveSetRecord *GameData::FindMoveSet(long moveSetNum) const
+{
+    auto entry = moveSetIndex.find(moveSetNum);
+
+    return (entry == moveSetIndex.end()) ? nullptr : &moveSets[entry->second];
+}
+
+
+const FastAttackRecord *GameData::FindFastAttack(long moveNum) const
+{
+    auto entry = fastAttackIndex.find(moveNum);
+
+    return (entry == fastAttackIndex.end()) ? nullptr : &fastAttacks[entry->second];
+}
+
+
+/* returns 0 if the level is not in the levels table */
+double GameData::CPMultiplier(double level) const
+{
+    auto entry = cpMultipliers.find(level);
+
+    return (entry == cpMultipliers.end()) ? 0.0 : entry->second;
+}
+
+
+int GameData::AttackingType(const std::string &typeName) const
+{
+    size_t i;
+
+    for (i = 0; i < attackingTypes.size(); ++i) {
+        if (attackingTypes[i] == typeName) return (int) i;
+    }
+    return noType;
+}
+
+
+int GameData::DefendingType(const std::string &typeName) const
+{
+    size_t i;
+
+    for (i = 0; i < defendingTypes.size(); ++i) {
+        if (defendingTypes[i] == typeName) return (int) i;
+    }
+    return noType;
+}
+
+
+double GameData::TypeEffectiveness(int attackType, int defenderType1, int defenderType2) const
+{
+    double effectiveness;
+
+    assert(attackType != noType && defenderType1 != noType);
+    effectiveness = typeMatchups[attackType * defendingTypes.size() + defenderType1];
+    if (defenderType2 != noType) {
+        effectiveness *= typeMatchups[attackType * defendingTypes.size() + defenderType2];
+    }
+    return effectiveness;
+}
+
+
+/* game data file sections, written in this order because the tables refer to the types */
+const char *gameDataSections[] = {
+    "[Inputs]",
+    "[AttackingTypes]",
+    "[DefendingTypes]",
+    "[TypeMatchups]",
+    "[Levels]",
+    "[Species]",
+    "[FastAttacks]",
+    "[MoveSets]"
+};
+
+
+enum GameDataSections {
+    InputsSection,
+    AttackingTypesSection,
+    DefendingTypesSection,
+    TypeMatchupsSection,
+    LevelsSection,
+    SpeciesSection,
+    FastAttacksSection,
+    MoveSetsSection,
+    numGameDataSections
+};
+
+
+void SplitFields(const std::string &line, std::vector<std::string> &fields)
+{
+    size_t start, end;
+
+    fields.clear();
+    start = 0;
+    do {
+        end = line.find('\t', start);
+        fields.push_back(line.substr(start, (end == std::string::npos) ? std::string::npos : end - start));
+        start = end + 1;
+    } while (end != std::string::npos);
+}
+
+
+bool ParseNumber(const std::string &field, double &number)
+{
+    char *end;
+
+    number = strtod(field.c_str(), &end);
+    return end != field.c_str() && *end == '\0';
+}
+
+
+bool ParseInteger(const std::string &field, long &number)
+{
+    char *end;
+
+    number = strtol(field.c_str(), &end, 10);
+    return end != field.c_str() && *end == '\0';
+}
+
+
+bool ParseAttack(const GameData &gameData, const std::vector<std::string> &fields, size_t firstField, AttackRecord &attack)
+{
+    long power, energy, damageStart, duration;
+
+    attack.name = fields[firstField];
+    attack.type = gameData.AttackingType(fields[firstField + 1]);
+    if (attack.type == noType) return false;
+    if (!ParseInteger(fields[firstField + 2], power) || !ParseInteger(fields[firstField + 3], energy) ||
+        !ParseInteger(fields[firstField + 4], damageStart) || !ParseInteger(fields[firstField + 5], duration) ||
+        !ParseNumber(fields[firstField + 6], attack.stab)) return false;
+    attack.power = (int) power;
+    attack.energy = (int) energy;
+    attack.damageStart = (int) damageStart;
+    attack.duration = (int) duration;
+    return true;
+}
+
+
+/* read game data and raw input values from a tab-separated game data file */
+/* returns false if the file is malformed */
+bool ReadGameData(std::istream &stream, GameData &gameData, std::map<std::string, std::string> &inputs)
+{
+    std::string              line;
+    std::vector<std::string> fields;
+    int                      section;
+    int                      i;
+    double                   number1, number2;
+    long                     integer;
+    SpeciesRecord            speciesRecord;
+    FastAttackRecord         fastAttackRecord;
+    MoveSetRecord            moveSetRecord;
+
+    gameData.Clear();
+    section = -1;
+    while (std::getline(stream, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+            line.erase(line.size() - 1);
+        }
+        if (line.empty()) continue;
+
+        /* section header */
+        if (line[0] == '[') {
+            for (section = 0; section < numGameDataSections; ++section) {
+                if (line == gameDataSections[section]) break;
+            }
+            if (section == numGameDataSections) return false;
+            continue;
+        }
+
+        SplitFields(line, fields);
+        switch (section) {
+        case InputsSection:
+            if (fields.size() != 2) return false;
+            inputs[fields[0]] = fields[1];
+            break;
+        case AttackingTypesSection:
+            gameData.attackingTypes.push_back(fields[0]);
+            break;
+        case DefendingTypesSection:
+            gameData.defendingTypes.push_back(fields[0]);
+            break;
+        case TypeMatchupsSection:
+            if (fields.size() != gameData.defendingTypes.size()) return false;
+            for (i = 0; i < (int) fields.size(); ++i) {
+                if (!ParseNumber(fields[i], number1)) return false;
+                gameData.typeMatchups.push_back(number1);
+            }
+            break;
+        case LevelsSection:
+            if (fields.size() != 2 || !ParseNumber(fields[0], number1) || !ParseNumber(fields[1], number2)) return false;
+            gameData.cpMultipliers[number1] = number2;
+            break;
+        case SpeciesSection:
+            if (fields.size() != 7 || !ParseInteger(fields[0], integer)) return false;
+            speciesRecord.pokedexNum = (int) integer;
+            speciesRecord.name = fields[1];
+            speciesRecord.type1 = gameData.DefendingType(fields[2]);
+            speciesRecord.type2 = fields[3].empty() ? noType : gameData.DefendingType(fields[3]);
+            if (speciesRecord.type1 == noType || (!fields[3].empty() && speciesRecord.type2 == noType)) return false;
+            if (!ParseNumber(fields[4], speciesRecord.baseStamina) || !ParseNumber(fields[5], speciesRecord.baseAttack) ||
+                !ParseNumber(fields[6], speciesRecord.baseDefense)) return false;
+            gameData.species.push_back(speciesRecord);
+            break;
+        case FastAttacksSection:
+            if (fields.size() != 5 || !ParseInteger(fields[0], fastAttackRecord.moveNum)) return false;
+            if (!ParseInteger(fields[1], integer)) return false;
+            fastAttackRecord.power = (int) integer;
+            if (!ParseInteger(fields[2], integer)) return false;
+            fastAttackRecord.energy = (int) integer;
+            if (!ParseInteger(fields[3], integer)) return false;
+            fastAttackRecord.damageStart = (int) integer;
+            if (!ParseInteger(fields[4], integer)) return false;
+            fastAttackRecord.duration = (int) integer;
+            gameData.fastAttacks.push_back(fastAttackRecord);
+            break;
+        case MoveSetsSection:
+            if (fields.size() != 15 || !ParseInteger(fields[0], moveSetRecord.moveSetNum)) return false;
+            if (!ParseAttack(gameData, fields, 1, moveSetRecord.fastAttack) || !ParseAttack(gameData, fields, 8, moveSetRecord.specialAttack)) return false;
+            gameData.moveSets.push_back(moveSetRecord);
+            break;
+        default:
+            return false;
+        }
+    }
+    if (gameData.typeMatchups.size() != gameData.attackingTypes.size() * gameData.defendingTypes.size()) return false;
+    gameData.Index();
+    return true;
+}
+
+
+void WriteAttack(std::ostream &stream, const GameData &gameData, const AttackRecord &attack)
+{
+    stream << attack.name << '\t' << gameData.attackingTypes[attack.type] << '\t' << attack.power << '\t' << attack.energy << '\t'
+           << attack.damageStart << '\t' << attack.duration << '\t' << attack.stab;
+}
+
+
+/* write game data and raw input values as a tab-separated game data file */
+void WriteGameData(std::ostream &stream, const GameData &gameData, const std::map<std::string, std::string> &inputs)
+{
+    std::streamsize precision;
+    size_t          i, j;
+
+    /* enough digits to read back the same doubles */
+    precision = stream.precision(17);
+
+    stream << gameDataSections[InputsSection] << '\n';
+    for (auto &input : inputs) {
+        stream << input.first << '\t' << input.second << '\n';
+    }
+
+    stream << gameDataSections[AttackingTypesSection] << '\n';
+    for (i = 0; i < gameData.attackingTypes.size(); ++i) {
+        stream << gameData.attackingTypes[i] << '\n';
+    }
+    stream << gameDataSections[DefendingTypesSection] << '\n';
+    for (i = 0; i < gameData.defendingTypes.size(); ++i) {
+        stream << gameData.defendingTypes[i] << '\n';
+    }
+    stream << gameDataSections[TypeMatchupsSection] << '\n';
+    for (i = 0; i < gameData.attackingTypes.size(); ++i) {
+        for (j = 0; j < gameData.defendingTypes.size(); ++j) {
+            stream << ((j == 0) ? "" : "\t") << gameData.typeMatchups[i * gameData.defendingTypes.size() + j];
+        }
+        stream << '\n';
+    }
+
+    stream << gameDataSections[LevelsSection] << '\n';
+    for (auto &level : gameData.cpMultipliers) {
+        stream << level.first << '\t' << level.second << '\n';
+    }
+
+    stream << gameDataSections[SpeciesSection] << '\n';
+    for (auto &speciesRecord : gameData.species) {
+        stream << speciesRecord.pokedexNum << '\t' << speciesRecord.name << '\t' << gameData.defendingTypes[speciesRecord.type1] << '\t'
+               << ((speciesRecord.type2 == noType) ? "" : gameData.defendingTypes[speciesRecord.type2]) << '\t'
+               << speciesRecord.baseStamina << '\t' << speciesRecord.baseAttack << '\t' << speciesRecord.baseDefense << '\n';
+    }
+
+    stream << gameDataSections[FastAttacksSection] << '\n';
+    for (auto &fastAttackRecord : gameData.fastAttacks) {
+        stream << fastAttackRecord.moveNum << '\t' << fastAttackRecord.power << '\t' << fastAttackRecord.energy << '\t'
+               << fastAttackRecord.damageStart << '\t' << fastAttackRecord.duration << '\n';
+    }
+
+    stream << gameDataSections[MoveSetsSection] << '\n';
+    for (auto &moveSetRecord : gameData.moveSets) {
+        stream << moveSetRecord.moveSetNum << '\t';
+        WriteAttack(stream, gameData, moveSetRecord.fastAttack);
+        stream << '\t';
+        WriteAttack(stream, gameData, moveSetRecord.specialAttack);
+        stream << '\n';
+    }
+
+    stream.precision(precision);
+}
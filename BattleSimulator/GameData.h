@@ -0,0 +1,98 @@
+#pragma once
+
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/* type index of a missing second type */
+const int noType = -1;
+
+
+/* bits of the game tables, which can be loaded one at a time */
+/* species and move sets name their types, so they need the type matchups */
+enum GameTables {
+    TypeMatchupsTable = 1,
+    LevelsTable = 2,
+    SpeciesTable = 4,
+    FastAttacksTable = 8,
+    MoveSetsTable = 16,
+    allGameTables = 31
+};
+
+
+/* row of Species!Species */
+struct SpeciesRecord {
+    int         pokedexNum;
+    std::string name;
+    int         type1, type2;
+    double      baseStamina, baseAttack, baseDefense;
+};
+
+
+/* attack columns of 'Move Sets'!MoveSets */
+struct AttackRecord {
+    std::string name;
+    int         type;
+    int         power, energy, damageStart, duration;
+    double      stab;
+};
+
+
+/* row of 'Move Sets'!MoveSets */
+struct MoveSetRecord {
+    long         moveSetNum;
+    AttackRecord fastAttack, specialAttack;
+};
+
+
+/* row of 'Fast Attacks'!FastAttacks */
+struct FastAttackRecord {
+    long moveNum;
+    int  power, energy, damageStart, duration;
+};
+
+
+/* game tables of the workbook in the simulator's internal representation */
+/* species types index the defending types and attack types index the attacking types of the type matchups */
+class GameData {
+public:
+    std::vector<SpeciesRecord>    species;
+    std::vector<MoveSetRecord>    moveSets;
+    std::vector<FastAttackRecord> fastAttacks;
+    std::map<double, double>      cpMultipliers;
+    std::vector<std::string>      attackingTypes, defendingTypes;
+    std::vector<double>           typeMatchups;
+
+    void                    Clear              (void);
+
+    void                    Index              (void);
+
+    const SpeciesRecord    *FindSpecies        (int pokedexNum) const;
+
+    const MoveSetRecord    *FindMoveSet        (long moveSetNum) const;
+
+    const FastAttackRecord *FindFastAttack     (long moveNum) const;
+
+    double                  CPMultiplier       (double level) const;
+
+    int                     AttackingType      (const std::string &typeName) const;
+
+    int                     DefendingType      (const std::string &typeName) const;
+
+    double                  TypeEffectiveness  (int attackType, int defenderType1, int defenderType2) const;
+
+private:
+    std::unordered_map<int, size_t>  speciesIndex;
+    std::unordered_map<long, size_t> moveSetIndex;
+    std::unordered_map<long, size_t> fastAttackIndex;
+};
+
+
+bool ReadGameData  (std::istream &stream, GameData &gameData, std::map<std::string, std::string> &inputs);
+
+void WriteGameData (std::ostream &stream, const GameData &gameData, const std::map<std::string, std::string> &inputs);
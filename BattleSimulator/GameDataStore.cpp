@@ -0,0 +1,103 @@
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "GameData.h"
+
+#include "GameDataStore.h"
+
+
+GameDataStore::GameDataStore(const GameTableLoader &load, const GameTableStamp &stamp)
+    : load(load), stamp(stamp)
+{
+    gameData = std::make_shared<GameData>();
+    loadedTables = 0;
+    generation = 1;
+    tablesStamped = false;
+    tableShapeStamp = 0;
+    tableStamp = 0;
+}
+
+
+/* game data with at least the given tables, loading the missing ones */
+/* callers keep the snapshot they got even if the tables are invalidated while they use it */
+std::shared_ptr<const GameData> GameDataStore::Get(int tables, unsigned long &generation)
+{
+    std::shared_ptr<GameData> newGameData;
+    unsigned long             loadGeneration;
+    int                       missingTables;
+
+    /* species and move sets are read with the types they name */
+    if (tables & (SpeciesTable | MoveSetsTable)) tables |= TypeMatchupsTable;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        if ((loadedTables & tables) == tables) {
+            generation = this->generation;
+            return gameData;
+        }
+    }
+
+    /* one load at a time, callers whose tables are loaded meanwhile do not wait for it */
+    std::lock_guard<std::mutex> loadGuard(loadLock);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        if ((loadedTables & tables) == tables) {
+            generation = this->generation;
+            return gameData;
+        }
+        newGameData = std::make_shared<GameData>(*gameData);
+        missingTables = tables & ~loadedTables;
+        loadGeneration = this->generation;
+    }
+    load(missingTables, *newGameData);
+    newGameData->Index();
+    if (!tablesStamped) {
+        tableShapeStamp = stamp(false);
+        tableStamp = stamp(true);
+        tablesStamped = true;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    /* tables invalidated during the load are not kept, but this caller still gets what it loaded */
+    if (loadGeneration == this->generation) {
+        gameData = newGameData;
+        loadedTables |= missingTables;
+    }
+    generation = loadGeneration;
+    return newGameData;
+}
+
+
+/* forget every table, called when the game tables are edited */
+void GameDataStore::Invalidate(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    gameData = std::make_shared<GameData>();
+    loadedTables = 0;
+    ++generation;
+    tablesStamped = false;
+}
+
+
+/* forget every table if the stamp of the tables changed since they were loaded, called when a recalculation ends */
+/* a moved or resized table is found without reading a cell, and nothing is read while no table is loaded */
+void GameDataStore::CheckTables(void)
+{
+    /* no table is loaded while the stamp is taken */
+    std::lock_guard<std::mutex> loadGuard(loadLock);
+
+    if (!tablesStamped) return;
+    if (stamp(false) != tableShapeStamp || stamp(true) != tableStamp) Invalidate();
+}
+
+
+unsigned long GameDataStore::Generation(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    return generation;
+}
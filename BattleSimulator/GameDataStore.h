@@ -0,0 +1,44 @@
+#pragma once
+
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "GameData.h"
+
+
+/* copies the given game tables into the game data */
+typedef std::function<void (int tables, GameData &gameData)> GameTableLoader;
+
+/* checksum of where the game tables are and their size, and with cells, of every cell too */
+typedef std::function<unsigned long long (bool cells)> GameTableStamp;
+
+
+/* game tables loaded once and shared by every function until the tables change */
+/* tables are loaded when first needed, so a function only waits for the tables it uses */
+/* the generation counts the changes, results computed from an older generation are stale */
+/* the tables are stamped when first loaded, and CheckTables() finds edits by comparing the stamp again */
+class GameDataStore {
+public:
+                                    GameDataStore (const GameTableLoader &load, const GameTableStamp &stamp);
+
+    std::shared_ptr<const GameData> Get           (int tables, unsigned long &generation);
+
+    void                            Invalidate    (void);
+
+    void                            CheckTables   (void);
+
+    unsigned long                   Generation    (void);
+
+private:
+    GameTableLoader                 load;
+    GameTableStamp                  stamp;
+    std::mutex                      lock, loadLock;
+    std::shared_ptr<const GameData> gameData;
+    int                             loadedTables;
+    unsigned long                   generation;
+    std::atomic<bool>               tablesStamped;
+    unsigned long long              tableShapeStamp, tableStamp;
+};
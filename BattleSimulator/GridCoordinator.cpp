@@ -0,0 +1,384 @@
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BattleEngine.h"
+#include "BattleResolver.h"
+#include "Checkpoint.h"
+#include "GameData.h"
+#include "MatchupCache.h"
+#include "ParameterSweep.h"
+#include "Socket.h"
+#include "WorkerProtocol.h"
+
+#include "GridCoordinator.h"
+
+
+/* tiles sent to one worker before waiting for its first reply, so it is never idle between tiles */
+const int gridTilesInFlight = 2;
+
+
+/* tiles not yet handed out, and the number of tiles not yet finished */
+class TileQueue {
+public:
+                TileQueue (void);
+
+    void        Add       (const GridTile &tile);
+
+    void        Push      (const GridTile &tile);
+
+    bool        Pop       (GridTile &tile);
+
+    bool        TryPop    (GridTile &tile);
+
+    void        Finish    (void);
+
+    void        Abort     (void);
+
+private:
+    std::deque<GridTile>    tiles;
+    long                    numUnfinished;
+    std::mutex              lock;
+    std::condition_variable changed;
+};
+
+
+TileQueue::TileQueue(void)
+{
+    numUnfinished = 0;
+}
+
+
+/* add a tile that has not been handed out yet */
+void TileQueue::Add(const GridTile &tile)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    tiles.push_back(tile);
+    ++numUnfinished;
+}
+
+
+/* give back an unfinished tile */
+void TileQueue::Push(const GridTile &tile)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        tiles.push_back(tile);
+    }
+    changed.notify_one();
+}
+
+
+/* wait for a tile while other workers may still give theirs back */
+/* returns false once every tile is finished */
+bool TileQueue::Pop(GridTile &tile)
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    changed.wait(guard, [this] { return !tiles.empty() || numUnfinished <= 0; });
+    if (tiles.empty()) return false;
+    tile = tiles.front();
+    tiles.pop_front();
+    return true;
+}
+
+
+/* returns false if no tile is waiting */
+bool TileQueue::TryPop(GridTile &tile)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (tiles.empty()) return false;
+    tile = tiles.front();
+    tiles.pop_front();
+    return true;
+}
+
+
+void TileQueue::Finish(void)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        --numUnfinished;
+    }
+    changed.notify_all();
+}
+
+
+/* stop every worker after an error */
+void TileQueue::Abort(void)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        tiles.clear();
+        numUnfinished = 0;
+    }
+    changed.notify_all();
+}
+
+
+/* everything the workers of a grid share */
+struct GridJob {
+    const GameData            *gameData;
+    const std::vector<long>   *attackerMoveSetNums, *defenderMoveSetNums;
+    std::vector<BattleInputs> pointInputs;
+    std::vector<double>       attackerCPMultipliers, defenderCPMultipliers;
+    const GridTileCallback    *storeTile;
+    std::mutex                storeLock;
+    CheckpointFile            checkpoint;
+    TileQueue                 tileQueue;
+    std::atomic<long>         numReassignedTiles;
+    std::atomic<bool>         failed;
+};
+
+
+/* returns false if a matchup of the tile is not in the game data */
+bool ResolveTile(const GridJob &job, const GridTile &tile, std::vector<BattleParameters> &parameters)
+{
+    MatchupData matchupData;
+    size_t      i, j;
+
+    parameters.resize(tile.numAttackers * tile.numDefenders);
+    for (i = 0; i < tile.numAttackers; ++i) {
+        for (j = 0; j < tile.numDefenders; ++j) {
+            if (!ResolveMatchupData(*job.gameData, (*job.attackerMoveSetNums)[tile.firstAttacker + i], (*job.defenderMoveSetNums)[tile.firstDefender + j],
+                                    matchupData)) {
+                return false;
+            }
+            ResolveBattleParameters(matchupData, job.pointInputs[tile.pointNum], job.attackerCPMultipliers[tile.pointNum],
+                                    job.defenderCPMultipliers[tile.pointNum], parameters[i * tile.numDefenders + j]);
+        }
+    }
+    return true;
+}
+
+
+void StoreTile(GridJob &job, const GridTile &tile, const std::vector<BattleResult> &tileResults)
+{
+    std::lock_guard<std::mutex> guard(job.storeLock);
+
+    (*job.storeTile)(tile, tileResults);
+}
+
+
+/* receive one tile reply, returns false if the worker went away or sent a bad message */
+bool ReceiveTile(SocketHandle socket, unsigned long long &tileId, std::vector<BattleResult> &tileResults)
+{
+    std::vector<unsigned char> reply;
+    long                       numMatchups;
+
+    reply.resize(tileHeaderSize);
+    if (!ReceiveBytes(socket, reply.data(), tileHeaderSize) || MessageType(reply.data()) != TileReplyMessage) return false;
+    numMatchups = TileMatchups(reply.data());
+    if (numMatchups < 0) return false;
+    reply.resize(TileReplySize(numMatchups));
+    if (!ReceiveBytes(socket, reply.data() + tileHeaderSize, reply.size() - tileHeaderSize)) return false;
+    return DecodeTileReply(reply, tileId, tileResults);
+}
+
+
+/* hand tiles to one worker until none are left, giving its unfinished tiles back if it goes away */
+void RunGridWorker(GridJob &job, SocketHandle socket, long &numWorkerTiles)
+{
+    std::map<unsigned long long, GridTile> tilesInFlight;
+    std::vector<BattleParameters>          parameters;
+    std::vector<BattleResult>              tileResults;
+    std::vector<unsigned char>             request;
+    GridTile                               tile;
+    unsigned long long                     tileId;
+    bool                                   alive;
+
+    alive = true;
+    while (alive) {
+        /* keep the worker busy, but only wait for new tiles when it has nothing to do */
+        while (alive && (int) tilesInFlight.size() < gridTilesInFlight &&
+               (tilesInFlight.empty() ? job.tileQueue.Pop(tile) : job.tileQueue.TryPop(tile))) {
+            if (!ResolveTile(job, tile, parameters)) {
+                job.failed = true;
+                job.tileQueue.Abort();
+                return;
+            }
+            EncodeTileRequest(tile.tileId, parameters, request);
+            tilesInFlight[tile.tileId] = tile;
+            alive = SendBytes(socket, request.data(), request.size());
+        }
+        if (tilesInFlight.empty()) break;
+
+        if (alive && ReceiveTile(socket, tileId, tileResults)) {
+            auto inFlight = tilesInFlight.find(tileId);
+            if (inFlight == tilesInFlight.end() ||
+                tileResults.size() != inFlight->second.numAttackers * inFlight->second.numDefenders) {
+                alive = false;
+                continue;
+            }
+            StoreTile(job, inFlight->second, tileResults);
+            job.checkpoint.Append(tileId, tileResults.data(), (long) tileResults.size());
+            tilesInFlight.erase(inFlight);
+            ++numWorkerTiles;
+            job.tileQueue.Finish();
+        } else {
+            alive = false;
+        }
+    }
+
+    for (auto &inFlight : tilesInFlight) {
+        ++job.numReassignedTiles;
+        job.tileQueue.Push(inFlight.second);
+    }
+}
+
+
+bool RunGrid(const GameData &gameData, const BattleInputs &inputs, const std::vector<SweepPoint> &points,
+             const std::vector<long> &attackerMoveSetNums, const std::vector<long> &defenderMoveSetNums, const std::string &workers, long tileSize,
+             const char *checkpointFileName, const GridTileCallback &storeTile, GridProgress &progress, std::string &error)
+{
+    GridJob                       job;
+    GridTile                      tile;
+    std::vector<GridTile>         tiles;
+    std::vector<bool>             tilesDone;
+    JobHash                       jobHash;
+    MatchupData                   matchupData;
+    std::vector<SocketHandle>     sockets;
+    std::vector<std::thread>      threads;
+    std::vector<BattleParameters> parameters, uniqueParameters;
+    std::vector<BattleResult>     tileResults, uniqueResults;
+    std::vector<size_t>           uniqueResultNums;
+    MatchupCache                  gridCache;
+    BattleKey                     key;
+    std::string                   endpoint;
+    SocketHandle                  socket;
+    size_t                        numAttackers, numDefenders, pointNum, start, end, colon, i;
+    int                           j;
+
+    numAttackers = attackerMoveSetNums.size();
+    numDefenders = defenderMoveSetNums.size();
+    if (numAttackers == 0 || numDefenders == 0 || points.empty() || tileSize < 1 || tileSize > maxGridTileSize) return false;
+    if (numAttackers > (size_t) maxGridResults / numDefenders || points.size() > (size_t) maxGridResults / (numAttackers * numDefenders)) return false;
+
+    /* every move set must resolve before any tile is handed out */
+    for (i = 0; i < numAttackers; ++i) {
+        if (!ResolveMatchupData(gameData, attackerMoveSetNums[i], defenderMoveSetNums[0], matchupData)) return false;
+    }
+    for (i = 0; i < numDefenders; ++i) {
+        if (!ResolveMatchupData(gameData, attackerMoveSetNums[0], defenderMoveSetNums[i], matchupData)) return false;
+    }
+
+    /* look up levels once per point */
+    job.gameData = &gameData;
+    job.attackerMoveSetNums = &attackerMoveSetNums;
+    job.defenderMoveSetNums = &defenderMoveSetNums;
+    job.pointInputs.assign(points.size(), inputs);
+    job.attackerCPMultipliers.resize(points.size());
+    job.defenderCPMultipliers.resize(points.size());
+    for (pointNum = 0; pointNum < points.size(); ++pointNum) {
+        for (j = 0; j < numSweepInputs; ++j) {
+            job.pointInputs[pointNum].values[sweepInputIds[j]] = points[pointNum].values[j];
+        }
+        job.attackerCPMultipliers[pointNum] = gameData.CPMultiplier(points[pointNum].values[AttackerLevelSweep]);
+        job.defenderCPMultipliers[pointNum] = gameData.CPMultiplier(points[pointNum].values[DefenderLevelSweep]);
+        if (job.attackerCPMultipliers[pointNum] == 0.0 || job.defenderCPMultipliers[pointNum] == 0.0) return false;
+    }
+
+    job.storeTile = &storeTile;
+    job.numReassignedTiles = 0;
+    job.failed = false;
+
+    /* shard the grid, one sweep point at a time */
+    tile.tileId = 0;
+    for (tile.pointNum = 0; tile.pointNum < points.size(); ++tile.pointNum) {
+        for (tile.firstAttacker = 0; tile.firstAttacker < numAttackers; tile.firstAttacker += tileSize) {
+            tile.numAttackers = std::min((size_t) tileSize, numAttackers - tile.firstAttacker);
+            for (tile.firstDefender = 0; tile.firstDefender < numDefenders; tile.firstDefender += tileSize) {
+                tile.numDefenders = std::min((size_t) tileSize, numDefenders - tile.firstDefender);
+                tiles.push_back(tile);
+                ++tile.tileId;
+            }
+        }
+    }
+    progress.numTiles = (long) tiles.size();
+
+    /* tiles finished by an earlier run of the same grid are read back instead of simulated */
+    tilesDone.assign(tiles.size(), false);
+    progress.numRestoredTiles = 0;
+    if (checkpointFileName) {
+        jobHash.Add("grid", 4);
+        jobHash.AddGameData(gameData, inputs);
+        jobHash.Add(points.data(), points.size() * sizeof points[0]);
+        jobHash.Add(attackerMoveSetNums.data(), numAttackers * sizeof attackerMoveSetNums[0]);
+        jobHash.Add(defenderMoveSetNums.data(), numDefenders * sizeof defenderMoveSetNums[0]);
+        jobHash.Add(&tileSize, sizeof tileSize);
+        auto restoreTile = [&] (long long tileId, const std::vector<BattleResult> &tileResults) {
+            if (tileResults.size() != tiles[tileId].numAttackers * tiles[tileId].numDefenders) return false;
+            StoreTile(job, tiles[tileId], tileResults);
+            if (!tilesDone[tileId]) ++progress.numRestoredTiles;
+            tilesDone[tileId] = true;
+            return true;
+        };
+        if (!job.checkpoint.Open(checkpointFileName, jobHash.Value(), (long long) tiles.size(), inputs, restoreTile, error)) return false;
+    }
+    for (i = 0; i < tiles.size(); ++i) {
+        if (!tilesDone[i]) job.tileQueue.Add(tiles[i]);
+    }
+
+    /* one thread per worker that could be reached */
+    if (StartSockets()) {
+        for (start = 0; start < workers.size(); start = end + 1) {
+            end = workers.find(',', start);
+            if (end == std::string::npos) end = workers.size();
+            endpoint = workers.substr(start, end - start);
+            colon = endpoint.rfind(':');
+            if (colon == std::string::npos) continue;
+            socket = ConnectSocket(endpoint.substr(0, colon).c_str(), atoi(endpoint.c_str() + colon + 1));
+            if (socket != invalidSocket) sockets.push_back(socket);
+        }
+    }
+    progress.workerTiles.assign(sockets.size(), 0);
+    for (i = 0; i < sockets.size(); ++i) {
+        threads.emplace_back(RunGridWorker, std::ref(job), sockets[i], std::ref(progress.workerTiles[i]));
+    }
+    for (i = 0; i < sockets.size(); ++i) {
+        threads[i].join();
+        CloseSocket(sockets[i]);
+    }
+    if (job.failed) return false;
+
+    /* tiles no worker could take, sharing results across tiles like a worker does */
+    progress.numLocalTiles = 0;
+    while (job.tileQueue.TryPop(tile)) {
+        if (!ResolveTile(job, tile, parameters)) return false;
+        tileResults.resize(parameters.size());
+        uniqueParameters.clear();
+        uniqueResultNums.clear();
+        for (i = 0; i < parameters.size(); ++i) {
+            MakeBattleKey(parameters[i], key);
+            if (!gridCache.Find(key, tileResults[i])) {
+                uniqueParameters.push_back(parameters[i]);
+                uniqueResultNums.push_back(i);
+            }
+        }
+        uniqueResults.resize(uniqueParameters.size());
+        SimulateUniqueBattles(uniqueParameters.data(), (long) uniqueParameters.size(), uniqueResults.data(), (int) std::thread::hardware_concurrency());
+        for (i = 0; i < uniqueParameters.size(); ++i) {
+            tileResults[uniqueResultNums[i]] = uniqueResults[i];
+            MakeBattleKey(uniqueParameters[i], key);
+            gridCache.Insert(key, uniqueResults[i]);
+        }
+        StoreTile(job, tile, tileResults);
+        job.checkpoint.Append(tile.tileId, tileResults.data(), (long) tileResults.size());
+        ++progress.numLocalTiles;
+    }
+    progress.numReassignedTiles = job.numReassignedTiles;
+    return true;
+}
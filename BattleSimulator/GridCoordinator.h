@@ -0,0 +1,56 @@
+#pragma once
+
+
+#include <stddef.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "BattleEngine.h"
+#include "BattleResolver.h"
+#include "GameData.h"
+#include "ParameterSweep.h"
+
+
+/* attackers and defenders of a square block of the grid at one sweep point, the unit of work handed to a worker */
+struct GridTile {
+    unsigned long long tileId;
+    size_t             pointNum;
+    size_t             firstAttacker, numAttackers;
+    size_t             firstDefender, numDefenders;
+};
+
+
+/* largest tile side, so a tile fits in one worker message */
+const long maxGridTileSize = 256;
+
+/* big enough that workers spend far longer simulating a tile than receiving it */
+const long defaultGridTileSize = 64;
+
+/* grids are streamed out a tile at a time, so they can be much larger than a sweep held in memory */
+const long long maxGridResults = 1LL << 36;
+
+
+/* called with each finished tile and its results, attacker rows of defender columns */
+/* calls are serialized, but come from whichever thread finished the tile */
+typedef std::function<void (const GridTile &tile, const std::vector<BattleResult> &results)> GridTileCallback;
+
+
+/* where the tiles of a grid were simulated */
+struct GridProgress {
+    long              numTiles;
+    long              numRestoredTiles;
+    long              numReassignedTiles;
+    long              numLocalTiles;
+    std::vector<long> workerTiles;
+};
+
+
+/* simulate every attacker versus every defender at every sweep point on a comma separated list of host:port workers */
+/* tiles of dead workers go to the others, and are simulated in process if none is left */
+/* with a checkpoint file, finished tiles are saved as they come in and a rerun of the same grid only simulates the missing ones */
+/* tiles are passed to storeTile as they finish, restored tiles first */
+bool RunGrid (const GameData &gameData, const BattleInputs &inputs, const std::vector<SweepPoint> &points,
+              const std::vector<long> &attackerMoveSetNums, const std::vector<long> &defenderMoveSetNums, const std::string &workers, long tileSize,
+              const char *checkpointFileName, const GridTileCallback &storeTile, GridProgress &progress, std::string &error);
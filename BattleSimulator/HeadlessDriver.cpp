@@ -0,0 +1,1312 @@
+/* command line driver for running simulations outside Excel on game data exported from the workbook */
+/* built from the portable sources only, without XLCALL.H or Windows.h */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BattleResolver.h"
+#include "EngineCalibration.h"
+#include "EnginePlanner.h"
+#include "GameData.h"
+#include "GridCoordinator.h"
+#include "MatchupCache.h"
+#include "MatrixFile.h"
+#include "ParameterSweep.h"
+#include "RaidEngine.h"
+#include "RandomStream.h"
+#include "ReferenceEngine.h"
+#include "StrategySolver.h"
+#include "TaskScheduler.h"
+#include "TeamEngine.h"
+#include "SimulationWorker.h"
+#include "WorkerPool.h"
+#include "WorkloadTrace.h"
+
+
+const char *battleInputErrorMessages[] = {
+    "",
+    "Monte Carlo simulations require randomness.",
+    "Antithetic trials require an even number of trials.",
+    "Quasi-Monte Carlo trials cannot be antithetic.",
+    "Quasi-Monte Carlo trials must divide evenly into randomizations.",
+    "Unknown attacker or defender policy."
+};
+
+
+/* count the heap allocations of each thread with a replacement operator new, for trace benchmark builds only */
+/* every other command would pay for the count on each allocation */
+#ifndef COUNTALLOCATIONS
+#define COUNTALLOCATIONS 0
+#endif
+
+
+#if COUNTALLOCATIONS
+/* heap allocations made by the calling thread, so benchmarks can show the evaluation path makes none */
+thread_local unsigned long long numThreadAllocations = 0;
+
+
+void *operator new(size_t size)
+{
+    void *memory;
+
+    ++numThreadAllocations;
+    memory = malloc((size > 0) ? size : 1);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+#endif
+
+
+/* heap allocations made by the calling thread so far, always 0 unless they are counted */
+inline unsigned long long ThreadAllocations(void)
+{
+#if COUNTALLOCATIONS
+    return numThreadAllocations;
+#else
+    return 0;
+#endif
+}
+
+
+void PrintUsage(void)
+{
+    fprintf(stderr, "usage: BattleSimulator sweep <game data file> <sweep file> <output file> [threads] [checkpoint file]\n"
+                    "       BattleSimulator grid <game data file> <sweep file> <output file or .matrix file> <host:port,...> [tile size] [checkpoint file]\n"
+                    "       BattleSimulator worker <port> [threads] [listen address]\n"
+                    "       BattleSimulator replay <game data file> <sweep file> <host:port,...>\n"
+                    "       BattleSimulator query <matrix file> <point> <attacker move set> <defender move set>\n"
+                    "       BattleSimulator stats <game data file> <attacker move set> <defender move set>\n"
+                    "       BattleSimulator solve <game data file> <attacker move set> <defender move set> [win|time] [interval points]\n"
+                    "       BattleSimulator raid <game data file> <boss move set> <party swap delay> <relobby delay> <relobbies> <move set,...> ...\n"
+                    "       BattleSimulator team <game data file> <attacker move set,...> <defender move set,...>\n"
+                    "       BattleSimulator calibrate <game data file> <sweep file> <header file>\n"
+                    "       BattleSimulator trace <trace file> [threads]\n"
+                    "       BattleSimulator verify <game data file> [matchups] [seed] [threads]\n");
+}
+
+
+/* read game data and inputs exported from the workbook */
+bool LoadGameDataFile(const char *fileName, GameData &gameData, BattleInputs &inputs)
+{
+    std::ifstream                      dataFile;
+    std::map<std::string, std::string> inputStrs;
+    BattleInputErrors                  inputError;
+
+    dataFile.open(fileName);
+    if (dataFile.fail()) {
+        fprintf(stderr, "Opening %s failed.\n", fileName);
+        return false;
+    }
+    if (!ReadGameData(dataFile, gameData, inputStrs)) {
+        fprintf(stderr, "%s is not a valid game data file.\n", fileName);
+        return false;
+    }
+    DefaultBattleInputs(inputs);
+    if (!ParseBattleInputs(inputStrs, inputs)) {
+        fprintf(stderr, "%s has an invalid input value.\n", fileName);
+        return false;
+    }
+    inputError = CheckBattleInputs(inputs);
+    if (inputError != NoInputError) {
+        fprintf(stderr, "%s\n", battleInputErrorMessages[inputError]);
+        return false;
+    }
+    return true;
+}
+
+
+/* read sweep ranges and matchups, one per line: */
+/*     <sweep input name> <first> <last> <step> */
+/*     matchup <attacker move set num> <defender move set num> */
+/*     attackers <move set num> ... */
+/*     defenders <move set num> ... */
+/* inputs that are not swept keep their values from the game data file */
+bool ReadSweepFile(const char *fileName, const BattleInputs &inputs, SweepRange ranges[numSweepInputs], std::vector<Matchup> &matchups,
+                   std::vector<long> &attackerMoveSetNums, std::vector<long> &defenderMoveSetNums)
+{
+    std::ifstream      sweepFile;
+    std::string        line, name;
+    std::istringstream lineStream;
+    Matchup            matchup;
+    SweepRange         range;
+    long               moveSetNum;
+    int                i;
+
+    for (i = 0; i < numSweepInputs; ++i) {
+        ranges[i].first = inputs.values[sweepInputIds[i]];
+        ranges[i].last = ranges[i].first;
+        ranges[i].step = 0.0;
+    }
+    matchups.clear();
+    attackerMoveSetNums.clear();
+    defenderMoveSetNums.clear();
+
+    sweepFile.open(fileName);
+    if (sweepFile.fail()) {
+        fprintf(stderr, "Opening %s failed.\n", fileName);
+        return false;
+    }
+    while (std::getline(sweepFile, line)) {
+        lineStream.clear();
+        lineStream.str(line);
+        if (!(lineStream >> name) || name[0] == '#') continue;
+        if (name == "matchup") {
+            if (!(lineStream >> matchup.attackerMoveSetNum >> matchup.defenderMoveSetNum)) {
+                fprintf(stderr, "%s has an invalid line: %s\n", fileName, line.c_str());
+                return false;
+            }
+            matchups.push_back(matchup);
+            continue;
+        }
+        if (name == "attackers" || name == "defenders") {
+            while (lineStream >> moveSetNum) {
+                ((name == "attackers") ? attackerMoveSetNums : defenderMoveSetNums).push_back(moveSetNum);
+            }
+            if (!lineStream.eof()) {
+                fprintf(stderr, "%s has an invalid line: %s\n", fileName, line.c_str());
+                return false;
+            }
+            continue;
+        }
+        for (i = 0; i < numSweepInputs; ++i) {
+            if (name == battleInputInfo[sweepInputIds[i]].name) break;
+        }
+        if (i == numSweepInputs || !(lineStream >> range.first >> range.last >> range.step)) {
+            fprintf(stderr, "%s has an invalid line: %s\n", fileName, line.c_str());
+            return false;
+        }
+        ranges[i] = range;
+    }
+    return true;
+}
+
+
+int Sweep(int argc, char *argv[])
+{
+    GameData                  gameData;
+    BattleInputs              inputs;
+    SweepRange                ranges[numSweepInputs];
+    std::vector<Matchup>      matchups;
+    std::vector<long>         attackerMoveSetNums, defenderMoveSetNums;
+    std::vector<SweepPoint>   points;
+    std::vector<BattleResult> results;
+    Matchup                   matchup;
+    int                       numThreads;
+    const char                *checkpointFileName;
+    std::string               error;
+    FILE                      *outputFile;
+    size_t                    pointNum, matchupNum;
+    const BattleResult        *result;
+    int                       i;
+
+    if (argc < 5 || argc > 7) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    numThreads = (argc >= 6) ? atoi(argv[5]) : (int) std::thread::hardware_concurrency();
+    if (numThreads < 1) numThreads = 1;
+    checkpointFileName = (argc == 7) ? argv[6] : nullptr;
+
+    if (!LoadGameDataFile(argv[2], gameData, inputs)) return EXIT_FAILURE;
+    if (!ReadSweepFile(argv[3], inputs, ranges, matchups, attackerMoveSetNums, defenderMoveSetNums)) return EXIT_FAILURE;
+    /* every listed attacker versus every listed defender */
+    for (auto attackerMoveSetNum : attackerMoveSetNums) {
+        for (auto defenderMoveSetNum : defenderMoveSetNums) {
+            matchup.attackerMoveSetNum = attackerMoveSetNum;
+            matchup.defenderMoveSetNum = defenderMoveSetNum;
+            matchups.push_back(matchup);
+        }
+    }
+    if (!MakeSweepPoints(ranges, points)) {
+        fprintf(stderr, "The sweep ranges are invalid or too large.\n");
+        return EXIT_FAILURE;
+    }
+    if (!RunSweep(gameData, inputs, points, matchups, numThreads, checkpointFileName, results, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    outputFile = fopen(argv[4], "w");
+    if (!outputFile) {
+        fprintf(stderr, "Opening %s failed.\n", argv[4]);
+        return EXIT_FAILURE;
+    }
+    /* one row per grid point and matchup */
+    for (i = 0; i < numSweepInputs; ++i) {
+        fprintf(outputFile, "%s,", battleInputInfo[sweepInputIds[i]].name);
+    }
+    fprintf(outputFile, "AttackerMoveSetNum,DefenderMoveSetNum,WinProbability,StandardError,Engine\n");
+    result = results.data();
+    for (pointNum = 0; pointNum < points.size(); ++pointNum) {
+        for (matchupNum = 0; matchupNum < matchups.size(); ++matchupNum, ++result) {
+            for (i = 0; i < numSweepInputs; ++i) {
+                fprintf(outputFile, "%g,", points[pointNum].values[i]);
+            }
+            fprintf(outputFile, "%ld,%ld,%.17g,%.17g,%s\n", matchups[matchupNum].attackerMoveSetNum, matchups[matchupNum].defenderMoveSetNum,
+                    result->winProbability, result->standardError, EngineName(result->engine));
+        }
+    }
+    fclose(outputFile);
+    return EXIT_SUCCESS;
+}
+
+
+/* write every result of a grid as CSV, one row per point and matchup */
+bool WriteGridCSV(const char *fileName, const std::vector<SweepPoint> &points, const std::vector<long> &attackerMoveSetNums,
+                  const std::vector<long> &defenderMoveSetNums, const std::vector<BattleResult> &results)
+{
+    FILE               *outputFile;
+    size_t             pointNum, attackerNum, defenderNum;
+    const BattleResult *result;
+    int                i;
+
+    outputFile = fopen(fileName, "w");
+    if (!outputFile) {
+        fprintf(stderr, "Opening %s failed.\n", fileName);
+        return false;
+    }
+    /* same rows as a sweep of the grid's matchups */
+    for (i = 0; i < numSweepInputs; ++i) {
+        fprintf(outputFile, "%s,", battleInputInfo[sweepInputIds[i]].name);
+    }
+    fprintf(outputFile, "AttackerMoveSetNum,DefenderMoveSetNum,WinProbability,StandardError,Engine\n");
+    result = results.data();
+    for (pointNum = 0; pointNum < points.size(); ++pointNum) {
+        for (attackerNum = 0; attackerNum < attackerMoveSetNums.size(); ++attackerNum) {
+            for (defenderNum = 0; defenderNum < defenderMoveSetNums.size(); ++defenderNum, ++result) {
+                for (i = 0; i < numSweepInputs; ++i) {
+                    fprintf(outputFile, "%g,", points[pointNum].values[i]);
+                }
+                fprintf(outputFile, "%ld,%ld,%.17g,%.17g,%s\n", attackerMoveSetNums[attackerNum], defenderMoveSetNums[defenderNum], result->winProbability,
+                        result->standardError, EngineName(result->engine));
+            }
+        }
+    }
+    fclose(outputFile);
+    return true;
+}
+
+
+/* simulate every attacker versus every defender at every sweep point on worker processes */
+/* attackers and defenders default to every move set in the game data */
+/* grids written to a .matrix file are streamed out tile by tile instead of held in memory */
+int Grid(int argc, char *argv[])
+{
+    GameData                  gameData;
+    BattleInputs              inputs;
+    SweepRange                ranges[numSweepInputs];
+    std::vector<Matchup>      matchups;
+    std::vector<long>         attackerMoveSetNums, defenderMoveSetNums;
+    std::vector<SweepPoint>   points;
+    std::vector<BattleResult> results;
+    MatrixFileWriter          matrixFile;
+    GridTileCallback          storeTile;
+    GridProgress              progress;
+    long                      tileSize;
+    const char                *checkpointFileName;
+    std::string               error;
+    size_t                    numAttackers, numDefenders, nameLength, i, j;
+    bool                      matrixOutput;
+
+    if (argc < 6 || argc > 8) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    tileSize = (argc >= 7) ? atol(argv[6]) : defaultGridTileSize;
+    checkpointFileName = (argc == 8) ? argv[7] : nullptr;
+    nameLength = strlen(argv[4]);
+    matrixOutput = nameLength > 7 && !strcmp(argv[4] + nameLength - 7, ".matrix");
+
+    if (!LoadGameDataFile(argv[2], gameData, inputs)) return EXIT_FAILURE;
+    if (!ReadSweepFile(argv[3], inputs, ranges, matchups, attackerMoveSetNums, defenderMoveSetNums)) return EXIT_FAILURE;
+    if (!matchups.empty()) {
+        fprintf(stderr, "Grids take attackers and defenders, not matchups.\n");
+        return EXIT_FAILURE;
+    }
+    if (attackerMoveSetNums.empty()) {
+        for (auto &moveSet : gameData.moveSets) attackerMoveSetNums.push_back(moveSet.moveSetNum);
+    }
+    if (defenderMoveSetNums.empty()) {
+        for (auto &moveSet : gameData.moveSets) defenderMoveSetNums.push_back(moveSet.moveSetNum);
+    }
+    if (!MakeSweepPoints(ranges, points)) {
+        fprintf(stderr, "The sweep ranges are invalid or too large.\n");
+        return EXIT_FAILURE;
+    }
+    numAttackers = attackerMoveSetNums.size();
+    numDefenders = defenderMoveSetNums.size();
+
+    if (matrixOutput) {
+        if (tileSize < 1 || !matrixFile.Create(argv[4], attackerMoveSetNums, defenderMoveSetNums, (long) points.size(), tileSize, true)) {
+            fprintf(stderr, "Opening %s failed.\n", argv[4]);
+            return EXIT_FAILURE;
+        }
+        storeTile = [&] (const GridTile &tile, const std::vector<BattleResult> &tileResults) {
+            (void) matrixFile.WriteTile(tile.pointNum, tile.firstAttacker, tile.numAttackers, tile.firstDefender, tile.numDefenders, tileResults.data());
+        };
+    } else {
+        if (numAttackers * numDefenders * points.size() > (size_t) maxSweepResults) {
+            fprintf(stderr, "Grids this large must be written to a .matrix file.\n");
+            return EXIT_FAILURE;
+        }
+        results.resize(points.size() * numAttackers * numDefenders);
+        storeTile = [&] (const GridTile &tile, const std::vector<BattleResult> &tileResults) {
+            for (i = 0; i < tile.numAttackers; ++i) {
+                for (j = 0; j < tile.numDefenders; ++j) {
+                    results[(tile.pointNum * numAttackers + tile.firstAttacker + i) * numDefenders + tile.firstDefender + j] =
+                        tileResults[i * tile.numDefenders + j];
+                }
+            }
+        };
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!RunGrid(gameData, inputs, points, attackerMoveSetNums, defenderMoveSetNums, argv[5], tileSize, checkpointFileName, storeTile, progress, error)) {
+        fprintf(stderr, "%s\n",
+                error.empty() ? "A move set or level is not in the game data, the tile size is invalid, or the grid is too large." : error.c_str());
+        return EXIT_FAILURE;
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%ld tiles in %.3f seconds, %ld restored from the checkpoint, %ld reassigned, %ld simulated in process\n", progress.numTiles,
+            elapsed, progress.numRestoredTiles, progress.numReassignedTiles, progress.numLocalTiles);
+    for (i = 0; i < progress.workerTiles.size(); ++i) {
+        fprintf(stderr, "worker %d: %ld tiles\n", (int) i + 1, progress.workerTiles[i]);
+    }
+
+    if (matrixOutput) {
+        if (!matrixFile.Close()) {
+            fprintf(stderr, "Writing %s failed.\n", argv[4]);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    return WriteGridCSV(argv[4], points, attackerMoveSetNums, defenderMoveSetNums, results) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/* serve simulate requests from workbooks and replay clients */
+/* workers only accept connections from the same machine unless given another address to listen on */
+int Worker(int argc, char *argv[])
+{
+    const char *host;
+    int        port, numThreads;
+
+    if (argc < 3 || argc > 5) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    port = atoi(argv[2]);
+    numThreads = (argc >= 4) ? atoi(argv[3]) : (int) std::thread::hardware_concurrency();
+    if (numThreads < 1) numThreads = 1;
+    host = (argc == 5) ? argv[4] : "127.0.0.1";
+
+    if (!RunSimulationWorker(host, port, numThreads)) {
+        fprintf(stderr, "Listening on %s port %d failed.\n", host, port);
+    }
+    return EXIT_FAILURE;
+}
+
+
+/* resolve every matchup at every sweep point, in the order of the sweep's results */
+bool ResolveSweepParameters(const GameData &gameData, const BattleInputs &inputs, const std::vector<SweepPoint> &points,
+                            const std::vector<Matchup> &matchups, std::vector<BattleParameters> &parameters)
+{
+    BattleInputs             pointInputs;
+    std::vector<MatchupData> matchupData;
+    size_t                   pointNum, matchupNum;
+    double                   attackerCPMultiplier, defenderCPMultiplier;
+    int                      j;
+
+    matchupData.resize(matchups.size());
+    for (matchupNum = 0; matchupNum < matchups.size(); ++matchupNum) {
+        if (!ResolveMatchupData(gameData, matchups[matchupNum].attackerMoveSetNum, matchups[matchupNum].defenderMoveSetNum, matchupData[matchupNum])) {
+            fprintf(stderr, "A matchup is not in the game data.\n");
+            return false;
+        }
+    }
+    for (pointNum = 0; pointNum < points.size(); ++pointNum) {
+        pointInputs = inputs;
+        for (j = 0; j < numSweepInputs; ++j) {
+            pointInputs.values[sweepInputIds[j]] = points[pointNum].values[j];
+        }
+        attackerCPMultiplier = gameData.CPMultiplier(points[pointNum].values[AttackerLevelSweep]);
+        defenderCPMultiplier = gameData.CPMultiplier(points[pointNum].values[DefenderLevelSweep]);
+        if (attackerCPMultiplier == 0.0 || defenderCPMultiplier == 0.0) {
+            fprintf(stderr, "A level is not in the game data.\n");
+            return false;
+        }
+        for (matchupNum = 0; matchupNum < matchups.size(); ++matchupNum) {
+            parameters.emplace_back();
+            ResolveBattleParameters(matchupData[matchupNum], pointInputs, attackerCPMultiplier, defenderCPMultiplier, parameters.back());
+        }
+    }
+    return true;
+}
+
+
+/* send the Battle() requests of a sweep to workers and check every reply against an in process simulation */
+int Replay(int argc, char *argv[])
+{
+    GameData                      gameData;
+    BattleInputs                  inputs;
+    SweepRange                    ranges[numSweepInputs];
+    std::vector<Matchup>          matchups;
+    std::vector<long>             attackerMoveSetNums, defenderMoveSetNums;
+    std::vector<SweepPoint>       points;
+    std::vector<BattleParameters> parameters;
+    std::vector<BattleResult>     workerResults;
+    WorkerPool                    workerPool;
+    std::mutex                    lock;
+    std::condition_variable       replied;
+    size_t                        numReplies, numMismatches, i;
+    std::ofstream                 logFile;
+    BattleResult                  result;
+    int                           numWorkers;
+
+    if (argc != 5) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    if (!LoadGameDataFile(argv[2], gameData, inputs)) return EXIT_FAILURE;
+    if (!ReadSweepFile(argv[3], inputs, ranges, matchups, attackerMoveSetNums, defenderMoveSetNums)) return EXIT_FAILURE;
+    if (!MakeSweepPoints(ranges, points)) {
+        fprintf(stderr, "The sweep ranges are invalid or too large.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (!ResolveSweepParameters(gameData, inputs, points, matchups, parameters)) return EXIT_FAILURE;
+
+    numWorkers = workerPool.Connect(argv[4]);
+    fprintf(stderr, "Connected to %d workers.\n", numWorkers);
+
+    auto start = std::chrono::steady_clock::now();
+    workerResults.resize(parameters.size());
+    numReplies = 0;
+    for (i = 0; i < parameters.size(); ++i) {
+        workerPool.Submit(parameters[i], [&, i] (const BattleResult &workerResult) {
+            std::lock_guard<std::mutex> guard(lock);
+
+            workerResults[i] = workerResult;
+            if (++numReplies == parameters.size()) replied.notify_one();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> guard(lock);
+
+        replied.wait(guard, [&] { return numReplies == parameters.size(); });
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    workerPool.Disconnect();
+
+    numMismatches = 0;
+    for (i = 0; i < parameters.size(); ++i) {
+        EvaluateBattles(parameters[i], logFile, result);
+        if (result.numWins != workerResults[i].numWins || result.numTrials != workerResults[i].numTrials ||
+            result.winProbability != workerResults[i].winProbability || result.standardError != workerResults[i].standardError ||
+            result.engine != workerResults[i].engine) {
+            ++numMismatches;
+        }
+    }
+    printf("%zu requests, %zu mismatches, %.3f seconds\n", parameters.size(), numMismatches, elapsed);
+    return (numMismatches == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/* look up one matchup of a matrix file and the attacker's average versus the defender's species */
+int Query(int argc, char *argv[])
+{
+    MatrixFileReader matrixFile;
+    double           probability, average;
+    size_t           pointNum;
+    long             attackerMoveSetNum, defenderMoveSetNum;
+
+    if (argc != 6) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    pointNum = (size_t) atol(argv[3]);
+    attackerMoveSetNum = atol(argv[4]);
+    defenderMoveSetNum = atol(argv[5]);
+
+    if (!matrixFile.Open(argv[2])) {
+        fprintf(stderr, "%s is not a complete matrix file.\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    if (!matrixFile.WinProbability(pointNum, attackerMoveSetNum, defenderMoveSetNum, probability) ||
+        !matrixFile.DefenderSpeciesAverage(pointNum, attackerMoveSetNum, defenderMoveSetNum, average)) {
+        fprintf(stderr, "The point or a move set is not in %s.\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    printf("%.6f %.6f\n", probability, average);
+    return EXIT_SUCCESS;
+}
+
+
+/* simulate one matchup at the inputs of the game data file and print its outcome measures */
+int Stats(int argc, char *argv[])
+{
+    GameData         gameData;
+    BattleInputs     inputs;
+    MatchupData      matchupData;
+    BattleParameters parameters;
+    BattleResult     result;
+    TrialStatistics  statistics;
+    std::ofstream    logFile;
+    double           attackerCPMultiplier, defenderCPMultiplier;
+    double           numTrials;
+    int              i;
+
+    if (argc != 5) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    if (!LoadGameDataFile(argv[2], gameData, inputs)) return EXIT_FAILURE;
+    attackerCPMultiplier = gameData.CPMultiplier(inputs.values[AttackerLevelInput]);
+    defenderCPMultiplier = gameData.CPMultiplier(inputs.values[DefenderLevelInput]);
+    if (!ResolveMatchupData(gameData, atol(argv[3]), atol(argv[4]), matchupData) || attackerCPMultiplier == 0.0 || defenderCPMultiplier == 0.0) {
+        fprintf(stderr, "The matchup or a level is not in the game data.\n");
+        return EXIT_FAILURE;
+    }
+    ResolveBattleParameters(matchupData, inputs, attackerCPMultiplier, defenderCPMultiplier, parameters);
+    SimulateBattleStatistics(parameters, logFile, result, statistics);
+
+    numTrials = (double) parameters.numTrials;
+    printf("WinProbability %.6f\n", result.winProbability);
+    printf("StandardError %.6f\n", result.standardError);
+    printf("MeanDuration %.3f\n", statistics.sumOfDurations / numTrials / 1000.0);
+    printf("DurationP10 %.3f\n", DurationPercentile(parameters, statistics, parameters.numTrials, 0.1) / 1000.0);
+    printf("DurationP50 %.3f\n", DurationPercentile(parameters, statistics, parameters.numTrials, 0.5) / 1000.0);
+    printf("DurationP90 %.3f\n", DurationPercentile(parameters, statistics, parameters.numTrials, 0.9) / 1000.0);
+    if (result.numWins > 0) printf("MeanTimeToWin %.3f\n", statistics.sumOfWinDurations / (double) result.numWins / 1000.0);
+    printf("MeanDamageDealt %.3f\n", statistics.sumOfDamageDealt / numTrials);
+    printf("MeanDamageTaken %.3f\n", statistics.sumOfDamageTaken / numTrials);
+    printf("MeanAttackerSpecialAttacks %.3f\n", statistics.numAttackerSpecialAttacks / numTrials);
+    printf("MeanDefenderSpecialAttacks %.3f\n", statistics.numDefenderSpecialAttacks / numTrials);
+    printf("RemainingHP,Attacker,Defender\n");
+    for (i = 0; i < numHPBins; ++i) {
+        printf("%g,%.6f,%.6f\n", (i + 1.0) / numHPBins, statistics.attackerHPCounts[i] / numTrials, statistics.defenderHPCounts[i] / numTrials);
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/* find the best attacker strategy for one matchup at the inputs of the game data file */
+/* special attacks are never skipped, so the solver can choose them wherever they help */
+int Solve(int argc, char *argv[])
+{
+    GameData         gameData;
+    BattleInputs     inputs;
+    MatchupData      matchupData;
+    BattleParameters parameters;
+    StrategyResult   result;
+    double           attackerCPMultiplier, defenderCPMultiplier;
+    int              objective, numIntervalPoints;
+
+    if (argc < 5 || argc > 7 || (argc >= 6 && strcmp(argv[5], "win") && strcmp(argv[5], "time"))) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    objective = (argc >= 6 && !strcmp(argv[5], "time")) ? WinTimeObjective : WinProbabilityObjective;
+    numIntervalPoints = (argc >= 7) ? atoi(argv[6]) : defaultIntervalPoints;
+    if (!LoadGameDataFile(argv[2], gameData, inputs)) return EXIT_FAILURE;
+    inputs.values[SkipWeakerSpecialAttacksInput] = 0.0;
+    attackerCPMultiplier = gameData.CPMultiplier(inputs.values[AttackerLevelInput]);
+    defenderCPMultiplier = gameData.CPMultiplier(inputs.values[DefenderLevelInput]);
+    if (!ResolveMatchupData(gameData, atol(argv[3]), atol(argv[4]), matchupData) || attackerCPMultiplier == 0.0 || defenderCPMultiplier == 0.0) {
+        fprintf(stderr, "The matchup or a level is not in the game data.\n");
+        return EXIT_FAILURE;
+    }
+    ResolveBattleParameters(matchupData, inputs, attackerCPMultiplier, defenderCPMultiplier, parameters);
+
+    StrategySolver solver(parameters, objective, numIntervalPoints);
+
+    auto start = std::chrono::steady_clock::now();
+    if (!solver.Solve(result)) {
+        fprintf(stderr, "The solver needs the standard defender, 1 to %d interval points, and at most %zu battle states.\n", maxIntervalPoints,
+                maxSolverStates);
+        return EXIT_FAILURE;
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (objective == WinTimeObjective) {
+        printf("OptimalTimeToWin %.3f\n", result.optimalValue / 1000.0);
+        printf("GreedyTimeToWin %.3f\n", result.greedyValue / 1000.0);
+    } else {
+        printf("OptimalWinProbability %.6f\n", result.optimalValue);
+        printf("GreedyWinProbability %.6f\n", result.greedyValue);
+    }
+    printf("States %ld\n", result.numStates);
+    printf("Plan %s\n", result.plan.c_str());
+    printf("Seconds %.3f\n", elapsed);
+    return EXIT_SUCCESS;
+}
+
+
+/* comma separated move set numbers */
+void ParseMoveSetNums(const char *str, std::vector<long> &moveSetNums)
+{
+    std::stringstream moveSetStream(str);
+    std::string       moveSetStr;
+
+    moveSetNums.clear();
+    while (std::getline(moveSetStream, moveSetStr, ',')) {
+        moveSetNums.push_back(atol(moveSetStr.c_str()));
+    }
+}
+
+
+/* simulate a raid at the inputs of the game data file, one party of comma separated move sets per player */
+int Raid(int argc, char *argv[])
+{
+    GameData                       gameData;
+    BattleInputs                   inputs;
+    std::vector<std::vector<long>> partyMoveSetNums;
+    RaidParameters                 raid;
+    BattleResult                   result;
+    int                            numThreads;
+    int                            i;
+
+    if (argc < 8) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    if (!LoadGameDataFile(argv[2], gameData, inputs)) return EXIT_FAILURE;
+    for (i = 7; i < argc; ++i) {
+        partyMoveSetNums.emplace_back();
+        ParseMoveSetNums(argv[i], partyMoveSetNums.back());
+    }
+    if (!ResolveRaidParameters(gameData, inputs, partyMoveSetNums, atol(argv[3]), raid)) {
+        fprintf(stderr, "A move set or level is not in the game data.\n");
+        return EXIT_FAILURE;
+    }
+    raid.partySwapDelay = atoi(argv[4]);
+    raid.relobbyDelay = atoi(argv[5]);
+    raid.numRelobbies = atoi(argv[6]);
+    if (!CheckRaidParameters(raid)) {
+        fprintf(stderr, "A raid has 1 to %d players with 1 to %d Pokemon each and no negative delays.\n", maxRaidPlayers, maxPartySize);
+        return EXIT_FAILURE;
+    }
+
+    numThreads = (int) std::thread::hardware_concurrency();
+    auto start = std::chrono::steady_clock::now();
+    SimulateRaid(raid, numThreads, result);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%.6f %.6f %.3f seconds\n", result.winProbability, result.standardError, elapsed);
+    return EXIT_SUCCESS;
+}
+
+
+/* simulate an attacking team against a gym lineup at the inputs of the game data file */
+int Team(int argc, char *argv[])
+{
+    GameData          gameData;
+    BattleInputs      inputs;
+    std::vector<long> attackerMoveSetNums, defenderMoveSetNums;
+    TeamParameters    team;
+    TeamResult        result;
+
+    if (argc != 5) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    if (!LoadGameDataFile(argv[2], gameData, inputs)) return EXIT_FAILURE;
+    ParseMoveSetNums(argv[3], attackerMoveSetNums);
+    ParseMoveSetNums(argv[4], defenderMoveSetNums);
+    if (!ResolveTeamParameters(gameData, inputs, attackerMoveSetNums, defenderMoveSetNums, team) || !CheckTeamParameters(team)) {
+        fprintf(stderr, "A team has 1 to %d move sets in the game data, and the level must be in the game data.\n", maxTeamSize);
+        return EXIT_FAILURE;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    SimulateTeam(team, (int) std::thread::hardware_concurrency(), result);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%.6f %.6f %.4f %.4f %.3f seconds\n", result.battleResult.winProbability, result.battleResult.standardError, result.attackersNeeded,
+           result.attackersNeededStandardError, elapsed);
+    return EXIT_SUCCESS;
+}
+
+
+/* widths of the defender's interval randomness the exact solver is timed at, all split exactly */
+const int calibrationIntervalRandomness[] = {0, 1, 3, 7, 15};
+
+
+/* time both engines on every matchup of a sweep and write the engine planner's cost model as a header */
+/* the exact solver is timed as the greedy attacker against the standard defender at each calibration width */
+int Calibrate(int argc, char *argv[])
+{
+    GameData                      gameData;
+    BattleInputs                  inputs;
+    SweepRange                    ranges[numSweepInputs];
+    std::vector<Matchup>          matchups;
+    std::vector<long>             attackerMoveSetNums, defenderMoveSetNums;
+    std::vector<SweepPoint>       points;
+    std::vector<BattleParameters> parameters;
+    BattleParameters              exactParameters;
+    Matchup                       matchup;
+    std::ofstream                 logFile;
+    BattleResult                  result;
+    double                        monteCarloSeconds, numEvents;
+    double                        exactSeconds, numStates, statesPerPointDraw;
+    double                        winProbability;
+    long                          numSolverStates;
+    FILE                          *headerFile;
+
+    if (argc != 5) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    if (!LoadGameDataFile(argv[2], gameData, inputs)) return EXIT_FAILURE;
+    if (!ReadSweepFile(argv[3], inputs, ranges, matchups, attackerMoveSetNums, defenderMoveSetNums)) return EXIT_FAILURE;
+    for (auto attackerMoveSetNum : attackerMoveSetNums) {
+        for (auto defenderMoveSetNum : defenderMoveSetNums) {
+            matchup.attackerMoveSetNum = attackerMoveSetNum;
+            matchup.defenderMoveSetNum = defenderMoveSetNum;
+            matchups.push_back(matchup);
+        }
+    }
+    if (!MakeSweepPoints(ranges, points)) {
+        fprintf(stderr, "The sweep ranges are invalid or too large.\n");
+        return EXIT_FAILURE;
+    }
+    if (!ResolveSweepParameters(gameData, inputs, points, matchups, parameters)) return EXIT_FAILURE;
+
+    monteCarloSeconds = 0.0;
+    numEvents = 0.0;
+    exactSeconds = 0.0;
+    numStates = 0.0;
+    statesPerPointDraw = 0.0;
+    for (auto &matchupParameters : parameters) {
+        auto start = std::chrono::steady_clock::now();
+        SimulateBattles(matchupParameters, logFile, result);
+        monteCarloSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        numEvents += EstimateBattleCost(matchupParameters);
+
+        exactParameters = matchupParameters;
+        exactParameters.randomness = true;
+        exactParameters.attackerPolicy = GreedyAttackerPolicy;
+        exactParameters.defenderPolicy = StandardDefenderPolicy;
+        for (auto intervalRandomness : calibrationIntervalRandomness) {
+            exactParameters.defensiveIntervalRandomness = intervalRandomness;
+            StrategySolver solver(exactParameters, WinProbabilityObjective, intervalRandomness + 1);
+
+            start = std::chrono::steady_clock::now();
+            if (!solver.SolveGreedy(winProbability, numSolverStates)) continue;
+            exactSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            numStates += numSolverStates;
+            /* the most states seen, so predictions err towards simulating */
+            statesPerPointDraw = std::max(statesPerPointDraw, numSolverStates / NumPointDraws(exactParameters));
+        }
+    }
+    if (numEvents == 0.0 || numStates == 0.0) {
+        fprintf(stderr, "The sweep has no battles to time.\n");
+        return EXIT_FAILURE;
+    }
+
+    headerFile = fopen(argv[4], "w");
+    if (!headerFile) {
+        fprintf(stderr, "Opening %s failed.\n", argv[4]);
+        return EXIT_FAILURE;
+    }
+    fprintf(headerFile, "#pragma once\n\n\n"
+                        "/* cost model of the engine planner, written by \"BattleSimulator calibrate\" on the build machine */\n"
+                        "/* regenerate after changing either engine or moving to other hardware */\n"
+                        "const double monteCarloSecondsPerEvent = %.3g;\n"
+                        "const double exactSecondsPerState = %.3g;\n"
+                        "const double exactStatesPerPointDraw = %.3g;\n",
+            monteCarloSeconds / numEvents, exactSeconds / numStates, statesPerPointDraw);
+    fclose(headerFile);
+    printf("MonteCarloSecondsPerEvent %.3g (was %.3g)\n", monteCarloSeconds / numEvents, monteCarloSecondsPerEvent);
+    printf("ExactSecondsPerState %.3g (was %.3g)\n", exactSeconds / numStates, exactSecondsPerState);
+    printf("ExactStatesPerPointDraw %.3g (was %.3g)\n", statesPerPointDraw, exactStatesPerPointDraw);
+    return EXIT_SUCCESS;
+}
+
+
+/* value one traced function returns for a matchup, or -1 like the workbook function if the matchup cannot be resolved */
+double ReplayTraceCall(const WorkloadTrace &trace, const TraceCall &call, MatchupCache &matchupCache)
+{
+    const GameData   &gameData = trace.snapshots[call.snapshotNum];
+    const auto       &inputs = trace.inputs.at(call.inputsHash);
+    MatchupData      matchupData;
+    double           attackerCPMultiplier, defenderCPMultiplier;
+    BattleParameters parameters;
+    BattleKey        key;
+    std::ofstream    logFile;
+    BattleResult     result;
+
+    if (CheckBattleInputs(inputs) != NoInputError) return -1.0;
+    if (!ResolveMatchupData(gameData, call.attackerMoveSetNum, call.defenderMoveSetNum, matchupData)) return -1.0;
+    attackerCPMultiplier = gameData.CPMultiplier(inputs.values[AttackerLevelInput]);
+    defenderCPMultiplier = gameData.CPMultiplier(inputs.values[DefenderLevelInput]);
+    if (attackerCPMultiplier == 0.0 || defenderCPMultiplier == 0.0) return -1.0;
+    ResolveBattleParameters(matchupData, inputs, attackerCPMultiplier, defenderCPMultiplier, parameters);
+
+    MakeBattleKey(parameters, key);
+    if (!matchupCache.Find(key, result)) {
+        EvaluateBattles(parameters, logFile, result);
+        matchupCache.Insert(key, result);
+    }
+    switch (call.function) {
+    case BattleStandardErrorFunction:
+        return result.standardError;
+    case MatchupEngineFunction:
+        return result.engine;
+    default:
+        return result.winProbability;
+    }
+}
+
+
+/* latency percentiles of calls in milliseconds */
+void PrintLatencies(const char *label, std::vector<double> &seconds)
+{
+    std::sort(seconds.begin(), seconds.end());
+    printf("%s latency ms: p50 %.3f, p90 %.3f, p99 %.3f, max %.3f\n", label, 1000.0 * seconds[seconds.size() / 2],
+           1000.0 * seconds[seconds.size() * 9 / 10], 1000.0 * seconds[seconds.size() * 99 / 100], 1000.0 * seconds.back());
+}
+
+
+/* replay every call of a trace on the given number of threads in the order recorded, timing each call and counting its heap allocations */
+void ReplayTraceCalls(const WorkloadTrace &trace, MatchupCache &matchupCache, int numThreads, std::vector<double> &values, std::vector<double> &seconds,
+                      std::vector<unsigned long long> &numAllocations)
+{
+    std::vector<std::thread> threads;
+    std::atomic<size_t>      nextCallNum;
+    int                      i;
+
+    values.assign(trace.calls.size(), 0.0);
+    seconds.assign(trace.calls.size(), 0.0);
+    numAllocations.assign(trace.calls.size(), 0);
+    nextCallNum = 0;
+    for (i = 0; i < numThreads; ++i) {
+        threads.emplace_back([&] {
+            size_t             callNum;
+            unsigned long long firstAllocation;
+
+            while ((callNum = nextCallNum++) < trace.calls.size()) {
+                firstAllocation = ThreadAllocations();
+                auto callStart = std::chrono::steady_clock::now();
+                values[callNum] = ReplayTraceCall(trace, trace.calls[callNum], matchupCache);
+                seconds[callNum] = std::chrono::duration<double>(std::chrono::steady_clock::now() - callStart).count();
+                numAllocations[callNum] = ThreadAllocations() - firstAllocation;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+
+/* replay the function calls of a workload trace captured in the workbook and check every value against the recorded one */
+/* calls are spread over the threads in the order recorded and share one matchup cache, as the workbook's calculation threads do */
+/* the calls are replayed again on the warm cache, which is the steady state of a recalculation and should allocate nothing */
+int Trace(int argc, char *argv[])
+{
+    WorkloadTrace                   trace;
+    std::string                     error;
+    std::vector<double>             values, seconds, recordedSeconds, warmValues, warmSeconds;
+    std::vector<unsigned long long> numAllocations, numWarmAllocations;
+    MatchupCache                    matchupCache;
+    size_t                          numMismatches, i;
+    unsigned long long              totalAllocations, totalWarmAllocations;
+    int                             numThreads;
+
+    if (argc < 3 || argc > 4) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    numThreads = (argc == 4) ? atoi(argv[3]) : (int) std::thread::hardware_concurrency();
+    numThreads = std::max(numThreads, 1);
+    if (!ReadTrace(argv[2], trace, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+    if (trace.calls.empty()) {
+        fprintf(stderr, "%s has no calls.\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ReplayTraceCalls(trace, matchupCache, numThreads, values, seconds, numAllocations);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ReplayTraceCalls(trace, matchupCache, numThreads, warmValues, warmSeconds, numWarmAllocations);
+
+    numMismatches = 0;
+    totalAllocations = 0;
+    totalWarmAllocations = 0;
+    for (i = 0; i < trace.calls.size(); ++i) {
+        recordedSeconds.push_back(trace.calls[i].seconds);
+        totalAllocations += numAllocations[i];
+        totalWarmAllocations += numWarmAllocations[i];
+        if (values[i] != trace.calls[i].result || warmValues[i] != trace.calls[i].result) {
+            if (numMismatches < 10) {
+                fprintf(stderr, "%s(%ld, %ld) returned %.17g and %.17g warm, recorded %.17g\n", TracedName(trace.calls[i].function),
+                        trace.calls[i].attackerMoveSetNum, trace.calls[i].defenderMoveSetNum, values[i], warmValues[i], trace.calls[i].result);
+            }
+            ++numMismatches;
+        }
+    }
+    printf("%zu calls, %zu game tables, %zu inputs, %zu mismatches\n", trace.calls.size(), trace.snapshots.size(), trace.inputs.size(), numMismatches);
+    printf("%.3f seconds, %.0f calls per second with %d threads\n", elapsed, trace.calls.size() / elapsed, numThreads);
+#if COUNTALLOCATIONS
+    printf("%llu heap allocations, %llu warm, in %ld cache misses and %ld hits\n", totalAllocations, totalWarmAllocations, matchupCache.NumMisses(),
+           matchupCache.NumHits());
+#else
+    printf("%ld cache misses and %ld hits, heap allocations are counted when built with COUNTALLOCATIONS\n", matchupCache.NumMisses(),
+           matchupCache.NumHits());
+#endif
+    PrintLatencies("replayed", seconds);
+    PrintLatencies("warm", warmSeconds);
+    PrintLatencies("recorded", recordedSeconds);
+    return (numMismatches == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/* engines checked against the reference simulator */
+enum VerifiedEngines {
+    ReferenceVerified,
+    OptimizedVerified,
+    StatisticsVerified,
+    ScheduledVerified,
+    ExactVerified,
+    numVerifiedEngines
+};
+
+const char *verifiedEngineNames[numVerifiedEngines] = {
+    "Reference",
+    "Optimized",
+    "Statistics",
+    "Scheduled",
+    "Exact"
+};
+
+/* fuzzed settings, drawn from values the workbook uses and the edge cases of each engine */
+const int    numVerifyMatchups = 500;
+const long   verifyTrialChoices[] = {1, 2, 10, 64, 256, 1000};
+const long   verifyRandomizationChoices[] = {1, 2, 4, 8};
+const int    verifyIntervalRandomnessChoices[] = {0, 1, 3, 7, 15, 100, 1000};
+const int    verifyBattleDurationChoices[] = {30000, 100000, 300000};
+const double verifyHPMultiplierChoices[] = {1.0, 2.0};
+
+/* exact results must be within this many binomial standard errors of the reference's trials */
+const double exactVerifyErrors = 5.0;
+
+
+/* random element of a table of choices */
+template <class Choice, size_t numChoices>
+inline Choice FuzzChoice(RandomStream &fuzzStream, const Choice (&choices)[numChoices])
+{
+    return choices[(size_t) (fuzzStream.Uniform() * numChoices)];
+}
+
+
+inline int FuzzInt(RandomStream &fuzzStream, int numValues)
+{
+    return (int) (fuzzStream.Uniform() * numValues);
+}
+
+
+/* random matchup with random levels, IVs and simulation settings, half of them random and some with Ditto */
+void FuzzMatchup(RandomStream &fuzzStream, const GameData &gameData, const std::vector<long> &dittoMoveSetNums, const std::vector<double> &levels,
+                 BattleInputs &inputs, Matchup &matchup)
+{
+    long numTrials, numRandomizations;
+
+    matchup.attackerMoveSetNum = gameData.moveSets[FuzzInt(fuzzStream, (int) gameData.moveSets.size())].moveSetNum;
+    matchup.defenderMoveSetNum = gameData.moveSets[FuzzInt(fuzzStream, (int) gameData.moveSets.size())].moveSetNum;
+    if (!dittoMoveSetNums.empty() && fuzzStream.Uniform() < 0.25) {
+        if (fuzzStream.Uniform() < 0.5) {
+            matchup.attackerMoveSetNum = dittoMoveSetNums[FuzzInt(fuzzStream, (int) dittoMoveSetNums.size())];
+        } else {
+            matchup.defenderMoveSetNum = dittoMoveSetNums[FuzzInt(fuzzStream, (int) dittoMoveSetNums.size())];
+        }
+    }
+
+    inputs.values[SkipWeakerSpecialAttacksInput] = FuzzInt(fuzzStream, 2);
+    inputs.values[AttackerLevelInput] = levels[FuzzInt(fuzzStream, (int) levels.size())];
+    inputs.values[DefenderLevelInput] = levels[FuzzInt(fuzzStream, (int) levels.size())];
+    inputs.values[AttackerStaminaIVInput] = FuzzInt(fuzzStream, 16);
+    inputs.values[AttackerAttackIVInput] = FuzzInt(fuzzStream, 16);
+    inputs.values[AttackerDefenseIVInput] = FuzzInt(fuzzStream, 16);
+    inputs.values[DefenderStaminaIVInput] = FuzzInt(fuzzStream, 16);
+    inputs.values[DefenderAttackIVInput] = FuzzInt(fuzzStream, 16);
+    inputs.values[DefenderDefenseIVInput] = FuzzInt(fuzzStream, 16);
+    inputs.values[DefensiveHPMultiplierInput] = FuzzChoice(fuzzStream, verifyHPMultiplierChoices);
+    inputs.values[BattleDurationInput] = FuzzChoice(fuzzStream, verifyBattleDurationChoices);
+    inputs.values[DefensiveIntervalRandomnessInput] = FuzzChoice(fuzzStream, verifyIntervalRandomnessChoices);
+    inputs.values[NumDefensiveSpecialAttackDeferralsInput] = FuzzInt(fuzzStream, 4);
+    inputs.values[DefensiveSpecialAttackProbabilityInput] = fuzzStream.Uniform();
+    inputs.values[AttackerPolicyInput] = FuzzInt(fuzzStream, numAttackerPolicies);
+    inputs.values[DefenderPolicyInput] = FuzzInt(fuzzStream, numDefenderPolicies);
+    inputs.values[EnginePlanningInput] = FuzzInt(fuzzStream, 2);
+    inputs.values[LogBattlesInput] = 0.0;
+
+    inputs.values[RandomnessInput] = FuzzInt(fuzzStream, 2);
+    inputs.values[RNGSeedInput] = 1 + FuzzInt(fuzzStream, 1000);
+    inputs.values[CommonRandomNumbersInput] = 0.0;
+    inputs.values[AntitheticTrialsInput] = 0.0;
+    inputs.values[QuasiMonteCarloInput] = 0.0;
+    inputs.values[NumQMCRandomizationsInput] = 1.0;
+    inputs.values[NumMonteCarloTrialsInput] = 1.0;
+    if (inputs.values[RandomnessInput] == 0.0) return;
+
+    /* one variance reduction at most, with trial counts it accepts */
+    numTrials = FuzzChoice(fuzzStream, verifyTrialChoices);
+    switch (FuzzInt(fuzzStream, 4)) {
+    case 1:
+        inputs.values[CommonRandomNumbersInput] = 1.0;
+        break;
+    case 2:
+        inputs.values[AntitheticTrialsInput] = 1.0;
+        numTrials = 2 * numTrials;
+        break;
+    case 3:
+        numRandomizations = FuzzChoice(fuzzStream, verifyRandomizationChoices);
+        inputs.values[QuasiMonteCarloInput] = 1.0;
+        inputs.values[NumQMCRandomizationsInput] = numRandomizations;
+        numTrials = numRandomizations * numTrials;
+        break;
+    }
+    inputs.values[NumMonteCarloTrialsInput] = numTrials;
+}
+
+
+/* whether an engine's result is the reference's, identical tallies for the Monte Carlo engines and within sampling error for the exact solver */
+bool SameResult(const BattleParameters &parameters, const BattleResult &referenceResult, const BattleResult &result, bool exact)
+{
+    double probability, samplingError;
+
+    if (!exact) {
+        return result.numWins == referenceResult.numWins && result.numTrials == referenceResult.numTrials &&
+               result.winProbability == referenceResult.winProbability && result.standardError == referenceResult.standardError;
+    }
+    if (!parameters.randomness) return result.winProbability == referenceResult.winProbability;
+    /* a probability within one trial of 0 or 1 is taken as one win or loss, whose sampling error does not vanish */
+    probability = std::min(std::max(result.winProbability, 1.0 / (parameters.numTrials + 1)), 1.0 - 1.0 / (parameters.numTrials + 1));
+    samplingError = sqrt(probability * (1.0 - probability) / parameters.numTrials);
+    return fabs(result.winProbability - referenceResult.winProbability) <= exactVerifyErrors * samplingError + tolerance;
+}
+
+
+/* print a mismatch with enough of the matchup to reproduce it */
+void PrintMismatch(int engine, const Matchup &matchup, const BattleInputs &inputs, const BattleResult &referenceResult, const BattleResult &result)
+{
+    std::map<std::string, std::string> inputStrs;
+
+    fprintf(stderr, "%s: %ld versus %ld won %ld of %ld, reference won %ld of %ld, with", verifiedEngineNames[engine], matchup.attackerMoveSetNum,
+            matchup.defenderMoveSetNum, result.numWins, result.numTrials, referenceResult.numWins, referenceResult.numTrials);
+    FormatBattleInputs(inputs, inputStrs);
+    for (auto &inputStr : inputStrs) {
+        fprintf(stderr, " %s=%s", inputStr.first.c_str(), inputStr.second.c_str());
+    }
+    fprintf(stderr, "\n");
+}
+
+
+/* fuzz matchups, levels, IVs and simulation settings and check every optimized engine against the reference simulator */
+/* the Monte Carlo engines must give identical tallies, and the exact solver must agree within sampling error where it applies */
+int Verify(int argc, char *argv[])
+{
+    GameData                      gameData;
+    BattleInputs                  inputs, defaultInputs;
+    std::vector<long>             dittoMoveSetNums;
+    std::vector<double>           levels;
+    std::vector<Matchup>          matchups;
+    std::vector<BattleInputs>     matchupInputs;
+    std::vector<BattleParameters> parameters;
+    std::vector<long>             matchupNums, legacyMatchupNums;
+    std::vector<BattleResult>     referenceResults, scheduledResults;
+    std::vector<BattleParameters> legacyParameters;
+    std::vector<double>           referenceSeconds;
+    RandomStream                  fuzzStream;
+    Matchup                       matchup;
+    MatchupData                   matchupData;
+    BattleParameters              matchupParameters;
+    BattleResult                  result;
+    TrialStatistics               statistics;
+    EnginePlan                    plan;
+    std::ofstream                 logFile;
+    double                        attackerCPMultiplier, defenderCPMultiplier;
+    double                        seconds[numVerifiedEngines], exactReferenceSeconds;
+    long                          numChecked[numVerifiedEngines], numMismatches[numVerifiedEngines], numFailures;
+    long                          numMatchups, i;
+    int                           numThreads, engine;
+
+    if (argc < 3 || argc > 6) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    numMatchups = (argc >= 4) ? atol(argv[3]) : numVerifyMatchups;
+    fuzzStream.Seed((argc >= 5) ? strtoull(argv[4], nullptr, 10) : 1);
+    numThreads = (argc == 6) ? atoi(argv[5]) : (int) std::thread::hardware_concurrency();
+    numThreads = std::max(numThreads, 1);
+    if (!LoadGameDataFile(argv[2], gameData, defaultInputs)) return EXIT_FAILURE;
+    if (gameData.moveSets.empty() || gameData.cpMultipliers.empty()) {
+        fprintf(stderr, "%s has no move sets or levels.\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    for (auto &moveSet : gameData.moveSets) {
+        if (moveSet.moveSetNum / 1000000 == dittoPokedexNum) dittoMoveSetNums.push_back(moveSet.moveSetNum);
+    }
+    for (auto &cpMultiplier : gameData.cpMultipliers) {
+        levels.push_back(cpMultiplier.first);
+    }
+
+    /* fuzz matchups that resolve */
+    while ((long) parameters.size() < numMatchups) {
+        inputs = defaultInputs;
+        FuzzMatchup(fuzzStream, gameData, dittoMoveSetNums, levels, inputs, matchup);
+        if (CheckBattleInputs(inputs) != NoInputError) continue;
+        if (!ResolveMatchupData(gameData, matchup.attackerMoveSetNum, matchup.defenderMoveSetNum, matchupData)) continue;
+        attackerCPMultiplier = gameData.CPMultiplier(inputs.values[AttackerLevelInput]);
+        defenderCPMultiplier = gameData.CPMultiplier(inputs.values[DefenderLevelInput]);
+        ResolveBattleParameters(matchupData, inputs, attackerCPMultiplier, defenderCPMultiplier, matchupParameters);
+        matchups.push_back(matchup);
+        matchupInputs.push_back(inputs);
+        parameters.push_back(matchupParameters);
+        matchupNums.push_back((long) matchupNums.size());
+    }
+
+    for (engine = 0; engine < numVerifiedEngines; ++engine) {
+        seconds[engine] = 0.0;
+        numChecked[engine] = 0;
+        numMismatches[engine] = 0;
+    }
+    exactReferenceSeconds = 0.0;
+
+    /* reference */
+    referenceResults.resize(parameters.size());
+    referenceSeconds.resize(parameters.size());
+    for (i = 0; i < numMatchups; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        SimulateReferenceBattles(parameters[i], referenceResults[i]);
+        referenceSeconds[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        seconds[ReferenceVerified] += referenceSeconds[i];
+        ++numChecked[ReferenceVerified];
+    }
+
+    /* single matchup engines */
+    for (i = 0; i < numMatchups; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        SimulateBattles(parameters[i], logFile, result);
+        seconds[OptimizedVerified] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++numChecked[OptimizedVerified];
+        if (!SameResult(parameters[i], referenceResults[i], result, false)) {
+            if (numMismatches[OptimizedVerified]++ < 10) PrintMismatch(OptimizedVerified, matchups[i], matchupInputs[i], referenceResults[i], result);
+        }
+
+        start = std::chrono::steady_clock::now();
+        SimulateBattleStatistics(parameters[i], logFile, result, statistics);
+        seconds[StatisticsVerified] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++numChecked[StatisticsVerified];
+        if (!SameResult(parameters[i], referenceResults[i], result, false)) {
+            if (numMismatches[StatisticsVerified]++ < 10) PrintMismatch(StatisticsVerified, matchups[i], matchupInputs[i], referenceResults[i], result);
+        }
+
+        /* the exact solver only where the engine planner would allow it */
+        matchupParameters = parameters[i];
+        matchupParameters.enginePlanning = true;
+        PlanBattleEngine(matchupParameters, plan);
+        if (plan.exactSeconds == HUGE_VAL) continue;
+        start = std::chrono::steady_clock::now();
+        if (!SolveExactBattles(matchupParameters, result)) continue;
+        seconds[ExactVerified] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++numChecked[ExactVerified];
+        exactReferenceSeconds += referenceSeconds[i];
+        if (!SameResult(parameters[i], referenceResults[i], result, true)) {
+            if (numMismatches[ExactVerified]++ < 10) PrintMismatch(ExactVerified, matchups[i], matchupInputs[i], referenceResults[i], result);
+        }
+    }
+
+    /* the whole batch on the scheduler's threads, where planned matchups are solved exactly unless the solver gives up */
+    scheduledResults.resize(parameters.size());
+    auto start = std::chrono::steady_clock::now();
+    ScheduleBattles(parameters.data(), matchupNums.data(), numMatchups, scheduledResults.data(), numThreads);
+    seconds[ScheduledVerified] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    numChecked[ScheduledVerified] = numMatchups;
+    for (i = 0; i < numMatchups; ++i) {
+        if (!SameResult(parameters[i], referenceResults[i], scheduledResults[i], scheduledResults[i].engine == ExactEngine)) {
+            if (numMismatches[ScheduledVerified]++ < 10) {
+                PrintMismatch(ScheduledVerified, matchups[i], matchupInputs[i], referenceResults[i], scheduledResults[i]);
+            }
+        }
+    }
+
+    /* a batch of only Monte Carlo matchups on the single rand() stream, which the scheduler simulates one after another */
+    for (i = 0; i < numMatchups; ++i) {
+        if (TrialsAreSeparable(parameters[i])) continue;
+        legacyMatchupNums.push_back(i);
+        legacyParameters.push_back(parameters[i]);
+        legacyParameters.back().enginePlanning = false;
+    }
+    /* the batch numbers its matchups from zero like the whole batch */
+    matchupNums.resize(legacyMatchupNums.size());
+    scheduledResults.assign(legacyMatchupNums.size(), BattleResult());
+    ScheduleBattles(legacyParameters.data(), matchupNums.data(), (long) legacyMatchupNums.size(), scheduledResults.data(), numThreads);
+    numChecked[ScheduledVerified] += (long) legacyMatchupNums.size();
+    for (i = 0; i < (long) legacyMatchupNums.size(); ++i) {
+        if (!SameResult(legacyParameters[i], referenceResults[legacyMatchupNums[i]], scheduledResults[i], false)) {
+            if (numMismatches[ScheduledVerified]++ < 10) {
+                PrintMismatch(ScheduledVerified, matchups[legacyMatchupNums[i]], matchupInputs[legacyMatchupNums[i]], referenceResults[legacyMatchupNums[i]],
+                              scheduledResults[i]);
+            }
+        }
+    }
+
+    /* speedups are over the reference on the same matchups, the scheduler's with all of its threads */
+    printf("%-10s  %8s  %10s  %9s  %7s\n", "Engine", "Matchups", "Mismatches", "Seconds", "Speedup");
+    numFailures = 0;
+    for (engine = 0; engine < numVerifiedEngines; ++engine) {
+        printf("%-10s  %8ld  %10ld  %9.3f  %7.2f\n", verifiedEngineNames[engine], numChecked[engine], numMismatches[engine], seconds[engine],
+               (seconds[engine] > 0.0) ? ((engine == ExactVerified) ? exactReferenceSeconds : seconds[ReferenceVerified]) / seconds[engine] : 0.0);
+        numFailures += numMismatches[engine];
+    }
+    return (numFailures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 2 && !strcmp(argv[1], "sweep")) return Sweep(argc, argv);
+    if (argc >= 2 && !strcmp(argv[1], "grid")) return Grid(argc, argv);
+    if (argc >= 2 && !strcmp(argv[1], "worker")) return Worker(argc, argv);
+    if (argc >= 2 && !strcmp(argv[1], "replay")) return Replay(argc, argv);
+    if (argc >= 2 && !strcmp(argv[1], "query")) return Query(argc, argv);
+    if (argc >= 2 && !strcmp(argv[1], "stats")) return Stats(argc, argv);
+    if (argc >= 2 && !strcmp(argv[1], "solve")) return Solve(argc, argv);
+    if (argc >= 2 && !strcmp(argv[1], "raid")) return Raid(argc, argv);
+    if (argc >= 2 && !strcmp(argv[1], "team")) return Team(argc, argv);
+    if (argc >= 2 && !strcmp(argv[1], "calibrate")) return Calibrate(argc, argv);
+    if (argc >= 2 && !strcmp(argv[1], "trace")) return Trace(argc, argv);
+    if (argc >= 2 && !strcmp(argv[1], "verify")) return Verify(argc, argv);
+    PrintUsage();
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,127 @@
+#include <string.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "TaskScheduler.h"
+
+#include "MatchupCache.h"
+
+
+size_t BattleKeyHash::operator() (const BattleKey &key) const
+{
+    unsigned long long hash;
+    int                i;
+
+    /* FNV-1a over the key words */
+    hash = 0xCBF29CE484222325ULL;
+    for (i = 0; i < numBattleKeyWords; ++i) {
+        hash ^= key.words[i];
+        hash *= 0x100000001B3ULL;
+        hash ^= hash >> 32;
+    }
+    return (size_t) hash;
+}
+
+
+bool BattleKeyEqual::operator() (const BattleKey &key1, const BattleKey &key2) const
+{
+    return memcmp(key1.words, key2.words, sizeof key1.words) == 0;
+}
+
+
+/* spreads move set numbers over the bits picking a shard and a slot */
+size_t MatchupKeyHash::operator() (unsigned long long key) const
+{
+    key *= 0x9E3779B97F4A7C15ULL;
+    return (size_t) (key ^ (key >> 29));
+}
+
+
+bool MatchupCache::Find(const BattleKey &key, BattleResult &result)
+{
+    return results.Find(key, result);
+}
+
+
+void MatchupCache::Insert(const BattleKey &key, const BattleResult &result)
+{
+    results.Insert(key, result);
+}
+
+
+void MatchupCache::Clear(void)
+{
+    results.Clear();
+}
+
+
+long MatchupCache::NumHits(void)
+{
+    return results.NumHits();
+}
+
+
+long MatchupCache::NumMisses(void)
+{
+    return results.NumMisses();
+}
+
+
+/* move set numbers are below 2^32 */
+inline unsigned long long MatchupKey(long attackerMoveSetNum, long defenderMoveSetNum)
+{
+    return ((unsigned long long) attackerMoveSetNum << 32) | (unsigned long) defenderMoveSetNum;
+}
+
+
+bool DependencyCache::Find(long attackerMoveSetNum, long defenderMoveSetNum, DependentResult &dependentResult)
+{
+    return results.Find(MatchupKey(attackerMoveSetNum, defenderMoveSetNum), dependentResult);
+}
+
+
+void DependencyCache::Insert(long attackerMoveSetNum, long defenderMoveSetNum, const DependentResult &dependentResult)
+{
+    results.Insert(MatchupKey(attackerMoveSetNum, defenderMoveSetNum), dependentResult);
+}
+
+
+void DependencyCache::Clear(void)
+{
+    results.Clear();
+}
+
+
+/* simulate each distinct set of battle parameters once and copy its result to the duplicates */
+/* the distinct matchups are scheduled on the given number of threads, which simulates those on the single rand() stream serially */
+void SimulateUniqueBattles(const BattleParameters *parameters, long numMatchups, BattleResult *results, int numThreads)
+{
+    std::unordered_map<BattleKey, long, BattleKeyHash, BattleKeyEqual> firstMatchups;
+    std::vector<long>                                                  uniqueMatchups;
+    std::vector<long>                                                  firstMatchupNums;
+    BattleKey                                                          key;
+    long                                                               i;
+
+    firstMatchups.reserve(numMatchups);
+    firstMatchupNums.resize(numMatchups);
+    for (i = 0; i < numMatchups; ++i) {
+        MakeBattleKey(parameters[i], key);
+        auto first = firstMatchups.find(key);
+        if (first == firstMatchups.end()) {
+            firstMatchups[key] = i;
+            firstMatchupNums[i] = i;
+            uniqueMatchups.push_back(i);
+        } else {
+            firstMatchupNums[i] = first->second;
+        }
+    }
+
+    ScheduleBattles(parameters, uniqueMatchups.data(), (long) uniqueMatchups.size(), results, numThreads);
+
+    for (i = 0; i < numMatchups; ++i) {
+        if (firstMatchupNums[i] != i) {
+            results[i] = results[firstMatchupNums[i]];
+        }
+    }
+}
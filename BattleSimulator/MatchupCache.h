@@ -0,0 +1,228 @@
+#pragma once
+
+
+#include <stddef.h>
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "BattleEngine.h"
+#include "BattleResolver.h"
+
+
+/* number of results a cache has room for, each shard starts over when three quarters of its share is used */
+const size_t maxCachedMatchups = 1 << 20;
+
+/* parts of a cache with their own locks, so threads looking up different matchups seldom wait for each other */
+const size_t numCacheShards = 64;
+
+/* slots of a shard when its first result is inserted */
+const size_t minCacheShardSlots = 16;
+
+
+struct BattleKeyHash {
+    size_t operator() (const BattleKey &key) const;
+};
+
+
+struct BattleKeyEqual {
+    bool operator() (const BattleKey &key1, const BattleKey &key2) const;
+};
+
+
+struct MatchupKeyHash {
+    size_t operator() (unsigned long long key) const;
+};
+
+
+/* values by key in shards picked by the key's hash, each an open addressing table under its own lock */
+/* a shard doubles its slots up to its share of maxCachedMatchups and keeps them when it starts over, */
+/* so a warm cache looks up and inserts without allocating */
+template <class Key, class Value, class Hash, class Equal>
+class ShardedCache {
+public:
+    inline bool Find(const Key &key, Value &value)
+    {
+        size_t hash, slotNum;
+
+        hash = Hash()(key);
+        Shard &shard = shards[(hash >> 16) % numCacheShards];
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        if (!FindSlot(shard, key, hash, slotNum)) {
+            ++shard.numMisses;
+            return false;
+        }
+        value = shard.slots[slotNum].value;
+        ++shard.numHits;
+        return true;
+    }
+
+    inline void Insert(const Key &key, const Value &value)
+    {
+        size_t hash, slotNum;
+
+        hash = Hash()(key);
+        Shard &shard = shards[(hash >> 16) % numCacheShards];
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        if (!FindSlot(shard, key, hash, slotNum)) {
+            if (4 * (shard.numUsed + 1) > 3 * shard.slots.size()) {
+                if (shard.slots.size() < maxCachedMatchups / numCacheShards) {
+                    Grow(shard);
+                } else {
+                    for (auto &slot : shard.slots) {
+                        slot.used = false;
+                    }
+                    shard.numUsed = 0;
+                }
+                (void) FindSlot(shard, key, hash, slotNum);
+            }
+            shard.slots[slotNum].hash = hash;
+            shard.slots[slotNum].used = true;
+            shard.slots[slotNum].key = key;
+            ++shard.numUsed;
+        }
+        shard.slots[slotNum].value = value;
+    }
+
+    /* forgets the values and the counts, but keeps the slots */
+    inline void Clear(void)
+    {
+        for (auto &shard : shards) {
+            std::lock_guard<std::mutex> guard(shard.lock);
+
+            for (auto &slot : shard.slots) {
+                slot.used = false;
+            }
+            shard.numUsed = 0;
+            shard.numHits = 0;
+            shard.numMisses = 0;
+        }
+    }
+
+    inline long NumHits(void)
+    {
+        long numHits;
+
+        numHits = 0;
+        for (auto &shard : shards) {
+            std::lock_guard<std::mutex> guard(shard.lock);
+
+            numHits += shard.numHits;
+        }
+        return numHits;
+    }
+
+    inline long NumMisses(void)
+    {
+        long numMisses;
+
+        numMisses = 0;
+        for (auto &shard : shards) {
+            std::lock_guard<std::mutex> guard(shard.lock);
+
+            numMisses += shard.numMisses;
+        }
+        return numMisses;
+    }
+
+private:
+    struct Slot {
+        size_t hash;
+        bool   used;
+        Key    key;
+        Value  value;
+    };
+
+    /* a cache line of its own, so the locks of neighboring shards do not share one */
+    struct alignas(64) Shard {
+        inline Shard(void)
+        {
+            numUsed = 0;
+            numHits = 0;
+            numMisses = 0;
+        }
+
+        std::mutex        lock;
+        std::vector<Slot> slots;
+        size_t            numUsed;
+        long              numHits;
+        long              numMisses;
+    };
+
+    /* the slot of the key, or the empty slot where it would go, returns false if the key is not found */
+    inline bool FindSlot(const Shard &shard, const Key &key, size_t hash, size_t &slotNum) const
+    {
+        slotNum = 0;
+        if (shard.slots.empty()) return false;
+        slotNum = hash & (shard.slots.size() - 1);
+        while (shard.slots[slotNum].used) {
+            if (shard.slots[slotNum].hash == hash && Equal()(shard.slots[slotNum].key, key)) return true;
+            slotNum = (slotNum + 1) & (shard.slots.size() - 1);
+        }
+        return false;
+    }
+
+    inline void Grow(Shard &shard)
+    {
+        std::vector<Slot> oldSlots;
+        size_t            slotNum;
+
+        oldSlots.swap(shard.slots);
+        shard.slots.resize(oldSlots.empty() ? minCacheShardSlots : 2 * oldSlots.size());
+        for (auto &slot : oldSlots) {
+            if (!slot.used) continue;
+            (void) FindSlot(shard, slot.key, slot.hash, slotNum);
+            shard.slots[slotNum] = slot;
+        }
+    }
+
+    Shard shards[numCacheShards];
+};
+
+
+/* results of simulated matchups by canonical battle key */
+class MatchupCache {
+public:
+    bool         Find         (const BattleKey &key, BattleResult &result);
+
+    void         Insert       (const BattleKey &key, const BattleResult &result);
+
+    void         Clear        (void);
+
+    long         NumHits      (void);
+
+    long         NumMisses    (void);
+
+private:
+    ShardedCache<BattleKey, BattleResult, BattleKeyHash, BattleKeyEqual> results;
+};
+
+
+/* last result of a matchup with the values of the inputs and the generation of the game tables it depended on */
+struct DependentResult {
+    BattleInputMask mask;
+    BattleInputs    inputs;
+    unsigned long   gameDataGeneration;
+    BattleResult    result;
+};
+
+
+/* last results of matchups by attacker and defender move set numbers */
+/* a result stays valid while the inputs in its mask keep their values and the game tables are unchanged */
+class DependencyCache {
+public:
+    bool         Find            (long attackerMoveSetNum, long defenderMoveSetNum, DependentResult &dependentResult);
+
+    void         Insert          (long attackerMoveSetNum, long defenderMoveSetNum, const DependentResult &dependentResult);
+
+    void         Clear           (void);
+
+private:
+    ShardedCache<unsigned long long, DependentResult, MatchupKeyHash, std::equal_to<unsigned long long>> results;
+};
+
+
+void SimulateUniqueBattles (const BattleParameters *parameters, long numMatchups, BattleResult *results, int numThreads);
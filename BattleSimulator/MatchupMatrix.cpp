@@ -0,0 +1,258 @@
+#include <stddef.h>
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MATRIX_SSE2 1
+#else
+#define MATRIX_SSE2 0
+#endif
+
+#include "MatrixFile.h"
+
+#include "MatchupMatrix.h"
+
+
+/* cells summed into 32-bit lanes before the lanes are added to the total, small enough that no lane overflows */
+const size_t sumBlockSize = 1 << 14;
+
+
+/* sum, minimum, and maximum of a run of cells in one pass */
+void AggregateCells(const unsigned short *cells, size_t numCells, unsigned long long &sum, unsigned short &minimum, unsigned short &maximum)
+{
+    size_t i;
+
+    sum = 0;
+    minimum = 65535;
+    maximum = 0;
+    i = 0;
+#if MATRIX_SSE2
+    if (numCells >= 8) {
+        /* SSE2 only compares signed 16-bit numbers, so cells are offset by 32768 */
+        const __m128i offset = _mm_set1_epi16((short) 0x8000);
+        const __m128i zero = _mm_setzero_si128();
+        __m128i       minimums, maximums, sums, cellVector;
+        unsigned int  lanes[4];
+        short         lanesShort[8];
+        size_t        blockEnd;
+        int           j;
+
+        minimums = _mm_set1_epi16(32767);
+        maximums = _mm_set1_epi16(-32768);
+        while (i + 8 <= numCells) {
+            sums = zero;
+            blockEnd = std::min(numCells, i + sumBlockSize) & ~(size_t) 7;
+            for (; i < blockEnd; i += 8) {
+                cellVector = _mm_loadu_si128((const __m128i *) (cells + i));
+                sums = _mm_add_epi32(sums, _mm_unpacklo_epi16(cellVector, zero));
+                sums = _mm_add_epi32(sums, _mm_unpackhi_epi16(cellVector, zero));
+                cellVector = _mm_xor_si128(cellVector, offset);
+                minimums = _mm_min_epi16(minimums, cellVector);
+                maximums = _mm_max_epi16(maximums, cellVector);
+            }
+            _mm_storeu_si128((__m128i *) lanes, sums);
+            sum += (unsigned long long) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        }
+        _mm_storeu_si128((__m128i *) lanesShort, minimums);
+        for (j = 0; j < 8; ++j) {
+            minimum = std::min(minimum, (unsigned short) (lanesShort[j] ^ 0x8000));
+        }
+        _mm_storeu_si128((__m128i *) lanesShort, maximums);
+        for (j = 0; j < 8; ++j) {
+            maximum = std::max(maximum, (unsigned short) (lanesShort[j] ^ 0x8000));
+        }
+    }
+#endif
+    for (; i < numCells; ++i) {
+        sum += cells[i];
+        minimum = std::min(minimum, cells[i]);
+        maximum = std::max(maximum, cells[i]);
+    }
+}
+
+
+/* sum of cells times weights */
+double WeightedSum(const unsigned short *cells, const float *weights, size_t numCells)
+{
+    double sum;
+    size_t i;
+
+    sum = 0.0;
+    i = 0;
+#if MATRIX_SSE2
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i       cellVector;
+        __m128        sums;
+        float         lanes[4];
+        size_t        blockEnd;
+
+        /* float lanes are added to the total a block at a time to keep their rounding error small */
+        while (i + 8 <= numCells) {
+            sums = _mm_setzero_ps();
+            blockEnd = std::min(numCells, i + 1024) & ~(size_t) 7;
+            for (; i < blockEnd; i += 8) {
+                cellVector = _mm_loadu_si128((const __m128i *) (cells + i));
+                sums = _mm_add_ps(sums, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(cellVector, zero)), _mm_loadu_ps(weights + i)));
+                sums = _mm_add_ps(sums, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(cellVector, zero)), _mm_loadu_ps(weights + i + 4)));
+            }
+            _mm_storeu_ps(lanes, sums);
+            sum += (double) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        }
+    }
+#endif
+    for (; i < numCells; ++i) {
+        sum += (double) cells[i] * weights[i];
+    }
+    return sum;
+}
+
+
+/* returns false for an unknown statistic */
+bool PickStatistic(int statistic, unsigned long long sum, unsigned short minimum, unsigned short maximum, size_t numCells, double &aggregate)
+{
+    switch (statistic) {
+    case AverageStatistic:
+        aggregate = (double) sum / numCells / 65535.0;
+        return true;
+    case MaxStatistic:
+        aggregate = DequantizeProbability(maximum);
+        return true;
+    case MinStatistic:
+        aggregate = DequantizeProbability(minimum);
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+MatchupMatrix::MatchupMatrix(void)
+{
+    numAttackers = 0;
+    numDefenders = 0;
+}
+
+
+/* probabilities are attacker rows of defender columns in the order of the move set numbers */
+void MatchupMatrix::Build(const std::vector<long> &attackerMoveSetNums, const std::vector<long> &defenderMoveSetNums,
+                          const std::vector<double> &probabilities)
+{
+    std::vector<size_t> defenderOrder;
+    size_t              attackerNum, column;
+
+    numAttackers = attackerMoveSetNums.size();
+    numDefenders = defenderMoveSetNums.size();
+
+    /* species stay in order of their first move set, move sets keep their order within a species */
+    defenderOrder.resize(numDefenders);
+    std::iota(defenderOrder.begin(), defenderOrder.end(), 0);
+    std::stable_sort(defenderOrder.begin(), defenderOrder.end(), [&defenderMoveSetNums] (size_t defender1, size_t defender2) {
+        return defenderMoveSetNums[defender1] / 1000000 < defenderMoveSetNums[defender2] / 1000000;
+    });
+    sortedColumns.resize(numDefenders);
+    defenderColumns.clear();
+    speciesColumns.clear();
+    for (column = 0; column < numDefenders; ++column) {
+        sortedColumns[defenderOrder[column]] = column;
+        defenderColumns[defenderMoveSetNums[defenderOrder[column]]] = column;
+        auto species = speciesColumns.emplace(defenderMoveSetNums[defenderOrder[column]] / 1000000, SpeciesColumns{column, 0});
+        ++species.first->second.numColumns;
+    }
+
+    attackerRows.clear();
+    cells.resize(numAttackers * numDefenders);
+    for (attackerNum = 0; attackerNum < numAttackers; ++attackerNum) {
+        attackerRows[attackerMoveSetNums[attackerNum]] = attackerNum;
+        for (column = 0; column < numDefenders; ++column) {
+            cells[attackerNum * numDefenders + column] = QuantizeProbability(probabilities[attackerNum * numDefenders + defenderOrder[column]]);
+        }
+    }
+}
+
+
+void MatchupMatrix::Clear(void)
+{
+    numAttackers = 0;
+    numDefenders = 0;
+    cells.clear();
+    attackerRows.clear();
+    defenderColumns.clear();
+    speciesColumns.clear();
+    sortedColumns.clear();
+}
+
+
+/* aggregate of the attacker versus every defender, returns false if the attacker is not in the matrix */
+bool MatchupMatrix::AttackerAggregate(long attackerMoveSetNum, int statistic, double &aggregate) const
+{
+    unsigned long long sum;
+    unsigned short     minimum, maximum;
+
+    auto attacker = attackerRows.find(attackerMoveSetNum);
+    if (attacker == attackerRows.end() || numDefenders == 0) return false;
+    AggregateCells(cells.data() + attacker->second * numDefenders, numDefenders, sum, minimum, maximum);
+    return PickStatistic(statistic, sum, minimum, maximum, numDefenders, aggregate);
+}
+
+
+/* aggregate of every attacker versus the defender, a column is strided so it is not vectorized */
+bool MatchupMatrix::DefenderAggregate(long defenderMoveSetNum, int statistic, double &aggregate) const
+{
+    unsigned long long sum;
+    unsigned short     minimum, maximum, cell;
+    size_t             attackerNum;
+
+    auto defender = defenderColumns.find(defenderMoveSetNum);
+    if (defender == defenderColumns.end() || numAttackers == 0) return false;
+    sum = 0;
+    minimum = 65535;
+    maximum = 0;
+    for (attackerNum = 0; attackerNum < numAttackers; ++attackerNum) {
+        cell = cells[attackerNum * numDefenders + defender->second];
+        sum += cell;
+        minimum = std::min(minimum, cell);
+        maximum = std::max(maximum, cell);
+    }
+    return PickStatistic(statistic, sum, minimum, maximum, numAttackers, aggregate);
+}
+
+
+/* aggregate of the attacker versus every move set of the defender's species */
+bool MatchupMatrix::SpeciesAggregate(long attackerMoveSetNum, long defenderMoveSetNum, int statistic, double &aggregate) const
+{
+    unsigned long long sum;
+    unsigned short     minimum, maximum;
+
+    auto attacker = attackerRows.find(attackerMoveSetNum);
+    auto species = speciesColumns.find(defenderMoveSetNum / 1000000);
+    if (attacker == attackerRows.end() || species == speciesColumns.end()) return false;
+    AggregateCells(cells.data() + attacker->second * numDefenders + species->second.firstColumn, species->second.numColumns, sum, minimum, maximum);
+    return PickStatistic(statistic, sum, minimum, maximum, species->second.numColumns, aggregate);
+}
+
+
+/* average of the attacker versus every defender weighted by the weights, in the order the defenders were built with */
+/* returns false if the attacker is not in the matrix or the weights do not add up to a positive number */
+bool MatchupMatrix::WeightedAttackerAverage(long attackerMoveSetNum, const std::vector<double> &weights, double &average) const
+{
+    std::vector<float> sortedWeights;
+    double             weightSum;
+    size_t             defenderNum;
+
+    auto attacker = attackerRows.find(attackerMoveSetNum);
+    if (attacker == attackerRows.end() || weights.size() != numDefenders) return false;
+    sortedWeights.resize(numDefenders);
+    weightSum = 0.0;
+    for (defenderNum = 0; defenderNum < numDefenders; ++defenderNum) {
+        sortedWeights[sortedColumns[defenderNum]] = (float) weights[defenderNum];
+        weightSum += weights[defenderNum];
+    }
+    if (!(weightSum > 0.0)) return false;
+    average = WeightedSum(cells.data() + attacker->second * numDefenders, sortedWeights.data(), numDefenders) / 65535.0 / weightSum;
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+
+#include <stddef.h>
+
+#include <unordered_map>
+#include <vector>
+
+
+/* same numbers as the function numbers of SUBTOTAL() */
+enum MatrixStatistics {
+    AverageStatistic = 1,
+    MaxStatistic = 4,
+    MinStatistic = 5
+};
+
+
+/* columns of one defender species */
+struct SpeciesColumns {
+    size_t firstColumn;
+    size_t numColumns;
+};
+
+
+/* win probabilities of attackers versus defenders in 16-bit fixed point, a quarter of the size of the worksheet's doubles */
+/* defender columns are grouped by species so species aggregates read one contiguous run of each attacker row */
+/* a matrix is not changed once it is built and shared, so queries from any thread need no lock */
+class MatchupMatrix {
+public:
+                       MatchupMatrix           (void);
+
+    void               Build                   (const std::vector<long> &attackerMoveSetNums, const std::vector<long> &defenderMoveSetNums,
+                                                const std::vector<double> &probabilities);
+
+    void               Clear                   (void);
+
+    bool               AttackerAggregate       (long attackerMoveSetNum, int statistic, double &aggregate) const;
+
+    bool               DefenderAggregate       (long defenderMoveSetNum, int statistic, double &aggregate) const;
+
+    bool               SpeciesAggregate        (long attackerMoveSetNum, long defenderMoveSetNum, int statistic, double &aggregate) const;
+
+    bool               WeightedAttackerAverage (long attackerMoveSetNum, const std::vector<double> &weights, double &average) const;
+
+private:
+    size_t                                     numAttackers, numDefenders;
+    std::vector<unsigned short>                cells;
+    std::unordered_map<long, size_t>           attackerRows, defenderColumns;
+    std::unordered_map<long, SpeciesColumns>   speciesColumns;
+    std::vector<size_t>                        sortedColumns;
+};
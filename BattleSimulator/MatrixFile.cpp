@@ -0,0 +1,377 @@
+#include <stdio.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "BattleEngine.h"
+
+#include "MatrixFile.h"
+
+
+/* "BSMATRX\0" */
+const unsigned long long matrixFileMagic = 0x00585254414D5342ULL;
+
+/* magic, version, points, attackers, defenders, tile size, flags, index offset, number of tiles */
+const int numMatrixHeaderWords = 9;
+const int indexOffsetWord = 7;
+
+const unsigned long long standardErrorsFlag = 1;
+
+
+inline void PutWord(std::vector<unsigned char> &bytes, unsigned long long word)
+{
+    int i;
+
+    for (i = 0; i < 8; ++i) {
+        bytes.push_back((unsigned char) (word >> (8 * i)));
+    }
+}
+
+
+inline void PutShort(std::vector<unsigned char> &bytes, unsigned short quantity)
+{
+    bytes.push_back((unsigned char) quantity);
+    bytes.push_back((unsigned char) (quantity >> 8));
+}
+
+
+inline unsigned long long GetWord(const unsigned char *bytes)
+{
+    unsigned long long word;
+    int                i;
+
+    word = 0;
+    for (i = 0; i < 8; ++i) {
+        word |= (unsigned long long) bytes[i] << (8 * i);
+    }
+    return word;
+}
+
+
+/* returns false at the end of the file */
+inline bool ReadWords(FILE *file, unsigned long long *words, size_t numWords)
+{
+    std::vector<unsigned char> bytes;
+    size_t                     i;
+
+    bytes.resize(8 * numWords);
+    if (fread(bytes.data(), 1, bytes.size(), file) != bytes.size()) return false;
+    for (i = 0; i < numWords; ++i) {
+        words[i] = GetWord(bytes.data() + 8 * i);
+    }
+    return true;
+}
+
+
+/* matrix files pass 2 GB, which a long offset cannot reach on Windows */
+inline int SeekFile(FILE *file, unsigned long long offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, (long long) offset, SEEK_SET);
+#else
+    return fseeko(file, (off_t) offset, SEEK_SET);
+#endif
+}
+
+
+MatrixFileWriter::MatrixFileWriter(void)
+{
+    file = nullptr;
+}
+
+
+MatrixFileWriter::~MatrixFileWriter(void)
+{
+    (void) Close();
+}
+
+
+bool MatrixFileWriter::Create(const char *fileName, const std::vector<long> &attackerMoveSetNums, const std::vector<long> &defenderMoveSetNums,
+                              long numPoints, long tileSize, bool standardErrors)
+{
+    std::vector<unsigned char> header;
+
+    file = fopen(fileName, "wb");
+    if (!file) return false;
+    this->standardErrors = standardErrors;
+    index.clear();
+    failed = false;
+
+    /* the index offset and number of tiles are filled in when the file is closed */
+    PutWord(header, matrixFileMagic);
+    PutWord(header, matrixFileVersion);
+    PutWord(header, (unsigned long long) numPoints);
+    PutWord(header, (unsigned long long) attackerMoveSetNums.size());
+    PutWord(header, (unsigned long long) defenderMoveSetNums.size());
+    PutWord(header, (unsigned long long) tileSize);
+    PutWord(header, standardErrors ? standardErrorsFlag : 0);
+    PutWord(header, 0);
+    PutWord(header, 0);
+    for (auto moveSetNum : attackerMoveSetNums) {
+        PutWord(header, (unsigned long long) moveSetNum);
+    }
+    for (auto moveSetNum : defenderMoveSetNums) {
+        PutWord(header, (unsigned long long) moveSetNum);
+    }
+    fileSize = header.size();
+    if (fwrite(header.data(), 1, header.size(), file) != header.size()) {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+
+/* may be called from any thread, tiles are appended in the order they arrive */
+bool MatrixFileWriter::WriteTile(size_t pointNum, size_t firstAttacker, size_t numAttackers, size_t firstDefender, size_t numDefenders,
+                                 const BattleResult *results)
+{
+    std::vector<unsigned char> chunk;
+    size_t                     numCells, i;
+
+    numCells = numAttackers * numDefenders;
+    chunk.reserve((standardErrors ? 4 : 2) * numCells);
+    for (i = 0; i < numCells; ++i) {
+        PutShort(chunk, QuantizeProbability(results[i].winProbability));
+    }
+    if (standardErrors) {
+        for (i = 0; i < numCells; ++i) {
+            PutShort(chunk, QuantizeStandardError(results[i].standardError));
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (!file || failed) return false;
+    if (fwrite(chunk.data(), 1, chunk.size(), file) != chunk.size()) {
+        failed = true;
+        return false;
+    }
+    index.push_back(pointNum);
+    index.push_back(firstAttacker);
+    index.push_back(firstDefender);
+    index.push_back(fileSize);
+    fileSize += chunk.size();
+    return true;
+}
+
+
+/* write the index and point the header at it, returns false if any write failed */
+bool MatrixFileWriter::Close(void)
+{
+    std::vector<unsigned char> bytes;
+    bool                       written;
+
+    if (!file) return false;
+    for (auto word : index) {
+        PutWord(bytes, word);
+    }
+    written = !failed && fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    bytes.clear();
+    PutWord(bytes, fileSize);
+    PutWord(bytes, index.size() / 4);
+    written = written && fseek(file, 8 * indexOffsetWord, SEEK_SET) == 0 && fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    written = (fclose(file) == 0) && written;
+    file = nullptr;
+    return written;
+}
+
+
+MatrixFileReader::MatrixFileReader(void)
+{
+    file = nullptr;
+}
+
+
+MatrixFileReader::~MatrixFileReader(void)
+{
+    Close();
+}
+
+
+/* read the header, move set numbers, and index, returns false if the file is not a complete matrix file */
+bool MatrixFileReader::Open(const char *fileName)
+{
+    unsigned long long              header[numMatrixHeaderWords];
+    std::vector<unsigned long long> words;
+    std::error_code                 sizeError;
+    unsigned long long              fileSize, indexOffset, tileBytes;
+    size_t                          numAttackers, numDefenders, numTiles, tileNum, i;
+
+    Close();
+    fileSize = std::filesystem::file_size(fileName, sizeError);
+    if (sizeError) return false;
+    file = fopen(fileName, "rb");
+    if (!file) return false;
+    if (!ReadWords(file, header, numMatrixHeaderWords) || header[0] != matrixFileMagic || header[1] != matrixFileVersion || header[5] == 0 ||
+        header[5] > (unsigned long long) std::numeric_limits<long>::max() || header[indexOffsetWord] == 0) {
+        Close();
+        return false;
+    }
+
+    /* the counts below size the allocations, so a damaged header must not claim more than the file holds */
+    /* the move set numbers follow the header, the tiles follow them, and the index of four words a tile ends the file */
+    indexOffset = header[indexOffsetWord];
+    if (header[3] > fileSize / 8 || header[4] > fileSize / 8 || 8 * (numMatrixHeaderWords + header[3] + header[4]) > indexOffset ||
+        indexOffset > fileSize || header[8] > (fileSize - indexOffset) / 32) {
+        Close();
+        return false;
+    }
+    numAttackers = (size_t) header[3];
+    numDefenders = (size_t) header[4];
+    tileSize = (long) header[5];
+    standardErrors = (header[6] & standardErrorsFlag) != 0;
+    numTiles = (size_t) header[8];
+
+    /* every tile takes at least two bytes, so there are no more tiles than bytes unless most are missing */
+    numTileRows = numAttackers / tileSize + (numAttackers % tileSize != 0);
+    numTileColumns = numDefenders / tileSize + (numDefenders % tileSize != 0);
+    if ((numTileRows != 0 && numTileColumns > fileSize / numTileRows) ||
+        (numTileRows * numTileColumns != 0 && header[2] > fileSize / (numTileRows * numTileColumns))) {
+        Close();
+        return false;
+    }
+    numPoints = (size_t) header[2];
+
+    words.resize(numAttackers + numDefenders);
+    if (!ReadWords(file, words.data(), words.size())) {
+        Close();
+        return false;
+    }
+    attackerMoveSetNums.assign(words.begin(), words.begin() + numAttackers);
+    defenderMoveSetNums.assign(words.begin() + numAttackers, words.end());
+    attackerNums.clear();
+    defenderNums.clear();
+    speciesDefenderNums.clear();
+    for (i = 0; i < numAttackers; ++i) {
+        attackerNums[attackerMoveSetNums[i]] = i;
+    }
+    for (i = 0; i < numDefenders; ++i) {
+        defenderNums[defenderMoveSetNums[i]] = i;
+        speciesDefenderNums[defenderMoveSetNums[i] / 1000000].push_back(i);
+    }
+
+    /* tile offsets by point, tile row, and tile column */
+    tileOffsets.assign(numPoints * numTileRows * numTileColumns, -1);
+    words.resize(4 * numTiles);
+    if (SeekFile(file, indexOffset) != 0 || !ReadWords(file, words.data(), words.size())) {
+        Close();
+        return false;
+    }
+    for (tileNum = 0; tileNum < numTiles; ++tileNum) {
+        if (words[4 * tileNum] >= numPoints || words[4 * tileNum + 1] >= numAttackers || words[4 * tileNum + 2] >= numDefenders) {
+            Close();
+            return false;
+        }
+        /* the cells of a tile lie between the move set numbers and the index */
+        tileBytes = (standardErrors ? 4 : 2) * std::min((unsigned long long) tileSize, numAttackers - words[4 * tileNum + 1]) *
+                    std::min((unsigned long long) tileSize, numDefenders - words[4 * tileNum + 2]);
+        if (words[4 * tileNum + 3] < 8 * (numMatrixHeaderWords + numAttackers + numDefenders) || words[4 * tileNum + 3] > indexOffset ||
+            tileBytes > indexOffset - words[4 * tileNum + 3]) {
+            Close();
+            return false;
+        }
+        tileOffsets[(words[4 * tileNum] * numTileRows + words[4 * tileNum + 1] / tileSize) * numTileColumns + words[4 * tileNum + 2] / tileSize] =
+            (long long) words[4 * tileNum + 3];
+    }
+    return true;
+}
+
+
+void MatrixFileReader::Close(void)
+{
+    if (file) fclose(file);
+    file = nullptr;
+}
+
+
+size_t MatrixFileReader::NumPoints(void) const
+{
+    return numPoints;
+}
+
+
+const std::vector<long> &MatrixFileReader::AttackerMoveSetNums(void) const
+{
+    return attackerMoveSetNums;
+}
+
+
+const std::vector<long> &MatrixFileReader::DefenderMoveSetNums(void) const
+{
+    return defenderMoveSetNums;
+}
+
+
+/* read one attacker's cells of a tile, returns false if the tile is missing */
+bool MatrixFileReader::ReadTileRow(size_t pointNum, size_t attackerNum, size_t tileColumn, std::vector<unsigned short> &probabilities)
+{
+    std::vector<unsigned char> bytes;
+    long long                  tileOffset;
+    size_t                     tileRow, tileDefenders, i;
+
+    tileRow = attackerNum / tileSize;
+    tileOffset = tileOffsets[(pointNum * numTileRows + tileRow) * numTileColumns + tileColumn];
+    if (tileOffset < 0) return false;
+    tileDefenders = std::min((size_t) tileSize, defenderMoveSetNums.size() - tileColumn * tileSize);
+
+    bytes.resize(2 * tileDefenders);
+    if (SeekFile(file, tileOffset + 2 * (attackerNum - tileRow * tileSize) * tileDefenders) != 0 ||
+        fread(bytes.data(), 1, bytes.size(), file) != bytes.size()) {
+        return false;
+    }
+    probabilities.resize(tileDefenders);
+    for (i = 0; i < tileDefenders; ++i) {
+        probabilities[i] = (unsigned short) (bytes[2 * i] | (bytes[2 * i + 1] << 8));
+    }
+    return true;
+}
+
+
+/* returns false if a move set is not in the matrix or its tile is missing */
+bool MatrixFileReader::WinProbability(size_t pointNum, long attackerMoveSetNum, long defenderMoveSetNum, double &probability)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<unsigned short> probabilities;
+    size_t                      defenderNum;
+
+    auto attacker = attackerNums.find(attackerMoveSetNum);
+    auto defender = defenderNums.find(defenderMoveSetNum);
+    if (!file || pointNum >= numPoints || attacker == attackerNums.end() || defender == defenderNums.end()) return false;
+    defenderNum = defender->second;
+    if (!ReadTileRow(pointNum, attacker->second, defenderNum / tileSize, probabilities)) return false;
+    probability = DequantizeProbability(probabilities[defenderNum % tileSize]);
+    return true;
+}
+
+
+/* average win probability of the attacker versus every move set of the defender's species */
+/* reads one row of each tile holding those move sets */
+bool MatrixFileReader::DefenderSpeciesAverage(size_t pointNum, long attackerMoveSetNum, long defenderMoveSetNum, double &average)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<unsigned short> probabilities;
+    size_t                      tileColumn;
+    double                      matchupSum;
+
+    auto attacker = attackerNums.find(attackerMoveSetNum);
+    auto species = speciesDefenderNums.find(defenderMoveSetNum / 1000000);
+    if (!file || pointNum >= numPoints || attacker == attackerNums.end() || species == speciesDefenderNums.end()) return false;
+
+    matchupSum = 0.0;
+    tileColumn = numTileColumns;
+    for (auto defenderNum : species->second) {
+        if (defenderNum / tileSize != tileColumn) {
+            tileColumn = defenderNum / tileSize;
+            if (!ReadTileRow(pointNum, attacker->second, tileColumn, probabilities)) return false;
+        }
+        matchupSum += DequantizeProbability(probabilities[defenderNum % tileSize]);
+    }
+    average = matchupSum / species->second.size();
+    return true;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+
+#include <stdio.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "BattleEngine.h"
+
+
+/* matrix files hold attacker x defender grids at one or more sweep points as 64-bit little-endian header words, */
+/* the attacker and defender move set numbers, then one chunk per tile in the order tiles were finished: */
+/*     win probabilities of the tile's cells, attacker rows of defender columns, as 16-bit fixed point */
+/*     standard errors in the same layout if the file has them */
+/* followed by an index of where each tile's chunk starts */
+
+/* change whenever the file layout changes */
+const unsigned long long matrixFileVersion = 1;
+
+
+/* probabilities are stored in units of 1/65535 */
+inline unsigned short QuantizeProbability(double probability)
+{
+    if (probability <= 0.0) return 0;
+    if (probability >= 1.0) return 65535;
+    return (unsigned short) (probability * 65535.0 + 0.5);
+}
+
+
+inline double DequantizeProbability(unsigned short quantity)
+{
+    return quantity / 65535.0;
+}
+
+
+/* standard errors of a probability are at most 1/2 */
+inline unsigned short QuantizeStandardError(double standardError)
+{
+    return QuantizeProbability(2.0 * standardError);
+}
+
+
+inline double DequantizeStandardError(unsigned short quantity)
+{
+    return DequantizeProbability(quantity) / 2.0;
+}
+
+
+/* writes tiles to a matrix file as they are finished, holding only the index in memory */
+class MatrixFileWriter {
+public:
+                       MatrixFileWriter  (void);
+
+                       ~MatrixFileWriter (void);
+
+    bool               Create            (const char *fileName, const std::vector<long> &attackerMoveSetNums, const std::vector<long> &defenderMoveSetNums,
+                                          long numPoints, long tileSize, bool standardErrors);
+
+    bool               WriteTile         (size_t pointNum, size_t firstAttacker, size_t numAttackers, size_t firstDefender, size_t numDefenders,
+                                          const BattleResult *results);
+
+    bool               Close             (void);
+
+private:
+    FILE                            *file;
+    std::mutex                      lock;
+    bool                            standardErrors;
+    unsigned long long              fileSize;
+    std::vector<unsigned long long> index;
+    bool                            failed;
+};
+
+
+/* random access to a matrix file, reading only the tile rows a query needs */
+class MatrixFileReader {
+public:
+                             MatrixFileReader       (void);
+
+                             ~MatrixFileReader      (void);
+
+    bool                     Open                   (const char *fileName);
+
+    void                     Close                  (void);
+
+    size_t                   NumPoints              (void) const;
+
+    const std::vector<long> &AttackerMoveSetNums    (void) const;
+
+    const std::vector<long> &DefenderMoveSetNums    (void) const;
+
+    bool                     WinProbability         (size_t pointNum, long attackerMoveSetNum, long defenderMoveSetNum, double &probability);
+
+    bool                     DefenderSpeciesAverage (size_t pointNum, long attackerMoveSetNum, long defenderMoveSetNum, double &average);
+
+private:
+    bool                     ReadTileRow            (size_t pointNum, size_t attackerNum, size_t tileColumn, std::vector<unsigned short> &probabilities);
+
+    FILE                                          *file;
+    std::mutex                                    lock;
+    size_t                                        numPoints;
+    long                                          tileSize;
+    bool                                          standardErrors;
+    size_t                                        numTileRows, numTileColumns;
+    std::vector<long>                             attackerMoveSetNums, defenderMoveSetNums;
+    std::unordered_map<long, size_t>              attackerNums, defenderNums;
+    std::unordered_map<long, std::vector<size_t>> speciesDefenderNums;
+    std::vector<long long>                        tileOffsets;
+};
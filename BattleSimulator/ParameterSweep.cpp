@@ -0,0 +1,192 @@
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Checkpoint.h"
+#include "MatchupCache.h"
+
+#include "ParameterSweep.h"
+
+
+const BattleInputIds sweepInputIds[numSweepInputs] = {
+    AttackerLevelInput,
+    AttackerStaminaIVInput,
+    AttackerAttackIVInput,
+    AttackerDefenseIVInput,
+    DefenderLevelInput,
+    DefenderStaminaIVInput,
+    DefenderAttackIVInput,
+    DefenderDefenseIVInput
+};
+
+
+/* number of matchups resolved and simulated together */
+const long sweepBlockSize = 1 << 16;
+
+
+/* number of values in a sweep range, or 0 if the range is invalid */
+long NumSweepValues(const SweepRange &range)
+{
+    if (range.step == 0.0) {
+        return (range.first == range.last) ? 1 : 0;
+    }
+    if ((range.last - range.first) / range.step < -tolerance) return 0;
+    return (long) floor((range.last - range.first) / range.step + tolerance) + 1;
+}
+
+
+/* make the grid of all combinations of the swept values, with the last input varying fastest */
+/* returns false if a range is invalid or the grid is too large */
+bool MakeSweepPoints(const SweepRange ranges[numSweepInputs], std::vector<SweepPoint> &points)
+{
+    long       numValues[numSweepInputs];
+    long       valueNums[numSweepInputs];
+    long       numPoints;
+    SweepPoint point;
+    int        i;
+
+    numPoints = 1;
+    for (i = 0; i < numSweepInputs; ++i) {
+        numValues[i] = NumSweepValues(ranges[i]);
+        if (numValues[i] == 0 || numValues[i] > maxSweepResults / numPoints) return false;
+        numPoints *= numValues[i];
+        valueNums[i] = 0;
+    }
+
+    points.clear();
+    points.reserve(numPoints);
+    while (true) {
+        for (i = 0; i < numSweepInputs; ++i) {
+            point.values[i] = ranges[i].first + valueNums[i] * ranges[i].step;
+        }
+        points.push_back(point);
+        /* advance like an odometer */
+        for (i = numSweepInputs - 1; i >= 0 && ++valueNums[i] == numValues[i]; --i) {
+            valueNums[i] = 0;
+        }
+        if (i < 0) break;
+    }
+    return true;
+}
+
+
+/* simulate every matchup at every grid point, results are ordered by point and then matchup */
+/* move and type data are resolved once per matchup, only the stats and damages are recalculated per point */
+/* grid points that give a matchup the same HP and integer damages share one simulation */
+/* with a checkpoint file, blocks finished by an earlier run of the same sweep are read back instead of simulated */
+/* returns false with the reason in error if a move set, species, or level is not in the game data, the grid is too large, or the checkpoint cannot be used */
+bool RunSweep(const GameData &gameData, const BattleInputs &inputs, const std::vector<SweepPoint> &points, const std::vector<Matchup> &matchups,
+              int numThreads, const char *checkpointFileName, std::vector<BattleResult> &results, std::string &error)
+{
+    std::vector<MatchupData>      matchupData;
+    std::vector<double>           attackerCPMultipliers, defenderCPMultipliers;
+    MatchupCache                  sweepCache;
+    BattleInputs                  pointInputs;
+    std::vector<BattleParameters> blockParameters;
+    std::vector<BattleResult>     blockResults;
+    std::vector<long>             blockResultNums;
+    BattleParameters              parameters;
+    BattleKey                     key;
+    JobHash                       jobHash;
+    CheckpointFile                checkpoint;
+    std::vector<bool>             blocksDone;
+    long                          numMatchups, numResults, numBlocks;
+    long                          resultNum, blockStart, i;
+    size_t                        pointNum;
+    double                        level;
+    char                          levelStr[32];
+    int                           j;
+
+    numMatchups = (long) matchups.size();
+    if (numMatchups == 0) {
+        error = "The sweep has no matchups.";
+        return false;
+    }
+    if ((long) points.size() > maxSweepResults / numMatchups) {
+        error = "The sweep has more than " + std::to_string(maxSweepResults) + " results.";
+        return false;
+    }
+    numResults = (long) points.size() * numMatchups;
+
+    /* resolve move and type data once per matchup */
+    matchupData.resize(numMatchups);
+    for (i = 0; i < numMatchups; ++i) {
+        if (!ResolveMatchupData(gameData, matchups[i].attackerMoveSetNum, matchups[i].defenderMoveSetNum, matchupData[i])) {
+            if (!gameData.FindMoveSet(matchups[i].attackerMoveSetNum)) {
+                error = "Move set " + std::to_string(matchups[i].attackerMoveSetNum) + " is not in the game data.";
+            } else if (!gameData.FindMoveSet(matchups[i].defenderMoveSetNum)) {
+                error = "Move set " + std::to_string(matchups[i].defenderMoveSetNum) + " is not in the game data.";
+            } else {
+                error = "A species of move set " + std::to_string(matchups[i].attackerMoveSetNum) + " or " +
+                        std::to_string(matchups[i].defenderMoveSetNum) + " is not in the game data.";
+            }
+            return false;
+        }
+    }
+
+    /* look up levels once per point */
+    attackerCPMultipliers.resize(points.size());
+    defenderCPMultipliers.resize(points.size());
+    for (pointNum = 0; pointNum < points.size(); ++pointNum) {
+        attackerCPMultipliers[pointNum] = gameData.CPMultiplier(points[pointNum].values[AttackerLevelSweep]);
+        defenderCPMultipliers[pointNum] = gameData.CPMultiplier(points[pointNum].values[DefenderLevelSweep]);
+        if (attackerCPMultipliers[pointNum] == 0.0 || defenderCPMultipliers[pointNum] == 0.0) {
+            level = points[pointNum].values[(attackerCPMultipliers[pointNum] == 0.0) ? AttackerLevelSweep : DefenderLevelSweep];
+            snprintf(levelStr, sizeof levelStr, "%g", level);
+            error = std::string("Level ") + levelStr + " is not in the game data.";
+            return false;
+        }
+    }
+
+    results.resize(numResults);
+    numBlocks = (numResults + sweepBlockSize - 1) / sweepBlockSize;
+    blocksDone.assign(numBlocks, false);
+    if (checkpointFileName) {
+        jobHash.Add("sweep", 5);
+        jobHash.AddGameData(gameData, inputs);
+        jobHash.Add(points.data(), points.size() * sizeof points[0]);
+        jobHash.Add(matchups.data(), matchups.size() * sizeof matchups[0]);
+        auto restoreBlock = [&] (long long blockNum, const std::vector<BattleResult> &blockResults) {
+            if ((long) blockResults.size() != std::min(sweepBlockSize, numResults - (long) blockNum * sweepBlockSize)) return false;
+            std::copy(blockResults.begin(), blockResults.end(), results.begin() + blockNum * sweepBlockSize);
+            blocksDone[blockNum] = true;
+            return true;
+        };
+        if (!checkpoint.Open(checkpointFileName, jobHash.Value(), numBlocks, inputs, restoreBlock, error)) return false;
+    }
+
+    pointInputs = inputs;
+    for (blockStart = 0; blockStart < numResults; blockStart += sweepBlockSize) {
+        if (blocksDone[blockStart / sweepBlockSize]) continue;
+
+        /* resolve the block, keeping only matchups not already simulated at an earlier point */
+        blockParameters.clear();
+        blockResultNums.clear();
+        for (resultNum = blockStart; resultNum < numResults && resultNum < blockStart + sweepBlockSize; ++resultNum) {
+            pointNum = resultNum / numMatchups;
+            for (j = 0; j < numSweepInputs; ++j) {
+                pointInputs.values[sweepInputIds[j]] = points[pointNum].values[j];
+            }
+            ResolveBattleParameters(matchupData[resultNum % numMatchups], pointInputs, attackerCPMultipliers[pointNum], defenderCPMultipliers[pointNum],
+                                    parameters);
+            MakeBattleKey(parameters, key);
+            if (!sweepCache.Find(key, results[resultNum])) {
+                blockParameters.push_back(parameters);
+                blockResultNums.push_back(resultNum);
+            }
+        }
+
+        blockResults.resize(blockParameters.size());
+        SimulateUniqueBattles(blockParameters.data(), (long) blockParameters.size(), blockResults.data(), numThreads);
+        for (i = 0; i < (long) blockParameters.size(); ++i) {
+            results[blockResultNums[i]] = blockResults[i];
+            MakeBattleKey(blockParameters[i], key);
+            sweepCache.Insert(key, blockResults[i]);
+        }
+        checkpoint.Append(blockStart / sweepBlockSize, results.data() + blockStart, std::min(sweepBlockSize, numResults - blockStart));
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+
+#include <string>
+#include <vector>
+
+#include "BattleEngine.h"
+#include "BattleResolver.h"
+#include "GameData.h"
+
+
+/* inputs that can be swept, in the order of sweep ranges */
+enum SweepInputIds {
+    AttackerLevelSweep,
+    AttackerStaminaIVSweep,
+    AttackerAttackIVSweep,
+    AttackerDefenseIVSweep,
+    DefenderLevelSweep,
+    DefenderStaminaIVSweep,
+    DefenderAttackIVSweep,
+    DefenderDefenseIVSweep,
+    numSweepInputs
+};
+
+
+extern const BattleInputIds sweepInputIds[numSweepInputs];
+
+
+/* maximum number of grid points times matchups in one sweep */
+const long maxSweepResults = 1 << 24;
+
+
+/* values first, first + step, ... up to last */
+struct SweepRange {
+    double first, last, step;
+};
+
+
+/* values of the swept inputs at one grid point */
+struct SweepPoint {
+    double values[numSweepInputs];
+};
+
+
+bool MakeSweepPoints (const SweepRange ranges[numSweepInputs], std::vector<SweepPoint> &points);
+
+bool RunSweep        (const GameData &gameData, const BattleInputs &inputs, const std::vector<SweepPoint> &points, const std::vector<Matchup> &matchups,
+                      int numThreads, const char *checkpointFileName, std::vector<BattleResult> &results, std::string &error);
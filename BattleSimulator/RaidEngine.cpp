@@ -0,0 +1,366 @@
+#include <assert.h>
+#include <math.h>
+
+#include <vector>
+
+#include "CombatantPolicies.h"
+#include "EventQueue.h"
+#include "RandomStream.h"
+#include "TaskScheduler.h"
+#include "TrialSampler.h"
+
+#include "RaidEngine.h"
+
+
+inline int Min(int number1, int number2)
+{
+    return (number1 < number2) ? number1 : number2;
+}
+
+
+/* returns false if there are no players, too many, or a party is empty or too large */
+bool CheckRaidParameters(const RaidParameters &raid)
+{
+    if (raid.parties.empty() || raid.parties.size() > (size_t) maxRaidPlayers) return false;
+    for (auto &party : raid.parties) {
+        if (party.empty() || party.size() > (size_t) maxPartySize) return false;
+    }
+    return raid.partySwapDelay >= 0 && raid.relobbyDelay >= 0 && raid.numRelobbies >= 0;
+}
+
+
+/* first action of a party member entering the raid */
+inline void EnterRaid(EventQueue &eventQueue, int delay, const BattleParameters &member)
+{
+    eventQueue.Initialize(1);
+    if (member.attackerTransforms) {
+        eventQueue.Add(delay, PlayerStartsTransform);
+    } else {
+        eventQueue.Add(delay, PlayerStartsAttack);
+    }
+}
+
+
+/* player the boss turns to after its target stops fighting, the next one in order or a random one */
+/* returns the old target if no player is fighting */
+inline int NextTarget(const bool fighting[], int numPlayers, int target, bool randomness, RandomStream &targetStream)
+{
+    int numPlayersFighting, numSkipped, playerNum;
+
+    numPlayersFighting = 0;
+    for (playerNum = 0; playerNum < numPlayers; ++playerNum) {
+        if (fighting[playerNum]) ++numPlayersFighting;
+    }
+    if (numPlayersFighting == 0) return target;
+    numSkipped = randomness ? (int) (numPlayersFighting * targetStream.Uniform()) : 0;
+    playerNum = target;
+    do {
+        playerNum = (playerNum + 1) % numPlayers;
+    } while (!fighting[playerNum] || numSkipped-- > 0);
+    return playerNum;
+}
+
+
+/* simulate raid trials firstTrial to firstTrial + numTrials - 1, which must be whole groups, and add them to the tally */
+/* every player has its own event queue, the boss attacks one player at a time like the defender of a battle */
+/* when its target's Pokemon faints the boss turns to another player still fighting, at random if the battle is random */
+/* raid trials always draw from per-trial random number streams, so any range of them can be simulated on its own */
+/* every party member has its own copy of the attacker policy, which starts over when the player relobbies */
+template <class AttackerPolicy, class DefenderPolicy>
+void SimulateRaidTrialsWith(const RaidParameters &raid, long firstTrial, long numTrials, BattleTally &tally, AttackerPolicy attacker,
+                            DefenderPolicy defender)
+{
+    const BattleParameters &boss = raid.parties[0][0];
+    BattleParameters       samplerParameters;
+    const BattleParameters *member, *targetMember;
+    bool                   randomness;
+    int                    numPlayers, partySizes[maxRaidPlayers];
+    int                    bossHP, maxBossEnergy;
+    double                 energyPerDamage;
+    EventQueue             playerEventQueues[maxRaidPlayers];
+    EventQueue             bossEventQueue;
+    RandomStream           targetStream;
+    long                   trialsPerGroup, groupWins;
+    int                    bossTime;
+    int                    battleTimer, nextTime;
+    int                    bossBattleHP, bossEnergy;
+    int                    memberNums[maxRaidPlayers], numRelobbiesUsed[maxRaidPlayers];
+    int                    memberHP[maxRaidPlayers][maxPartySize], memberEnergy[maxRaidPlayers][maxPartySize];
+    AttackerPolicy         memberAttackers[maxRaidPlayers][maxPartySize];
+    bool                   inRaid[maxRaidPlayers], fighting[maxRaidPlayers];
+    int                    numPlayersInRaid, target, damage;
+    int                    *attackerEnergy;
+    PlayerEvents           playerEvent;
+    bool                   specialAttack;
+    int                    interval;
+    int                    playerNum, memberNum, j;
+    long                   i;
+
+    assert(CheckRaidParameters(raid));
+    samplerParameters = boss;
+    if (!TrialsAreSeparable(samplerParameters)) samplerParameters.commonRandomNumbers = true;
+    TrialSampler sampler(samplerParameters);
+
+    randomness = boss.randomness;
+    numPlayers = (int) raid.parties.size();
+    for (playerNum = 0; playerNum < numPlayers; ++playerNum) {
+        partySizes[playerNum] = (int) raid.parties[playerNum].size();
+    }
+    bossHP = (int) (boss.defenderHP * boss.defensiveHPMultiplier);
+    maxBossEnergy = boss.maxDefenderEnergy;
+    energyPerDamage = boss.energyPerDamage;
+
+    trialsPerGroup = TrialsPerGroup(boss);
+    assert(firstTrial % trialsPerGroup == 0 && numTrials % trialsPerGroup == 0);
+
+    /* perform Monte Carlo trials */
+    groupWins = 0;
+    for (i = firstTrial; i < firstTrial + numTrials; ++i) {
+        sampler.StartTrial(i);
+        targetStream.Seed(boss.rngSeed, i, TargetStream);
+
+        /* every player starts with the first Pokemon of its party */
+        for (playerNum = 0; playerNum < numPlayers; ++playerNum) {
+            for (memberNum = 0; memberNum < partySizes[playerNum]; ++memberNum) {
+                memberHP[playerNum][memberNum] = raid.parties[playerNum][memberNum].attackerHP;
+                memberEnergy[playerNum][memberNum] = 0;
+                memberAttackers[playerNum][memberNum] = attacker;
+                memberAttackers[playerNum][memberNum].StartBattle(raid.parties[playerNum][memberNum]);
+            }
+            memberNums[playerNum] = 0;
+            numRelobbiesUsed[playerNum] = 0;
+            inRaid[playerNum] = true;
+            fighting[playerNum] = true;
+            EnterRaid(playerEventQueues[playerNum], boss.offensiveInitialInterval, raid.parties[playerNum][0]);
+        }
+        numPlayersInRaid = numPlayers;
+        target = 0;
+
+        /* the boss starts like the defender of a battle */
+        bossEventQueue.Initialize(boss.numDefensiveInitialIntervals);
+        bossTime = boss.defensiveInitialIntervals[0];
+        if (boss.defenderTransforms) {
+            bossEventQueue.Add(bossTime, PlayerStartsTransform);
+        } else {
+            bossEventQueue.Add(bossTime, PlayerStartsInitialAttack);
+        }
+        bossTime += boss.defensiveInitialIntervals[1];
+        bossEventQueue.Add(bossTime, PlayerStartsInitialAttack);
+        if (randomness) {
+            bossTime += sampler.Interval(boss.defensiveInitialIntervals[2], boss.defensiveIntervalRandomness);
+        } else {
+            bossTime += boss.defensiveInitialIntervals[2];
+        }
+        bossEventQueue.Add(bossTime, PlayerStartsAttack);
+
+        /* simulate raid */
+        battleTimer = boss.battleDuration;
+        bossBattleHP = bossHP;
+        bossEnergy = 0;
+        defender.StartBattle(boss);
+        while (battleTimer > 0 && bossBattleHP > 0 && numPlayersInRaid > 0) {
+
+            /* count down timers to next event */
+            nextTime = bossEventQueue.Timer();
+            for (playerNum = 0; playerNum < numPlayers; ++playerNum) {
+                if (inRaid[playerNum]) nextTime = Min(nextTime, playerEventQueues[playerNum].Timer());
+            }
+            for (playerNum = 0; playerNum < numPlayers; ++playerNum) {
+                if (inRaid[playerNum]) playerEventQueues[playerNum].CountDown(nextTime);
+            }
+            bossEventQueue.CountDown(nextTime);
+            battleTimer -= nextTime;
+
+            /* next event of each player whose time has come */
+            for (playerNum = 0; playerNum < numPlayers; ++playerNum) {
+                if (!inRaid[playerNum] || playerEventQueues[playerNum].Timer() != 0) continue;
+                playerEvent = playerEventQueues[playerNum].Pop();
+                memberNum = memberNums[playerNum];
+                member = &raid.parties[playerNum][memberNum];
+                attackerEnergy = &memberEnergy[playerNum][memberNum];
+
+                /* player's Pokemon finishes action */
+                switch (playerEvent) {
+                case PlayerLandsFastAttack:
+                    damage = member->attackerFastAttackDamage;
+                    bossBattleHP -= damage;
+                    bossEnergy = Min(bossEnergy + (int) round(damage * energyPerDamage + tolerance), maxBossEnergy);
+                    break;
+                case PlayerLandsSpecialAttack:
+                    damage = member->attackerSpecialAttackDamage;
+                    bossBattleHP -= damage;
+                    bossEnergy = Min(bossEnergy + (int) round(damage * energyPerDamage + tolerance), maxBossEnergy);
+                    break;
+                case PlayerLandsTransform:
+                    damage = member->transformDamage;
+                    bossBattleHP -= damage;
+                    bossEnergy = Min(bossEnergy + (int) round(damage * energyPerDamage + tolerance), maxBossEnergy);
+                    break;
+                default:
+                    break;
+                }
+
+                /* player's Pokemon performs next action */
+                switch (playerEvent) {
+                case PlayerStartsTransform:
+                    /* a Pokemon entering after a swap or relobby starts here or with its first attack */
+                    fighting[playerNum] = true;
+                    *attackerEnergy = Min(*attackerEnergy + member->transformEnergy, member->maxAttackerEnergy);
+                    playerEventQueues[playerNum].Add(member->transformDamageStart, PlayerLandsTransform);
+                    playerEventQueues[playerNum].Add(member->transformDuration, PlayerFinishesTransform);
+                    break;
+                case PlayerStartsAttack:
+                case PlayerFinishesFastAttack:
+                case PlayerFinishesSpecialAttack:
+                case PlayerFinishesTransform:
+                    fighting[playerNum] = true;
+                    if (memberAttackers[playerNum][memberNum].StartsSpecialAttack(*attackerEnergy)) {
+                        /* special attack */
+                        playerEventQueues[playerNum].Add(member->longPressDuration, PlayerFinishesLongPress);
+                    } else {
+                        /* fast attack */
+                        *attackerEnergy = Min(*attackerEnergy + member->attackerFastAttackEnergy, member->maxAttackerEnergy);
+                        playerEventQueues[playerNum].Add(member->attackerFastAttackDamageStart, PlayerLandsFastAttack);
+                        playerEventQueues[playerNum].Add(member->attackerFastAttackDuration, PlayerFinishesFastAttack);
+                    }
+                    break;
+                case PlayerFinishesLongPress:
+                    *attackerEnergy = *attackerEnergy + member->attackerSpecialAttackEnergy;
+                    playerEventQueues[playerNum].Add(member->attackerSpecialAttackDamageStart, PlayerLandsSpecialAttack);
+                    playerEventQueues[playerNum].Add(member->attackerSpecialAttackDuration, PlayerFinishesSpecialAttack);
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            /* check if time for next boss event */
+            if (bossEventQueue.Timer() == 0) {
+                playerEvent = bossEventQueue.Pop();
+
+                /* boss finishes action, its damage is lost if no player is fighting */
+                switch (playerEvent) {
+                case PlayerLandsFastAttack:
+                case PlayerLandsSpecialAttack:
+                case PlayerLandsTransform:
+                    if (!fighting[target]) target = NextTarget(fighting, numPlayers, target, randomness, targetStream);
+                    if (!fighting[target]) break;
+                    memberNum = memberNums[target];
+                    targetMember = &raid.parties[target][memberNum];
+                    if (playerEvent == PlayerLandsFastAttack) {
+                        damage = targetMember->defenderFastAttackDamage;
+                    } else if (playerEvent == PlayerLandsSpecialAttack) {
+                        damage = targetMember->defenderSpecialAttackDamage;
+                    } else {
+                        damage = targetMember->transformDamage;
+                    }
+                    memberHP[target][memberNum] -= damage;
+                    memberEnergy[target][memberNum] = Min(memberEnergy[target][memberNum] + (int) round(damage * energyPerDamage + tolerance),
+                                                          targetMember->maxAttackerEnergy);
+                    if (memberHP[target][memberNum] > 0) break;
+
+                    /* the next Pokemon of the party swaps in, after the last one the player relobbies or leaves the raid */
+                    fighting[target] = false;
+                    if (memberNum + 1 < partySizes[target]) {
+                        memberNums[target] = memberNum + 1;
+                        EnterRaid(playerEventQueues[target], raid.partySwapDelay, raid.parties[target][memberNum + 1]);
+                    } else if (numRelobbiesUsed[target] < raid.numRelobbies) {
+                        ++numRelobbiesUsed[target];
+                        for (j = 0; j < partySizes[target]; ++j) {
+                            memberHP[target][j] = raid.parties[target][j].attackerHP;
+                            memberEnergy[target][j] = 0;
+                            memberAttackers[target][j].StartBattle(raid.parties[target][j]);
+                        }
+                        memberNums[target] = 0;
+                        EnterRaid(playerEventQueues[target], raid.relobbyDelay, raid.parties[target][0]);
+                    } else {
+                        inRaid[target] = false;
+                        --numPlayersInRaid;
+                    }
+
+                    target = NextTarget(fighting, numPlayers, target, randomness, targetStream);
+                    break;
+                default:
+                    break;
+                }
+
+                /* boss performs next action */
+                switch (playerEvent) {
+                case PlayerStartsTransform:
+                    bossEnergy = Min(bossEnergy + boss.transformEnergy, maxBossEnergy);
+                    bossEventQueue.Add(boss.transformDamageStart, PlayerLandsTransform);
+                    bossEventQueue.Add(boss.transformDuration, PlayerFinishesTransform);
+                    break;
+                case PlayerStartsAttack:
+                case PlayerStartsInitialAttack:
+                    /* boss starts next attack */
+                    specialAttack = defender.StartsSpecialAttack(bossEnergy, sampler);
+                    if (specialAttack) {
+                        bossEnergy = bossEnergy + boss.defenderSpecialAttackEnergy;
+                        bossEventQueue.Add(boss.defenderSpecialAttackDamageStart, PlayerLandsSpecialAttack);
+                        if (playerEvent == PlayerStartsInitialAttack) {
+                            bossEventQueue.Add(boss.defenderSpecialAttackDuration, PlayerFinishesInitialSpecialAttack);
+                        } else {
+                            bossEventQueue.Add(boss.defenderSpecialAttackDuration, PlayerFinishesSpecialAttack);
+                        }
+                    } else {
+                        bossEnergy = Min(bossEnergy + boss.defenderFastAttackEnergy, maxBossEnergy);
+                        bossEventQueue.Add(boss.defenderFastAttackDamageStart, PlayerLandsFastAttack);
+                        if (playerEvent == PlayerStartsInitialAttack) {
+                            bossEventQueue.Add(boss.defenderFastAttackDuration, PlayerFinishesInitialFastAttack);
+                        } else {
+                            bossEventQueue.Add(boss.defenderFastAttackDuration, PlayerFinishesFastAttack);
+                        }
+                    }
+                    break;
+                case PlayerFinishesFastAttack:
+                case PlayerFinishesSpecialAttack:
+                    /* boss does nothing for a while and then starts next attack */
+                    if (randomness) {
+                        interval = sampler.Interval(boss.defensiveInterval, boss.defensiveIntervalRandomness);
+                    } else {
+                        interval = boss.defensiveInterval;
+                    }
+                    bossEventQueue.Add(interval, PlayerStartsAttack);
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+
+        if (bossBattleHP <= 0) {
+            /* raid won */
+            ++tally.numWins;
+            ++groupWins;
+        }
+
+        /* accumulate group wins for the variance estimate */
+        if ((i + 1) % trialsPerGroup == 0) {
+            tally.sumOfSquaredGroupWins += (long long) groupWins * groupWins;
+            groupWins = 0;
+        }
+    }
+}
+
+
+/* simulate raid trials with the policies of the boss settings */
+void SimulateRaidTrials(const RaidParameters &raid, long firstTrial, long numTrials, BattleTally &tally)
+{
+    DispatchPolicies(raid.parties[0][0].attackerPolicy, raid.parties[0][0].defenderPolicy, [&] (auto attacker, auto defender) {
+        SimulateRaidTrialsWith(raid, firstTrial, numTrials, tally, attacker, defender);
+    });
+}
+
+
+/* trials of one raid are split over the threads, the result does not depend on the number of threads */
+void SimulateRaid(const RaidParameters &raid, int numThreads, BattleResult &result)
+{
+    BattleTally tally;
+
+    ScheduleTrials(raid.parties[0][0].numTrials, TrialsPerGroup(raid.parties[0][0]), numThreads,
+                   [&raid] (long, long firstTrial, long numTrials, BattleTally &rangeTally) {
+        SimulateRaidTrials(raid, firstTrial, numTrials, rangeTally);
+    }, tally);
+    FinishBattles(raid.parties[0][0], tally, result);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+
+#include <vector>
+
+#include "BattleEngine.h"
+
+
+/* most players in a raid and Pokemon in a party */
+const int maxRaidPlayers = 20;
+const int maxPartySize = 6;
+
+
+/* players versus one raid boss with a shared HP pool */
+/* each party member's matchup against the boss is resolved like a battle, the boss's damage to it included */
+/* the simulation settings, boss HP, and boss behavior come from the first member of the first party */
+/* delays are in milliseconds, a relobby brings back the whole party after it has fainted */
+struct RaidParameters {
+    std::vector<std::vector<BattleParameters>> parties;
+    int                                        partySwapDelay;
+    int                                        relobbyDelay;
+    int                                        numRelobbies;
+};
+
+
+bool CheckRaidParameters (const RaidParameters &raid);
+
+void SimulateRaidTrials  (const RaidParameters &raid, long firstTrial, long numTrials, BattleTally &tally);
+
+void SimulateRaid        (const RaidParameters &raid, int numThreads, BattleResult &result);
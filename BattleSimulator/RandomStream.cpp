@@ -0,0 +1,42 @@
+#include "RandomStream.h"
+
+
+/* SplitMix64 increment and mixing constants */
+const unsigned long long goldenGamma = 0x9E3779B97F4A7C15ULL;
+const unsigned long long mixMultiplier1 = 0xBF58476D1CE4E5B9ULL;
+const unsigned long long mixMultiplier2 = 0x94D049BB133111EBULL;
+
+
+inline unsigned long long Mix(unsigned long long z)
+{
+    z = (z ^ (z >> 30)) * mixMultiplier1;
+    z = (z ^ (z >> 27)) * mixMultiplier2;
+    return z ^ (z >> 31);
+}
+
+
+RandomStream::RandomStream(void)
+{
+    state = 0;
+}
+
+
+void RandomStream::Seed(unsigned long long seed)
+{
+    state = seed;
+}
+
+
+void RandomStream::Seed(int rngSeed, long substreamNum, RandomStreams stream)
+{
+    /* hash the seed, substream, and stream so neighboring substreams are uncorrelated */
+    state = Mix(Mix(Mix((unsigned long long) rngSeed) + (unsigned long long) substreamNum) + (unsigned long long) stream);
+}
+
+
+double RandomStream::Uniform(void)
+{
+    state += goldenGamma;
+    /* use the top 53 bits for a double in [0, 1) */
+    return (Mix(state) >> 11) * (1.0 / 9007199254740992.0);
+}
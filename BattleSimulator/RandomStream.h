@@ -0,0 +1,27 @@
+#pragma once
+
+
+/* random number stream identifiers for common random numbers and quasi-Monte Carlo */
+enum RandomStreams {
+    IntervalStream,
+    DeferralStream,
+    ScrambleStream,
+    PaddingStream,
+    TargetStream
+};
+
+
+/* small seedable random number generator that does not share state with rand() */
+class RandomStream {
+public:
+                 RandomStream (void);
+
+    void         Seed         (unsigned long long seed);
+
+    void         Seed         (int rngSeed, long substreamNum, RandomStreams stream);
+
+    double       Uniform      (void);
+
+private:
+    unsigned long long state;
+};
@@ -0,0 +1,196 @@
+#include <assert.h>
+#include <math.h>
+
+#include "CombatantPolicies.h"
+#include "EventQueue.h"
+#include "TrialSampler.h"
+
+#include "ReferenceEngine.h"
+
+
+inline int Min(int number1, int number2)
+{
+    return (number1 < number2) ? number1 : number2;
+}
+
+
+/* energy a combatant gains from taking damage */
+inline int DamageEnergy(const BattleParameters &parameters, int damage)
+{
+    return (int) round(damage * parameters.energyPerDamage + tolerance);
+}
+
+
+/* simulate all trials with the given attacker and defender policies */
+template <class AttackerPolicy, class DefenderPolicy>
+void SimulateReferenceTrials(const BattleParameters &parameters, BattleTally &tally, AttackerPolicy attacker, DefenderPolicy defender)
+{
+    TrialSampler sampler(parameters);
+    EventQueue   attackerEventQueue, defenderEventQueue;
+    long         trialsPerGroup, groupWins;
+    int          defenderTime;
+    int          battleTimer, nextTime;
+    int          attackerBattleHP, defenderBattleHP;
+    int          attackerEnergy, defenderEnergy;
+    PlayerEvents playerEvent;
+    long         i;
+
+    trialsPerGroup = TrialsPerGroup(parameters);
+    groupWins = 0;
+    for (i = 0; i < parameters.numTrials; ++i) {
+        sampler.StartTrial(i);
+
+        /* set up event queues */
+        attackerEventQueue.Initialize(1);
+        attackerEventQueue.Add(parameters.offensiveInitialInterval, parameters.attackerTransforms ? PlayerStartsTransform : PlayerStartsAttack);
+        defenderEventQueue.Initialize(parameters.numDefensiveInitialIntervals);
+        defenderTime = parameters.defensiveInitialIntervals[0];
+        defenderEventQueue.Add(defenderTime, parameters.defenderTransforms ? PlayerStartsTransform : PlayerStartsInitialAttack);
+        defenderTime += parameters.defensiveInitialIntervals[1];
+        defenderEventQueue.Add(defenderTime, PlayerStartsInitialAttack);
+        if (parameters.randomness) {
+            defenderTime += sampler.Interval(parameters.defensiveInitialIntervals[2], parameters.defensiveIntervalRandomness);
+        } else {
+            defenderTime += parameters.defensiveInitialIntervals[2];
+        }
+        defenderEventQueue.Add(defenderTime, PlayerStartsAttack);
+
+        /* simulate battle */
+        battleTimer = parameters.battleDuration;
+        attackerBattleHP = parameters.attackerHP;
+        defenderBattleHP = (int) (parameters.defenderHP * parameters.defensiveHPMultiplier);
+        attackerEnergy = 0;
+        defenderEnergy = 0;
+        attacker.StartBattle(parameters);
+        defender.StartBattle(parameters);
+        while (battleTimer > 0 && attackerBattleHP > 0 && defenderBattleHP > 0) {
+
+            /* count down timers to next event */
+            nextTime = Min(attackerEventQueue.Timer(), defenderEventQueue.Timer());
+            attackerEventQueue.CountDown(nextTime);
+            defenderEventQueue.CountDown(nextTime);
+            battleTimer -= nextTime;
+
+            /* attacker event */
+            if (attackerEventQueue.Timer() == 0) {
+                playerEvent = attackerEventQueue.Pop();
+                switch (playerEvent) {
+                case PlayerLandsFastAttack:
+                    defenderBattleHP -= parameters.attackerFastAttackDamage;
+                    defenderEnergy = Min(defenderEnergy + DamageEnergy(parameters, parameters.attackerFastAttackDamage), parameters.maxDefenderEnergy);
+                    break;
+                case PlayerLandsSpecialAttack:
+                    defenderBattleHP -= parameters.attackerSpecialAttackDamage;
+                    defenderEnergy = Min(defenderEnergy + DamageEnergy(parameters, parameters.attackerSpecialAttackDamage), parameters.maxDefenderEnergy);
+                    break;
+                case PlayerLandsTransform:
+                    defenderBattleHP -= parameters.transformDamage;
+                    defenderEnergy = Min(defenderEnergy + DamageEnergy(parameters, parameters.transformDamage), parameters.maxDefenderEnergy);
+                    break;
+                case PlayerStartsTransform:
+                    attackerEnergy = Min(attackerEnergy + parameters.transformEnergy, parameters.maxAttackerEnergy);
+                    attackerEventQueue.Add(parameters.transformDamageStart, PlayerLandsTransform);
+                    attackerEventQueue.Add(parameters.transformDuration, PlayerFinishesTransform);
+                    break;
+                case PlayerStartsAttack:
+                case PlayerFinishesFastAttack:
+                case PlayerFinishesSpecialAttack:
+                case PlayerFinishesTransform:
+                    if (attacker.StartsSpecialAttack(attackerEnergy)) {
+                        attackerEventQueue.Add(parameters.longPressDuration, PlayerFinishesLongPress);
+                    } else {
+                        attackerEnergy = Min(attackerEnergy + parameters.attackerFastAttackEnergy, parameters.maxAttackerEnergy);
+                        attackerEventQueue.Add(parameters.attackerFastAttackDamageStart, PlayerLandsFastAttack);
+                        attackerEventQueue.Add(parameters.attackerFastAttackDuration, PlayerFinishesFastAttack);
+                    }
+                    break;
+                case PlayerFinishesLongPress:
+                    attackerEnergy = attackerEnergy + parameters.attackerSpecialAttackEnergy;
+                    attackerEventQueue.Add(parameters.attackerSpecialAttackDamageStart, PlayerLandsSpecialAttack);
+                    attackerEventQueue.Add(parameters.attackerSpecialAttackDuration, PlayerFinishesSpecialAttack);
+                    break;
+                default:
+                    assert(false);
+                    break;
+                }
+            }
+
+            /* defender event */
+            if (defenderEventQueue.Timer() == 0) {
+                playerEvent = defenderEventQueue.Pop();
+                switch (playerEvent) {
+                case PlayerLandsFastAttack:
+                    attackerBattleHP -= parameters.defenderFastAttackDamage;
+                    attackerEnergy = Min(attackerEnergy + DamageEnergy(parameters, parameters.defenderFastAttackDamage), parameters.maxAttackerEnergy);
+                    break;
+                case PlayerLandsSpecialAttack:
+                    attackerBattleHP -= parameters.defenderSpecialAttackDamage;
+                    attackerEnergy = Min(attackerEnergy + DamageEnergy(parameters, parameters.defenderSpecialAttackDamage), parameters.maxAttackerEnergy);
+                    break;
+                case PlayerLandsTransform:
+                    attackerBattleHP -= parameters.transformDamage;
+                    attackerEnergy = Min(attackerEnergy + DamageEnergy(parameters, parameters.transformDamage), parameters.maxAttackerEnergy);
+                    break;
+                case PlayerStartsTransform:
+                    defenderEnergy = Min(defenderEnergy + parameters.transformEnergy, parameters.maxDefenderEnergy);
+                    defenderEventQueue.Add(parameters.transformDamageStart, PlayerLandsTransform);
+                    defenderEventQueue.Add(parameters.transformDuration, PlayerFinishesTransform);
+                    break;
+                case PlayerStartsAttack:
+                case PlayerStartsInitialAttack:
+                    if (defender.StartsSpecialAttack(defenderEnergy, sampler)) {
+                        defenderEnergy = defenderEnergy + parameters.defenderSpecialAttackEnergy;
+                        defenderEventQueue.Add(parameters.defenderSpecialAttackDamageStart, PlayerLandsSpecialAttack);
+                        defenderEventQueue.Add(parameters.defenderSpecialAttackDuration,
+                                               (playerEvent == PlayerStartsInitialAttack) ? PlayerFinishesInitialSpecialAttack : PlayerFinishesSpecialAttack);
+                    } else {
+                        defenderEnergy = Min(defenderEnergy + parameters.defenderFastAttackEnergy, parameters.maxDefenderEnergy);
+                        defenderEventQueue.Add(parameters.defenderFastAttackDamageStart, PlayerLandsFastAttack);
+                        defenderEventQueue.Add(parameters.defenderFastAttackDuration,
+                                               (playerEvent == PlayerStartsInitialAttack) ? PlayerFinishesInitialFastAttack : PlayerFinishesFastAttack);
+                    }
+                    break;
+                case PlayerFinishesFastAttack:
+                case PlayerFinishesSpecialAttack:
+                    /* defender idles before its next attack */
+                    if (parameters.randomness) {
+                        defenderEventQueue.Add(sampler.Interval(parameters.defensiveInterval, parameters.defensiveIntervalRandomness), PlayerStartsAttack);
+                    } else {
+                        defenderEventQueue.Add(parameters.defensiveInterval, PlayerStartsAttack);
+                    }
+                    break;
+                case PlayerFinishesInitialFastAttack:
+                case PlayerFinishesInitialSpecialAttack:
+                case PlayerFinishesTransform:
+                    /* initial attacks do not start new attacks */
+                    break;
+                default:
+                    assert(false);
+                    break;
+                }
+            }
+        }
+
+        if (defenderBattleHP <= 0) {
+            ++tally.numWins;
+            ++groupWins;
+        }
+        if ((i + 1) % trialsPerGroup == 0) {
+            tally.sumOfSquaredGroupWins += (long long) groupWins * groupWins;
+            groupWins = 0;
+        }
+    }
+}
+
+
+void SimulateReferenceBattles(const BattleParameters &parameters, BattleResult &result)
+{
+    BattleTally tally;
+
+    tally.numWins = 0;
+    tally.sumOfSquaredGroupWins = 0;
+    DispatchPolicies(parameters.attackerPolicy, parameters.defenderPolicy, [&] (auto attacker, auto defender) {
+        SimulateReferenceTrials(parameters, tally, attacker, defender);
+    });
+    FinishBattles(parameters, tally, result);
+}
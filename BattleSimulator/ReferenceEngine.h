@@ -0,0 +1,10 @@
+#pragma once
+
+
+#include "BattleEngine.h"
+
+
+/* the battle engine as a plain event-by-event loop, kept as the definition the optimized engines must reproduce */
+/* every attack is simulated and every battle runs to its end, with the same draws from the same random number streams, */
+/* so the tally of any optimized engine on the same trials must be identical */
+void SimulateReferenceBattles (const BattleParameters &parameters, BattleResult &result);
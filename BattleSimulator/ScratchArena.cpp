@@ -0,0 +1,98 @@
+#include <assert.h>
+#include <stddef.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "ScratchArena.h"
+
+
+ScratchArena::ScratchArena(void)
+{
+    blockNum = 0;
+    used = 0;
+}
+
+
+ScratchArena::~ScratchArena(void)
+{
+    for (auto &block : blocks) {
+        delete[] block.memory;
+    }
+}
+
+
+/* memory for the given number of bytes until the arena is released past it */
+/* moves on to the next block when the current one is full, and adds a block twice as large as the last after the last */
+void *ScratchArena::Allocate(size_t size, size_t alignment)
+{
+    ScratchBlock block;
+    size_t       offset;
+
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && alignment <= alignof(max_align_t));
+    offset = (used + alignment - 1) & ~(alignment - 1);
+    while (blockNum < blocks.size() && offset + size > blocks[blockNum].size) {
+        ++blockNum;
+        offset = 0;
+    }
+    if (blockNum == blocks.size()) {
+        block.size = std::max(std::max(minScratchBlockSize, blocks.empty() ? 0 : 2 * blocks.back().size), size);
+        block.memory = new char[block.size];
+        blocks.push_back(block);
+        offset = 0;
+    }
+    used = offset + size;
+    return blocks[blockNum].memory + offset;
+}
+
+
+ScratchMark ScratchArena::Mark(void)
+{
+    ScratchMark mark;
+
+    mark.blockNum = blockNum;
+    mark.used = used;
+    return mark;
+}
+
+
+/* free everything allocated since the mark, and return the blocks over the retained size to the heap once the arena is empty */
+void ScratchArena::Release(const ScratchMark &mark)
+{
+    size_t retainedSize;
+    size_t i;
+
+    blockNum = mark.blockNum;
+    used = mark.used;
+    if (blockNum != 0 || used != 0) return;
+    retainedSize = 0;
+    for (i = 0; i < blocks.size() && retainedSize + blocks[i].size <= maxRetainedScratch; ++i) {
+        retainedSize += blocks[i].size;
+    }
+    while (blocks.size() > i) {
+        delete[] blocks.back().memory;
+        blocks.pop_back();
+    }
+}
+
+
+/* arena of the calling thread */
+ScratchArena &ScratchArena::ThreadArena(void)
+{
+    static thread_local ScratchArena arena;
+
+    return arena;
+}
+
+
+ScratchScope::ScratchScope(ScratchArena &arena)
+    : arena(arena)
+{
+    mark = arena.Mark();
+}
+
+
+ScratchScope::~ScratchScope(void)
+{
+    arena.Release(mark);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+
+#include <stddef.h>
+
+#include <vector>
+
+
+/* smallest block a scratch arena takes from the heap */
+const size_t minScratchBlockSize = 64 << 10;
+
+/* most bytes a thread's scratch arena keeps once everything is released, larger blocks go back to the heap */
+const size_t maxRetainedScratch = 16 << 20;
+
+
+/* point in a scratch arena to release back to */
+struct ScratchMark {
+    size_t blockNum;
+    size_t used;
+};
+
+
+/* memory for the scratch data of one evaluation, allocated by bumping a pointer and released all at once */
+/* blocks are kept for the next evaluation, so evaluations in steady state take nothing from the heap */
+class ScratchArena {
+public:
+                         ScratchArena  (void);
+
+                         ~ScratchArena (void);
+
+    void                 *Allocate     (size_t size, size_t alignment);
+
+    ScratchMark          Mark          (void);
+
+    void                 Release       (const ScratchMark &mark);
+
+    static ScratchArena  &ThreadArena  (void);
+
+private:
+    struct ScratchBlock {
+        char   *memory;
+        size_t size;
+    };
+
+                         ScratchArena  (const ScratchArena &arena);
+
+    std::vector<ScratchBlock> blocks;
+    size_t                    blockNum;
+    size_t                    used;
+};
+
+
+/* releases everything allocated from an arena during its lifetime, scopes on one arena must nest */
+class ScratchScope {
+public:
+                 ScratchScope  (ScratchArena &arena);
+
+                 ~ScratchScope (void);
+
+private:
+    ScratchArena &arena;
+    ScratchMark  mark;
+};
+
+
+/* standard allocator from a scratch arena, whose memory comes back when the arena is released */
+template <class T>
+class ScratchAllocator {
+public:
+    typedef T value_type;
+
+    inline ScratchAllocator(ScratchArena &arena)
+    {
+        this->arena = &arena;
+    }
+
+    template <class U>
+    inline ScratchAllocator(const ScratchAllocator<U> &allocator)
+    {
+        arena = allocator.arena;
+    }
+
+    inline T *allocate(size_t n)
+    {
+        return static_cast<T *>(arena->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    inline void deallocate(T *, size_t)
+    {
+    }
+
+    ScratchArena *arena;
+};
+
+
+template <class T, class U>
+inline bool operator==(const ScratchAllocator<T> &allocator1, const ScratchAllocator<U> &allocator2)
+{
+    return allocator1.arena == allocator2.arena;
+}
+
+
+template <class T, class U>
+inline bool operator!=(const ScratchAllocator<T> &allocator1, const ScratchAllocator<U> &allocator2)
+{
+    return allocator1.arena != allocator2.arena;
+}
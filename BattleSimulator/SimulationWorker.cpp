@@ -0,0 +1,220 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BattleEngine.h"
+#include "EnginePlanner.h"
+#include "MatchupCache.h"
+#include "Socket.h"
+#include "WorkerProtocol.h"
+
+#include "SimulationWorker.h"
+
+
+/* connection to one client, shared by its reader thread and the simulation threads replying to it */
+struct ClientConnection {
+    SocketHandle socket;
+    std::mutex   sendLock;
+};
+
+
+/* results of a tile, replied when its last matchup is simulated */
+struct TileState {
+    unsigned long long        tileId;
+    std::vector<BattleResult> results;
+    std::atomic<long>         numRemaining;
+};
+
+
+/* one matchup of a simulate request or of a tile */
+struct SimulateJob {
+    std::shared_ptr<ClientConnection> client;
+    unsigned long long                requestId;
+    BattleParameters                  parameters;
+    std::shared_ptr<TileState>        tile;
+    long                              matchupNum;
+};
+
+
+/* requests from all clients waiting for a simulation thread */
+class JobQueue {
+public:
+    void        Push (const SimulateJob &job);
+
+    SimulateJob Pop  (void);
+
+private:
+    std::deque<SimulateJob>  jobs;
+    std::mutex               lock;
+    std::condition_variable  jobAdded;
+};
+
+
+void JobQueue::Push(const SimulateJob &job)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        jobs.push_back(job);
+    }
+    jobAdded.notify_one();
+}
+
+
+SimulateJob JobQueue::Pop(void)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    SimulateJob                  job;
+
+    jobAdded.wait(guard, [this] { return !jobs.empty(); });
+    job = jobs.front();
+    jobs.pop_front();
+    return job;
+}
+
+
+/* results shared by every workbook connected to this worker */
+MatchupCache workerCache;
+
+/* rand() has one state per process, so legacy random trials run one matchup at a time */
+std::mutex legacyRandomLock;
+
+
+void SimulateJobs(JobQueue &jobQueue)
+{
+    std::ofstream logFile;
+    SimulateJob   job;
+    BattleKey     key;
+    BattleResult  result;
+    unsigned char              reply[simulateReplySize];
+    std::vector<unsigned char> tileReply;
+
+    while (true) {
+        job = jobQueue.Pop();
+        MakeBattleKey(job.parameters, key);
+        if (!workerCache.Find(key, result)) {
+            if (job.parameters.randomness && !job.parameters.commonRandomNumbers && !job.parameters.quasiMonteCarlo) {
+                std::lock_guard<std::mutex> guard(legacyRandomLock);
+
+                EvaluateBattles(job.parameters, logFile, result);
+            } else {
+                EvaluateBattles(job.parameters, logFile, result);
+            }
+            workerCache.Insert(key, result);
+        }
+
+        /* a client that went away just loses its replies */
+        if (job.tile) {
+            job.tile->results[job.matchupNum] = result;
+            if (--job.tile->numRemaining > 0) continue;
+            EncodeTileReply(job.tile->tileId, job.tile->results, tileReply);
+            std::lock_guard<std::mutex> guard(job.client->sendLock);
+
+            (void) SendBytes(job.client->socket, tileReply.data(), tileReply.size());
+        } else {
+            EncodeSimulateReply(job.requestId, result, reply);
+            std::lock_guard<std::mutex> guard(job.client->sendLock);
+
+            (void) SendBytes(job.client->socket, reply, sizeof reply);
+        }
+    }
+}
+
+
+/* queue the matchups of a tile request whose header has been received */
+bool ReadTile(std::shared_ptr<ClientConnection> client, const unsigned char header[messageHeaderSize], JobQueue &jobQueue)
+{
+    std::vector<unsigned char>    request;
+    std::vector<BattleParameters> parameters;
+    std::shared_ptr<TileState>    tile;
+    SimulateJob                   job;
+    long                          numMatchups;
+
+    request.assign(header, header + messageHeaderSize);
+    request.resize(tileHeaderSize);
+    if (!ReceiveBytes(client->socket, request.data() + messageHeaderSize, tileHeaderSize - messageHeaderSize)) return false;
+    numMatchups = TileMatchups(request.data());
+    if (numMatchups <= 0) return false;
+    request.resize(TileRequestSize(numMatchups));
+    if (!ReceiveBytes(client->socket, request.data() + tileHeaderSize, request.size() - tileHeaderSize)) return false;
+
+    tile = std::make_shared<TileState>();
+    if (!DecodeTileRequest(request, tile->tileId, parameters)) return false;
+    tile->results.resize(numMatchups);
+    tile->numRemaining = numMatchups;
+
+    job.client = client;
+    job.requestId = tile->tileId;
+    job.tile = tile;
+    for (job.matchupNum = 0; job.matchupNum < numMatchups; ++job.matchupNum) {
+        job.parameters = parameters[job.matchupNum];
+        jobQueue.Push(job);
+    }
+    return true;
+}
+
+
+/* queue the requests of one client until it disconnects or sends a bad message */
+void ReadRequests(std::shared_ptr<ClientConnection> client, JobQueue &jobQueue)
+{
+    unsigned char request[simulateRequestSize];
+    SimulateJob   job;
+    bool          valid;
+
+    job.client = client;
+    job.matchupNum = 0;
+    valid = true;
+    while (valid && ReceiveBytes(client->socket, request, messageHeaderSize)) {
+        switch (MessageType(request)) {
+        case SimulateRequestMessage:
+            valid = ReceiveBytes(client->socket, request + messageHeaderSize, simulateRequestSize - messageHeaderSize) &&
+                    DecodeSimulateRequest(request, job.requestId, job.parameters);
+            if (valid) jobQueue.Push(job);
+            break;
+        case TileRequestMessage:
+            valid = ReadTile(client, request, jobQueue);
+            break;
+        default:
+            valid = false;
+            break;
+        }
+    }
+    ShutdownSocket(client->socket);
+}
+
+
+/* the socket is closed when the last job holding the connection is done */
+void CloseClient(ClientConnection *client)
+{
+    CloseSocket(client->socket);
+    delete client;
+}
+
+
+bool RunSimulationWorker(const char *host, int port, int numThreads)
+{
+    SocketHandle                      listener, socket;
+    JobQueue                          jobQueue;
+    std::shared_ptr<ClientConnection> client;
+    int                               threadNum;
+
+    if (!StartSockets()) return false;
+    listener = ListenSocket(host, port);
+    if (listener == invalidSocket) return false;
+
+    for (threadNum = 0; threadNum < numThreads; ++threadNum) {
+        std::thread(SimulateJobs, std::ref(jobQueue)).detach();
+    }
+    while (true) {
+        socket = AcceptSocket(listener);
+        if (socket == invalidSocket) continue;
+        client = std::shared_ptr<ClientConnection>(new ClientConnection, CloseClient);
+        client->socket = socket;
+        std::thread(ReadRequests, client, std::ref(jobQueue)).detach();
+    }
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+
+/* serve simulate and tile requests from any number of clients until the process is killed */
+/* listen on 127.0.0.1 for workbooks on the same machine, or 0.0.0.0 for grid coordinators on other machines */
+/* returns only if the port cannot be opened */
+bool RunSimulationWorker (const char *host, int port, int numThreads);
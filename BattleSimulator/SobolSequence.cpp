@@ -0,0 +1,138 @@
+#include <assert.h>
+
+#include "SobolSequence.h"
+
+
+/* primitive polynomial and initial direction numbers for dimensions 2 and up (Joe and Kuo) */
+struct SobolInitializer {
+    int          degree;
+    unsigned int coefficients;
+    unsigned int initialNumbers[7];
+};
+
+
+const SobolInitializer sobolInitializers[maxSobolDimensions - 1] = {
+    {1,  0, {1}},
+    {2,  1, {1, 3}},
+    {3,  1, {1, 3, 1}},
+    {3,  2, {1, 1, 1}},
+    {4,  1, {1, 1, 3, 3}},
+    {4,  4, {1, 3, 5, 13}},
+    {5,  2, {1, 1, 5, 5, 17}},
+    {5,  4, {1, 1, 5, 5, 5}},
+    {5,  7, {1, 1, 7, 11, 19}},
+    {5, 11, {1, 1, 5, 1, 1}},
+    {5, 13, {1, 1, 1, 3, 11}},
+    {5, 14, {1, 3, 5, 5, 31}},
+    {6,  1, {1, 3, 3, 9, 7, 49}},
+    {6, 13, {1, 1, 1, 15, 21, 21}},
+    {6, 16, {1, 3, 1, 13, 27, 49}},
+    {6, 19, {1, 1, 1, 15, 7, 5}},
+    {6, 22, {1, 3, 1, 15, 13, 25}},
+    {6, 25, {1, 1, 5, 5, 19, 61}},
+    {7,  1, {1, 3, 7, 11, 23, 15, 103}},
+    {7,  4, {1, 3, 7, 13, 13, 15, 69}}
+};
+
+
+inline unsigned int Parity(unsigned int bits)
+{
+    bits ^= bits >> 16;
+    bits ^= bits >> 8;
+    bits ^= bits >> 4;
+    bits ^= bits >> 2;
+    bits ^= bits >> 1;
+    return bits & 1;
+}
+
+
+SobolSequence::SobolSequence(void)
+{
+    int                    dimension;
+    int                    bit, term;
+    const SobolInitializer *initializer;
+    unsigned int           direction;
+
+    /* first dimension is the van der Corput sequence */
+    for (bit = 0; bit < numSobolBits; ++bit) {
+        directions[0][bit] = 1u << (numSobolBits - 1 - bit);
+    }
+
+    /* other dimensions follow the recurrence of their primitive polynomials */
+    for (dimension = 1; dimension < maxSobolDimensions; ++dimension) {
+        initializer = &sobolInitializers[dimension - 1];
+        for (bit = 0; bit < numSobolBits; ++bit) {
+            if (bit < initializer->degree) {
+                direction = initializer->initialNumbers[bit] << (numSobolBits - 1 - bit);
+            } else {
+                direction = directions[dimension][bit - initializer->degree];
+                direction ^= direction >> initializer->degree;
+                for (term = 1; term < initializer->degree; ++term) {
+                    if ((initializer->coefficients >> (initializer->degree - 1 - term)) & 1) {
+                        direction ^= directions[dimension][bit - term];
+                    }
+                }
+            }
+            directions[dimension][bit] = direction;
+        }
+    }
+    Randomize(0, -1);
+}
+
+
+void SobolSequence::Randomize(int rngSeed, long randomizationNum)
+{
+    RandomStream scrambleStream;
+    unsigned int rows[numSobolBits];
+    int          dimension;
+    int          bit, row;
+    unsigned int scrambled;
+
+    if (randomizationNum < 0) {
+        /* unscrambled sequence */
+        for (dimension = 0; dimension < maxSobolDimensions; ++dimension) {
+            for (bit = 0; bit < numSobolBits; ++bit) {
+                scrambledDirections[dimension][bit] = directions[dimension][bit];
+            }
+            shifts[dimension] = 0;
+        }
+        return;
+    }
+
+    scrambleStream.Seed(rngSeed, randomizationNum, ScrambleStream);
+    for (dimension = 0; dimension < maxSobolDimensions; ++dimension) {
+        /* random lower triangular matrix with unit diagonal, digits ordered from most significant */
+        for (row = 0; row < numSobolBits; ++row) {
+            rows[row] = (unsigned int) (scrambleStream.Uniform() * 4294967296.0);
+            rows[row] &= ~(0xFFFFFFFFu >> row);
+            rows[row] |= 1u << (numSobolBits - 1 - row);
+        }
+        /* linear scrambling of the sequence is scrambling of its direction numbers */
+        for (bit = 0; bit < numSobolBits; ++bit) {
+            scrambled = 0;
+            for (row = 0; row < numSobolBits; ++row) {
+                scrambled |= Parity(rows[row] & directions[dimension][bit]) << (numSobolBits - 1 - row);
+            }
+            scrambledDirections[dimension][bit] = scrambled;
+        }
+        /* random digital shift */
+        shifts[dimension] = (unsigned int) (scrambleStream.Uniform() * 4294967296.0);
+    }
+}
+
+
+double SobolSequence::Point(unsigned long pointNum, int dimension)
+{
+    unsigned int coordinate;
+    int          bit;
+
+    assert(dimension >= 0 && dimension < maxSobolDimensions);
+    coordinate = shifts[dimension];
+    for (bit = 0; pointNum != 0; ++bit, pointNum >>= 1) {
+        assert(bit < numSobolBits);
+        if (pointNum & 1) {
+            coordinate ^= scrambledDirections[dimension][bit];
+        }
+    }
+    return coordinate * (1.0 / 4294967296.0);
+}
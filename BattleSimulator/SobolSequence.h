@@ -0,0 +1,28 @@
+#pragma once
+
+
+#include "RandomStream.h"
+
+
+/* number of dimensions with direction numbers */
+const int maxSobolDimensions = 21;
+
+/* number of bits in each coordinate */
+const int numSobolBits = 32;
+
+
+/* Sobol low-discrepancy sequence with random linear scrambling and digital shift */
+/* every randomization is an independent unbiased estimator, so error estimates still work */
+class SobolSequence {
+public:
+                 SobolSequence (void);
+
+    void         Randomize     (int rngSeed, long randomizationNum);
+
+    double       Point         (unsigned long pointNum, int dimension);
+
+private:
+    unsigned int directions[maxSobolDimensions][numSobolBits];
+    unsigned int scrambledDirections[maxSobolDimensions][numSobolBits];
+    unsigned int shifts[maxSobolDimensions];
+};
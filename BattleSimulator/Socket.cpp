@@ -0,0 +1,146 @@
+#include <stddef.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "Socket.h"
+
+
+#ifdef _WIN32
+#define SEND_FLAGS 0
+#else
+/* report closed connections as errors instead of raising SIGPIPE */
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+
+bool StartSockets(void)
+{
+#ifdef _WIN32
+    WSADATA wsaData;
+
+    return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+    return true;
+#endif
+}
+
+
+/* listen on the loopback interface only */
+/* returns invalidSocket if the address is not a dotted IPv4 address or the port is taken */
+SocketHandle ListenSocket(const char *host, int port)
+{
+    SocketHandle listener;
+    sockaddr_in  address;
+    int          reuse;
+
+    memset(&address, 0, sizeof address);
+    address.sin_family = AF_INET;
+    if (inet_pton(AF_INET, host, &address.sin_addr) != 1) return invalidSocket;
+    address.sin_port = htons((unsigned short) port);
+
+    listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener == invalidSocket) return invalidSocket;
+    reuse = 1;
+    (void) setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char *) &reuse, sizeof reuse);
+    if (bind(listener, (sockaddr *) &address, sizeof address) != 0 || listen(listener, SOMAXCONN) != 0) {
+        CloseSocket(listener);
+        return invalidSocket;
+    }
+    return listener;
+}
+
+
+SocketHandle AcceptSocket(SocketHandle listener)
+{
+    SocketHandle client;
+    int          noDelay;
+
+    client = accept(listener, nullptr, nullptr);
+    if (client != invalidSocket) {
+        /* requests and replies are small */
+        noDelay = 1;
+        (void) setsockopt(client, IPPROTO_TCP, TCP_NODELAY, (const char *) &noDelay, sizeof noDelay);
+    }
+    return client;
+}
+
+
+SocketHandle ConnectSocket(const char *host, int port)
+{
+    SocketHandle server;
+    sockaddr_in  address;
+    int          noDelay;
+
+    memset(&address, 0, sizeof address);
+    address.sin_family = AF_INET;
+    address.sin_port = htons((unsigned short) port);
+    if (inet_pton(AF_INET, host, &address.sin_addr) != 1) return invalidSocket;
+    server = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (server == invalidSocket) return invalidSocket;
+    if (connect(server, (sockaddr *) &address, sizeof address) != 0) {
+        CloseSocket(server);
+        return invalidSocket;
+    }
+    noDelay = 1;
+    (void) setsockopt(server, IPPROTO_TCP, TCP_NODELAY, (const char *) &noDelay, sizeof noDelay);
+    return server;
+}
+
+
+bool SendBytes(SocketHandle socket, const void *bytes, size_t numBytes)
+{
+    const char *next;
+    int         numSent;
+
+    for (next = (const char *) bytes; numBytes > 0; next += numSent, numBytes -= numSent) {
+        numSent = send(socket, next, (int) numBytes, SEND_FLAGS);
+        if (numSent <= 0) return false;
+    }
+    return true;
+}
+
+
+/* returns false if the connection closes before all bytes arrive */
+bool ReceiveBytes(SocketHandle socket, void *bytes, size_t numBytes)
+{
+    char *next;
+    int  numReceived;
+
+    for (next = (char *) bytes; numBytes > 0; next += numReceived, numBytes -= numReceived) {
+        numReceived = recv(socket, next, (int) numBytes, 0);
+        if (numReceived <= 0) return false;
+    }
+    return true;
+}
+
+
+/* wake up any thread blocked receiving on the socket */
+void ShutdownSocket(SocketHandle socket)
+{
+#ifdef _WIN32
+    (void) shutdown(socket, SD_BOTH);
+#else
+    (void) shutdown(socket, SHUT_RDWR);
+#endif
+}
+
+
+void CloseSocket(SocketHandle socket)
+{
+#ifdef _WIN32
+    (void) closesocket(socket);
+#else
+    (void) close(socket);
+#endif
+}
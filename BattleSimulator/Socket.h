@@ -0,0 +1,35 @@
+#pragma once
+
+
+#include <stddef.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#endif
+
+
+/* blocking TCP sockets, Winsock on Windows and BSD sockets elsewhere */
+#ifdef _WIN32
+typedef SOCKET SocketHandle;
+const SocketHandle invalidSocket = INVALID_SOCKET;
+#else
+typedef int SocketHandle;
+const SocketHandle invalidSocket = -1;
+#endif
+
+
+bool         StartSockets   (void);
+
+SocketHandle ListenSocket   (const char *host, int port);
+
+SocketHandle AcceptSocket   (SocketHandle listener);
+
+SocketHandle ConnectSocket  (const char *host, int port);
+
+bool         SendBytes      (SocketHandle socket, const void *bytes, size_t numBytes);
+
+bool         ReceiveBytes   (SocketHandle socket, void *bytes, size_t numBytes);
+
+void         ShutdownSocket (SocketHandle socket);
+
+void         CloseSocket    (SocketHandle socket);
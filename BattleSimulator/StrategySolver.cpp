@@ -0,0 +1,513 @@
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include <string>
+#include <unordered_map>
+
+#include "ScratchArena.h"
+
+#include "StrategySolver.h"
+
+
+/* where the solver's battle is, the choice and draw phases are the nodes of the value tables */
+enum SolverPhases {
+    LoopPhase,
+    DefenderPhase,
+    AttackerChoicePhase,
+    DeferralPhase,
+    InitialIntervalPhase,
+    IntervalPhase,
+    FinalPhase
+};
+
+
+inline int Min(int number1, int number2)
+{
+    return (number1 < number2) ? number1 : number2;
+}
+
+
+/* insert an event after any events at the same time, like EventQueue::Add() */
+inline void AddEvent(EventRecord events[], int &numEvents, int maxEvents, int time, PlayerEvents playerEvent)
+{
+    int i;
+
+    assert(numEvents < maxEvents);
+    i = numEvents;
+    while (i > 0 && events[i - 1].time > time) {
+        events[i] = events[i - 1];
+        --i;
+    }
+    events[i].time = time;
+    events[i].event = playerEvent;
+    ++numEvents;
+}
+
+
+/* remove the first event and zero its slot so states still compare as bytes */
+inline PlayerEvents PopEvent(EventRecord events[], int &numEvents)
+{
+    PlayerEvents playerEvent;
+    int          i;
+
+    assert(numEvents > 0 && events[0].time == 0);
+    playerEvent = events[0].event;
+    for (i = 1; i < numEvents; ++i) {
+        events[i - 1] = events[i];
+    }
+    --numEvents;
+    events[numEvents].time = 0;
+    events[numEvents].event = NullEvent;
+    return playerEvent;
+}
+
+
+inline void CountDownEvents(EventRecord events[], int numEvents, int time)
+{
+    int i;
+
+    for (i = 0; i < numEvents; ++i) {
+        events[i].time -= time;
+    }
+}
+
+
+/* number of equally likely points a random interval is split into */
+inline int NumIntervalPoints(int intervalRandomness, int numIntervalPoints)
+{
+    return (intervalRandomness + 1 < numIntervalPoints) ? intervalRandomness + 1 : numIntervalPoints;
+}
+
+
+/* interval at the middle of one of the equally likely parts of the range TrialSampler::Interval() draws from */
+inline int IntervalPoint(int expectedInterval, int intervalRandomness, int pointNum, int numPoints)
+{
+    return expectedInterval - intervalRandomness / 2 + (int) ((intervalRandomness + 1) * (pointNum + 0.5) / numPoints);
+}
+
+
+size_t SolverStateHash::operator() (const SolverState &state) const
+{
+    const int          *words;
+    unsigned long long hash;
+    size_t             i;
+
+    /* FNV-1a over the state words */
+    words = (const int *) &state;
+    hash = 0xCBF29CE484222325ULL;
+    for (i = 0; i < sizeof state / sizeof (int); ++i) {
+        hash ^= (unsigned int) words[i];
+        hash *= 0x100000001B3ULL;
+        hash ^= hash >> 32;
+    }
+    return (size_t) hash;
+}
+
+
+bool SolverStateEqual::operator() (const SolverState &state1, const SolverState &state2) const
+{
+    return memcmp(&state1, &state2, sizeof state1) == 0;
+}
+
+
+StrategySolver::StrategySolver(const BattleParameters &parameters, int objective, int numIntervalPoints)
+    : scratch(ScratchArena::ThreadArena()),
+      optimalValues(0, SolverStateHash(), SolverStateEqual(), ScratchAllocator<ValueEntry>(ScratchArena::ThreadArena())),
+      greedyValues(0, SolverStateHash(), SolverStateEqual(), ScratchAllocator<ValueEntry>(ScratchArena::ThreadArena()))
+{
+    this->parameters = parameters;
+    this->objective = objective;
+    this->numIntervalPoints = numIntervalPoints;
+
+    /* the defender uses a special attack it has the energy for when its deferral draw is above the probability */
+    specialAttackProbability = fmin(fmax(1.0 - parameters.defensiveSpecialAttackProbability, 0.0), 1.0);
+    overflow = false;
+}
+
+
+/* attacker starts its chosen attack */
+void StrategySolver::StartAttack(SolverState &state, bool specialAttack)
+{
+    if (specialAttack) {
+        AddEvent(state.attackerEvents, state.numAttackerEvents, maxSolverAttackerEvents, parameters.longPressDuration, PlayerFinishesLongPress);
+    } else {
+        state.attackerEnergy = Min(state.attackerEnergy + parameters.attackerFastAttackEnergy, parameters.maxAttackerEnergy);
+        AddEvent(state.attackerEvents, state.numAttackerEvents, maxSolverAttackerEvents, parameters.attackerFastAttackDamageStart,
+                 PlayerLandsFastAttack);
+        AddEvent(state.attackerEvents, state.numAttackerEvents, maxSolverAttackerEvents, parameters.attackerFastAttackDuration,
+                 PlayerFinishesFastAttack);
+    }
+}
+
+
+/* defender starts the attack of its pending start event */
+void StrategySolver::StartDefenderAttack(SolverState &state, bool specialAttack)
+{
+    bool initialAttack;
+
+    initialAttack = state.pendingEvent == PlayerStartsInitialAttack;
+    if (specialAttack) {
+        state.defenderEnergy = state.defenderEnergy + parameters.defenderSpecialAttackEnergy;
+        AddEvent(state.defenderEvents, state.numDefenderEvents, maxSolverDefenderEvents, parameters.defenderSpecialAttackDamageStart,
+                 PlayerLandsSpecialAttack);
+        AddEvent(state.defenderEvents, state.numDefenderEvents, maxSolverDefenderEvents, parameters.defenderSpecialAttackDuration,
+                 initialAttack ? PlayerFinishesInitialSpecialAttack : PlayerFinishesSpecialAttack);
+    } else {
+        state.defenderEnergy = Min(state.defenderEnergy + parameters.defenderFastAttackEnergy, parameters.maxDefenderEnergy);
+        AddEvent(state.defenderEvents, state.numDefenderEvents, maxSolverDefenderEvents, parameters.defenderFastAttackDamageStart,
+                 PlayerLandsFastAttack);
+        AddEvent(state.defenderEvents, state.numDefenderEvents, maxSolverDefenderEvents, parameters.defenderFastAttackDuration,
+                 initialAttack ? PlayerFinishesInitialFastAttack : PlayerFinishesFastAttack);
+    }
+    state.pendingEvent = NullEvent;
+}
+
+
+/* defender starts its next attack after the third initial interval or an idle interval */
+void StrategySolver::AddInterval(SolverState &state, int pointNum)
+{
+    int expectedInterval, time, numPoints;
+
+    if (state.phase == InitialIntervalPhase) {
+        expectedInterval = parameters.defensiveInitialIntervals[2];
+        time = parameters.defensiveInitialIntervals[0] + parameters.defensiveInitialIntervals[1];
+    } else {
+        expectedInterval = parameters.defensiveInterval;
+        time = 0;
+    }
+    numPoints = NumIntervalPoints(parameters.defensiveIntervalRandomness, numIntervalPoints);
+    time += IntervalPoint(expectedInterval, parameters.defensiveIntervalRandomness, pointNum, numPoints);
+    AddEvent(state.defenderEvents, state.numDefenderEvents, maxSolverDefenderEvents, time, PlayerStartsAttack);
+    state.phase = LoopPhase;
+}
+
+
+/* run the battle loop of SimulateTrials() until the attacker has a choice, the defender draws, or the battle ends */
+/* forced fast attacks are added to the plan if there is one */
+int StrategySolver::Advance(SolverState &state, std::string *plan)
+{
+    PlayerEvents playerEvent;
+    int          nextTime, damage;
+    bool         specialAttack;
+
+    while (true) {
+        switch (state.phase) {
+        case LoopPhase:
+            if (state.battleTimer <= 0 || state.attackerBattleHP <= 0 || state.defenderBattleHP <= 0) {
+                state.phase = FinalPhase;
+                break;
+            }
+
+            /* count down timers to next event */
+            nextTime = Min(state.attackerEvents[0].time, state.defenderEvents[0].time);
+            CountDownEvents(state.attackerEvents, state.numAttackerEvents, nextTime);
+            CountDownEvents(state.defenderEvents, state.numDefenderEvents, nextTime);
+            state.battleTimer -= nextTime;
+            state.phase = DefenderPhase;
+            if (state.attackerEvents[0].time != 0) break;
+            playerEvent = PopEvent(state.attackerEvents, state.numAttackerEvents);
+
+            /* attacker finishes action */
+            switch (playerEvent) {
+            case PlayerLandsFastAttack:
+            case PlayerLandsSpecialAttack:
+            case PlayerLandsTransform:
+                if (playerEvent == PlayerLandsFastAttack) {
+                    damage = parameters.attackerFastAttackDamage;
+                } else if (playerEvent == PlayerLandsSpecialAttack) {
+                    damage = parameters.attackerSpecialAttackDamage;
+                } else {
+                    damage = parameters.transformDamage;
+                }
+                state.defenderBattleHP -= damage;
+                state.defenderEnergy = Min(state.defenderEnergy + (int) round(damage * parameters.energyPerDamage + tolerance),
+                                           parameters.maxDefenderEnergy);
+                break;
+            default:
+                break;
+            }
+
+            /* attacker performs next action */
+            switch (playerEvent) {
+            case PlayerStartsTransform:
+                state.attackerEnergy = Min(state.attackerEnergy + parameters.transformEnergy, parameters.maxAttackerEnergy);
+                AddEvent(state.attackerEvents, state.numAttackerEvents, maxSolverAttackerEvents, parameters.transformDamageStart, PlayerLandsTransform);
+                AddEvent(state.attackerEvents, state.numAttackerEvents, maxSolverAttackerEvents, parameters.transformDuration, PlayerFinishesTransform);
+                break;
+            case PlayerStartsAttack:
+            case PlayerFinishesFastAttack:
+            case PlayerFinishesSpecialAttack:
+            case PlayerFinishesTransform:
+                if (state.attackerEnergy >= -parameters.attackerSpecialAttackEnergy) {
+                    state.phase = AttackerChoicePhase;
+                } else {
+                    StartAttack(state, false);
+                    if (plan && plan->size() < (size_t) maxPlanLength) *plan += 'F';
+                }
+                break;
+            case PlayerFinishesLongPress:
+                state.attackerEnergy = state.attackerEnergy + parameters.attackerSpecialAttackEnergy;
+                AddEvent(state.attackerEvents, state.numAttackerEvents, maxSolverAttackerEvents, parameters.attackerSpecialAttackDamageStart,
+                         PlayerLandsSpecialAttack);
+                AddEvent(state.attackerEvents, state.numAttackerEvents, maxSolverAttackerEvents, parameters.attackerSpecialAttackDuration,
+                         PlayerFinishesSpecialAttack);
+                break;
+            default:
+                break;
+            }
+            break;
+
+        case DefenderPhase:
+            state.phase = LoopPhase;
+            if (state.defenderEvents[0].time != 0) break;
+            playerEvent = PopEvent(state.defenderEvents, state.numDefenderEvents);
+
+            /* defender finishes action */
+            switch (playerEvent) {
+            case PlayerLandsFastAttack:
+            case PlayerLandsSpecialAttack:
+            case PlayerLandsTransform:
+                if (playerEvent == PlayerLandsFastAttack) {
+                    damage = parameters.defenderFastAttackDamage;
+                } else if (playerEvent == PlayerLandsSpecialAttack) {
+                    damage = parameters.defenderSpecialAttackDamage;
+                } else {
+                    damage = parameters.transformDamage;
+                }
+                state.attackerBattleHP -= damage;
+                state.attackerEnergy = Min(state.attackerEnergy + (int) round(damage * parameters.energyPerDamage + tolerance),
+                                           parameters.maxAttackerEnergy);
+                break;
+            default:
+                break;
+            }
+
+            /* defender performs next action */
+            switch (playerEvent) {
+            case PlayerStartsTransform:
+                state.defenderEnergy = Min(state.defenderEnergy + parameters.transformEnergy, parameters.maxDefenderEnergy);
+                AddEvent(state.defenderEvents, state.numDefenderEvents, maxSolverDefenderEvents, parameters.transformDamageStart, PlayerLandsTransform);
+                AddEvent(state.defenderEvents, state.numDefenderEvents, maxSolverDefenderEvents, parameters.transformDuration, PlayerFinishesTransform);
+                break;
+            case PlayerStartsAttack:
+            case PlayerStartsInitialAttack:
+                state.pendingEvent = playerEvent;
+                if (state.defenderEnergy < -parameters.defenderSpecialAttackEnergy) {
+                    specialAttack = false;
+                } else if (parameters.randomness) {
+                    /* the deferral draw is a node unless its outcome is certain */
+                    if (specialAttackProbability > 0.0 && specialAttackProbability < 1.0) {
+                        state.phase = DeferralPhase;
+                        break;
+                    }
+                    specialAttack = specialAttackProbability >= 1.0;
+                } else {
+                    state.numDefensiveSpecialAttackOpportunities = state.numDefensiveSpecialAttackOpportunities + 1;
+                    specialAttack = state.numDefensiveSpecialAttackOpportunities > parameters.numDefensiveSpecialAttackDeferrals;
+                    if (specialAttack) state.numDefensiveSpecialAttackOpportunities = 0;
+                }
+                StartDefenderAttack(state, specialAttack);
+                break;
+            case PlayerFinishesFastAttack:
+            case PlayerFinishesSpecialAttack:
+                if (parameters.randomness && NumIntervalPoints(parameters.defensiveIntervalRandomness, numIntervalPoints) > 1) {
+                    state.phase = IntervalPhase;
+                } else {
+                    AddEvent(state.defenderEvents, state.numDefenderEvents, maxSolverDefenderEvents, parameters.defensiveInterval, PlayerStartsAttack);
+                }
+                break;
+            default:
+                break;
+            }
+            break;
+
+        default:
+            return state.phase;
+        }
+    }
+}
+
+
+/* value of a finished battle */
+double StrategySolver::FinalValue(const SolverState &state)
+{
+    if (state.defenderBattleHP > 0) return 0.0;
+    if (objective == WinTimeObjective) {
+        /* time left on the battle timer, so the largest value is the shortest win */
+        return (state.battleTimer > 0) ? state.battleTimer : 0.0;
+    }
+    return 1.0;
+}
+
+
+/* value of a choice or draw node with the best choices, or with the greedy attacker's choices */
+double StrategySolver::Value(const SolverState &state, bool greedy)
+{
+    ValueTable  &values = greedy ? greedyValues : optimalValues;
+    SolverState nextState;
+    SolverEntry entry;
+    double      fastValue;
+    int         numPoints, pointNum;
+
+    if (state.phase == FinalPhase) return FinalValue(state);
+    auto found = values.find(state);
+    if (found != values.end()) return found->second.value;
+    if (overflow) return 0.0;
+
+    switch (state.phase) {
+    case AttackerChoicePhase:
+        /* the greedy attacker always uses its special attack */
+        nextState = state;
+        StartAttack(nextState, true);
+        nextState.phase = DefenderPhase;
+        Advance(nextState, nullptr);
+        entry.value = Value(nextState, greedy);
+        entry.specialAttack = true;
+        if (!greedy) {
+            nextState = state;
+            StartAttack(nextState, false);
+            nextState.phase = DefenderPhase;
+            Advance(nextState, nullptr);
+            fastValue = Value(nextState, greedy);
+            if (fastValue > entry.value) {
+                entry.value = fastValue;
+                entry.specialAttack = false;
+            }
+        }
+        break;
+    case DeferralPhase:
+        nextState = state;
+        StartDefenderAttack(nextState, true);
+        nextState.phase = LoopPhase;
+        Advance(nextState, nullptr);
+        entry.value = specialAttackProbability * Value(nextState, greedy);
+        nextState = state;
+        StartDefenderAttack(nextState, false);
+        nextState.phase = LoopPhase;
+        Advance(nextState, nullptr);
+        entry.value += (1.0 - specialAttackProbability) * Value(nextState, greedy);
+        entry.specialAttack = false;
+        break;
+    default:
+        numPoints = NumIntervalPoints(parameters.defensiveIntervalRandomness, numIntervalPoints);
+        entry.value = 0.0;
+        for (pointNum = 0; pointNum < numPoints; ++pointNum) {
+            nextState = state;
+            AddInterval(nextState, pointNum);
+            Advance(nextState, nullptr);
+            entry.value += Value(nextState, greedy);
+        }
+        entry.value /= numPoints;
+        entry.specialAttack = false;
+        break;
+    }
+
+    if (values.size() >= maxSolverStates) {
+        overflow = true;
+    } else {
+        values.emplace(state, entry);
+    }
+    return entry.value;
+}
+
+
+/* follow the optimal choices along the most likely draws, from the state before the first advance */
+void StrategySolver::FollowPlan(SolverState state, std::string &plan)
+{
+    bool specialAttack;
+
+    plan.clear();
+    while (Advance(state, &plan) != FinalPhase && plan.size() < (size_t) maxPlanLength) {
+        switch (state.phase) {
+        case AttackerChoicePhase:
+            specialAttack = optimalValues[state].specialAttack;
+            plan += specialAttack ? 'S' : 'F';
+            StartAttack(state, specialAttack);
+            state.phase = DefenderPhase;
+            break;
+        case DeferralPhase:
+            StartDefenderAttack(state, specialAttackProbability >= 0.5);
+            state.phase = LoopPhase;
+            break;
+        default:
+            AddInterval(state, NumIntervalPoints(parameters.defensiveIntervalRandomness, numIntervalPoints) / 2);
+            break;
+        }
+    }
+}
+
+
+/* set up the battle like SimulateTrials() up to the defender's third initial interval */
+void StrategySolver::StartBattle(SolverState &startState)
+{
+    int defenderTime;
+
+    memset(&startState, 0, sizeof startState);
+    startState.battleTimer = parameters.battleDuration;
+    startState.attackerBattleHP = parameters.attackerHP;
+    startState.defenderBattleHP = (int) (parameters.defenderHP * parameters.defensiveHPMultiplier);
+    AddEvent(startState.attackerEvents, startState.numAttackerEvents, maxSolverAttackerEvents, parameters.offensiveInitialInterval,
+             parameters.attackerTransforms ? PlayerStartsTransform : PlayerStartsAttack);
+    defenderTime = parameters.defensiveInitialIntervals[0];
+    AddEvent(startState.defenderEvents, startState.numDefenderEvents, maxSolverDefenderEvents, defenderTime,
+             parameters.defenderTransforms ? PlayerStartsTransform : PlayerStartsInitialAttack);
+    defenderTime += parameters.defensiveInitialIntervals[1];
+    AddEvent(startState.defenderEvents, startState.numDefenderEvents, maxSolverDefenderEvents, defenderTime, PlayerStartsInitialAttack);
+    if (parameters.randomness && NumIntervalPoints(parameters.defensiveIntervalRandomness, numIntervalPoints) > 1) {
+        startState.phase = InitialIntervalPhase;
+    } else {
+        defenderTime += parameters.defensiveInitialIntervals[2];
+        AddEvent(startState.defenderEvents, startState.numDefenderEvents, maxSolverDefenderEvents, defenderTime, PlayerStartsAttack);
+        startState.phase = LoopPhase;
+    }
+
+    optimalValues.clear();
+    greedyValues.clear();
+    overflow = false;
+}
+
+
+/* returns false for a defender other than the standard one or a battle with too many states */
+bool StrategySolver::Solve(StrategyResult &result)
+{
+    SolverState startState, state;
+
+    if (parameters.defenderPolicy != StandardDefenderPolicy || numIntervalPoints < 1 || numIntervalPoints > maxIntervalPoints) return false;
+
+    StartBattle(startState);
+    state = startState;
+    Advance(state, nullptr);
+    result.optimalValue = Value(state, false);
+    result.greedyValue = Value(state, true);
+    if (overflow) return false;
+    result.numStates = (long) optimalValues.size();
+    FollowPlan(startState, result.plan);
+
+    if (objective == WinTimeObjective) {
+        result.optimalValue = parameters.battleDuration - result.optimalValue;
+        result.greedyValue = parameters.battleDuration - result.greedyValue;
+    }
+    return true;
+}
+
+
+/* value of the greedy attacker alone, without solving for the optimal strategy */
+/* returns false like Solve(), the number of states is that of the greedy value table */
+bool StrategySolver::SolveGreedy(double &greedyValue, long &numStates)
+{
+    SolverState state;
+
+    if (parameters.defenderPolicy != StandardDefenderPolicy || numIntervalPoints < 1 || numIntervalPoints > maxIntervalPoints) return false;
+
+    StartBattle(state);
+    Advance(state, nullptr);
+    greedyValue = Value(state, true);
+    if (overflow) return false;
+    numStates = (long) greedyValues.size();
+
+    if (objective == WinTimeObjective) {
+        greedyValue = parameters.battleDuration - greedyValue;
+    }
+    return true;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+
+#include <stddef.h>
+
+#include <string>
+#include <unordered_map>
+
+#include "BattleEngine.h"
+#include "ScratchArena.h"
+
+
+/* what the optimal attacker strategy maximizes */
+enum StrategyObjectives {
+    WinProbabilityObjective,
+    WinTimeObjective
+};
+
+
+/* most points a random defender interval is split into, and the number used unless another is given */
+const int maxIntervalPoints = 16;
+const int defaultIntervalPoints = 5;
+
+/* most battle states the solver keeps in each value table before it gives up */
+const size_t maxSolverStates = 1 << 20;
+
+/* most attacks shown in a plan */
+const int maxPlanLength = 255;
+
+/* most events in the solver's attacker and defender event queues, as in the battle engine */
+const int maxSolverAttackerEvents = 3;
+const int maxSolverDefenderEvents = 2 * numDefensiveInitialIntervalInputs + 1;
+
+
+/* everything that decides the rest of a battle at a point where the attacker chooses or the defender draws */
+/* all members are ints and unused events are zero, so states compare and hash as bytes */
+struct SolverState {
+    int          phase;
+    PlayerEvents pendingEvent;
+    int          battleTimer;
+    int          attackerBattleHP, attackerEnergy;
+    int          defenderBattleHP, defenderEnergy;
+    int          numDefensiveSpecialAttackOpportunities;
+    int          numAttackerEvents, numDefenderEvents;
+    EventRecord  attackerEvents[maxSolverAttackerEvents];
+    EventRecord  defenderEvents[maxSolverDefenderEvents];
+};
+
+
+struct SolverStateHash {
+    size_t operator() (const SolverState &state) const;
+};
+
+
+struct SolverStateEqual {
+    bool operator() (const SolverState &state1, const SolverState &state2) const;
+};
+
+
+/* value of a battle state under the best or the greedy choices, and the attacker's choice there */
+struct SolverEntry {
+    double value;
+    bool   specialAttack;
+};
+
+
+/* optimal and greedy values are win probabilities or expected times to win in milliseconds, */
+/* where battles that are lost count as taking the whole battle duration */
+/* the plan is the optimal attacks on the most likely course of the battle, F for fast and S for special */
+struct StrategyResult {
+    double      optimalValue, greedyValue;
+    long        numStates;
+    std::string plan;
+};
+
+
+/* finds the attacker strategy that is best against the standard defender by dynamic programming over battle states */
+/* the attacker chooses between fast and special attacks whenever it has the energy for a special attack, */
+/* so holding its energy to bank it is choosing fast attacks */
+/* random defender intervals are split into equally likely points, deferrals are exact */
+/* without randomness the battle is deterministic and the values are exact */
+/* the value tables live in the thread's scratch arena until the solver is destroyed, so solvers must be destroyed in reverse order */
+class StrategySolver {
+public:
+                     StrategySolver      (const BattleParameters &parameters, int objective, int numIntervalPoints);
+
+    bool             Solve               (StrategyResult &result);
+
+    bool             SolveGreedy         (double &greedyValue, long &numStates);
+
+private:
+    typedef std::pair<const SolverState, SolverEntry>                                      ValueEntry;
+    typedef std::unordered_map<SolverState, SolverEntry, SolverStateHash, SolverStateEqual,
+                               ScratchAllocator<ValueEntry>>                                ValueTable;
+
+    void             StartBattle         (SolverState &startState);
+
+    int              Advance             (SolverState &state, std::string *plan);
+
+    void             StartAttack         (SolverState &state, bool specialAttack);
+
+    void             StartDefenderAttack (SolverState &state, bool specialAttack);
+
+    void             AddInterval         (SolverState &state, int pointNum);
+
+    double           Value               (const SolverState &state, bool greedy);
+
+    double           FinalValue          (const SolverState &state);
+
+    void             FollowPlan          (SolverState state, std::string &plan);
+
+    ScratchScope     scratch;
+    BattleParameters parameters;
+    int              objective;
+    int              numIntervalPoints;
+    double           specialAttackProbability;
+    ValueTable       optimalValues, greedyValues;
+    bool             overflow;
+};
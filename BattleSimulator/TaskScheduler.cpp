@@ -0,0 +1,330 @@
+#include <math.h>
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BattleEngine.h"
+#include "EnginePlanner.h"
+
+#include "TaskScheduler.h"
+
+
+/* tasks per thread when splitting matchups, enough for stealing to even out the last few */
+const long tasksPerThread = 16;
+
+/* smallest range of trials worth scheduling on its own */
+const long minTrialsPerTask = 16;
+
+
+/* range of trials of one matchup */
+struct BattleTask {
+    long   matchupNum;
+    long   batchNum;
+    long   firstTrial, numTrials;
+    double cost;
+    long   taskNum;
+};
+
+
+/* tasks of one thread, taken from the front by the owner and stolen half at a time from the back */
+class TaskDeque {
+public:
+    void Push      (const BattleTask &task);
+
+    bool Pop       (BattleTask &task);
+
+    void StealHalf (std::vector<BattleTask> &stolenTasks);
+
+private:
+    std::deque<BattleTask> tasks;
+    std::mutex             lock;
+};
+
+
+void TaskDeque::Push(const BattleTask &task)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    tasks.push_back(task);
+}
+
+
+bool TaskDeque::Pop(BattleTask &task)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (tasks.empty()) return false;
+    task = tasks.front();
+    tasks.pop_front();
+    return true;
+}
+
+
+/* the owner works from the longest task down, so thieves take the shorter half */
+void TaskDeque::StealHalf(std::vector<BattleTask> &stolenTasks)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    size_t                      numStolen;
+
+    stolenTasks.clear();
+    numStolen = (tasks.size() + 1) / 2;
+    stolenTasks.assign(tasks.end() - numStolen, tasks.end());
+    tasks.erase(tasks.end() - numStolen, tasks.end());
+}
+
+
+inline double Max(double number1, double number2)
+{
+    return (number1 > number2) ? number1 : number2;
+}
+
+
+/* damage per millisecond of fast attacks and of the special attacks their energy pays for */
+inline double DamageRate(int fastAttackDamage, int fastAttackEnergy, int cycleDuration, int specialAttackDamage, int specialAttackEnergy)
+{
+    double rate;
+
+    rate = fastAttackDamage / Max(cycleDuration, 1.0);
+    if (specialAttackEnergy < 0) {
+        rate += specialAttackDamage * (fastAttackEnergy / Max(cycleDuration, 1.0)) / -specialAttackEnergy;
+    }
+    return rate;
+}
+
+
+double EstimateBattleTime(const BattleParameters &parameters)
+{
+    double attackerCycle, defenderCycle;
+    double attackerRate, defenderRate;
+    double battleTime;
+
+    attackerCycle = Max(parameters.attackerFastAttackDuration, 1.0);
+    defenderCycle = Max(parameters.defenderFastAttackDuration + parameters.defensiveInterval, 1.0);
+    attackerRate = DamageRate(parameters.attackerFastAttackDamage, parameters.attackerFastAttackEnergy, (int) attackerCycle,
+                              parameters.attackerSpecialAttackDamage, parameters.attackerSpecialAttackEnergy);
+    defenderRate = DamageRate(parameters.defenderFastAttackDamage, parameters.defenderFastAttackEnergy, (int) defenderCycle,
+                              parameters.defenderSpecialAttackDamage, parameters.defenderSpecialAttackEnergy);
+
+    /* the battle lasts until either side faints or time runs out */
+    battleTime = parameters.battleDuration;
+    if (attackerRate > 0.0) battleTime = std::min(battleTime, parameters.defenderHP * parameters.defensiveHPMultiplier / attackerRate);
+    if (defenderRate > 0.0) battleTime = std::min(battleTime, parameters.attackerHP / defenderRate);
+    return battleTime;
+}
+
+
+double EstimateBattleCost(const BattleParameters &parameters)
+{
+    double attackerCycle, defenderCycle;
+    double battleTime;
+
+    attackerCycle = Max(parameters.attackerFastAttackDuration, 1.0);
+    defenderCycle = Max(parameters.defenderFastAttackDuration + parameters.defensiveInterval, 1.0);
+    battleTime = EstimateBattleTime(parameters);
+
+    /* each attack is about three events on its side */
+    return parameters.numTrials * (8.0 + 3.0 * battleTime / attackerCycle + 3.0 * battleTime / defenderCycle);
+}
+
+
+/* run tasks from this thread's deque, then steal from the others until every deque is empty */
+void RunTasks(const TrialRangeSimulator &simulate, std::vector<TaskDeque> &taskDeques, int threadNum, std::vector<BattleTally> &tallies)
+{
+    std::vector<BattleTask> stolenTasks;
+    BattleTask              task;
+    int                     numThreads, victimNum;
+
+    numThreads = (int) taskDeques.size();
+    while (true) {
+        while (taskDeques[threadNum].Pop(task)) {
+            simulate(task.matchupNum, task.firstTrial, task.numTrials, tallies[task.taskNum]);
+        }
+
+        /* no tasks are added once the threads start, so finding every deque empty means the batch is done */
+        stolenTasks.clear();
+        for (victimNum = 1; victimNum < numThreads && stolenTasks.empty(); ++victimNum) {
+            taskDeques[(threadNum + victimNum) % numThreads].StealHalf(stolenTasks);
+        }
+        if (stolenTasks.empty()) return;
+        for (auto &stolenTask : stolenTasks) {
+            taskDeques[threadNum].Push(stolenTask);
+        }
+    }
+}
+
+
+/* give every task its own tally and run the tasks to completion on the threads */
+void RunTaskBatch(std::vector<BattleTask> &tasks, int numThreads, const TrialRangeSimulator &simulate, std::vector<BattleTally> &tallies)
+{
+    std::vector<TaskDeque>   taskDeques;
+    std::vector<std::thread> threads;
+    long                     i;
+    int                      threadNum;
+
+    /* each task has its own tally, added up by the caller when all are done */
+    tallies.resize(tasks.size());
+    for (auto &tally : tallies) {
+        tally.numWins = 0;
+        tally.sumOfSquaredGroupWins = 0;
+    }
+    if (tasks.empty()) return;
+
+    /* longest first, dealt round robin so every thread starts with a share of the long tasks */
+    std::stable_sort(tasks.begin(), tasks.end(), [] (const BattleTask &task1, const BattleTask &task2) { return task1.cost > task2.cost; });
+    numThreads = (int) std::min((long) numThreads, (long) tasks.size());
+    taskDeques = std::vector<TaskDeque>(numThreads);
+    for (i = 0; i < (long) tasks.size(); ++i) {
+        taskDeques[i % numThreads].Push(tasks[i]);
+    }
+
+    for (threadNum = 1; threadNum < numThreads; ++threadNum) {
+        threads.emplace_back(RunTasks, std::cref(simulate), std::ref(taskDeques), threadNum, std::ref(tallies));
+    }
+    RunTasks(simulate, taskDeques, 0, tallies);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+
+void ScheduleBattles(const BattleParameters *parameters, const long *matchupNums, long numMatchups, BattleResult *results, int numThreads)
+{
+    std::vector<BattleTask>  tasks;
+    std::vector<BattleTally> tallies, matchupTallies;
+    std::vector<double>      costs;
+    std::ofstream            logFile;
+    std::mutex               randStreamLock;
+    BattleTask               task;
+    EnginePlan               plan;
+    double                   totalCost, taskCost;
+    long                     trialsPerGroup, numGroups, numTasks, groupsPerTask;
+    long                     i;
+
+    if (numThreads <= 1 || numMatchups <= 1) {
+        for (i = 0; i < numMatchups; ++i) {
+            EvaluateBattles(parameters[matchupNums[i]], logFile, results[matchupNums[i]]);
+        }
+        return;
+    }
+
+    /* each result starts with its planned engine, exact matchups are solved whole by one task */
+    costs.resize(numMatchups);
+    totalCost = 0.0;
+    for (i = 0; i < numMatchups; ++i) {
+        costs[i] = EstimateBattleCost(parameters[matchupNums[i]]);
+        results[matchupNums[i]].engine = MonteCarloEngine;
+        if (parameters[matchupNums[i]].enginePlanning) {
+            PlanBattleEngine(parameters[matchupNums[i]], plan);
+            if (plan.engine == ExactEngine) {
+                costs[i] *= plan.exactSeconds / plan.monteCarloSeconds;
+                results[matchupNums[i]].engine = ExactEngine;
+            }
+        }
+        totalCost += costs[i];
+    }
+    taskCost = totalCost / (numThreads * tasksPerThread);
+
+    /* split expensive matchups into ranges of whole groups of trials */
+    /* matchups drawing from the single rand() stream are simulated one after another first, as concurrent ones would interleave their draws */
+    for (i = 0; i < numMatchups; ++i) {
+        const BattleParameters &matchupParameters = parameters[matchupNums[i]];
+
+        if (!TrialsAreSeparable(matchupParameters) && results[matchupNums[i]].engine == MonteCarloEngine) {
+            SimulateBattles(matchupParameters, logFile, results[matchupNums[i]]);
+            continue;
+        }
+        task.matchupNum = matchupNums[i];
+        task.batchNum = i;
+        trialsPerGroup = TrialsPerGroup(matchupParameters);
+        numGroups = matchupParameters.numTrials / trialsPerGroup;
+        numTasks = 1;
+        if (TrialsAreSeparable(matchupParameters) && costs[i] > taskCost && results[matchupNums[i]].engine == MonteCarloEngine) {
+            numTasks = std::min((long) ceil(costs[i] / taskCost), numGroups);
+            numTasks = std::max(std::min(numTasks, matchupParameters.numTrials / minTrialsPerTask), 1L);
+        }
+        groupsPerTask = (numGroups + numTasks - 1) / numTasks;
+        for (task.firstTrial = 0; task.firstTrial < matchupParameters.numTrials; task.firstTrial += task.numTrials) {
+            task.numTrials = std::min(groupsPerTask * trialsPerGroup, matchupParameters.numTrials - task.firstTrial);
+            task.cost = costs[i] * task.numTrials / matchupParameters.numTrials;
+            task.taskNum = (long) tasks.size();
+            tasks.push_back(task);
+        }
+    }
+
+    /* a batch of only rand() stream matchups has nothing left to schedule */
+    if (tasks.empty()) return;
+
+    /* scheduled trials are never logged, each range gets a closed log file */
+    /* an exact matchup the solver runs out of states for is simulated in the same task instead */
+    RunTaskBatch(tasks, numThreads, [parameters, results, &randStreamLock] (long matchupNum, long firstTrial, long numTrials, BattleTally &tally) {
+        std::ofstream threadLogFile;
+
+        if (results[matchupNum].engine == ExactEngine) {
+            if (SolveExactBattles(parameters[matchupNum], results[matchupNum])) return;
+            results[matchupNum].engine = MonteCarloEngine;
+            if (!TrialsAreSeparable(parameters[matchupNum])) {
+                std::lock_guard<std::mutex> guard(randStreamLock);
+
+                SimulateBattles(parameters[matchupNum], threadLogFile, results[matchupNum]);
+                return;
+            }
+        }
+        SimulateTrials(parameters[matchupNum], threadLogFile, firstTrial, numTrials, tally, nullptr);
+    }, tallies);
+
+    matchupTallies.resize(numMatchups);
+    for (auto &tally : matchupTallies) {
+        tally.numWins = 0;
+        tally.sumOfSquaredGroupWins = 0;
+    }
+    for (auto &scheduledTask : tasks) {
+        matchupTallies[scheduledTask.batchNum].numWins += tallies[scheduledTask.taskNum].numWins;
+        matchupTallies[scheduledTask.batchNum].sumOfSquaredGroupWins += tallies[scheduledTask.taskNum].sumOfSquaredGroupWins;
+    }
+    for (i = 0; i < numMatchups; ++i) {
+        if (results[matchupNums[i]].engine == MonteCarloEngine && TrialsAreSeparable(parameters[matchupNums[i]])) {
+            FinishBattles(parameters[matchupNums[i]], matchupTallies[i], results[matchupNums[i]]);
+        }
+    }
+}
+
+
+void ScheduleTrials(long numTrials, long trialsPerGroup, int numThreads, const TrialRangeSimulator &simulate, BattleTally &tally)
+{
+    std::vector<BattleTask>  tasks;
+    std::vector<BattleTally> tallies;
+    BattleTask               task;
+    long                     numGroups, numTasks, groupsPerTask;
+
+    tally.numWins = 0;
+    tally.sumOfSquaredGroupWins = 0;
+    if (numThreads <= 1) {
+        simulate(0, 0, numTrials, tally);
+        return;
+    }
+
+    /* equal ranges of whole groups, several per thread so stealing evens out trials of different lengths */
+    numGroups = numTrials / trialsPerGroup;
+    numTasks = std::min((long) numThreads * tasksPerThread, numGroups);
+    numTasks = std::max(std::min(numTasks, numTrials / minTrialsPerTask), 1L);
+    groupsPerTask = (numGroups + numTasks - 1) / numTasks;
+    task.matchupNum = 0;
+    task.batchNum = 0;
+    for (task.firstTrial = 0; task.firstTrial < numTrials; task.firstTrial += task.numTrials) {
+        task.numTrials = std::min(groupsPerTask * trialsPerGroup, numTrials - task.firstTrial);
+        task.cost = (double) task.numTrials;
+        task.taskNum = (long) tasks.size();
+        tasks.push_back(task);
+    }
+
+    RunTaskBatch(tasks, numThreads, simulate, tallies);
+    for (auto &taskTally : tallies) {
+        tally.numWins += taskTally.numWins;
+        tally.sumOfSquaredGroupWins += taskTally.sumOfSquaredGroupWins;
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+
+#include <functional>
+
+#include "BattleEngine.h"
+
+
+/* simulate trials firstTrial to firstTrial + numTrials - 1 of one matchup of a batch and add them to the tally */
+typedef std::function<void (long matchupNum, long firstTrial, long numTrials, BattleTally &tally)> TrialRangeSimulator;
+
+
+/* rough length of a battle in milliseconds, until either side faints at its damage per second or time runs out */
+double EstimateBattleTime (const BattleParameters &parameters);
+
+/* rough number of engine events needed to simulate all trials of a matchup, from HP, damage per second and battle duration */
+double EstimateBattleCost (const BattleParameters &parameters);
+
+/* simulate the given matchups on a pool of threads that steal work from each other */
+/* matchups are split into trial ranges so one long matchup does not leave the other threads idle at the end */
+/* matchups are evaluated by their planned engines, results are identical to evaluating each matchup on its own */
+void   ScheduleBattles    (const BattleParameters *parameters, const long *matchupNums, long numMatchups, BattleResult *results, int numThreads);
+
+/* simulate the trials of a single matchup, such as a raid, on a pool of threads in ranges of whole groups */
+/* the trials must be separable, the tally is the same as simulating them in one range */
+void   ScheduleTrials     (long numTrials, long trialsPerGroup, int numThreads, const TrialRangeSimulator &simulate, BattleTally &tally);
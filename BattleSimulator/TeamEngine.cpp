@@ -0,0 +1,334 @@
+#include <assert.h>
+#include <math.h>
+
+#include <mutex>
+
+#include "CombatantPolicies.h"
+#include "EventQueue.h"
+#include "TaskScheduler.h"
+#include "TrialSampler.h"
+
+#include "TeamEngine.h"
+
+
+inline int Min(int number1, int number2)
+{
+    return (number1 < number2) ? number1 : number2;
+}
+
+
+/* returns false if the team or the lineup is empty or too large */
+bool CheckTeamParameters(const TeamParameters &team)
+{
+    return team.numAttackers >= 1 && team.numAttackers <= maxTeamSize && team.numDefenders >= 1 && team.numDefenders <= maxTeamSize;
+}
+
+
+/* one fight of a pair from the HP and energy each side has left, until either faints or time runs out */
+/* the defender starts with its initial attacks as in a new battle, and both policies start over */
+template <class AttackerPolicy, class DefenderPolicy>
+void Fight(const BattleParameters &parameters, TrialSampler &sampler, EventQueue &attackerEventQueue, EventQueue &defenderEventQueue,
+           AttackerPolicy &attacker, DefenderPolicy &defender, int &attackerBattleHP, int &attackerEnergy, int &defenderBattleHP, int &defenderEnergy)
+{
+    int          defenderTime;
+    int          battleTimer, nextTime;
+    PlayerEvents playerEvent;
+    bool         specialAttack;
+    int          interval;
+
+    /* set up event queues */
+    attackerEventQueue.Initialize(1);
+    if (parameters.attackerTransforms) {
+        attackerEventQueue.Add(parameters.offensiveInitialInterval, PlayerStartsTransform);
+    } else {
+        attackerEventQueue.Add(parameters.offensiveInitialInterval, PlayerStartsAttack);
+    }
+    defenderEventQueue.Initialize(parameters.numDefensiveInitialIntervals);
+    defenderTime = parameters.defensiveInitialIntervals[0];
+    if (parameters.defenderTransforms) {
+        defenderEventQueue.Add(defenderTime, PlayerStartsTransform);
+    } else {
+        defenderEventQueue.Add(defenderTime, PlayerStartsInitialAttack);
+    }
+    defenderTime += parameters.defensiveInitialIntervals[1];
+    defenderEventQueue.Add(defenderTime, PlayerStartsInitialAttack);
+    if (parameters.randomness) {
+        defenderTime += sampler.Interval(parameters.defensiveInitialIntervals[2], parameters.defensiveIntervalRandomness);
+    } else {
+        defenderTime += parameters.defensiveInitialIntervals[2];
+    }
+    defenderEventQueue.Add(defenderTime, PlayerStartsAttack);
+
+    /* simulate fight */
+    battleTimer = parameters.battleDuration;
+    attacker.StartBattle(parameters);
+    defender.StartBattle(parameters);
+    while (battleTimer > 0 && attackerBattleHP > 0 && defenderBattleHP > 0) {
+
+        /* count down timers to next event */
+        nextTime = Min(attackerEventQueue.Timer(), defenderEventQueue.Timer());
+        attackerEventQueue.CountDown(nextTime);
+        defenderEventQueue.CountDown(nextTime);
+        battleTimer -= nextTime;
+
+        /* check if time for next attacker event */
+        if (attackerEventQueue.Timer() == 0) {
+            playerEvent = attackerEventQueue.Pop();
+
+            /* attacker finishes action */
+            switch (playerEvent) {
+            case PlayerLandsFastAttack:
+                defenderBattleHP -= parameters.attackerFastAttackDamage;
+                defenderEnergy = Min(defenderEnergy + (int) round(parameters.attackerFastAttackDamage * parameters.energyPerDamage + tolerance),
+                                     parameters.maxDefenderEnergy);
+                break;
+            case PlayerLandsSpecialAttack:
+                defenderBattleHP -= parameters.attackerSpecialAttackDamage;
+                defenderEnergy = Min(defenderEnergy + (int) round(parameters.attackerSpecialAttackDamage * parameters.energyPerDamage + tolerance),
+                                     parameters.maxDefenderEnergy);
+                break;
+            case PlayerLandsTransform:
+                defenderBattleHP -= parameters.transformDamage;
+                defenderEnergy = Min(defenderEnergy + (int) round(parameters.transformDamage * parameters.energyPerDamage + tolerance),
+                                     parameters.maxDefenderEnergy);
+                break;
+            default:
+                break;
+            }
+
+            /* attacker performs next action */
+            switch (playerEvent) {
+            case PlayerStartsTransform:
+                attackerEnergy = Min(attackerEnergy + parameters.transformEnergy, parameters.maxAttackerEnergy);
+                attackerEventQueue.Add(parameters.transformDamageStart, PlayerLandsTransform);
+                attackerEventQueue.Add(parameters.transformDuration, PlayerFinishesTransform);
+                break;
+            case PlayerStartsAttack:
+            case PlayerFinishesFastAttack:
+            case PlayerFinishesSpecialAttack:
+            case PlayerFinishesTransform:
+                if (attacker.StartsSpecialAttack(attackerEnergy)) {
+                    /* special attack */
+                    attackerEventQueue.Add(parameters.longPressDuration, PlayerFinishesLongPress);
+                } else {
+                    /* fast attack */
+                    attackerEnergy = Min(attackerEnergy + parameters.attackerFastAttackEnergy, parameters.maxAttackerEnergy);
+                    attackerEventQueue.Add(parameters.attackerFastAttackDamageStart, PlayerLandsFastAttack);
+                    attackerEventQueue.Add(parameters.attackerFastAttackDuration, PlayerFinishesFastAttack);
+                }
+                break;
+            case PlayerFinishesLongPress:
+                attackerEnergy = attackerEnergy + parameters.attackerSpecialAttackEnergy;
+                attackerEventQueue.Add(parameters.attackerSpecialAttackDamageStart, PlayerLandsSpecialAttack);
+                attackerEventQueue.Add(parameters.attackerSpecialAttackDuration, PlayerFinishesSpecialAttack);
+                break;
+            default:
+                break;
+            }
+        }
+
+        /* check if time for next defender event */
+        if (defenderEventQueue.Timer() == 0) {
+            playerEvent = defenderEventQueue.Pop();
+
+            /* defender finishes action */
+            switch (playerEvent) {
+            case PlayerLandsFastAttack:
+                attackerBattleHP -= parameters.defenderFastAttackDamage;
+                attackerEnergy = Min(attackerEnergy + (int) round(parameters.defenderFastAttackDamage * parameters.energyPerDamage + tolerance),
+                                     parameters.maxAttackerEnergy);
+                break;
+            case PlayerLandsSpecialAttack:
+                attackerBattleHP -= parameters.defenderSpecialAttackDamage;
+                attackerEnergy = Min(attackerEnergy + (int) round(parameters.defenderSpecialAttackDamage * parameters.energyPerDamage + tolerance),
+                                     parameters.maxAttackerEnergy);
+                break;
+            case PlayerLandsTransform:
+                attackerBattleHP -= parameters.transformDamage;
+                attackerEnergy = Min(attackerEnergy + (int) round(parameters.transformDamage * parameters.energyPerDamage + tolerance),
+                                     parameters.maxAttackerEnergy);
+                break;
+            default:
+                break;
+            }
+
+            /* defender performs next action */
+            switch (playerEvent) {
+            case PlayerStartsTransform:
+                defenderEnergy = Min(defenderEnergy + parameters.transformEnergy, parameters.maxDefenderEnergy);
+                defenderEventQueue.Add(parameters.transformDamageStart, PlayerLandsTransform);
+                defenderEventQueue.Add(parameters.transformDuration, PlayerFinishesTransform);
+                break;
+            case PlayerStartsAttack:
+            case PlayerStartsInitialAttack:
+                specialAttack = defender.StartsSpecialAttack(defenderEnergy, sampler);
+                if (specialAttack) {
+                    defenderEnergy = defenderEnergy + parameters.defenderSpecialAttackEnergy;
+                    defenderEventQueue.Add(parameters.defenderSpecialAttackDamageStart, PlayerLandsSpecialAttack);
+                    if (playerEvent == PlayerStartsInitialAttack) {
+                        defenderEventQueue.Add(parameters.defenderSpecialAttackDuration, PlayerFinishesInitialSpecialAttack);
+                    } else {
+                        defenderEventQueue.Add(parameters.defenderSpecialAttackDuration, PlayerFinishesSpecialAttack);
+                    }
+                } else {
+                    defenderEnergy = Min(defenderEnergy + parameters.defenderFastAttackEnergy, parameters.maxDefenderEnergy);
+                    defenderEventQueue.Add(parameters.defenderFastAttackDamageStart, PlayerLandsFastAttack);
+                    if (playerEvent == PlayerStartsInitialAttack) {
+                        defenderEventQueue.Add(parameters.defenderFastAttackDuration, PlayerFinishesInitialFastAttack);
+                    } else {
+                        defenderEventQueue.Add(parameters.defenderFastAttackDuration, PlayerFinishesFastAttack);
+                    }
+                }
+                break;
+            case PlayerFinishesFastAttack:
+            case PlayerFinishesSpecialAttack:
+                /* defender does nothing for a while and then starts next attack */
+                if (parameters.randomness) {
+                    interval = sampler.Interval(parameters.defensiveInterval, parameters.defensiveIntervalRandomness);
+                } else {
+                    interval = parameters.defensiveInterval;
+                }
+                defenderEventQueue.Add(interval, PlayerStartsAttack);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+
+/* simulate team trials firstTrial to firstTrial + numTrials - 1, which must be whole groups, and add them to the tally */
+/* an attacker that defeats a defender fights the next one with the HP and energy it has left, */
+/* a defender keeps its HP and energy against the next attacker, and an attacker whose time runs out is lost */
+/* team trials always draw from per-trial random number streams, so any range of them can be simulated on its own */
+template <class AttackerPolicy, class DefenderPolicy>
+void SimulateTeamTrialsWith(const TeamParameters &team, long firstTrial, long numTrials, TeamTally &tally, AttackerPolicy attacker,
+                            DefenderPolicy defender)
+{
+    const BattleParameters &settings = team.matchups[0][0];
+    BattleParameters       samplerParameters;
+    EventQueue             attackerEventQueue, defenderEventQueue;
+    int                    attackerHP[maxTeamSize], attackerEnergy[maxTeamSize];
+    int                    defenderHP[maxTeamSize], defenderEnergy[maxTeamSize];
+    long                   trialsPerGroup, groupWins, groupAttackersNeeded;
+    int                    attackerNum, defenderNum, roundNum, attackersNeeded;
+    int                    j;
+    long                   i;
+
+    assert(CheckTeamParameters(team));
+    samplerParameters = settings;
+    if (!TrialsAreSeparable(samplerParameters)) samplerParameters.commonRandomNumbers = true;
+    TrialSampler sampler(samplerParameters);
+
+    trialsPerGroup = TrialsPerGroup(settings);
+    assert(firstTrial % trialsPerGroup == 0 && numTrials % trialsPerGroup == 0);
+
+    /* perform Monte Carlo trials */
+    groupWins = 0;
+    groupAttackersNeeded = 0;
+    for (i = firstTrial; i < firstTrial + numTrials; ++i) {
+        sampler.StartTrial(i);
+
+        for (j = 0; j < team.numAttackers; ++j) {
+            attackerHP[j] = team.matchups[j][0].attackerHP;
+            attackerEnergy[j] = 0;
+        }
+        for (j = 0; j < team.numDefenders; ++j) {
+            defenderHP[j] = (int) (team.matchups[0][j].defenderHP * team.matchups[0][j].defensiveHPMultiplier);
+            defenderEnergy[j] = 0;
+        }
+        attackerNum = 0;
+        defenderNum = 0;
+        roundNum = 0;
+        attackersNeeded = 1;
+        while (true) {
+            Fight(team.matchups[attackerNum][defenderNum], sampler, attackerEventQueue, defenderEventQueue, attacker, defender,
+                  attackerHP[attackerNum], attackerEnergy[attackerNum], defenderHP[defenderNum], defenderEnergy[defenderNum]);
+            if (defenderHP[defenderNum] <= 0) {
+                if (++defenderNum == team.numDefenders) break;
+                continue;
+            }
+
+            /* the next attacker steps in, after the last one the team rejoins healed */
+            if (++attackerNum == team.numAttackers) {
+                attackerNum = 0;
+                if (++roundNum == maxTeamRounds) break;
+                for (j = 0; j < team.numAttackers; ++j) {
+                    attackerHP[j] = team.matchups[j][0].attackerHP;
+                    attackerEnergy[j] = 0;
+                }
+            }
+            ++attackersNeeded;
+        }
+
+        if (defenderNum == team.numDefenders && roundNum == 0) {
+            /* team won without rejoining */
+            ++tally.battleTally.numWins;
+            ++groupWins;
+        }
+        tally.sumOfAttackersNeeded += attackersNeeded;
+        groupAttackersNeeded += attackersNeeded;
+
+        /* accumulate group sums for the variance estimates */
+        if ((i + 1) % trialsPerGroup == 0) {
+            tally.battleTally.sumOfSquaredGroupWins += (long long) groupWins * groupWins;
+            tally.sumOfSquaredGroupAttackersNeeded += (long long) groupAttackersNeeded * groupAttackersNeeded;
+            groupWins = 0;
+            groupAttackersNeeded = 0;
+        }
+    }
+}
+
+
+/* simulate team trials with the policies of the first matchup, every matchup has the same inputs */
+void SimulateTeamTrials(const TeamParameters &team, long firstTrial, long numTrials, TeamTally &tally)
+{
+    DispatchPolicies(team.matchups[0][0].attackerPolicy, team.matchups[0][0].defenderPolicy, [&] (auto attacker, auto defender) {
+        SimulateTeamTrialsWith(team, firstTrial, numTrials, tally, attacker, defender);
+    });
+}
+
+
+/* trials of one team are split over the threads, the result does not depend on the number of threads */
+void SimulateTeam(const TeamParameters &team, int numThreads, TeamResult &result)
+{
+    const BattleParameters &settings = team.matchups[0][0];
+    TeamTally              tally;
+    BattleTally            battleTally;
+    std::mutex             lock;
+    long                   trialsPerGroup, numGroups;
+    double                 groupMean, groupSumOfSquares;
+
+    /* each range adds its attackers to the total when it is done */
+    tally.sumOfAttackersNeeded = 0;
+    tally.sumOfSquaredGroupAttackersNeeded = 0;
+    ScheduleTrials(settings.numTrials, TrialsPerGroup(settings), numThreads,
+                   [&team, &tally, &lock] (long, long firstTrial, long numTrials, BattleTally &rangeTally) {
+        TeamTally rangeTeamTally;
+
+        rangeTeamTally.battleTally = rangeTally;
+        rangeTeamTally.sumOfAttackersNeeded = 0;
+        rangeTeamTally.sumOfSquaredGroupAttackersNeeded = 0;
+        SimulateTeamTrials(team, firstTrial, numTrials, rangeTeamTally);
+        rangeTally = rangeTeamTally.battleTally;
+
+        std::lock_guard<std::mutex> guard(lock);
+
+        tally.sumOfAttackersNeeded += rangeTeamTally.sumOfAttackersNeeded;
+        tally.sumOfSquaredGroupAttackersNeeded += rangeTeamTally.sumOfSquaredGroupAttackersNeeded;
+    }, battleTally);
+    FinishBattles(settings, battleTally, result.battleResult);
+
+    /* mean and standard error of the attackers needed the same way as the win probability */
+    result.attackersNeeded = (double) tally.sumOfAttackersNeeded / settings.numTrials;
+    trialsPerGroup = TrialsPerGroup(settings);
+    numGroups = settings.numTrials / trialsPerGroup;
+    if (numGroups > 1) {
+        groupMean = result.attackersNeeded;
+        groupSumOfSquares = (double) tally.sumOfSquaredGroupAttackersNeeded / ((double) trialsPerGroup * trialsPerGroup);
+        result.attackersNeededStandardError = sqrt(fmax(groupSumOfSquares - numGroups * groupMean * groupMean, 0.0) / (numGroups - 1) / numGroups);
+    } else {
+        result.attackersNeededStandardError = 0.0;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+
+#include "BattleEngine.h"
+
+
+/* most Pokemon in an attacking team and in a gym lineup */
+const int maxTeamSize = 6;
+
+/* times the team may rejoin healed before a lineup counts as not defeated */
+const int maxTeamRounds = 10;
+
+
+/* attacking team versus a gym lineup, fought one pair at a time */
+/* the matchup of every attacker against every defender is resolved once, the simulation settings come from the first one */
+struct TeamParameters {
+    int              numAttackers, numDefenders;
+    BattleParameters matchups[maxTeamSize][maxTeamSize];
+};
+
+
+/* probability of the team defeating the lineup without rejoining, and the number of attackers it takes with rejoins */
+/* lineups not defeated within maxTeamRounds rejoins count as taking every attacker of those rounds */
+struct TeamResult {
+    BattleResult battleResult;
+    double       attackersNeeded;
+    double       attackersNeededStandardError;
+};
+
+
+/* attackers used by a range of trials, exact integers like the tally */
+struct TeamTally {
+    BattleTally battleTally;
+    long long   sumOfAttackersNeeded;
+    long long   sumOfSquaredGroupAttackersNeeded;
+};
+
+
+bool CheckTeamParameters (const TeamParameters &team);
+
+void SimulateTeamTrials  (const TeamParameters &team, long firstTrial, long numTrials, TeamTally &tally);
+
+void SimulateTeam        (const TeamParameters &team, int numThreads, TeamResult &result);
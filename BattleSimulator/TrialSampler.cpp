@@ -0,0 +1,102 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "TrialSampler.h"
+
+
+TrialSampler::TrialSampler(const BattleParameters &parameters)
+{
+    commonRandomNumbers = parameters.commonRandomNumbers || parameters.antitheticTrials;
+    antitheticTrials = parameters.antitheticTrials;
+    rngSeed = parameters.rngSeed;
+    antithetic = false;
+    quasiMonteCarlo = parameters.quasiMonteCarlo;
+    if (quasiMonteCarlo) {
+        assert(parameters.numTrials % parameters.numRandomizations == 0);
+        pointsPerRandomization = parameters.numTrials / parameters.numRandomizations;
+        randomizationNum = -1;
+    }
+    pointNum = 0;
+    numIntervalDraws = 0;
+    numDeferralDraws = 0;
+    if (!commonRandomNumbers && !quasiMonteCarlo) {
+        /* seed random number generator */
+        srand(rngSeed);
+    }
+}
+
+
+void TrialSampler::StartTrial(long trialNum)
+{
+    if (quasiMonteCarlo) {
+        if (trialNum / pointsPerRandomization != randomizationNum) {
+            /* start next independently randomized point set */
+            randomizationNum = trialNum / pointsPerRandomization;
+            sobolSequence.Randomize(rngSeed, randomizationNum);
+        }
+        pointNum = (unsigned long) (trialNum % pointsPerRandomization);
+        numIntervalDraws = 0;
+        numDeferralDraws = 0;
+        /* draws beyond the last Sobol dimension are padded with pseudorandom numbers */
+        paddingStream.Seed(rngSeed, trialNum, PaddingStream);
+    } else if (commonRandomNumbers) {
+        if (antitheticTrials) {
+            /* both trials of a pair draw the same intervals, the second one mirrored */
+            intervalStream.Seed(rngSeed, trialNum / 2, IntervalStream);
+            antithetic = (trialNum % 2) != 0;
+        } else {
+            intervalStream.Seed(rngSeed, trialNum, IntervalStream);
+        }
+        deferralStream.Seed(rngSeed, trialNum, DeferralStream);
+    }
+}
+
+
+int TrialSampler::Interval(int expectedInterval, int intervalRandomness)
+{
+    int    intervalStart;
+    double uniform;
+    int    offset;
+
+    intervalStart = expectedInterval - intervalRandomness / 2;
+    if (quasiMonteCarlo) {
+        /* interval draws use the even dimensions */
+        if (2 * numIntervalDraws < maxSobolDimensions) {
+            uniform = sobolSequence.Point(pointNum, 2 * numIntervalDraws);
+        } else {
+            uniform = paddingStream.Uniform();
+        }
+        ++numIntervalDraws;
+    } else if (commonRandomNumbers) {
+        uniform = intervalStream.Uniform();
+    } else {
+        uniform = (double) rand() / (RAND_MAX + 1.0);
+    }
+    offset = (int) ((intervalRandomness + 1) * uniform);
+    assert(offset >= 0 && offset <= intervalRandomness);
+    if (antithetic) {
+        offset = intervalRandomness - offset;
+    }
+    return intervalStart + offset;
+}
+
+
+double TrialSampler::Deferral(void)
+{
+    double uniform;
+
+    if (quasiMonteCarlo) {
+        /* deferral draws use the odd dimensions */
+        if (2 * numDeferralDraws + 1 < maxSobolDimensions) {
+            uniform = sobolSequence.Point(pointNum, 2 * numDeferralDraws + 1);
+        } else {
+            uniform = paddingStream.Uniform();
+        }
+        ++numDeferralDraws;
+        return uniform;
+    } else if (commonRandomNumbers) {
+        return deferralStream.Uniform();
+    } else {
+        return (double) rand() / (RAND_MAX + 1.0);
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+
+#include "BattleEngine.h"
+#include "RandomStream.h"
+#include "SobolSequence.h"
+
+
+/* source of the defender's random behavior in one Monte Carlo trial */
+/* by default draws come from the rand() stream seeded once per Battle() call */
+/* with common random numbers every trial has its own substreams seeded from the trial number, */
+/* so trial n sees the same idle intervals and deferral decisions for every attacker */
+/* with quasi-Monte Carlo the trials are split into independently randomized Sobol point sets, */
+/* and the nth interval and deferral draws of a trial are coordinates of its point */
+class TrialSampler {
+public:
+                  TrialSampler (const BattleParameters &parameters);
+
+    void          StartTrial   (long trialNum);
+
+    int           Interval     (int expectedInterval, int intervalRandomness);
+
+    double        Deferral     (void);
+
+private:
+    bool          commonRandomNumbers;
+    bool          antitheticTrials;
+    int           rngSeed;
+    bool          antithetic;
+    RandomStream  intervalStream;
+    RandomStream  deferralStream;
+    bool          quasiMonteCarlo;
+    long          pointsPerRandomization;
+    long          randomizationNum;
+    unsigned long pointNum;
+    int           numIntervalDraws, numDeferralDraws;
+    SobolSequence sobolSequence;
+    RandomStream  paddingStream;
+};
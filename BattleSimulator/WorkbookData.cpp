@@ -0,0 +1,285 @@
+#include <assert.h>
+#include <wchar.h>
+
+#include <string>
+
+#include <Windows.h>
+
+#include <XLCALL.H>
+
+#include "ExcelCallbacks.h"
+
+#include "WorkbookData.h"
+
+
+/* maximum length of an input name including the sheet prefix */
+const int maxInputNameLength = 64;
+
+/* FNV-1a parameters of the game table stamp */
+const unsigned long long stampOffsetBasis = 14695981039346656037ULL;
+const unsigned long long stampPrime = 1099511628211ULL;
+
+
+std::string XLOPER12StrToUTF8(const XLOPER12 &operand)
+{
+    std::string operandStr;
+    int         length;
+
+    assert(operand.xltype == xltypeStr);
+    if (operand.val.str[0] == 0) return operandStr;
+    length = WideCharToMultiByte(CP_UTF8, 0, &operand.val.str[1], operand.val.str[0], nullptr, 0, nullptr, nullptr);
+    operandStr.resize(length);
+    (void) WideCharToMultiByte(CP_UTF8, 0, &operand.val.str[1], operand.val.str[0], &operandStr[0], length, nullptr, nullptr);
+    return operandStr;
+}
+
+
+/* read one named input on the Inputs sheet, booleans as 0 or 1 */
+double ReadBattleInput(int inputId)
+{
+    XCHAR nameStr[maxInputNameLength + 1];
+    int   length;
+    int   i;
+
+    /* construct counted string "Inputs!<name>" */
+    wcscpy(&nameStr[1], L"Inputs!");
+    length = (int) wcslen(L"Inputs!");
+    for (i = 0; battleInputInfo[inputId].name[i] != '\0'; ++i) {
+        assert(length < maxInputNameLength);
+        nameStr[++length] = battleInputInfo[inputId].name[i];
+    }
+    nameStr[0] = (XCHAR) length;
+    if (battleInputInfo[inputId].boolean) {
+        return GetNamedBoolean(nameStr) ? 1.0 : 0.0;
+    } else {
+        return GetNamedNumber(nameStr);
+    }
+}
+
+
+/* read every named input on the Inputs sheet */
+void ReadBattleInputs(BattleInputs &inputs)
+{
+    int i;
+
+    for (i = 0; i < numBattleInputs; ++i) {
+        inputs.values[i] = ReadBattleInput(i);
+    }
+}
+
+
+/* cell of a table array by 1-based row and column numbers */
+inline const XLOPER12 &Cell(const XLOPER12 &tableArray, int rowNum, int colNum)
+{
+    return tableArray.val.array.lparray[(rowNum - 1) * tableArray.val.array.columns + (colNum - 1)];
+}
+
+
+inline double CellNumber(const XLOPER12 &tableArray, int rowNum, int colNum)
+{
+    const XLOPER12 &cell = Cell(tableArray, rowNum, colNum);
+
+    assert(cell.xltype == xltypeNum);
+    return cell.val.num;
+}
+
+
+/* empty cells are empty strings */
+inline std::string CellString(const XLOPER12 &tableArray, int rowNum, int colNum)
+{
+    const XLOPER12 &cell = Cell(tableArray, rowNum, colNum);
+
+    assert(cell.xltype == xltypeStr || cell.xltype == xltypeNil);
+    return (cell.xltype == xltypeStr) ? XLOPER12StrToUTF8(cell) : std::string();
+}
+
+
+void LoadAttack(const GameData &gameData, const XLOPER12 &moveSetsArray, int rowNum, int firstColNum, AttackRecord &attack)
+{
+    attack.name = CellString(moveSetsArray, rowNum, firstColNum);
+    attack.type = gameData.AttackingType(CellString(moveSetsArray, rowNum, firstColNum + 1));
+    assert(attack.type != noType);
+    attack.power = (int) CellNumber(moveSetsArray, rowNum, firstColNum + 2);
+    attack.energy = (int) CellNumber(moveSetsArray, rowNum, firstColNum + 3);
+    attack.damageStart = (int) CellNumber(moveSetsArray, rowNum, firstColNum + 4);
+    attack.duration = (int) CellNumber(moveSetsArray, rowNum, firstColNum + 5);
+    attack.stab = CellNumber(moveSetsArray, rowNum, firstColNum + 6);
+}
+
+
+/* copy the given game tables of the workbook, with the same columns the lookups in the battle functions use */
+/* tables already in the game data are replaced, the game data must be indexed afterwards */
+void LoadGameTables(int tables, GameData &gameData)
+{
+    XLOPER12         attackingTypesArray, defendingTypesArray, typeMatchupsArray;
+    XLOPER12         levelsArray, speciesArray, fastAttacksArray, moveSetsArray;
+    SpeciesRecord    speciesRecord;
+    FastAttackRecord fastAttackRecord;
+    MoveSetRecord    moveSetRecord;
+    std::string      type2;
+    int              rowNum, colNum;
+
+    if (tables & TypeMatchupsTable) {
+        /* attacking types are a column and defending types are a row */
+        attackingTypesArray = GetNamedArray(L"\036'Type Matchups'!AttackingTypes");
+        defendingTypesArray = GetNamedArray(L"\036'Type Matchups'!DefendingTypes");
+        typeMatchupsArray = GetNamedArray(L"\034'Type Matchups'!TypeMatchups");
+        assert(attackingTypesArray.val.array.columns == 1 && defendingTypesArray.val.array.rows == 1);
+        gameData.attackingTypes.clear();
+        gameData.defendingTypes.clear();
+        gameData.typeMatchups.clear();
+        for (rowNum = 1; rowNum <= attackingTypesArray.val.array.rows; ++rowNum) {
+            gameData.attackingTypes.push_back(CellString(attackingTypesArray, rowNum, 1));
+        }
+        for (colNum = 1; colNum <= defendingTypesArray.val.array.columns; ++colNum) {
+            gameData.defendingTypes.push_back(CellString(defendingTypesArray, 1, colNum));
+        }
+        assert(typeMatchupsArray.val.array.rows == attackingTypesArray.val.array.rows);
+        assert(typeMatchupsArray.val.array.columns == defendingTypesArray.val.array.columns);
+        for (rowNum = 1; rowNum <= typeMatchupsArray.val.array.rows; ++rowNum) {
+            for (colNum = 1; colNum <= typeMatchupsArray.val.array.columns; ++colNum) {
+                /* blank cells are 0, as with IndexNumber() */
+                gameData.typeMatchups.push_back((Cell(typeMatchupsArray, rowNum, colNum).xltype == xltypeNil) ? 0.0 : CellNumber(typeMatchupsArray, rowNum, colNum));
+            }
+        }
+        FREE(3, &attackingTypesArray, &defendingTypesArray, &typeMatchupsArray);
+    }
+
+    if (tables & LevelsTable) {
+        levelsArray = GetNamedArray(L"\015Levels!Levels");
+        gameData.cpMultipliers.clear();
+        for (rowNum = 1; rowNum <= levelsArray.val.array.rows; ++rowNum) {
+            gameData.cpMultipliers[CellNumber(levelsArray, rowNum, 1)] = CellNumber(levelsArray, rowNum, 2);
+        }
+        FREE(1, &levelsArray);
+    }
+
+    if (tables & SpeciesTable) {
+        assert(!gameData.defendingTypes.empty());
+        speciesArray = GetNamedArray(L"\017Species!Species");
+        gameData.species.clear();
+        for (rowNum = 1; rowNum <= speciesArray.val.array.rows; ++rowNum) {
+            speciesRecord.pokedexNum = (int) CellNumber(speciesArray, rowNum, 1);
+            speciesRecord.name = CellString(speciesArray, rowNum, 2);
+            speciesRecord.type1 = gameData.DefendingType(CellString(speciesArray, rowNum, 3));
+            type2 = CellString(speciesArray, rowNum, 4);
+            speciesRecord.type2 = type2.empty() ? noType : gameData.DefendingType(type2);
+            assert(speciesRecord.type1 != noType);
+            speciesRecord.baseStamina = CellNumber(speciesArray, rowNum, 5);
+            speciesRecord.baseAttack = CellNumber(speciesArray, rowNum, 6);
+            speciesRecord.baseDefense = CellNumber(speciesArray, rowNum, 7);
+            gameData.species.push_back(speciesRecord);
+        }
+        FREE(1, &speciesArray);
+    }
+
+    if (tables & FastAttacksTable) {
+        fastAttacksArray = GetNamedArray(L"\032'Fast Attacks'!FastAttacks");
+        gameData.fastAttacks.clear();
+        for (rowNum = 1; rowNum <= fastAttacksArray.val.array.rows; ++rowNum) {
+            fastAttackRecord.moveNum = (long) CellNumber(fastAttacksArray, rowNum, 1);
+            fastAttackRecord.power = (int) CellNumber(fastAttacksArray, rowNum, 4);
+            fastAttackRecord.energy = (int) CellNumber(fastAttacksArray, rowNum, 5);
+            fastAttackRecord.damageStart = (int) CellNumber(fastAttacksArray, rowNum, 6);
+            fastAttackRecord.duration = (int) CellNumber(fastAttacksArray, rowNum, 7);
+            gameData.fastAttacks.push_back(fastAttackRecord);
+        }
+        FREE(1, &fastAttacksArray);
+    }
+
+    if (tables & MoveSetsTable) {
+        assert(!gameData.attackingTypes.empty());
+        moveSetsArray = GetNamedArray(L"\024'Move Sets'!MoveSets");
+        gameData.moveSets.clear();
+        for (rowNum = 1; rowNum <= moveSetsArray.val.array.rows; ++rowNum) {
+            moveSetRecord.moveSetNum = (long) CellNumber(moveSetsArray, rowNum, 1);
+            LoadAttack(gameData, moveSetsArray, rowNum, 7, moveSetRecord.fastAttack);
+            LoadAttack(gameData, moveSetsArray, rowNum, 15, moveSetRecord.specialAttack);
+            gameData.moveSets.push_back(moveSetRecord);
+        }
+        FREE(1, &moveSetsArray);
+    }
+}
+
+
+/* copy every game table of the workbook */
+void LoadGameData(GameData &gameData)
+{
+    gameData.Clear();
+    LoadGameTables(allGameTables, gameData);
+    gameData.Index();
+}
+
+
+inline void AddToStamp(unsigned long long &stamp, const void *bytes, size_t numBytes)
+{
+    size_t i;
+
+    for (i = 0; i < numBytes; ++i) {
+        stamp = (stamp ^ ((const unsigned char *) bytes)[i]) * stampPrime;
+    }
+}
+
+
+/* checksum of the sheet and range of each game table, and with cells, of every cell too, 0 if the active workbook has none */
+/* the ranges are found without reading a cell, but the cells are read like a load of every table */
+unsigned long long GameTablesStamp(bool cells)
+{
+    XCHAR              *tableNames[] = {L"\036'Type Matchups'!AttackingTypes", L"\036'Type Matchups'!DefendingTypes", L"\034'Type Matchups'!TypeMatchups",
+                                        L"\015Levels!Levels", L"\017Species!Species", L"\032'Fast Attacks'!FastAttacks", L"\024'Move Sets'!MoveSets"};
+    XLOPER12           name, tableReference, tableArray;
+    unsigned long long stamp;
+    int                returnValue, numCells, i;
+
+    if (!WorkbookHasGameData()) return 0;
+    stamp = stampOffsetBasis;
+    for (auto tableName : tableNames) {
+        name.xltype = xltypeStr;
+        name.val.str = tableName;
+        returnValue = Excel12(xlfEvaluate, &tableReference, 1, &name);
+        if (returnValue != xlretSuccess) return 0;
+        AddToStamp(stamp, &tableReference.xltype, sizeof tableReference.xltype);
+        if (tableReference.xltype == xltypeRef) {
+            AddToStamp(stamp, &tableReference.val.mref.idSheet, sizeof tableReference.val.mref.idSheet);
+            AddToStamp(stamp, tableReference.val.mref.lpmref->reftbl, tableReference.val.mref.lpmref->count * sizeof (XLREF12));
+        }
+        FREE(1, &tableReference);
+        if (!cells) continue;
+
+        tableArray = GetNamedArray(tableName);
+        numCells = tableArray.val.array.rows * tableArray.val.array.columns;
+        for (i = 0; i < numCells; ++i) {
+            const XLOPER12 &cell = tableArray.val.array.lparray[i];
+
+            AddToStamp(stamp, &cell.xltype, sizeof cell.xltype);
+            if (cell.xltype == xltypeNum) {
+                AddToStamp(stamp, &cell.val.num, sizeof cell.val.num);
+            } else if (cell.xltype == xltypeStr) {
+                AddToStamp(stamp, cell.val.str, (cell.val.str[0] + 1) * sizeof cell.val.str[0]);
+            } else if (cell.xltype == xltypeBool) {
+                AddToStamp(stamp, &cell.val.xbool, sizeof cell.val.xbool);
+            } else if (cell.xltype == xltypeErr) {
+                AddToStamp(stamp, &cell.val.err, sizeof cell.val.err);
+            }
+        }
+        FREE(1, &tableArray);
+    }
+    return stamp;
+}
+
+
+/* returns false if the active workbook has no game tables, such as before the battle workbook has opened */
+bool WorkbookHasGameData(void)
+{
+    XLOPER12 name, evaluateResult;
+    int      returnValue;
+    bool     hasGameData;
+
+    name.xltype = xltypeStr;
+    name.val.str = L"\024'Move Sets'!MoveSets";
+    returnValue = Excel12(xlfEvaluate, &evaluateResult, 1, &name);
+    if (returnValue != xlretSuccess) return false;
+    hasGameData = evaluateResult.xltype == xltypeRef;
+    FREE(1, &evaluateResult);
+    return hasGameData;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+
+#include <string>
+
+#include <XLCALL.H>
+
+#include "BattleResolver.h"
+#include "GameData.h"
+
+
+std::string        XLOPER12StrToUTF8   (const XLOPER12 &operand);
+
+double             ReadBattleInput     (int inputId);
+
+void               ReadBattleInputs    (BattleInputs &inputs);
+
+void               LoadGameTables      (int tables, GameData &gameData);
+
+void               LoadGameData        (GameData &gameData);
+
+unsigned long long GameTablesStamp     (bool cells);
+
+bool               WorkbookHasGameData (void);
@@ -0,0 +1,215 @@
+#include <stdlib.h>
+
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "BattleEngine.h"
+#include "EnginePlanner.h"
+#include "Socket.h"
+#include "WorkerProtocol.h"
+
+#include "WorkerPool.h"
+
+
+struct PendingMatchup {
+    BattleParameters parameters;
+    ResultCallback   callback;
+};
+
+
+/* connection to one worker with the matchups it has not answered yet */
+struct WorkerConnection {
+    SocketHandle                                           socket;
+    bool                                                   alive;
+    std::unordered_map<unsigned long long, PendingMatchup> pendingMatchups;
+    std::mutex                                             lock;
+    std::mutex                                             sendLock;
+    std::thread                                            reader;
+};
+
+
+void SimulateInProcess(const PendingMatchup &pendingMatchup)
+{
+    std::ofstream logFile;
+    BattleResult  result;
+
+    EvaluateBattles(pendingMatchup.parameters, logFile, result);
+    pendingMatchup.callback(result);
+}
+
+
+/* deliver replies until the worker goes away, then simulate its unanswered matchups in process */
+void ReadReplies(WorkerConnection *connection)
+{
+    unsigned char                                          reply[simulateReplySize];
+    unsigned long long                                     requestId;
+    BattleResult                                           result;
+    PendingMatchup                                         pendingMatchup;
+    std::unordered_map<unsigned long long, PendingMatchup> orphanedMatchups;
+
+    while (ReceiveBytes(connection->socket, reply, sizeof reply) && DecodeSimulateReply(reply, requestId, result)) {
+        {
+            std::lock_guard<std::mutex> guard(connection->lock);
+
+            auto pending = connection->pendingMatchups.find(requestId);
+            if (pending == connection->pendingMatchups.end()) continue;
+            pendingMatchup = pending->second;
+            connection->pendingMatchups.erase(pending);
+        }
+        pendingMatchup.callback(result);
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(connection->lock);
+
+        connection->alive = false;
+        orphanedMatchups.swap(connection->pendingMatchups);
+    }
+    for (auto &orphanedMatchup : orphanedMatchups) {
+        SimulateInProcess(orphanedMatchup.second);
+    }
+}
+
+
+WorkerPool::WorkerPool(void)
+{
+    nextRequestId = 0;
+    nextConnection = 0;
+}
+
+
+WorkerPool::~WorkerPool(void)
+{
+    Disconnect();
+}
+
+
+/* connect to a comma separated list of host:port workers */
+/* returns the number of workers connected */
+int WorkerPool::Connect(const std::string &endpoints)
+{
+    std::lock_guard<std::mutex>       guard(lock);
+    size_t                            start, end, colon;
+    std::string                       endpoint;
+    SocketHandle                      socket;
+    std::shared_ptr<WorkerConnection> connection;
+
+    if (!StartSockets()) return 0;
+    for (start = 0; start < endpoints.size(); start = end + 1) {
+        end = endpoints.find(',', start);
+        if (end == std::string::npos) end = endpoints.size();
+        endpoint = endpoints.substr(start, end - start);
+        colon = endpoint.rfind(':');
+        if (colon == std::string::npos) continue;
+        socket = ConnectSocket(endpoint.substr(0, colon).c_str(), atoi(endpoint.c_str() + colon + 1));
+        if (socket == invalidSocket) continue;
+
+        connection = std::make_shared<WorkerConnection>();
+        connection->socket = socket;
+        connection->alive = true;
+        connection->reader = std::thread(ReadReplies, connection.get());
+        connections.push_back(connection);
+    }
+    return (int) connections.size();
+}
+
+
+/* close all connections, simulating any unanswered matchups in process */
+void WorkerPool::Disconnect(void)
+{
+    std::vector<std::shared_ptr<WorkerConnection>> oldConnections;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        oldConnections.swap(connections);
+    }
+    for (auto &connection : oldConnections) {
+        ShutdownSocket(connection->socket);
+        connection->reader.join();
+        CloseSocket(connection->socket);
+    }
+}
+
+
+int WorkerPool::NumWorkers(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    int                         numWorkers;
+
+    numWorkers = 0;
+    for (auto &connection : connections) {
+        std::lock_guard<std::mutex> connectionGuard(connection->lock);
+
+        if (connection->alive) ++numWorkers;
+    }
+    return numWorkers;
+}
+
+
+/* send a matchup to the next live worker, the callback may run before this returns */
+void WorkerPool::Submit(const BattleParameters &parameters, const ResultCallback &callback)
+{
+    std::shared_ptr<WorkerConnection> connection;
+    unsigned long long                requestId;
+    PendingMatchup                    pendingMatchup;
+    unsigned char                     request[simulateRequestSize];
+    size_t                            i;
+    bool                              sent;
+
+    pendingMatchup.parameters = parameters;
+    pendingMatchup.callback = callback;
+
+    /* pick workers round robin */
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        requestId = nextRequestId++;
+        for (i = 0; i < connections.size() && !connection; ++i) {
+            std::lock_guard<std::mutex> connectionGuard(connections[nextConnection % connections.size()]->lock);
+
+            if (connections[nextConnection % connections.size()]->alive) {
+                connection = connections[nextConnection % connections.size()];
+            }
+            ++nextConnection;
+        }
+    }
+
+    if (connection) {
+        {
+            std::lock_guard<std::mutex> guard(connection->lock);
+
+            if (connection->alive) {
+                connection->pendingMatchups[requestId] = pendingMatchup;
+            } else {
+                connection.reset();
+            }
+        }
+    }
+    if (!connection) {
+        SimulateInProcess(pendingMatchup);
+        return;
+    }
+
+    EncodeSimulateRequest(requestId, parameters, request);
+    {
+        std::lock_guard<std::mutex> guard(connection->sendLock);
+
+        sent = SendBytes(connection->socket, request, sizeof request);
+    }
+    if (!sent) {
+        /* unless the reader already took it over when the connection dropped */
+        {
+            std::lock_guard<std::mutex> guard(connection->lock);
+
+            if (connection->pendingMatchups.erase(requestId) == 0) return;
+        }
+        SimulateInProcess(pendingMatchup);
+    }
+}
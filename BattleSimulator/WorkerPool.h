@@ -0,0 +1,41 @@
+#pragma once
+
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BattleEngine.h"
+
+
+/* called once with the result of a submitted matchup, on whichever thread received it */
+typedef std::function<void (const BattleResult &result)> ResultCallback;
+
+
+struct WorkerConnection;
+
+
+/* client side of a pool of out-of-process simulation workers */
+/* matchups are spread over the connected workers, and simulated in process if no worker can take them */
+class WorkerPool {
+public:
+                 WorkerPool  (void);
+
+                 ~WorkerPool (void);
+
+    int          Connect     (const std::string &endpoints);
+
+    void         Disconnect  (void);
+
+    int          NumWorkers  (void);
+
+    void         Submit      (const BattleParameters &parameters, const ResultCallback &callback);
+
+private:
+    std::vector<std::shared_ptr<WorkerConnection>> connections;
+    std::mutex         lock;
+    unsigned long long nextRequestId;
+    size_t             nextConnection;
+};
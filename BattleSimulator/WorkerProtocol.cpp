@@ -0,0 +1,405 @@
+#include <assert.h>
+#include <string.h>
+
+#include <vector>
+
+#include "WorkerProtocol.h"
+
+
+inline unsigned long long MessageWord(WorkerMessageTypes messageType)
+{
+    return (workerProtocolVersion << 32) | (unsigned long long) messageType;
+}
+
+
+inline void PutWord(unsigned char *bytes, int &numWords, unsigned long long word)
+{
+    int i;
+
+    for (i = 0; i < 8; ++i) {
+        bytes[8 * numWords + i] = (unsigned char) (word >> (8 * i));
+    }
+    ++numWords;
+}
+
+
+inline void PutWord(unsigned char *bytes, int &numWords, long long number)
+{
+    PutWord(bytes, numWords, (unsigned long long) number);
+}
+
+
+/* doubles are sent as their bit patterns so results are reproduced exactly */
+inline void PutWord(unsigned char *bytes, int &numWords, double number)
+{
+    unsigned long long word;
+
+    memcpy(&word, &number, sizeof word);
+    PutWord(bytes, numWords, word);
+}
+
+
+inline unsigned long long GetWord(const unsigned char *bytes, int &numWords)
+{
+    unsigned long long word;
+    int                i;
+
+    word = 0;
+    for (i = 0; i < 8; ++i) {
+        word |= (unsigned long long) bytes[8 * numWords + i] << (8 * i);
+    }
+    ++numWords;
+    return word;
+}
+
+
+inline long long GetInteger(const unsigned char *bytes, int &numWords)
+{
+    return (long long) GetWord(bytes, numWords);
+}
+
+
+inline double GetDouble(const unsigned char *bytes, int &numWords)
+{
+    unsigned long long word;
+    double             number;
+
+    word = GetWord(bytes, numWords);
+    memcpy(&number, &word, sizeof number);
+    return number;
+}
+
+
+void PutParameters(unsigned char *bytes, int &numWords, const BattleParameters &parameters)
+{
+    int i;
+
+    /* simulation settings */
+    PutWord(bytes, numWords, (long long) parameters.randomness);
+    PutWord(bytes, numWords, (long long) parameters.rngSeed);
+    PutWord(bytes, numWords, (long long) parameters.numTrials);
+    PutWord(bytes, numWords, (long long) parameters.commonRandomNumbers);
+    PutWord(bytes, numWords, (long long) parameters.antitheticTrials);
+    PutWord(bytes, numWords, (long long) parameters.quasiMonteCarlo);
+    PutWord(bytes, numWords, (long long) parameters.numRandomizations);
+    PutWord(bytes, numWords, (long long) parameters.enginePlanning);
+
+    /* combatants */
+    PutWord(bytes, numWords, (long long) parameters.attackerHP);
+    PutWord(bytes, numWords, (long long) parameters.defenderHP);
+    PutWord(bytes, numWords, (long long) parameters.attackerTransforms);
+    PutWord(bytes, numWords, (long long) parameters.defenderTransforms);
+
+    /* attacks */
+    PutWord(bytes, numWords, (long long) parameters.attackerFastAttackDamage);
+    PutWord(bytes, numWords, (long long) parameters.attackerFastAttackEnergy);
+    PutWord(bytes, numWords, (long long) parameters.attackerFastAttackDamageStart);
+    PutWord(bytes, numWords, (long long) parameters.attackerFastAttackDuration);
+    PutWord(bytes, numWords, (long long) parameters.attackerSpecialAttackDamage);
+    PutWord(bytes, numWords, (long long) parameters.attackerSpecialAttackEnergy);
+    PutWord(bytes, numWords, (long long) parameters.attackerSpecialAttackDamageStart);
+    PutWord(bytes, numWords, (long long) parameters.attackerSpecialAttackDuration);
+    PutWord(bytes, numWords, (long long) parameters.defenderFastAttackDamage);
+    PutWord(bytes, numWords, (long long) parameters.defenderFastAttackEnergy);
+    PutWord(bytes, numWords, (long long) parameters.defenderFastAttackDamageStart);
+    PutWord(bytes, numWords, (long long) parameters.defenderFastAttackDuration);
+    PutWord(bytes, numWords, (long long) parameters.defenderSpecialAttackDamage);
+    PutWord(bytes, numWords, (long long) parameters.defenderSpecialAttackEnergy);
+    PutWord(bytes, numWords, (long long) parameters.defenderSpecialAttackDamageStart);
+    PutWord(bytes, numWords, (long long) parameters.defenderSpecialAttackDuration);
+    PutWord(bytes, numWords, (long long) parameters.transformDamage);
+    PutWord(bytes, numWords, (long long) parameters.transformEnergy);
+    PutWord(bytes, numWords, (long long) parameters.transformDamageStart);
+    PutWord(bytes, numWords, (long long) parameters.transformDuration);
+
+    /* battle parameters */
+    PutWord(bytes, numWords, parameters.defensiveHPMultiplier);
+    PutWord(bytes, numWords, (long long) parameters.maxAttackerEnergy);
+    PutWord(bytes, numWords, (long long) parameters.maxDefenderEnergy);
+    PutWord(bytes, numWords, parameters.energyPerDamage);
+    PutWord(bytes, numWords, (long long) parameters.battleDuration);
+    PutWord(bytes, numWords, (long long) parameters.longPressDuration);
+    PutWord(bytes, numWords, (long long) parameters.offensiveInitialInterval);
+    PutWord(bytes, numWords, (long long) parameters.numDefensiveInitialIntervals);
+    for (i = 0; i < numDefensiveInitialIntervalInputs; ++i) {
+        PutWord(bytes, numWords, (long long) parameters.defensiveInitialIntervals[i]);
+    }
+    PutWord(bytes, numWords, (long long) parameters.defensiveInterval);
+    PutWord(bytes, numWords, (long long) parameters.defensiveIntervalRandomness);
+    PutWord(bytes, numWords, (long long) parameters.numDefensiveSpecialAttackDeferrals);
+    PutWord(bytes, numWords, parameters.defensiveSpecialAttackProbability);
+
+    /* combatant policies */
+    PutWord(bytes, numWords, (long long) parameters.attackerPolicy);
+    PutWord(bytes, numWords, (long long) parameters.defenderPolicy);
+}
+
+
+/* the checks CheckBattleInputs() makes on the local path, in the form ResolveBattleParameters() gives them */
+/* battles advance by attack durations and end when either HP or the battle timer runs out, so those must be positive */
+bool ParametersAreValid(const BattleParameters &parameters)
+{
+    int i;
+
+    if (parameters.numTrials <= 0 || (parameters.numTrials > 1 && !parameters.randomness)) return false;
+    if (!parameters.randomness && (parameters.commonRandomNumbers || parameters.antitheticTrials || parameters.quasiMonteCarlo)) return false;
+    if (parameters.antitheticTrials && (parameters.numTrials % 2 != 0 || parameters.quasiMonteCarlo)) return false;
+    if (parameters.quasiMonteCarlo) {
+        if (parameters.numRandomizations <= 0 || parameters.numTrials % parameters.numRandomizations != 0) return false;
+    } else if (parameters.numRandomizations != 1) {
+        return false;
+    }
+    if (parameters.attackerPolicy < 0 || parameters.attackerPolicy >= numAttackerPolicies || parameters.defenderPolicy < 0 ||
+        parameters.defenderPolicy >= numDefenderPolicies) return false;
+
+    if (parameters.attackerHP <= 0 || parameters.defenderHP <= 0 || !(parameters.defensiveHPMultiplier > 0.0)) return false;
+    if (parameters.attackerFastAttackDuration <= 0 || parameters.attackerSpecialAttackDuration <= 0 || parameters.defenderFastAttackDuration <= 0 ||
+        parameters.defenderSpecialAttackDuration <= 0) return false;
+    if ((parameters.attackerTransforms || parameters.defenderTransforms) && parameters.transformDuration <= 0) return false;
+    if (parameters.battleDuration <= 0) return false;
+
+    if (parameters.numDefensiveInitialIntervals != numDefensiveInitialIntervalInputs) return false;
+    for (i = 0; i < numDefensiveInitialIntervalInputs; ++i) {
+        if (parameters.defensiveInitialIntervals[i] < 0) return false;
+    }
+    return parameters.defensiveInterval >= 0 && parameters.defensiveIntervalRandomness >= 0;
+}
+
+
+/* returns false for parameters the engine cannot simulate */
+bool GetParameters(const unsigned char *bytes, int &numWords, BattleParameters &parameters)
+{
+    int i;
+
+    /* simulation settings */
+    parameters.randomness = GetInteger(bytes, numWords) != 0;
+    parameters.rngSeed = (int) GetInteger(bytes, numWords);
+    parameters.numTrials = (long) GetInteger(bytes, numWords);
+    parameters.commonRandomNumbers = GetInteger(bytes, numWords) != 0;
+    parameters.antitheticTrials = GetInteger(bytes, numWords) != 0;
+    parameters.quasiMonteCarlo = GetInteger(bytes, numWords) != 0;
+    parameters.numRandomizations = (long) GetInteger(bytes, numWords);
+    parameters.enginePlanning = GetInteger(bytes, numWords) != 0;
+
+    /* combatants */
+    parameters.attackerHP = (int) GetInteger(bytes, numWords);
+    parameters.defenderHP = (int) GetInteger(bytes, numWords);
+    parameters.attackerTransforms = GetInteger(bytes, numWords) != 0;
+    parameters.defenderTransforms = GetInteger(bytes, numWords) != 0;
+
+    /* attacks */
+    parameters.attackerFastAttackDamage = (int) GetInteger(bytes, numWords);
+    parameters.attackerFastAttackEnergy = (int) GetInteger(bytes, numWords);
+    parameters.attackerFastAttackDamageStart = (int) GetInteger(bytes, numWords);
+    parameters.attackerFastAttackDuration = (int) GetInteger(bytes, numWords);
+    parameters.attackerSpecialAttackDamage = (int) GetInteger(bytes, numWords);
+    parameters.attackerSpecialAttackEnergy = (int) GetInteger(bytes, numWords);
+    parameters.attackerSpecialAttackDamageStart = (int) GetInteger(bytes, numWords);
+    parameters.attackerSpecialAttackDuration = (int) GetInteger(bytes, numWords);
+    parameters.defenderFastAttackDamage = (int) GetInteger(bytes, numWords);
+    parameters.defenderFastAttackEnergy = (int) GetInteger(bytes, numWords);
+    parameters.defenderFastAttackDamageStart = (int) GetInteger(bytes, numWords);
+    parameters.defenderFastAttackDuration = (int) GetInteger(bytes, numWords);
+    parameters.defenderSpecialAttackDamage = (int) GetInteger(bytes, numWords);
+    parameters.defenderSpecialAttackEnergy = (int) GetInteger(bytes, numWords);
+    parameters.defenderSpecialAttackDamageStart = (int) GetInteger(bytes, numWords);
+    parameters.defenderSpecialAttackDuration = (int) GetInteger(bytes, numWords);
+    parameters.transformDamage = (int) GetInteger(bytes, numWords);
+    parameters.transformEnergy = (int) GetInteger(bytes, numWords);
+    parameters.transformDamageStart = (int) GetInteger(bytes, numWords);
+    parameters.transformDuration = (int) GetInteger(bytes, numWords);
+
+    /* battle parameters */
+    parameters.defensiveHPMultiplier = GetDouble(bytes, numWords);
+    parameters.maxAttackerEnergy = (int) GetInteger(bytes, numWords);
+    parameters.maxDefenderEnergy = (int) GetInteger(bytes, numWords);
+    parameters.energyPerDamage = GetDouble(bytes, numWords);
+    parameters.battleDuration = (int) GetInteger(bytes, numWords);
+    parameters.longPressDuration = (int) GetInteger(bytes, numWords);
+    parameters.offensiveInitialInterval = (int) GetInteger(bytes, numWords);
+    parameters.numDefensiveInitialIntervals = (int) GetInteger(bytes, numWords);
+    for (i = 0; i < numDefensiveInitialIntervalInputs; ++i) {
+        parameters.defensiveInitialIntervals[i] = (int) GetInteger(bytes, numWords);
+    }
+    parameters.defensiveInterval = (int) GetInteger(bytes, numWords);
+    parameters.defensiveIntervalRandomness = (int) GetInteger(bytes, numWords);
+    parameters.numDefensiveSpecialAttackDeferrals = (int) GetInteger(bytes, numWords);
+    parameters.defensiveSpecialAttackProbability = GetDouble(bytes, numWords);
+
+    /* combatant policies */
+    parameters.attackerPolicy = (int) GetInteger(bytes, numWords);
+    parameters.defenderPolicy = (int) GetInteger(bytes, numWords);
+    return ParametersAreValid(parameters);
+}
+
+
+void PutResult(unsigned char *bytes, int &numWords, const BattleResult &result)
+{
+    PutWord(bytes, numWords, (long long) result.numWins);
+    PutWord(bytes, numWords, (long long) result.numTrials);
+    PutWord(bytes, numWords, result.winProbability);
+    PutWord(bytes, numWords, result.standardError);
+    PutWord(bytes, numWords, (long long) result.engine);
+}
+
+
+void GetResult(const unsigned char *bytes, int &numWords, BattleResult &result)
+{
+    result.numWins = (long) GetInteger(bytes, numWords);
+    result.numTrials = (long) GetInteger(bytes, numWords);
+    result.winProbability = GetDouble(bytes, numWords);
+    result.standardError = GetDouble(bytes, numWords);
+    result.engine = (int) GetInteger(bytes, numWords);
+}
+
+
+void EncodeSimulateRequest(unsigned long long requestId, const BattleParameters &parameters, unsigned char bytes[simulateRequestSize])
+{
+    int numWords;
+
+    numWords = 0;
+    PutWord(bytes, numWords, MessageWord(SimulateRequestMessage));
+    PutWord(bytes, numWords, requestId);
+    PutParameters(bytes, numWords, parameters);
+    assert(numWords == 2 + numParameterWords);
+}
+
+
+/* returns false if the message is not a simulate request of this protocol version */
+bool DecodeSimulateRequest(const unsigned char bytes[simulateRequestSize], unsigned long long &requestId, BattleParameters &parameters)
+{
+    int numWords;
+
+    numWords = 0;
+    if (GetWord(bytes, numWords) != MessageWord(SimulateRequestMessage)) return false;
+    requestId = GetWord(bytes, numWords);
+    return GetParameters(bytes, numWords, parameters);
+}
+
+
+void EncodeSimulateReply(unsigned long long requestId, const BattleResult &result, unsigned char bytes[simulateReplySize])
+{
+    int numWords;
+
+    numWords = 0;
+    PutWord(bytes, numWords, MessageWord(SimulateReplyMessage));
+    PutWord(bytes, numWords, requestId);
+    PutResult(bytes, numWords, result);
+    assert(numWords == 2 + numResultWords);
+}
+
+
+/* returns false if the message is not a simulate reply of this protocol version */
+bool DecodeSimulateReply(const unsigned char bytes[simulateReplySize], unsigned long long &requestId, BattleResult &result)
+{
+    int numWords;
+
+    numWords = 0;
+    if (GetWord(bytes, numWords) != MessageWord(SimulateReplyMessage)) return false;
+    requestId = GetWord(bytes, numWords);
+    GetResult(bytes, numWords, result);
+    assert(numWords == 2 + numResultWords);
+    return true;
+}
+
+
+/* returns the type of a message from its first word, or 0 if it is from another protocol version */
+int MessageType(const unsigned char bytes[messageHeaderSize])
+{
+    unsigned long long word;
+    int                numWords;
+
+    numWords = 0;
+    word = GetWord(bytes, numWords);
+    if ((word >> 32) != workerProtocolVersion) return 0;
+    return (int) (word & 0xFFFFFFFF);
+}
+
+
+/* returns the number of matchups in a tile message from its first three words, or -1 if there are too many */
+long TileMatchups(const unsigned char bytes[tileHeaderSize])
+{
+    unsigned long long numMatchups;
+    int                numWords;
+
+    numWords = 2;
+    numMatchups = GetWord(bytes, numWords);
+    if (numMatchups > (unsigned long long) maxTileMatchups) return -1;
+    return (long) numMatchups;
+}
+
+
+void EncodeTileRequest(unsigned long long tileId, const std::vector<BattleParameters> &parameters, std::vector<unsigned char> &bytes)
+{
+    int numWords;
+
+    assert(parameters.size() <= (size_t) maxTileMatchups);
+    bytes.resize(TileRequestSize((long) parameters.size()));
+    numWords = 0;
+    PutWord(bytes.data(), numWords, MessageWord(TileRequestMessage));
+    PutWord(bytes.data(), numWords, tileId);
+    PutWord(bytes.data(), numWords, (unsigned long long) parameters.size());
+    for (auto &matchupParameters : parameters) {
+        PutParameters(bytes.data(), numWords, matchupParameters);
+    }
+}
+
+
+/* returns false if the message is not a tile request of this protocol version */
+bool DecodeTileRequest(const std::vector<unsigned char> &bytes, unsigned long long &tileId, std::vector<BattleParameters> &parameters)
+{
+    long numMatchups;
+    long i;
+    int  numWords;
+
+    if (bytes.size() < (size_t) tileHeaderSize || MessageType(bytes.data()) != TileRequestMessage) return false;
+    numMatchups = TileMatchups(bytes.data());
+    if (numMatchups < 0 || bytes.size() != TileRequestSize(numMatchups)) return false;
+
+    numWords = 1;
+    tileId = GetWord(bytes.data(), numWords);
+    ++numWords;
+    parameters.resize(numMatchups);
+    for (i = 0; i < numMatchups; ++i) {
+        if (!GetParameters(bytes.data(), numWords, parameters[i])) return false;
+    }
+    return true;
+}
+
+
+void EncodeTileReply(unsigned long long tileId, const std::vector<BattleResult> &results, std::vector<unsigned char> &bytes)
+{
+    int numWords;
+
+    assert(results.size() <= (size_t) maxTileMatchups);
+    bytes.resize(TileReplySize((long) results.size()));
+    numWords = 0;
+    PutWord(bytes.data(), numWords, MessageWord(TileReplyMessage));
+    PutWord(bytes.data(), numWords, tileId);
+    PutWord(bytes.data(), numWords, (unsigned long long) results.size());
+    for (auto &result : results) {
+        PutResult(bytes.data(), numWords, result);
+    }
+}
+
+
+/* returns false if the message is not a tile reply of this protocol version */
+bool DecodeTileReply(const std::vector<unsigned char> &bytes, unsigned long long &tileId, std::vector<BattleResult> &results)
+{
+    long numMatchups;
+    long i;
+    int  numWords;
+
+    if (bytes.size() < (size_t) tileHeaderSize || MessageType(bytes.data()) != TileReplyMessage) return false;
+    numMatchups = TileMatchups(bytes.data());
+    if (numMatchups < 0 || bytes.size() != TileReplySize(numMatchups)) return false;
+
+    numWords = 1;
+    tileId = GetWord(bytes.data(), numWords);
+    ++numWords;
+    results.resize(numMatchups);
+    for (i = 0; i < numMatchups; ++i) {
+        GetResult(bytes.data(), numWords, results[i]);
+    }
+    return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "BattleEngine.h"
+
+
+/* messages between clients and simulation workers are arrays of 64-bit little-endian words */
+/* the first word is the message type and protocol version, the second word is the request or tile id */
+/* tile messages have the number of matchups in the third word, followed by that many parameters or results */
+
+/* change whenever the message layout changes */
+const unsigned long long workerProtocolVersion = 4;
+
+
+enum WorkerMessageTypes {
+    SimulateRequestMessage = 1,
+    SimulateReplyMessage,
+    TileRequestMessage,
+    TileReplyMessage
+};
+
+
+/* number of words encoding the battle parameters and the battle result */
+const int numParameterWords = 49;
+const int numResultWords = 5;
+
+const int simulateRequestSize = 8 * (2 + numParameterWords);
+const int simulateReplySize = 8 * (2 + numResultWords);
+
+const int messageHeaderSize = 8 * 2;
+const int tileHeaderSize = 8 * 3;
+
+/* limits the memory a worker allocates for one tile */
+const long maxTileMatchups = 1 << 16;
+
+
+inline size_t TileRequestSize(long numMatchups)
+{
+    return tileHeaderSize + 8 * (size_t) numParameterWords * numMatchups;
+}
+
+
+inline size_t TileReplySize(long numMatchups)
+{
+    return tileHeaderSize + 8 * (size_t) numResultWords * numMatchups;
+}
+
+
+void EncodeSimulateRequest (unsigned long long requestId, const BattleParameters &parameters, unsigned char bytes[simulateRequestSize]);
+
+bool DecodeSimulateRequest (const unsigned char bytes[simulateRequestSize], unsigned long long &requestId, BattleParameters &parameters);
+
+void EncodeSimulateReply   (unsigned long long requestId, const BattleResult &result, unsigned char bytes[simulateReplySize]);
+
+bool DecodeSimulateReply   (const unsigned char bytes[simulateReplySize], unsigned long long &requestId, BattleResult &result);
+
+int  MessageType           (const unsigned char bytes[messageHeaderSize]);
+
+long TileMatchups          (const unsigned char bytes[tileHeaderSize]);
+
+void EncodeTileRequest     (unsigned long long tileId, const std::vector<BattleParameters> &parameters, std::vector<unsigned char> &bytes);
+
+bool DecodeTileRequest     (const std::vector<unsigned char> &bytes, unsigned long long &tileId, std::vector<BattleParameters> &parameters);
+
+void EncodeTileReply       (unsigned long long tileId, const std::vector<BattleResult> &results, std::vector<unsigned char> &bytes);
+
+bool DecodeTileReply       (const std::vector<unsigned char> &bytes, unsigned long long &tileId, std::vector<BattleResult> &results);
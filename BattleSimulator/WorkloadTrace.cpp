@@ -0,0 +1,271 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BattleResolver.h"
+#include "Checkpoint.h"
+#include "GameData.h"
+
+#include "WorkloadTrace.h"
+
+
+/* "BSTRACE\0" */
+const unsigned long long traceMagic = 0x0045434152545342ULL;
+
+enum TraceRecordTypes {
+    GameTablesRecord = 1,
+    InputsRecord,
+    CallRecord
+};
+
+/* largest game data file text, far beyond any workbook */
+const unsigned long long maxGameTablesBytes = 1ULL << 30;
+
+const char *tracedNames[numTracedFunctions] = {
+    "Battle",
+    "BattleStandardError",
+    "MatchupEngine",
+    "BattleAsync"
+};
+
+
+inline void PutWord(std::vector<unsigned char> &bytes, unsigned long long word)
+{
+    int i;
+
+    for (i = 0; i < 8; ++i) {
+        bytes.push_back((unsigned char) (word >> (8 * i)));
+    }
+}
+
+
+inline void PutWord(std::vector<unsigned char> &bytes, double number)
+{
+    unsigned long long word;
+
+    memcpy(&word, &number, sizeof word);
+    PutWord(bytes, word);
+}
+
+
+/* returns false at the end of the file */
+inline bool GetWord(FILE *file, unsigned long long &word)
+{
+    unsigned char bytes[8];
+    int           i;
+
+    if (fread(bytes, 1, sizeof bytes, file) != sizeof bytes) return false;
+    word = 0;
+    for (i = 0; i < 8; ++i) {
+        word |= (unsigned long long) bytes[i] << (8 * i);
+    }
+    return true;
+}
+
+
+inline double WordDouble(unsigned long long word)
+{
+    double number;
+
+    memcpy(&number, &word, sizeof number);
+    return number;
+}
+
+
+unsigned long long HashBattleInputs(const BattleInputs &inputs)
+{
+    JobHash inputsHash;
+
+    inputsHash.Add(inputs.values, sizeof inputs.values);
+    return inputsHash.Value();
+}
+
+
+const char *TracedName(int function)
+{
+    return (function >= 0 && function < numTracedFunctions) ? tracedNames[function] : "";
+}
+
+
+/* read a game tables record after its type */
+bool ReadGameTables(FILE *file, GameData &gameData)
+{
+    std::map<std::string, std::string> inputStrs;
+    std::string                        text;
+    unsigned long long                 numBytes;
+
+    if (!GetWord(file, numBytes) || numBytes > maxGameTablesBytes) return false;
+    text.resize((size_t) ((numBytes + 7) / 8 * 8));
+    if (fread(&text[0], 1, text.size(), file) != text.size()) return false;
+    text.resize((size_t) numBytes);
+
+    std::istringstream stream(text);
+
+    return ReadGameData(stream, gameData, inputStrs);
+}
+
+
+/* returns false if the file is not a trace, a record cut short at the end is dropped */
+bool ReadTrace(const char *fileName, WorkloadTrace &trace, std::string &error)
+{
+    FILE               *file;
+    unsigned long long words[6], type, hash;
+    BattleInputs       inputs;
+    TraceCall          call;
+    int                i;
+
+    trace.snapshots.clear();
+    trace.inputs.clear();
+    trace.calls.clear();
+    file = fopen(fileName, "rb");
+    if (!file) {
+        error = std::string("Opening ") + fileName + " failed.";
+        return false;
+    }
+    if (!GetWord(file, words[0]) || !GetWord(file, words[1]) || words[0] != traceMagic || words[1] != traceVersion) {
+        fclose(file);
+        error = std::string(fileName) + " is not a trace of this version.";
+        return false;
+    }
+
+    while (GetWord(file, type)) {
+        if (type == GameTablesRecord) {
+            trace.snapshots.emplace_back();
+            if (!ReadGameTables(file, trace.snapshots.back())) {
+                trace.snapshots.pop_back();
+                break;
+            }
+        } else if (type == InputsRecord) {
+            if (!GetWord(file, hash)) break;
+            for (i = 0; i < numBattleInputs; ++i) {
+                if (!GetWord(file, words[0])) break;
+                inputs.values[i] = WordDouble(words[0]);
+            }
+            if (i < numBattleInputs) break;
+            trace.inputs[hash] = inputs;
+        } else if (type == CallRecord) {
+            for (i = 0; i < 6; ++i) {
+                if (!GetWord(file, words[i])) break;
+            }
+            if (i < 6) break;
+            call.function = (int) words[0];
+            call.attackerMoveSetNum = (long) words[1];
+            call.defenderMoveSetNum = (long) words[2];
+            call.inputsHash = words[3];
+            call.result = WordDouble(words[4]);
+            call.seconds = WordDouble(words[5]);
+            call.snapshotNum = (long) trace.snapshots.size() - 1;
+            /* calls are always written after the tables and inputs they used */
+            if (call.function < 0 || call.function >= numTracedFunctions || call.snapshotNum < 0 || !trace.inputs.count(call.inputsHash)) {
+                fclose(file);
+                error = std::string(fileName) + " has an invalid call record.";
+                return false;
+            }
+            trace.calls.push_back(call);
+        } else {
+            fclose(file);
+            error = std::string(fileName) + " has an unknown record type.";
+            return false;
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+
+TraceWriter::TraceWriter(void)
+{
+    file = nullptr;
+    open = false;
+}
+
+
+TraceWriter::~TraceWriter(void)
+{
+    Close();
+}
+
+
+/* start a new trace, replacing any file of the same name */
+bool TraceWriter::Open(const char *fileName)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<unsigned char>  header;
+
+    if (open) return false;
+    PutWord(header, traceMagic);
+    PutWord(header, traceVersion);
+    file = fopen(fileName, "wb");
+    if (!file) return false;
+    if (fwrite(header.data(), 1, header.size(), file) != header.size()) {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+    snapshotWritten = false;
+    writtenInputs.clear();
+    open = true;
+    return true;
+}
+
+
+bool TraceWriter::IsOpen(void)
+{
+    return open;
+}
+
+
+/* append a call, preceded by the game tables if they changed and by its inputs if they are new */
+void TraceWriter::Record(const TraceCall &call, const BattleInputs &inputs, const GameData &gameData, unsigned long gameDataGeneration)
+{
+    std::lock_guard<std::mutex>        guard(lock);
+    std::vector<unsigned char>         bytes;
+    std::ostringstream                 stream;
+    std::map<std::string, std::string> inputStrs;
+    std::string                        text;
+    int                                i;
+
+    if (!open) return;
+    if (!snapshotWritten || gameDataGeneration != snapshotGeneration) {
+        FormatBattleInputs(inputs, inputStrs);
+        WriteGameData(stream, gameData, inputStrs);
+        text = stream.str();
+        text.resize((text.size() + 7) / 8 * 8, '\0');
+        PutWord(bytes, (unsigned long long) GameTablesRecord);
+        PutWord(bytes, (unsigned long long) stream.str().size());
+        bytes.insert(bytes.end(), text.begin(), text.end());
+        snapshotWritten = true;
+        snapshotGeneration = gameDataGeneration;
+    }
+    if (writtenInputs.insert(call.inputsHash).second) {
+        PutWord(bytes, (unsigned long long) InputsRecord);
+        PutWord(bytes, call.inputsHash);
+        for (i = 0; i < numBattleInputs; ++i) {
+            PutWord(bytes, inputs.values[i]);
+        }
+    }
+    PutWord(bytes, (unsigned long long) CallRecord);
+    PutWord(bytes, (unsigned long long) call.function);
+    PutWord(bytes, (unsigned long long) call.attackerMoveSetNum);
+    PutWord(bytes, (unsigned long long) call.defenderMoveSetNum);
+    PutWord(bytes, call.inputsHash);
+    PutWord(bytes, call.result);
+    PutWord(bytes, call.seconds);
+    (void) fwrite(bytes.data(), 1, bytes.size(), file);
+}
+
+
+void TraceWriter::Close(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (!open) return;
+    open = false;
+    fclose(file);
+    file = nullptr;
+}
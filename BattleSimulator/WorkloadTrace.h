@@ -0,0 +1,89 @@
+#pragma once
+
+
+#include <stdio.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "BattleResolver.h"
+#include "GameData.h"
+
+
+/* traces are arrays of 64-bit little-endian words: */
+/*     header: magic, version */
+/*     records, each starting with its type: */
+/*         game tables: number of bytes, the game data file text padded to whole words */
+/*         inputs: hash, one word per input */
+/*         call: function, attacker move set num, defender move set num, inputs hash, result, seconds */
+/* calls use the last game tables before them and the inputs with their hash, each written once */
+
+/* change whenever the file layout changes */
+const unsigned long long traceVersion = 1;
+
+
+/* functions recorded in a trace, all return one number for one matchup */
+enum TracedFunctions {
+    BattleFunction,
+    BattleStandardErrorFunction,
+    MatchupEngineFunction,
+    BattleAsyncFunction,
+    numTracedFunctions
+};
+
+
+/* one recorded function call and the value it returned */
+/* the snapshot number counts the game tables before the call and is only set when reading */
+struct TraceCall {
+    int                function;
+    long               attackerMoveSetNum, defenderMoveSetNum;
+    unsigned long long inputsHash;
+    double             result;
+    double             seconds;
+    long               snapshotNum;
+};
+
+
+/* everything read back from a trace */
+struct WorkloadTrace {
+    std::vector<GameData>                                snapshots;
+    std::unordered_map<unsigned long long, BattleInputs> inputs;
+    std::vector<TraceCall>                               calls;
+};
+
+
+unsigned long long HashBattleInputs (const BattleInputs &inputs);
+
+bool               ReadTrace        (const char *fileName, WorkloadTrace &trace, std::string &error);
+
+const char         *TracedName      (int function);
+
+
+/* file the workbook's function calls are recorded to while capturing, shared by every calculation thread */
+/* the game tables are written again whenever their generation changes */
+class TraceWriter {
+public:
+                  TraceWriter  (void);
+
+                  ~TraceWriter (void);
+
+    bool          Open         (const char *fileName);
+
+    bool          IsOpen       (void);
+
+    void          Record       (const TraceCall &call, const BattleInputs &inputs, const GameData &gameData, unsigned long gameDataGeneration);
+
+    void          Close        (void);
+
+private:
+    FILE                                   *file;
+    std::atomic<bool>                      open;
+    bool                                   snapshotWritten;
+    unsigned long                          snapshotGeneration;
+    std::unordered_set<unsigned long long> writtenInputs;
+    std::mutex                             lock;
+};
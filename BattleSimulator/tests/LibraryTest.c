@@ -0,0 +1,69 @@
+/* evaluates one matchup of the test game data through the C interface of libbattlesim */
+/* usage: LibraryTest <game data file>, returns 0 if the result is sound and the second evaluation comes from the cache */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BattleSimAPI.h"
+
+
+/* Ditto versus Charmander, which each win about half of the trials */
+const int64_t testAttackerMoveSetNum = 132242000;
+const int64_t testDefenderMoveSetNum = 4209010;
+
+
+int Fail(const char *step, int status)
+{
+    fprintf(stderr, "%s: %s\n", step, BattleSimStatusMessage(status));
+    return EXIT_FAILURE;
+}
+
+
+int main(int argc, char *argv[])
+{
+    BattleSimGameData *gameData;
+    BattleSimContext  *context;
+    BattleSimMatchup  matchup;
+    BattleSimResult   result, cachedResult;
+    double            numTrials;
+    int64_t           numHits, numMisses;
+    int               status;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: LibraryTest <game data file>\n");
+        return EXIT_FAILURE;
+    }
+    if (BattleSimApiVersion() != BATTLESIM_API_VERSION) return Fail("BattleSimApiVersion", BattleSimInternalError);
+    status = BattleSimLoadGameDataFile(argv[1], &gameData);
+    if (status != BattleSimOK) return Fail("BattleSimLoadGameDataFile", status);
+    status = BattleSimCreateContext(gameData, &context);
+    BattleSimFreeGameData(gameData);
+    if (status != BattleSimOK) return Fail("BattleSimCreateContext", status);
+
+    /* negative levels and IVs keep the inputs of the game data */
+    matchup.attackerMoveSetNum = testAttackerMoveSetNum;
+    matchup.defenderMoveSetNum = testDefenderMoveSetNum;
+    matchup.attackerLevel = matchup.attackerStaminaIV = matchup.attackerAttackIV = matchup.attackerDefenseIV = -1.0;
+    matchup.defenderLevel = matchup.defenderStaminaIV = matchup.defenderAttackIV = matchup.defenderDefenseIV = -1.0;
+    status = BattleSimEvaluate(context, &matchup, 1, &result, 1);
+    if (status == BattleSimOK) status = BattleSimEvaluate(context, &matchup, 1, &cachedResult, 1);
+    if (status == BattleSimOK) status = BattleSimGetInput(context, "NumMonteCarloTrials", &numTrials);
+    BattleSimCacheCounts(context, &numHits, &numMisses);
+    BattleSimFreeContext(context);
+    if (status != BattleSimOK) return Fail("BattleSimEvaluate", status);
+    if (result.status != BattleSimOK) return Fail("matchup", result.status);
+
+    printf("win probability %.4f, standard error %.4f, %lld of %lld trials won\n", result.winProbability, result.standardError,
+           (long long) result.numWins, (long long) result.numTrials);
+    if (result.numTrials != (int64_t) numTrials || result.numWins <= 0 || result.numWins >= result.numTrials ||
+        result.winProbability != (double) result.numWins / result.numTrials || !(result.standardError > 0.0)) {
+        fprintf(stderr, "The result is not a Monte Carlo result of a close matchup.\n");
+        return EXIT_FAILURE;
+    }
+    if (memcmp(&result, &cachedResult, sizeof result) != 0 || numHits != 1 || numMisses != 1) {
+        fprintf(stderr, "The second evaluation was not the cached result.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,41 @@
+# evaluates one matchup of the test game data through the battlesim module, with arrays from the standard library
+# usage: python PythonTest.py <game data file>, with the module on PYTHONPATH, exits with 1 if a check fails
+
+import array
+import sys
+
+import battlesim
+
+
+# Ditto versus Charmander, which each win about half of the trials
+TEST_ATTACKER_MOVE_SET_NUM = 132242000
+TEST_DEFENDER_MOVE_SET_NUM = 4209010
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit('usage: python PythonTest.py <game data file>')
+    context = battlesim.Context(sys.argv[1])
+    attackers = array.array('q', [TEST_ATTACKER_MOVE_SET_NUM])
+    defenders = array.array('q', [TEST_DEFENDER_MOVE_SET_NUM])
+    num_wins = array.array('q', [0])
+    num_trials = array.array('q', [0])
+    win_probability = array.array('d', [0.0])
+    status = array.array('i', [-1])
+    context.evaluate(attackers, defenders, num_wins=num_wins, num_trials=num_trials, win_probability=win_probability, status=status,
+                     threads=1)
+    print('win probability %.4f, %d of %d trials won' % (win_probability[0], num_wins[0], num_trials[0]))
+    if status[0] != 0 or num_trials[0] != context.get_input('NumMonteCarloTrials') or not 0 < num_wins[0] < num_trials[0] or \
+            win_probability[0] != num_wins[0] / num_trials[0]:
+        sys.exit('The result is not a Monte Carlo result of a close matchup.')
+
+    # a context is initialized once, since another thread may be evaluating with it
+    try:
+        context.__init__(sys.argv[1])
+    except battlesim.Error:
+        pass
+    else:
+        sys.exit('Initializing the context again did not fail.')
+
+
+main()